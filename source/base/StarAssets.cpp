@@ -16,13 +16,18 @@
 #include "StarAudio.hpp"
 #include "StarCasting.hpp"
 #include "StarLexicalCast.hpp"
+#include "StarMemoryTracker.hpp"
 #include "StarSha256.hpp"
+#include "StarXXHash.hpp"
 #include "StarDataStreamDevices.hpp"
+#include "StarDataStreamExtra.hpp"
 #include "StarLua.hpp"
 #include "StarImageLuaBindings.hpp"
 #include "StarUtilityLuaBindings.hpp"
 
 namespace Star {
+
+static MemoryTracker::Tag const AssetsMemoryTag = MemoryTracker::tag("assets");
     
 static void validateBasePath(std::string_view const& basePath) {
   if (basePath.empty() || basePath[0] != '/')
@@ -110,78 +115,157 @@ Json FramesSpecification::toJson() const {
   };
 }
 
-Assets::Assets(Settings settings, StringList assetSources) {
-  const char* AssetsPatchSuffix = ".patch";
-  const char* AssetsPatchListSuffix = ".patchlist";
-  const char* AssetsLuaPatchSuffix = ".patch.lua";
+// The part of a processed image key that describes the operations applied.
+// Equivalent chains of directives should produce the same key, so the pairs
+// of a color replacement, which apply all at once, are printed in a fixed
+// order, and consecutive replacements are merged when neither can replace a
+// color the other produces.  Other operations do not commute in general, and
+// are printed as they are.
+static String processedImageOperationsKey(List<ImageOperation const*> const& operations) {
+  String key;
+  Maybe<ColorReplaceMap> replacements;
+  auto flushReplacements = [&]() {
+    if (!replacements)
+      return;
+    auto pairs = take(replacements)->pairs();
+    sort(pairs);
+    key.append("?replace");
+    for (auto const& pair : pairs)
+      key.append(strf(";{}={}", Color::rgba(pair.first).toHex(), Color::rgba(pair.second).toHex()));
+  };
 
-  m_settings = std::move(settings);
-  m_stopThreads = false;
-  m_assetSources = std::move(assetSources);
+  for (auto operation : operations) {
+    if (auto replace = operation->ptr<ColorReplaceImageOperation>()) {
+      bool independent = replacements.isValid();
+      if (independent) {
+        auto produced = replacements->values();
+        for (auto const& pair : replace->colorReplaceMap) {
+          if (replacements->contains(pair.first) || produced.contains(pair.first)) {
+            independent = false;
+            break;
+          }
+        }
+      }
+      if (independent) {
+        for (auto const& pair : replace->colorReplaceMap)
+          replacements->add(pair.first, pair.second);
+      } else {
+        flushReplacements();
+        replacements = replace->colorReplaceMap;
+      }
+    } else {
+      flushReplacements();
+      key.append('?');
+      key.append(imageOperationToString(*operation));
+    }
+  }
+  flushReplacements();
+  return key;
+}
+
+static char const* const PersistentCacheIdentifier = "Assets Cache";
+static unsigned const PersistentCacheVersion = 1;
+
+// A single entry of a compiled patch array, exactly one member is set.
+struct Assets::PatchStep {
+  Maybe<JsonPatching::CompiledOperation> operation;
+  Maybe<List<PatchStep>> nested;
+  // Path to an asset that must load for the rest of the patch to apply.
+  Maybe<String> external;
+  // Compile errors are deferred so that they fail at the same point in the
+  // patch as they would if the operations were applied directly.
+  Maybe<JsonPatchException> error;
+};
+
+struct Assets::PatchPlan {
+  // Set for json merge patches
+  Maybe<JsonObject> merge;
+  // Set for operation array patches
+  Maybe<List<PatchStep>> steps;
+};
+
+List<Assets::PatchStep> Assets::compilePatchSteps(JsonArray const& patchData) {
+  List<PatchStep> steps;
+  steps.reserve(patchData.size());
+  for (auto const& patch : patchData) {
+    PatchStep step;
+    switch (patch.type()) {
+      case Json::Type::Array: // if the patch is an array, go down recursively until we get objects
+        step.nested = compilePatchSteps(patch.toArray());
+        break;
+      case Json::Type::Object:
+        try {
+          step.operation.emplace(patch);
+        } catch (JsonPatchException const& e) {
+          step.error = e;
+        }
+        break;
+      case Json::Type::String: // an external file is needed for patches to reference
+        step.external = patch.toString();
+        break;
+      default:
+        step.error = JsonPatchException(strf("Patch data is wrong type: {}", Json::typeName(patch.type())));
+        break;
+    }
+    steps.append(std::move(step));
+  }
+  return steps;
+}
 
+bool Assets::hasExternalSteps(List<PatchStep> const& steps) {
+  for (auto const& step : steps) {
+    if (step.external || (step.nested && hasExternalSteps(*step.nested)))
+      return true;
+  }
+  return false;
+}
+
+struct Assets::LuaPatchState {
+  LuaEnginePtr engine;
+  StringMap<LuaContextPtr> contexts;
+  // Patches applied since the engine last collected garbage.
+  unsigned uses = 0;
+};
+
+// Patches a pooled Lua engine applies between garbage collections.
+static unsigned const LuaPatchStateCollectInterval = 64;
+
+static LuaEnginePtr makeAssetsLuaEngine(LuaCallbacks const& assetCallbacks) {
   auto luaEngine = LuaEngine::create();
-  m_luaEngine = luaEngine;
-  auto pushGlobalContext = [&luaEngine](String const& name, LuaCallbacks && callbacks) {
+  auto pushGlobalContext = [&luaEngine](String const& name, LuaCallbacks const& callbacks) {
     auto table = luaEngine->createTable();
     for (auto const& p : callbacks.callbacks())
       table.set(p.first, luaEngine->createWrappedFunction(p.second));
     luaEngine->setGlobal(name, table);
   };
 
-  auto makeBaseAssetCallbacks = [this]() {
-    LuaCallbacks callbacks;
-    callbacks.registerCallbackWithSignature<StringSet, String>("byExtension", bind(&Assets::scanExtension, this, _1));
-    callbacks.registerCallbackWithSignature<Json, String>("json", bind(&Assets::json, this, _1));
-    callbacks.registerCallbackWithSignature<bool, String>("exists", bind(&Assets::assetExists, this, _1));
-
-    callbacks.registerCallback("sourcePaths", [this](LuaEngine& engine, Maybe<bool> withMetaData) -> LuaTable {
-      auto assetSources = this->assetSources();
-      auto table = engine.createTable(assetSources.size(), 0);
-      if (withMetaData.value()) {
-        for (auto& assetSource : assetSources)
-          table.set(assetSource, this->assetSourceMetadata(assetSource));
-      }
-      else {
-        size_t i = 0;
-        for (auto& assetSource : assetSources)
-          table.set(++i, assetSource);
-      }
-      return table;
-    });
-    
-    callbacks.registerCallback("origin", [this](String const& path) -> Maybe<String> {
-      if (auto descriptor = this->assetDescriptor(path))
-        return this->assetSourcePath(descriptor->source);
-      return {};
-    });
-    
-    callbacks.registerCallback("bytes", [this](String const& path) -> String {
-      auto assetBytes = bytes(path);
-      return String(assetBytes->ptr(), assetBytes->size());
-    });
-
-    callbacks.registerCallback("image", [this](String const& path) -> Image {
-      auto assetImage = image(path);
-      if (assetImage->bytesPerPixel() == 3)
-        return assetImage->convert(PixelFormat::RGBA32);
-      else
-        return *assetImage;
-    });
+  pushGlobalContext("sb", LuaBindings::makeUtilityCallbacks());
+  pushGlobalContext("assets", assetCallbacks);
+  return luaEngine;
+}
 
-    callbacks.registerCallback("frames", [this](String const& path) -> Json {
-      if (auto frames = imageFrames(path))
-        return frames->toJson();
-      return Json();
-    });
+Assets::Assets(Settings settings, StringList assetSources) {
+  const char* AssetsPatchSuffix = ".patch";
+  const char* AssetsPatchListSuffix = ".patchlist";
+  const char* AssetsLuaPatchSuffix = ".patch.lua";
 
-    callbacks.registerCallback("scan", [this](Maybe<String> const& a, Maybe<String> const& b) -> StringList {
-      return b ? scan(a.value(), *b) : scan(a.value());
-    });
-    return callbacks;
-  };
+  m_settings = std::move(settings);
+  m_patchPlans.setTimeToLive(m_settings.assetTimeToLive * 1000);
+  m_stopThreads = false;
+  m_fastHits = 0;
+  m_slowRequests = 0;
+  m_coalescedWaits = 0;
+  m_lockContentions = 0;
+  m_lockWaitMicroseconds = 0;
+  m_workerJobs = 0;
+  m_queuedCount = 0;
+  Audio::setDecodedCacheSize(m_settings.audioDecodedCacheSize);
+  m_persistentCacheEnabled = false;
+  m_persistentCacheChanged = false;
+  m_processedImagesSize = 0;
+  m_assetSources = std::move(assetSources);
 
-  pushGlobalContext("sb", LuaBindings::makeUtilityCallbacks());
-  pushGlobalContext("assets", makeBaseAssetCallbacks());
+  auto luaEngine = makeAssetsLuaEngine(makeBaseAssetCallbacks());
 
   auto decorateLuaContext = [&](LuaContext& context, MemoryAssetSourcePtr newFiles) {
     if (newFiles) {
@@ -232,6 +316,17 @@ Assets::Assets(Settings settings, StringList assetSources) {
     m_assetSourcePaths.add(sourcePath, source);
 
     for (auto const& filename : source->assetPaths()) {
+      if (filename == ImageMetadataIndex::IndexPath) {
+        if (as<PackedAssetSource>(source)) {
+          try {
+            m_imageMetadataIndexes[source] = make_shared<ImageMetadataIndex>(source);
+          } catch (StarException const& e) {
+            Logger::warn("Ignoring image metadata index of asset source '{}': {}", sourcePath, outputException(e, false));
+          }
+        }
+        continue;
+      }
+
       if (filename.contains(AssetsPatchSuffix, String::CaseInsensitive)) {
         if (filename.endsWith(AssetsPatchSuffix, String::CaseInsensitive)) {
           auto targetPatchFile = filename.substr(0, filename.size() - strlen(AssetsPatchSuffix));
@@ -304,6 +399,7 @@ Assets::Assets(Settings settings, StringList assetSources) {
     // clear any caching that may have been trigered by load scripts as they may no longer be valid
     m_framesSpecifications.clear();
     m_assetsCache.clear();
+    clearLoaded();
   };
 
   List<pair<String, AssetSourcePtr>> sources;
@@ -350,6 +446,8 @@ Assets::Assets(Settings settings, StringList assetSources) {
 
   m_digest = digest.compute();
 
+  loadPersistentCache();
+
   int workerPoolSize = m_settings.workerPoolSize;
   for (int i = 0; i < workerPoolSize; i++)
     m_workerThreads.append(Thread::invoke("Assets::workerMain", mem_fn(&Assets::workerMain), this));
@@ -381,13 +479,25 @@ Assets::~Assets() {
 
   // Join them all
   m_workerThreads.clear();
+
+  savePersistentCache();
 }
 
 void Assets::hotReload() const {
   MutexLocker assetsLocker(m_assetsMutex);
   m_assetsCache.clear();
+  clearLoaded();
   m_queue.clear();
+  m_pendingLoads.clear();
+  m_pendingPostProcesses.clear();
+  m_queuedCount = 0;
   m_framesSpecifications.clear();
+  MutexLocker plansLocker(m_patchPlansMutex);
+  m_patchPlans.clear();
+  MutexLocker processedLocker(m_processedImagesMutex);
+  m_processedImages.clear();
+  m_processedImagesSize = 0;
+  m_processedImageContents.clear();
 }
 
 StringList Assets::assetSources() const {
@@ -400,6 +510,18 @@ JsonObject Assets::assetSourceMetadata(String const& sourceName) const {
   return m_assetSourcePaths.getRight(sourceName)->metadata();
 }
 
+Assets::Metrics Assets::metrics() const {
+  Metrics metrics;
+  metrics.fastHits = m_fastHits;
+  metrics.slowRequests = m_slowRequests;
+  metrics.coalescedWaits = m_coalescedWaits;
+  metrics.lockContentions = m_lockContentions;
+  metrics.lockWaitTime = m_lockWaitMicroseconds / 1000000.0;
+  metrics.workerJobs = m_workerJobs;
+  metrics.queued = m_queuedCount;
+  return metrics;
+}
+
 ByteArray Assets::digest() const {
   MutexLocker assetsLocker(m_assetsMutex);
   return m_digest;
@@ -469,6 +591,28 @@ CaseInsensitiveStringSet const& Assets::scanExtension(String const& extension) c
   return find != m_filesByExtension.end() ? find->second : NullExtensionScan;
 }
 
+Maybe<ImageMetadataIndex::Entry> Assets::imageMetadata(String const& path) const {
+  auto p = m_files.ptr(path);
+  if (!p || !p->patchSources.empty())
+    return {};
+  if (auto index = m_imageMetadataIndexes.value(p->source)) {
+    if (auto entry = index->entry(p->sourceName))
+      return *entry;
+  }
+  return {};
+}
+
+Maybe<ImageMetadataIndex::AlphaMask> Assets::imageAlphaMask(String const& path) const {
+  auto p = m_files.ptr(path);
+  if (!p || !p->patchSources.empty())
+    return {};
+  if (auto index = m_imageMetadataIndexes.value(p->source)) {
+    if (auto entry = index->entry(p->sourceName))
+      return index->alphaMask(*entry);
+  }
+  return {};
+}
+
 Json Assets::json(String const& path) const {
   auto components = AssetPath::split(path);
   validatePath(components, true, false);
@@ -604,9 +748,20 @@ void Assets::clearCache() {
   while (it.hasNext()) {
     auto const& pair = it.next();
     // Don't clean up queued, persistent, or broken assets.
-    if (pair.second && !pair.second->shouldPersist() && !m_queue.contains(pair.first))
+    if (pair.second && !pair.second->shouldPersist() && !m_queue.contains(pair.first)) {
+      setLoaded(pair.first, {});
       it.remove();
+    }
   }
+
+  {
+    MutexLocker processedLocker(m_processedImagesMutex);
+    eraseWhere(m_processedImageContents, [](auto const& p) { return p.second.expired(); });
+  }
+
+  // The interner has its own lock, so loads are not held up by its sweep.
+  assetsLocker.unlock();
+  m_jsonInterner.cleanup();
 }
 
 void Assets::cleanup() {
@@ -622,13 +777,27 @@ void Assets::cleanup() {
       double liveTime = time - pair.second->time;
       if (liveTime > m_settings.assetTimeToLive) {
         // If the asset should persist, just refresh the access time.
-        if (pair.second->shouldPersist())
+        if (pair.second->shouldPersist()) {
           pair.second->time = time;
-        else
+        } else {
+          setLoaded(pair.first, {});
           it.remove();
+        }
       }
     }
   }
+
+  {
+    MutexLocker processedLocker(m_processedImagesMutex);
+    eraseWhere(m_processedImageContents, [](auto const& p) { return p.second.expired(); });
+  }
+
+  // The interner has its own lock, so loads are not held up by its sweep.
+  assetsLocker.unlock();
+  m_jsonInterner.cleanup();
+
+  MutexLocker plansLocker(m_patchPlansMutex);
+  m_patchPlans.cleanup();
 }
 
 bool Assets::AssetId::operator==(AssetId const& assetId) const {
@@ -753,7 +922,8 @@ FramesSpecification Assets::parseFramesSpecification(Json const& frameConfig, St
 }
 
 void Assets::queueAssets(List<AssetId> const& assetIds) const {
-  MutexLocker assetsLocker(m_assetsMutex);
+  MutexLocker assetsLocker(m_assetsMutex, false);
+  lockAssets(assetsLocker);
 
   for (auto const& id : assetIds)
     queueAsset(id);
@@ -765,16 +935,23 @@ void Assets::queueAsset(AssetId const& assetId) const {
     if (i->second)
       freshen(i->second);
   } else {
-    auto j = m_queue.find(assetId);
-    if (j == m_queue.end()) {
-      m_queue[assetId] = QueuePriority::Load;
+    if (!m_queue.contains(assetId)) {
+      setQueuePriority(assetId, QueuePriority::Load);
       m_assetsQueued.signal();
     }
   }
 }
 
 shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id) const {
-  MutexLocker assetsLocker(m_assetsMutex);
+  if (auto asset = findLoaded(id)) {
+    ++m_fastHits;
+    freshen(asset);
+    return asset;
+  }
+
+  ++m_slowRequests;
+  MutexLocker assetsLocker(m_assetsMutex, false);
+  lockAssets(assetsLocker);
 
   auto i = m_assetsCache.find(id);
   if (i != m_assetsCache.end()) {
@@ -785,9 +962,8 @@ shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id) const {
       throw AssetException::format("Error loading asset {}", id.path);
     }
   } else {
-    auto j = m_queue.find(id);
-    if (j == m_queue.end()) {
-      m_queue[id] = QueuePriority::Load;
+    if (!m_queue.contains(id)) {
+      setQueuePriority(id, QueuePriority::Load);
       m_assetsQueued.signal();
     }
     return {};
@@ -795,7 +971,15 @@ shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id) const {
 }
 
 shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id) const {
-  MutexLocker assetsLocker(m_assetsMutex);
+  if (auto asset = findLoaded(id)) {
+    ++m_fastHits;
+    freshen(asset);
+    return asset;
+  }
+
+  ++m_slowRequests;
+  MutexLocker assetsLocker(m_assetsMutex, false);
+  lockAssets(assetsLocker);
 
   while (true) {
     auto j = m_assetsCache.find(id);
@@ -809,9 +993,14 @@ shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id) const {
       }
     } else {
       // Try to load the asset in-thread, if we cannot, then the asset has been
-      // queued so wait for a worker thread to finish it.
-      if (!doLoad(id))
+      // queued so wait for a worker thread to finish it.  If another thread is
+      // already working on this exact asset, this wait is what keeps it from
+      // being loaded twice.
+      if (!doLoad(id)) {
+        if (m_queue.value(id, QueuePriority::None) == QueuePriority::Working)
+          ++m_coalescedWaits;
         m_assetsDone.wait(m_assetsMutex);
+      }
     }
   }
 }
@@ -821,27 +1010,20 @@ void Assets::workerMain() {
     if (m_stopThreads)
       break;
 
-    {
-      RecursiveMutexLocker luaLocker(m_luaMutex);
-      as<LuaEngine>(m_luaEngine.get())->collectGarbage();
-    }
-
-    MutexLocker assetsLocker(m_assetsMutex);
+    MutexLocker assetsLocker(m_assetsMutex, false);
+    lockAssets(assetsLocker);
 
     AssetId assetId;
     QueuePriority queuePriority = QueuePriority::None;
 
-    // Find the highest priority queue entry
-    for (auto const& pair : m_queue) {
-      if (pair.second == QueuePriority::Load || pair.second == QueuePriority::PostProcess) {
-        assetId = pair.first;
-        queuePriority = pair.second;
-        if (pair.second == QueuePriority::Load)
-          break;
-      }
-    }
-
-    if (queuePriority != QueuePriority::Load && queuePriority != QueuePriority::PostProcess) {
+    // Loads take priority over post-processing
+    if (!m_pendingLoads.empty()) {
+      assetId = m_pendingLoads.first();
+      queuePriority = QueuePriority::Load;
+    } else if (!m_pendingPostProcesses.empty()) {
+      assetId = m_pendingPostProcesses.first();
+      queuePriority = QueuePriority::PostProcess;
+    } else {
       // Nothing in the queue that needs work
       m_assetsQueued.wait(m_assetsMutex);
       continue;
@@ -860,6 +1042,8 @@ void Assets::workerMain() {
       continue;
     }
 
+    ++m_workerJobs;
+
     // After processing an asset, unlock the main asset mutex and yield so we
     // don't starve other threads.
     assetsLocker.unlock();
@@ -867,6 +1051,58 @@ void Assets::workerMain() {
   }
 }
 
+void Assets::lockAssets(MutexLocker& locker) const {
+  if (locker.tryLock())
+    return;
+
+  int64_t waitStart = Time::monotonicMicroseconds();
+  locker.lock();
+  ++m_lockContentions;
+  m_lockWaitMicroseconds += Time::monotonicMicroseconds() - waitStart;
+}
+
+shared_ptr<Assets::AssetData> Assets::findLoaded(AssetId const& id) const {
+  auto& shard = m_loadedShards[AssetIdHash()(id) % LoadedShardCount];
+  MutexLocker shardLocker(shard.mutex);
+  return shard.assets.value(id);
+}
+
+void Assets::setLoaded(AssetId const& id, shared_ptr<AssetData> const& asset) const {
+  auto& shard = m_loadedShards[AssetIdHash()(id) % LoadedShardCount];
+  MutexLocker shardLocker(shard.mutex);
+  if (asset)
+    shard.assets[id] = asset;
+  else
+    shard.assets.remove(id);
+}
+
+void Assets::clearLoaded() const {
+  for (auto& shard : m_loadedShards) {
+    MutexLocker shardLocker(shard.mutex);
+    shard.assets.clear();
+  }
+}
+
+void Assets::setQueuePriority(AssetId const& id, QueuePriority priority) const {
+  if (priority == QueuePriority::None)
+    m_queue.remove(id);
+  else
+    m_queue[id] = priority;
+
+  // Re-queued loads go to the back of the line.
+  if (priority == QueuePriority::Load)
+    m_pendingLoads.addBack(id);
+  else
+    m_pendingLoads.remove(id);
+
+  if (priority == QueuePriority::PostProcess)
+    m_pendingPostProcesses.addBack(id);
+  else
+    m_pendingPostProcesses.remove(id);
+
+  m_queuedCount = m_pendingLoads.size() + m_pendingPostProcesses.size();
+}
+
 template <typename Function>
 decltype(auto) Assets::unlockDuring(Function f) const {
   m_assetsMutex.unlock();
@@ -960,19 +1196,18 @@ ImageConstPtr Assets::readImage(String const& path) const {
       image = make_shared<Image>(Image::readPng(p->source->open(p->sourceName)));
 
     if (!p->patchSources.empty()) {
-      RecursiveMutexLocker luaLocker(m_luaMutex);
-      LuaEngine* luaEngine = as<LuaEngine>(m_luaEngine.get());
-      LuaValue result = luaEngine->createUserData(*image);
-      luaLocker.unlock();
+      // Every Lua value must be released before the state is returned.
+      auto luaState = takeLuaPatchState();
+      auto returnState = finally([&]() { returnLuaPatchState(std::move(luaState)); });
+      LuaValue result = luaState->engine->createUserData(*image);
       for (auto const& pair : p->patchSources) {
         auto& patchPath = pair.first;
         auto& patchSource = pair.second;
         auto patchStream = patchSource->read(patchPath);
         if (patchPath.endsWith(".lua")) {
-          luaLocker.lock();
-          LuaContextPtr& context = m_patchContexts[patchPath];
+          LuaContextPtr& context = luaState->contexts[patchPath];
           if (!context) {
-            context = make_shared<LuaContext>(luaEngine->createContext());
+            context = make_shared<LuaContext>(luaState->engine->createContext());
             context->load(patchStream, patchPath);
           }
           auto newResult = context->invokePath<LuaValue>("patch", result, path);
@@ -986,7 +1221,6 @@ ImageConstPtr Assets::readImage(String const& path) const {
               Logger::warn("Patch '{}' for image '{}' returned a non-Image value, ignoring");
             }
           }
-          luaLocker.unlock();
         } else {
           Logger::warn("Patch '{}' for image '{}' isn't a Lua script, ignoring", patchPath, path);
         }
@@ -1000,84 +1234,302 @@ ImageConstPtr Assets::readImage(String const& path) const {
 }
 
 
-Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData, Maybe<Json> const external) const {
+Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, List<PatchStep> const& patchSteps, Maybe<Json> const external) const {
   auto externalRef = external.value();
   auto newResult = result;
-  for (auto const& patch : patchData) {
-    switch(patch.type()) {
-      case Json::Type::Array: // if the patch is an array, go down recursively until we get objects
-        try {
-          newResult = checkPatchArray(path, source, newResult, patch.toArray(), externalRef);
-        } catch (JsonPatchTestFail const& e) {
-          Logger::debug("Patch test failure from file {} in source: '{}' at '{}'. Caused by: {}", path, source->metadata().value("name", ""), m_assetSourcePaths.getLeft(source), e.what());
-        } catch (JsonPatchException const& e) {
-          Logger::error("Could not apply patch from file {} in source: '{}' at '{}'.  Caused by: {}", path, source->metadata().value("name", ""), m_assetSourcePaths.getLeft(source), e.what());
-        }
-        break;
-      case Json::Type::Object: // if its an object, check for operations, or for if an external file is needed for patches to reference
-        newResult = JsonPatching::applyOperation(newResult, patch, externalRef);
-        break;
-      case Json::Type::String:
-        try {
-          externalRef = json(patch.toString());
-        } catch (...) {
-          throw JsonPatchTestFail(strf("Unable to load reference asset: {}", patch.toString()));
-        }
-        break;
-      default:
-        throw JsonPatchException(strf("Patch data is wrong type: {}", Json::typeName(patch.type())));
-        break;
+  for (auto const& step : patchSteps) {
+    if (step.nested) {
+      try {
+        newResult = checkPatchArray(path, source, newResult, *step.nested, externalRef);
+      } catch (JsonPatchTestFail const& e) {
+        Logger::debug("Patch test failure from file {} in source: '{}' at '{}'. Caused by: {}", path, source->metadata().value("name", ""), m_assetSourcePaths.getLeft(source), e.what());
+      } catch (JsonPatchException const& e) {
+        Logger::error("Could not apply patch from file {} in source: '{}' at '{}'.  Caused by: {}", path, source->metadata().value("name", ""), m_assetSourcePaths.getLeft(source), e.what());
+      }
+    } else if (step.operation) {
+      newResult = step.operation->apply(newResult);
+    } else if (step.external) {
+      try {
+        externalRef = json(*step.external);
+      } catch (...) {
+        throw JsonPatchTestFail(strf("Unable to load reference asset: {}", *step.external));
+      }
+    } else {
+      throw *step.error;
     }
   }
   return newResult;
 }
 
+Assets::PatchPlanConstPtr Assets::patchPlan(String const& patchPath, AssetSourcePtr const& patchSource) const {
+  auto key = make_pair(patchSource, patchPath);
+  {
+    MutexLocker plansLocker(m_patchPlansMutex);
+    if (auto plan = m_patchPlans.ptr(key))
+      return *plan;
+  }
+
+  auto patchAssetPath = AssetPath::split(patchPath);
+  auto patchStream = patchSource->read(patchAssetPath.basePath);
+  auto patchJson = inputUtf8Json(patchStream.begin(), patchStream.end(), JsonParseType::Top);
+  if (patchAssetPath.subPath)
+    patchJson = patchJson.query(*patchAssetPath.subPath);
+
+  auto plan = make_shared<PatchPlan>();
+  if (patchJson.isType(Json::Type::Array))
+    plan->steps = compilePatchSteps(patchJson.toArray());
+  else if (patchJson.isType(Json::Type::Object))
+    plan->merge = patchJson.toObject();
+
+  // Another thread may have compiled the same patch in the meantime, either
+  // result is equivalent.
+  MutexLocker plansLocker(m_patchPlansMutex);
+  if (auto existing = m_patchPlans.ptr(key))
+    return *existing;
+  m_patchPlans.set(key, plan);
+  return plan;
+}
+
 Json Assets::readJson(String const& path) const {
   ByteArray streamData = read(path);
+
+  auto stamp = persistentCacheStamp(path, streamData);
+  if (stamp) {
+    MutexLocker cacheLocker(m_persistentCacheMutex);
+    if (auto entry = m_persistentCacheLoaded.maybeTake(path)) {
+      if (entry->first == *stamp) {
+        try {
+          Json result = DataStreamBuffer::deserialize<Json>(entry->second);
+          m_persistentCache[path] = entry.take();
+          return result;
+        } catch (std::exception const& e) {
+          Logger::warn("Discarding corrupt persistent cache entry for '{}': {}", path, outputException(e, false));
+        }
+      }
+    }
+  }
+
   try {
     Json result = inputUtf8Json(streamData.begin(), streamData.end(), JsonParseType::Top);
     for (auto const& pair : m_files.get(path).patchSources) {
-      auto patchAssetPath = AssetPath::split(pair.first);
-      auto& patchBasePath = patchAssetPath.basePath;
       auto& patchSource = pair.second;
-      auto patchStream = patchSource->read(patchBasePath);
+      auto patchBasePath = AssetPath::removeSubPath(pair.first);
       if (patchBasePath.endsWith(".lua")) {
-        RecursiveMutexLocker luaLocker(m_luaMutex);
-        // Kae: i don't like that lock. perhaps have a LuaEngine and patch context cache per worker thread later on?
-        LuaContextPtr& context = m_patchContexts[patchBasePath];
+        auto luaState = takeLuaPatchState();
+        auto returnState = finally([&]() { returnLuaPatchState(std::move(luaState)); });
+        LuaContextPtr& context = luaState->contexts[patchBasePath];
         if (!context) {
-          context = make_shared<LuaContext>(as<LuaEngine>(m_luaEngine.get())->createContext());
-          context->load(patchStream, patchBasePath);
+          context = make_shared<LuaContext>(luaState->engine->createContext());
+          context->load(patchSource->read(patchBasePath), patchBasePath);
         }
         auto newResult = context->invokePath<Json>("patch", result, path);
         if (newResult)
           result = std::move(newResult);
       } else {
-        auto patchJson = inputUtf8Json(patchStream.begin(), patchStream.end(), JsonParseType::Top);
-        if (patchAssetPath.subPath)
-          patchJson = patchJson.query(*patchAssetPath.subPath);
-        if (patchJson.isType(Json::Type::Array)) {
-          auto patchData = patchJson.toArray();
+        auto plan = patchPlan(pair.first, patchSource);
+        if (plan->steps) {
           try {
-            result = checkPatchArray(pair.first, patchSource, result, patchData, {});
+            result = checkPatchArray(pair.first, patchSource, result, *plan->steps, {});
           } catch (JsonPatchTestFail const& e) {
             Logger::debug("Patch test failure from file {} in source: '{}' at '{}'. Caused by: {}", pair.first, patchSource->metadata().value("name", ""), m_assetSourcePaths.getLeft(patchSource), e.what());
           } catch (JsonPatchException const& e) {
             Logger::error("Could not apply patch from file {} in source: '{}' at '{}'.  Caused by: {}", pair.first, patchSource->metadata().value("name", ""), m_assetSourcePaths.getLeft(patchSource), e.what());
           }
-        } else if (patchJson.isType(Json::Type::Object)) {
-          result = jsonMergeNulling(result, patchJson.toObject());
+        } else if (plan->merge) {
+          result = jsonMergeNulling(result, *plan->merge);
         }
       }
     }
+
+    if (stamp) {
+      auto data = DataStreamBuffer::serialize(result);
+      // The cache may have been saved and disabled since the stamp was taken.
+      MutexLocker cacheLocker(m_persistentCacheMutex);
+      if (m_persistentCacheEnabled) {
+        m_persistentCache[path] = {*stamp, std::move(data)};
+        m_persistentCacheChanged = true;
+      }
+    }
+
     return result;
   } catch (std::exception const& e) {
     throw JsonParsingException(strf("Cannot parse json file: {}", path), e);
   }
 }
 
+LuaCallbacks Assets::makeBaseAssetCallbacks() const {
+  LuaCallbacks callbacks;
+  callbacks.registerCallbackWithSignature<StringSet, String>("byExtension", bind(&Assets::scanExtension, this, _1));
+  callbacks.registerCallbackWithSignature<Json, String>("json", bind(&Assets::json, this, _1));
+  callbacks.registerCallbackWithSignature<bool, String>("exists", bind(&Assets::assetExists, this, _1));
+
+  callbacks.registerCallback("sourcePaths", [this](LuaEngine& engine, Maybe<bool> withMetaData) -> LuaTable {
+    auto assetSources = this->assetSources();
+    auto table = engine.createTable(assetSources.size(), 0);
+    if (withMetaData.value()) {
+      for (auto& assetSource : assetSources)
+        table.set(assetSource, this->assetSourceMetadata(assetSource));
+    }
+    else {
+      size_t i = 0;
+      for (auto& assetSource : assetSources)
+        table.set(++i, assetSource);
+    }
+    return table;
+  });
+  
+  callbacks.registerCallback("origin", [this](String const& path) -> Maybe<String> {
+    if (auto descriptor = this->assetDescriptor(path))
+      return this->assetSourcePath(descriptor->source);
+    return {};
+  });
+  
+  callbacks.registerCallback("bytes", [this](String const& path) -> String {
+    auto assetBytes = bytes(path);
+    return String(assetBytes->ptr(), assetBytes->size());
+  });
+
+  callbacks.registerCallback("image", [this](String const& path) -> Image {
+    auto assetImage = image(path);
+    if (assetImage->bytesPerPixel() == 3)
+      return assetImage->convert(PixelFormat::RGBA32);
+    else
+      return *assetImage;
+  });
+
+  callbacks.registerCallback("frames", [this](String const& path) -> Json {
+    if (auto frames = imageFrames(path))
+      return frames->toJson();
+    return Json();
+  });
+
+  callbacks.registerCallback("scan", [this](Maybe<String> const& a, Maybe<String> const& b) -> StringList {
+    return b ? scan(a.value(), *b) : scan(a.value());
+  });
+  return callbacks;
+}
+
+Maybe<uint64_t> Assets::persistentCacheStamp(String const& path, ByteArray const& data) const {
+  if (!m_persistentCacheEnabled)
+    return {};
+
+  XXHash64 hasher;
+  hasher.push(data.ptr(), data.size());
+  for (auto const& pair : m_files.get(path).patchSources) {
+    auto patchBasePath = AssetPath::removeSubPath(pair.first);
+    // Lua patches can depend on anything, so are never cached.
+    if (patchBasePath.endsWith(".lua"))
+      return {};
+    xxHash64Push(hasher, pair.first);
+
+    // Neither are patches with steps that load other assets, as the result
+    // depends on the contents of those too.  Broken patches are left for
+    // readJson to report.
+    try {
+      auto plan = patchPlan(pair.first, pair.second);
+      if (plan->steps && hasExternalSteps(*plan->steps))
+        return {};
+    } catch (std::exception const&) {
+      return {};
+    }
+
+    auto key = make_pair(pair.second, patchBasePath);
+    Maybe<uint64_t> patchHash;
+    {
+      MutexLocker cacheLocker(m_persistentCacheMutex);
+      patchHash = m_persistentCachePatchHashes.maybe(key);
+    }
+    if (!patchHash) {
+      auto patchData = pair.second->read(patchBasePath);
+      patchHash = xxHash64(patchData.ptr(), patchData.size());
+      MutexLocker cacheLocker(m_persistentCacheMutex);
+      m_persistentCachePatchHashes[key] = *patchHash;
+    }
+    xxHash64Push(hasher, *patchHash);
+  }
+  return hasher.digest();
+}
+
+void Assets::loadPersistentCache() {
+  if (!m_settings.persistentCacheFile)
+    return;
+
+  MutexLocker cacheLocker(m_persistentCacheMutex);
+  m_persistentCacheEnabled = true;
+  auto const& cacheFile = *m_settings.persistentCacheFile;
+  if (!File::isFile(cacheFile))
+    return;
+
+  try {
+    DataStreamBuffer ds(File::readFile(cacheFile));
+    if (ds.read<String>() != PersistentCacheIdentifier || ds.readVlqU() != PersistentCacheVersion)
+      return;
+    // Everything cached is invalid when the set of assets changes, as patches
+    // may depend on what other assets exist.
+    if (ds.read<ByteArray>() != m_digest)
+      return;
+    ds >> m_persistentCacheLoaded;
+    Logger::info("Loaded {} json assets from persistent cache", m_persistentCacheLoaded.size());
+  } catch (std::exception const& e) {
+    Logger::warn("Could not load persistent asset cache '{}': {}", cacheFile, outputException(e, false));
+    m_persistentCacheLoaded.clear();
+  }
+}
+
+void Assets::savePersistentCache() {
+  MutexLocker cacheLocker(m_persistentCacheMutex);
+  if (!m_persistentCacheEnabled)
+    return;
+  m_persistentCacheEnabled = false;
+
+  // Json loaded after this is never cached, so nothing needs to be kept.
+  auto entries = take(m_persistentCache);
+  m_persistentCacheLoaded.clear();
+  m_persistentCachePatchHashes.clear();
+  if (!m_persistentCacheChanged)
+    return;
+
+  auto const& cacheFile = *m_settings.persistentCacheFile;
+  try {
+    DataStreamBuffer ds;
+    ds.write(String(PersistentCacheIdentifier));
+    ds.writeVlqU(PersistentCacheVersion);
+    ds.write(m_digest);
+    ds << entries;
+    File::overwriteFileWithRename(ds.data(), cacheFile);
+    Logger::info("Saved {} json assets to persistent cache", entries.size());
+  } catch (std::exception const& e) {
+    Logger::warn("Could not save persistent asset cache '{}': {}", cacheFile, outputException(e, false));
+  }
+}
+
+shared_ptr<Assets::LuaPatchState> Assets::takeLuaPatchState() const {
+  {
+    MutexLocker statesLocker(m_luaPatchStatesMutex);
+    if (!m_luaPatchStates.empty())
+      return m_luaPatchStates.takeLast();
+  }
+
+  auto state = make_shared<LuaPatchState>();
+  state->engine = makeAssetsLuaEngine(makeBaseAssetCallbacks());
+  return state;
+}
+
+void Assets::returnLuaPatchState(shared_ptr<LuaPatchState> state) const {
+  if (++state->uses >= LuaPatchStateCollectInterval) {
+    state->engine->collectGarbage();
+    state->uses = 0;
+  }
+
+  // Keep no more idle states than there are workers, any others are
+  // released once this returns.
+  MutexLocker statesLocker(m_luaPatchStatesMutex);
+  if (m_luaPatchStates.size() < max<size_t>(m_settings.workerPoolSize, 1))
+    m_luaPatchStates.append(std::move(state));
+}
 
 bool Assets::doLoad(AssetId const& id) const {
+  MemoryTagScope tagScope(AssetsMemoryTag);
   try {
     // loadAsset automatically manages the queue and freshens the asset
     // data.
@@ -1091,12 +1543,14 @@ bool Assets::doLoad(AssetId const& id) const {
   // There was an exception, remove the asset from the queue and fill the cache
   // with null so that getAsset will throw.
   m_assetsCache[id] = {};
+  setLoaded(id, {});
   m_assetsDone.broadcast();
-  m_queue.remove(id);
+  setQueuePriority(id, QueuePriority::None);
   return true;
 }
 
 bool Assets::doPost(AssetId const& id) const {
+  MemoryTagScope tagScope(AssetsMemoryTag);
   shared_ptr<AssetData> assetData;
   try {
     assetData = m_assetsCache.get(id);
@@ -1108,10 +1562,11 @@ bool Assets::doPost(AssetId const& id) const {
     Logger::error("Unknown exception caught post-processing asset: {}", id.path);
   }
 
-  m_queue.remove(id);
+  setQueuePriority(id, QueuePriority::None);
   if (assetData) {
     assetData->needsPostProcessing = false;
     m_assetsCache[id] = assetData;
+    setLoaded(id, assetData);
     freshen(assetData);
     m_assetsDone.broadcast();
   }
@@ -1127,7 +1582,7 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id) const {
     return {};
 
   try {
-    m_queue[id] = QueuePriority::Working;
+    setQueuePriority(id, QueuePriority::Working);
     shared_ptr<AssetData> assetData;
 
     try {
@@ -1157,10 +1612,11 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id) const {
 
     if (assetData) {
       if (assetData->needsPostProcessing)
-        m_queue[id] = QueuePriority::PostProcess;
+        setQueuePriority(id, QueuePriority::PostProcess);
       else
-        m_queue.remove(id);
+        setQueuePriority(id, QueuePriority::None);
       m_assetsCache[id] = assetData;
+      setLoaded(id, assetData);
       m_assetsDone.broadcast();
       freshen(assetData);
 
@@ -1168,16 +1624,16 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id) const {
       // We have failed to load an asset because it depends on an asset
       // currently being worked on.  Mark it as needing loading and move it to
       // the end of the queue.
-      m_queue[id] = QueuePriority::Load;
+      setQueuePriority(id, QueuePriority::Load);
       m_assetsQueued.signal();
-      m_queue.toBack(id);
     }
 
     return assetData;
 
   } catch (...) {
-    m_queue.remove(id);
+    setQueuePriority(id, QueuePriority::None);
     m_assetsCache[id] = {};
+    setLoaded(id, {});
     m_assetsDone.broadcast();
     throw;
   }
@@ -1195,6 +1651,15 @@ shared_ptr<Assets::AssetData> Assets::loadJson(AssetPath const& path) const {
     try {
       auto newData = make_shared<JsonData>();
       newData->json = topJson->json.query(*path.subPath);
+      // Values inside interned json are also referenced by the interner, so
+      // give sub-path assets their own top level storage for shouldPersist
+      // to be meaningful.
+      if (newData->json.isType(Json::Type::Object))
+        newData->json = newData->json.toObject();
+      else if (newData->json.isType(Json::Type::Array))
+        newData->json = newData->json.toArray();
+      else if (newData->json.isType(Json::Type::String))
+        newData->json = newData->json.toString();
       return newData;
     } catch (StarException const& e) {
       throw AssetException(strf("Could not read JSON value {}", path), e);
@@ -1203,7 +1668,7 @@ shared_ptr<Assets::AssetData> Assets::loadJson(AssetPath const& path) const {
     return unlockDuring([&]() {
       try {
         auto newData = make_shared<JsonData>();
-        newData->json = readJson(path.basePath);
+        newData->json = m_jsonInterner.intern(readJson(path.basePath));
         return newData;
       } catch (StarException const& e) {
         throw AssetException(strf("Could not read JSON asset {}", path), e);
@@ -1241,17 +1706,43 @@ shared_ptr<Assets::AssetData> Assets::loadImage(AssetPath const& path) const {
 
     return unlockDuring([&]() {
       auto newData = make_shared<ImageData>();
-      Image newImage = *source->image;
+      List<ImageOperation const*> operations;
       path.directives.forEach([&](Directives::Entry const& entry, Directives const&) {
-        if (auto error = entry.operation.ptr<ErrorImageOperation>())
+        if (auto error = entry.operation.ptr<ErrorImageOperation>()) {
           if (auto string = error->cause.ptr<std::string>())
             throw DirectivesException::format("ImageOperation parse error: {}", *string);
           else
             std::rethrow_exception(error->cause.get<std::exception_ptr>());
-        else
-          processImageOperation(entry.operation, newImage, [&](String const& ref) { return references.get(ref).get(); });
+        } else if (!entry.operation.is<NullImageOperation>()) {
+          operations.append(&entry.operation);
+        }
       });
-      newData->image = make_shared<Image>(std::move(newImage));
+
+      // Directives that do nothing leave the base image untouched, unless it
+      // lacks alpha, as callers expect processed images to always have it.
+      if (operations.empty() && source->image->bytesPerPixel() == 4) {
+        newData->image = source->image;
+        newData->alias = true;
+        return newData;
+      }
+
+      ProcessedImageKey key = {imageDigest(*source->image), processedImageOperationsKey(operations)};
+      ImageConstPtr image = processedImage(key);
+      if (!image) {
+        Image newImage = *source->image;
+        if (operations.empty())
+          newImage = newImage.convert(newImage.pixelFormat() == PixelFormat::BGR24 ? PixelFormat::BGRA32 : PixelFormat::RGBA32);
+        else
+          processImageOperations(operations, newImage, [&](String const& ref) { return references.get(ref).get(); });
+        image = cacheProcessedImage(key, make_shared<Image>(std::move(newImage)));
+      }
+
+      // The processed image is shared with the LRU and with entries whose
+      // directives produce the same result, so the entry gets its own handle
+      // to it.  Only references taken from this entry then count towards its
+      // shouldPersist, and the entry stays loaded for as long as they live.
+      Image const* imagePtr = image.get();
+      newData->image = ImageConstPtr(imagePtr, [image = std::move(image)](Image const*) mutable { image.reset(); });
       return newData;
     });
 
@@ -1332,6 +1823,13 @@ shared_ptr<Assets::AssetData> Assets::postProcessAudio(shared_ptr<AssetData> con
         auto audio = make_shared<Audio>(*audioData->audio);
         audio->uncompress();
 
+        auto newData = make_shared<AudioData>();
+        newData->audio = audio;
+        return newData;
+      } else if (m_settings.audioReadAhead > 0.0f) {
+        auto audio = make_shared<Audio>(*audioData->audio);
+        audio->setReadAhead(m_settings.audioReadAhead);
+
         auto newData = make_shared<AudioData>();
         newData->audio = audio;
         return newData;
@@ -1344,6 +1842,56 @@ shared_ptr<Assets::AssetData> Assets::postProcessAudio(shared_ptr<AssetData> con
   });
 }
 
+uint64_t Assets::imageDigest(Image const& image) {
+  XXHash3 hasher;
+  uint32_t header[3] = {image.width(), image.height(), (uint32_t)image.pixelFormat()};
+  hasher.push((char const*)header, sizeof(header));
+  hasher.push((char const*)image.data(), (size_t)image.width() * image.height() * image.bytesPerPixel());
+  return hasher.digest();
+}
+
+ImageConstPtr Assets::processedImage(ProcessedImageKey const& key) const {
+  MutexLocker processedLocker(m_processedImagesMutex);
+  auto i = m_processedImages.find(key);
+  if (i == m_processedImages.end())
+    return {};
+  return m_processedImages.toBack(i)->second;
+}
+
+ImageConstPtr Assets::cacheProcessedImage(ProcessedImageKey const& key, ImageConstPtr image) const {
+  uint64_t contentDigest = imageDigest(*image);
+  size_t imageSize = (size_t)image->width() * image->height() * image->bytesPerPixel();
+
+  MutexLocker processedLocker(m_processedImagesMutex);
+  auto& existing = m_processedImageContents[contentDigest];
+  if (auto existingImage = existing.lock()) {
+    if (existingImage->size() == image->size() && existingImage->pixelFormat() == image->pixelFormat()
+        && memcmp(existingImage->data(), image->data(), imageSize) == 0)
+      image = std::move(existingImage);
+  } else {
+    existing = image;
+  }
+
+  if (m_settings.processedImageCacheSize == 0 || imageSize > m_settings.processedImageCacheSize)
+    return image;
+
+  auto i = m_processedImages.find(key);
+  if (i != m_processedImages.end()) {
+    m_processedImagesSize -= (size_t)i->second->width() * i->second->height() * i->second->bytesPerPixel();
+    m_processedImages.erase(i);
+  }
+  m_processedImages.add(key, image);
+  m_processedImagesSize += imageSize;
+
+  while (m_processedImagesSize > m_settings.processedImageCacheSize) {
+    auto const& oldest = m_processedImages.first().second;
+    m_processedImagesSize -= (size_t)oldest->width() * oldest->height() * oldest->bytesPerPixel();
+    m_processedImages.removeFirst();
+  }
+
+  return image;
+}
+
 void Assets::freshen(shared_ptr<AssetData> const& asset) const {
   asset->time = Time::monotonicTime();
 }
@@ -1,23 +1,30 @@
 #pragma once
 
+#include <atomic>
+
 #include "StarJson.hpp"
+#include "StarJsonInterner.hpp"
 #include "StarOrderedMap.hpp"
+#include "StarOrderedSet.hpp"
+#include "StarTtlCache.hpp"
 #include "StarRect.hpp"
 #include "StarBiMap.hpp"
 #include "StarThread.hpp"
 #include "StarAssetSource.hpp"
 #include "StarAssetPath.hpp"
+#include "StarImageMetadataIndex.hpp"
 #include "StarRefPtr.hpp"
+#include "StarAudio.hpp"
 
 namespace Star {
 
 STAR_CLASS(Font);
-STAR_CLASS(Audio);
 STAR_CLASS(Image);
 STAR_STRUCT(FramesSpecification);
 STAR_CLASS(Assets);
 
 STAR_CLASS(LuaContext);
+class LuaCallbacks;
 
 STAR_EXCEPTION(AssetException, StarException);
 
@@ -52,6 +59,14 @@ public:
     // Audio under this length will be automatically decompressed
     float audioDecompressLimit;
 
+    // Longer audio is decoded this many seconds ahead of playback on a
+    // background thread, zero disables.
+    float audioReadAhead = 0.0f;
+
+    // Decompressed audio is kept cached up to this many bytes after it is
+    // no longer used, so that it is not decoded again when reloaded.
+    size_t audioDecodedCacheSize = Audio::DefaultDecodedCacheSize;
+
     // Number of background worker threads
     unsigned workerPoolSize;
 
@@ -69,6 +84,18 @@ public:
     // Same, but only ignores the file for the purposes of calculating the
     // digest.
     StringList digestIgnore;
+
+    // If given, parsed and patched json assets loaded during startup are
+    // saved to this file by savePersistentCache, and re-used on the next
+    // startup as long as the assets digest and the contents of the file and
+    // its patches are unchanged.
+    Maybe<String> persistentCacheFile;
+
+    // Processed images (images with directives) are kept alive in a least
+    // recently used cache of at most this many bytes of pixel data, keyed on
+    // the content of their base image and their normalized directives.  Zero
+    // disables the cache.
+    size_t processedImageCacheSize = 0;
   };
 
   enum class QueuePriority {
@@ -105,7 +132,8 @@ public:
     // the cache.
     virtual bool shouldPersist() const = 0;
 
-    double time = 0.0;
+    // Last access time, updated without the assets lock held.
+    std::atomic<double> time{0.0};
     bool needsPostProcessing = false;
     bool forcePersist = false;
   };
@@ -164,6 +192,12 @@ public:
 
   void hotReload() const;
 
+  // Writes the json assets loaded so far to the persistent cache file, if
+  // one is configured, and stops caching any more.  Called once startup
+  // loading is done, so that no copy of the cached json is kept in memory
+  // for the rest of the run.
+  void savePersistentCache();
+
   // Returns a list of all the asset source paths used by Assets in load order.
   StringList assetSources() const;
 
@@ -196,6 +230,12 @@ public:
   // '.' character or it may be omitted.
   CaseInsensitiveStringSet const& scanExtension(String const& extension) const;
 
+  // If the given png asset is unpatched and its asset source was packed with
+  // an image metadata index, returns the precomputed metadata for it.  Does
+  // not lock, so is cheap to call from any thread.
+  Maybe<ImageMetadataIndex::Entry> imageMetadata(String const& path) const;
+  Maybe<ImageMetadataIndex::AlphaMask> imageAlphaMask(String const& path) const;
+
   // Get json asset with an optional sub-path.  The sub-path portion of the
   // path refers to a key in the top-level object, and may use dot notation
   // for deeper field access and [] notation for array access.  Example:
@@ -255,6 +295,29 @@ public:
   // Run a cleanup pass and remove any assets past their time to live.
   void cleanup();
 
+  // Counters for how asset requests have been served since startup.  Reading
+  // them never takes the main assets lock.
+  struct Metrics {
+    // Requests answered from the loaded asset shards, without taking the
+    // main assets lock.
+    uint64_t fastHits;
+    // Requests that had to take the main assets lock.
+    uint64_t slowRequests;
+    // Requests that waited on another thread already loading the same asset
+    // rather than loading it a second time.
+    uint64_t coalescedWaits;
+    // Number of times the main assets lock was found already held, and the
+    // total time spent waiting for it.
+    uint64_t lockContentions;
+    double lockWaitTime;
+    // Loads and post-processing jobs completed by the worker threads.
+    uint64_t workerJobs;
+    // Assets currently waiting to be loaded or post-processed.
+    size_t queued;
+  };
+
+  Metrics metrics() const;
+
 private:
   EnumMap<AssetType> const AssetTypeNames{
       {AssetType::Json, "json"},
@@ -274,8 +337,22 @@ private:
 
   void workerMain();
 
+  // Locks the main assets mutex, recording any contention in the metrics.
+  void lockAssets(MutexLocker& locker) const;
+
+  // Loaded assets are mirrored into a set of independently locked shards, so
+  // that the common case of requesting an already loaded asset does not need
+  // the main assets lock.  Setting a null asset removes it.
+  shared_ptr<AssetData> findLoaded(AssetId const& id) const;
+  void setLoaded(AssetId const& id, shared_ptr<AssetData> const& asset) const;
+  void clearLoaded() const;
+
   // All methods below assume that the asset mutex is locked when calling.
 
+  // Updates the queue entry for the given asset, keeping the pending load and
+  // post-process lists in sync.  QueuePriority::None removes the entry.
+  void setQueuePriority(AssetId const& id, QueuePriority priority) const;
+
   // Do some processing that might take a long time and should not hold the
   // assets mutex during it.  Unlocks the assets mutex while the function is in
   // progress and re-locks it on return or before exception is thrown.
@@ -289,8 +366,34 @@ private:
   ByteArray read(String const& basePath) const;
   ImageConstPtr readImage(String const& path) const;
 
+  // A json patch file parsed once and compiled, so that it can be re-applied
+  // cheaply whenever the assets it patches are reloaded.
+  struct PatchStep;
+  struct PatchPlan;
+  typedef shared_ptr<PatchPlan const> PatchPlanConstPtr;
+
+  // Lua patches are applied with pooled engines and patch contexts.  A
+  // thread takes a state for the duration of a patch and returns it, so that
+  // patching different assets never contends on Lua, and there are only ever
+  // as many engines as patches applied at once.
+  struct LuaPatchState;
+
+  static List<PatchStep> compilePatchSteps(JsonArray const& patchData);
+  // Whether any step, including nested ones, loads another asset.
+  static bool hasExternalSteps(List<PatchStep> const& steps);
+
   Json readJson(String const& basePath) const;
-  Json checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData, Maybe<Json> const external) const;
+  PatchPlanConstPtr patchPlan(String const& patchPath, AssetSourcePtr const& patchSource) const;
+  Json checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, List<PatchStep> const& patchSteps, Maybe<Json> const external) const;
+
+  // Returns a hash of the contents of the given json file and all of its
+  // patches, or nothing if the result cannot be persistently cached.
+  Maybe<uint64_t> persistentCacheStamp(String const& path, ByteArray const& data) const;
+  void loadPersistentCache();
+
+  LuaCallbacks makeBaseAssetCallbacks() const;
+  shared_ptr<LuaPatchState> takeLuaPatchState() const;
+  void returnLuaPatchState(shared_ptr<LuaPatchState> state) const;
 
   // Load / post process an asset and log any exception.  Returns true if the
   // work was performed (whether successful or not), false if the work is
@@ -313,6 +416,20 @@ private:
 
   shared_ptr<AssetData> postProcessAudio(shared_ptr<AssetData> const& original) const;
 
+  // Content key of a processed image, the digest of the base image pixels
+  // along with the printed non-null image operations applied to it, with
+  // color replacements in a canonical form.
+  typedef pair<uint64_t, String> ProcessedImageKey;
+
+  static uint64_t imageDigest(Image const& image);
+
+  // Returns the cached result of a previous processing with the same key, if
+  // it is still cached.
+  ImageConstPtr processedImage(ProcessedImageKey const& key) const;
+  // Stores a freshly processed image in the processed image cache, returning
+  // an existing image with identical contents in its place if there is one.
+  ImageConstPtr cacheProcessedImage(ProcessedImageKey const& key, ImageConstPtr image) const;
+
   // Updates time on the given asset (with smearing).
   void freshen(shared_ptr<AssetData> const& asset) const;
 
@@ -321,18 +438,63 @@ private:
   mutable Mutex m_assetsMutex;
 
   mutable ConditionVariable m_assetsQueued;
-  mutable OrderedHashMap<AssetId, QueuePriority, AssetIdHash> m_queue;
+  mutable HashMap<AssetId, QueuePriority, AssetIdHash> m_queue;
+  // Assets with a Load or PostProcess queue entry, in the order workers should
+  // pick them up, so that finding work never scans the whole queue.
+  mutable OrderedHashSet<AssetId, AssetIdHash> m_pendingLoads;
+  mutable OrderedHashSet<AssetId, AssetIdHash> m_pendingPostProcesses;
 
   mutable ConditionVariable m_assetsDone;
   mutable HashMap<AssetId, shared_ptr<AssetData>, AssetIdHash> m_assetsCache;
 
+  struct LoadedShard {
+    Mutex mutex;
+    HashMap<AssetId, shared_ptr<AssetData>, AssetIdHash> assets;
+  };
+  static size_t const LoadedShardCount = 16;
+  mutable Array<LoadedShard, LoadedShardCount> m_loadedShards;
+
+  mutable std::atomic<uint64_t> m_fastHits;
+  mutable std::atomic<uint64_t> m_slowRequests;
+  mutable std::atomic<uint64_t> m_coalescedWaits;
+  mutable std::atomic<uint64_t> m_lockContentions;
+  mutable std::atomic<int64_t> m_lockWaitMicroseconds;
+  mutable std::atomic<uint64_t> m_workerJobs;
+  // Size of the pending queues, kept here so that metrics() can be called
+  // every frame without taking the main assets lock.
+  mutable std::atomic<size_t> m_queuedCount;
+
+  // Loaded json assets share identical strings and sub-values through this.
+  mutable JsonInterner m_jsonInterner;
+
   mutable StringMap<String> m_bestFramesFiles;
   mutable StringMap<FramesSpecificationConstPtr> m_framesSpecifications;
 
+  mutable Mutex m_persistentCacheMutex;
+  std::atomic<bool> m_persistentCacheEnabled;
+  mutable bool m_persistentCacheChanged;
+  // Maps json asset paths to their stamp and serialized json, as loaded from
+  // the cache file.  Entries are moved to m_persistentCache as they are used.
+  mutable StringMap<pair<uint64_t, ByteArray>> m_persistentCacheLoaded;
+  // The entries the cache file is saved with.
+  mutable StringMap<pair<uint64_t, ByteArray>> m_persistentCache;
+  // Hashes of patch files, so that each is only read and hashed once.
+  mutable HashMap<pair<AssetSourcePtr, String>, uint64_t> m_persistentCachePatchHashes;
+
+  mutable Mutex m_processedImagesMutex;
+  mutable OrderedHashMap<ProcessedImageKey, ImageConstPtr> m_processedImages;
+  mutable size_t m_processedImagesSize;
+  // Maps the pixel digest of every live processed image to that image, so
+  // that directives producing identical output share one image.
+  mutable HashMap<uint64_t, std::weak_ptr<Image const>> m_processedImageContents;
+
+  mutable Mutex m_patchPlansMutex;
+  // Plans expire like the assets they patch.
+  mutable HashTtlCache<pair<AssetSourcePtr, String>, PatchPlanConstPtr> m_patchPlans;
+
   // Lua
-  RefPtr<RefCounter> m_luaEngine; // dumb but to avoid including Lua.hpp in here...
-  mutable StringMap<LuaContextPtr> m_patchContexts;
-  mutable RecursiveMutex m_luaMutex;
+  mutable Mutex m_luaPatchStatesMutex;
+  mutable List<shared_ptr<LuaPatchState>> m_luaPatchStates;
 
   // Paths of all used asset sources, in load order.
   StringList m_assetSources;
@@ -340,6 +502,10 @@ private:
   // Maps an asset path to the loaded asset source and vice versa
   BiMap<String, AssetSourcePtr> m_assetSourcePaths;
 
+  // Image metadata indexes of packed asset sources, like m_files this is only
+  // modified during construction.
+  HashMap<AssetSourcePtr, ImageMetadataIndexConstPtr> m_imageMetadataIndexes;
+
   // Maps the source asset name to the source containing it
   CaseInsensitiveStringMap<AssetFileDescriptor> m_files;
   // Maps an extension to the files with that extension
@@ -0,0 +1,137 @@
+#include "StarImageMetadataIndex.hpp"
+#include "StarImage.hpp"
+#include "StarCompression.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarDataStreamExtra.hpp"
+
+namespace Star {
+
+char const* const ImageMetadataIndex::IndexPath = "/_imagemetadata.index";
+
+static char const* const ImageMetadataIndexHeader = "SBImgMt1";
+
+ImageMetadataIndex::AlphaMask ImageMetadataIndex::alphaMask(Image const& image) {
+  AlphaMask mask;
+  mask.size = image.size();
+  mask.bits = ByteArray((size_t)mask.size[0] * mask.size[1] / 8 + 1, 0);
+  image.forEachPixel([&mask](unsigned x, unsigned y, Vec4B const& pixel) {
+      if (pixel[3] > 0) {
+        size_t bit = (size_t)y * mask.size[0] + x;
+        mask.bits[bit / 8] |= (char)(1 << (bit % 8));
+      }
+    });
+  return mask;
+}
+
+auto ImageMetadataIndex::frameAlphaMask(AlphaMask const& mask, RectU const& frame) -> Maybe<AlphaMask> {
+  if (frame.xMax() > mask.size[0] || frame.yMax() > mask.size[1])
+    return {};
+
+  Vec2U offset(frame.xMin(), mask.size[1] - frame.yMax());
+  AlphaMask frameMask;
+  frameMask.size = frame.size();
+  frameMask.bits = ByteArray((size_t)frameMask.size[0] * frameMask.size[1] / 8 + 1, 0);
+  for (unsigned y = 0; y < frameMask.size[1]; ++y) {
+    for (unsigned x = 0; x < frameMask.size[0]; ++x) {
+      if (mask.get(x + offset[0], y + offset[1])) {
+        size_t bit = (size_t)y * frameMask.size[0] + x;
+        frameMask.bits[bit / 8] |= (char)(1 << (bit % 8));
+      }
+    }
+  }
+  return frameMask;
+}
+
+ByteArray ImageMetadataIndex::build(AssetSource& source, function<void(String const&)> progressCallback) {
+  List<pair<String, Entry>> entries;
+  DataStreamBuffer masks;
+
+  for (auto const& path : source.assetPaths()) {
+    if (!path.endsWith(".png", String::CaseInsensitive))
+      continue;
+
+    if (progressCallback)
+      progressCallback(path);
+
+    auto device = source.open(path);
+    if (!Image::isPng(device))
+      continue;
+    Image image = Image::readPng(device);
+
+    Entry entry;
+    entry.size = image.size();
+    entry.nonEmptyRegion = RectU::null();
+    image.forEachPixel([&entry](unsigned x, unsigned y, Vec4B const& pixel) {
+        if (pixel[3] > 0)
+          entry.nonEmptyRegion.combine(RectU::withSize({x, y}, {1, 1}));
+      });
+
+    ByteArray mask = compressData(alphaMask(image).bits);
+    entry.maskOffset = masks.pos();
+    entry.maskSize = mask.size();
+    masks.writeData(mask.ptr(), mask.size());
+
+    entries.append({path, entry});
+  }
+
+  DataStreamBuffer ds;
+  ds.writeData(ImageMetadataIndexHeader, 8);
+  ds.writeVlqU(entries.size());
+  for (auto const& p : entries) {
+    ds.write(p.first);
+    ds.write(p.second.size);
+    ds.write(p.second.nonEmptyRegion);
+    ds.writeVlqU(p.second.maskOffset);
+    ds.writeVlqU(p.second.maskSize);
+  }
+  ds.writeData(masks.ptr(), masks.size());
+
+  return ds.takeData();
+}
+
+ImageMetadataIndex::ImageMetadataIndex(AssetSourcePtr source)
+  : m_source(std::move(source)), m_device(m_source->open(IndexPath)) {
+  DataStreamIODevice ds(m_device);
+
+  if (ds.readBytes(8) != ByteArray(ImageMetadataIndexHeader, 8))
+    throw ImageMetadataIndexException("Image metadata index format unrecognized!");
+
+  size_t count = ds.readVlqU();
+  m_entries.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    String path = ds.read<String>();
+    Entry entry;
+    ds.read(entry.size);
+    ds.read(entry.nonEmptyRegion);
+    entry.maskOffset = ds.readVlqU();
+    entry.maskSize = ds.readVlqU();
+    m_entries.add(std::move(path), entry);
+  }
+
+  m_masksStart = m_device->pos();
+}
+
+size_t ImageMetadataIndex::size() const {
+  return m_entries.size();
+}
+
+auto ImageMetadataIndex::entry(String const& path) const -> Entry const* {
+  return m_entries.ptr(path);
+}
+
+auto ImageMetadataIndex::alphaMask(Entry const& entry) const -> AlphaMask {
+  ByteArray compressed;
+  {
+    MutexLocker deviceLocker(m_deviceMutex);
+    compressed = m_device->readBytesAbsolute(m_masksStart + entry.maskOffset, entry.maskSize);
+  }
+
+  AlphaMask mask;
+  mask.size = entry.size;
+  mask.bits = uncompressData(compressed);
+  if (mask.bits.size() * 8 < (size_t)mask.size[0] * mask.size[1])
+    throw ImageMetadataIndexException::format("Corrupt alpha mask in image metadata index of size {}", mask.size);
+  return mask;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "StarAssetSource.hpp"
+#include "StarRect.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(Image);
+STAR_CLASS(ImageMetadataIndex);
+
+STAR_EXCEPTION(ImageMetadataIndexException, AssetSourceException);
+
+// Precomputed size, non-empty region and alpha coverage of every png in an
+// asset source, built by asset_packer and stored inside the packed file so
+// that image metadata can be answered without decoding the images.
+class ImageMetadataIndex {
+public:
+  // Reserved path of the index inside a packed asset source.
+  static char const* const IndexPath;
+
+  struct Entry {
+    Vec2U size;
+    RectU nonEmptyRegion;
+
+    // Location of the compressed alpha mask, relative to the start of the
+    // mask data.
+    uint64_t maskOffset;
+    uint64_t maskSize;
+  };
+
+  // One bit per pixel, set if the pixel has non-zero alpha, in the same row
+  // order as Image.
+  struct AlphaMask {
+    Vec2U size;
+    ByteArray bits;
+
+    bool get(unsigned x, unsigned y) const;
+  };
+
+  static AlphaMask alphaMask(Image const& image);
+  // The part of a mask covered by a frame.  Frame rects are top down, as in
+  // frames files, while masks are bottom up like Image.  Returns nothing if
+  // the frame does not fit inside the mask.
+  static Maybe<AlphaMask> frameAlphaMask(AlphaMask const& mask, RectU const& frame);
+
+  // Decodes every png in the given source and returns the serialized index
+  // for them.  If given, 'progressCallback' is called with each png path.
+  static ByteArray build(AssetSource& source, function<void(String const&)> progressCallback = {});
+
+  // Reads the index stored at IndexPath in the given source.
+  explicit ImageMetadataIndex(AssetSourcePtr source);
+
+  size_t size() const;
+
+  Entry const* entry(String const& path) const;
+  AlphaMask alphaMask(Entry const& entry) const;
+
+private:
+  AssetSourcePtr m_source;
+  // Kept open for reading masks, which may happen from any thread.
+  mutable Mutex m_deviceMutex;
+  IODevicePtr m_device;
+  uint64_t m_masksStart;
+  CaseInsensitiveStringMap<Entry> m_entries;
+};
+
+inline bool ImageMetadataIndex::AlphaMask::get(unsigned x, unsigned y) const {
+  size_t bit = (size_t)y * size[0] + x;
+  return ((uint8_t)bits[bit / 8] >> (bit % 8)) & 1;
+}
+
+}
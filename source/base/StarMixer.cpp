@@ -4,6 +4,11 @@
 #include "StarTime.hpp"
 #include "StarLogging.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STAR_MIXER_SSE2
+#endif
+
 namespace Star {
 
 namespace {
@@ -15,6 +20,63 @@ namespace {
     else
       return 1.0f / rampTime;
   }
+
+  // Adds interleaved 16 bit samples to the float mixing bus, scaling each
+  // channel by its gain, and the whole by a volume that ramps linearly from
+  // beginVolume at the first frame towards endVolume at rampFrames.
+  void mixVoice(float* bus, int16_t const* samples, size_t frames, unsigned channels,
+      float const* channelGains, float beginVolume, float endVolume, size_t rampFrames) {
+    float volumeStep = (endVolume - beginVolume) / rampFrames;
+    size_t f = 0;
+
+#ifdef STAR_MIXER_SSE2
+    // Mono and stereo are mixed four samples at a time, the frame index of
+    // each lane is tracked so that the volume ramp does not accumulate error.
+    if (channels == 1 || channels == 2) {
+      size_t framesPerStep = 4 / channels;
+      __m128 gains = channels == 1
+          ? _mm_set1_ps(channelGains[0])
+          : _mm_setr_ps(channelGains[0], channelGains[1], channelGains[0], channelGains[1]);
+      __m128 laneFrames = channels == 1 ? _mm_setr_ps(0, 1, 2, 3) : _mm_setr_ps(0, 0, 1, 1);
+      __m128 frameStep = _mm_set1_ps((float)framesPerStep);
+      __m128 begin = _mm_set1_ps(beginVolume);
+      __m128 step = _mm_set1_ps(volumeStep);
+
+      for (; f + framesPerStep <= frames; f += framesPerStep) {
+        __m128i packed = _mm_loadl_epi64((__m128i const*)(samples + f * channels));
+        __m128i widened = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        __m128 volume = _mm_add_ps(begin, _mm_mul_ps(step, laneFrames));
+        __m128 mixed = _mm_mul_ps(_mm_cvtepi32_ps(widened), _mm_mul_ps(gains, volume));
+        _mm_storeu_ps(bus + f * channels, _mm_add_ps(_mm_loadu_ps(bus + f * channels), mixed));
+        laneFrames = _mm_add_ps(laneFrames, frameStep);
+      }
+    }
+#endif
+
+    for (; f < frames; ++f) {
+      float volume = beginVolume + volumeStep * f;
+      for (unsigned c = 0; c < channels; ++c)
+        bus[f * channels + c] += samples[f * channels + c] * channelGains[c] * volume;
+    }
+  }
+
+  // Converts the mixing bus to 16 bit output, clamping to the valid range.
+  void writeMixBus(int16_t* out, float const* bus, size_t size) {
+    size_t i = 0;
+
+#ifdef STAR_MIXER_SSE2
+    __m128 low = _mm_set1_ps(-32767.0f);
+    __m128 high = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= size; i += 8) {
+      __m128i first = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(bus + i), low), high));
+      __m128i second = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(bus + i + 4), low), high));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(first, second));
+    }
+#endif
+
+    for (; i < size; ++i)
+      out[i] = (int16_t)clamp(bus[i], -32767.0f, 32767.0f);
+  }
 }
 
 AudioInstance::AudioInstance(Audio const& audio)
@@ -175,6 +237,16 @@ Mixer::Mixer(unsigned sampleRate, unsigned channels) {
   m_groupVolumes[MixerGroup::Instruments] = {1.0f, 1.0f, 0};
 
   m_speed = 1.0f;
+
+  m_pendingVoices = nullptr;
+  m_readVoices = nullptr;
+  m_retiredVoices = nullptr;
+}
+
+Mixer::~Mixer() {
+  delete m_pendingVoices.exchange(nullptr);
+  delete m_readVoices;
+  freeRetiredVoices();
 }
 
 unsigned Mixer::sampleRate() const {
@@ -219,6 +291,7 @@ void Mixer::setVolume(float volume, float rampTime) {
 void Mixer::play(AudioInstancePtr sample) {
   MutexLocker locker(m_queueMutex);
   m_audios.add(std::move(sample), AudioState{List<float>(m_channels, 1.0f)});
+  publishVoices();
 }
 
 void Mixer::stopAll(float rampTime) {
@@ -252,6 +325,9 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
 
   size_t bufferSize = frameCount * m_channels;
   m_mixBuffer.resize(bufferSize, 0);
+  m_mixBus.resize(bufferSize);
+  std::fill(m_mixBus.begin(), m_mixBus.end(), 0.0f);
+  m_channelGains.resize(channels);
 
   float time = (float)frameCount / sampleRate;
   float beginVolume = volume;
@@ -265,15 +341,19 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
   unsigned millisecondsInBuffer = (bufferSize * 1000) / (channels * sampleRate);
   auto sampleEndTime = sampleStartTime + millisecondsInBuffer;
 
-  for (size_t i = 0; i < bufferSize; ++i)
-    outBuffer[i] = 0;
+  if (auto voices = m_pendingVoices.exchange(nullptr, std::memory_order_acquire)) {
+    if (m_readVoices) {
+      m_readVoices->nextRetired = m_retiredVoices.load(std::memory_order_relaxed);
+      while (!m_retiredVoices.compare_exchange_weak(m_readVoices->nextRetired, m_readVoices, std::memory_order_release))
+        ;
+    }
+    m_readVoices = voices;
+  }
 
-  {
-    MutexLocker locker(m_queueMutex);
+  if (m_readVoices) {
     // Mix all active sounds
-    for (auto& p : m_audios) {
-      auto& audioInstance = p.first;
-      auto& audioState = p.second;
+    for (auto const& voice : m_readVoices->voices) {
+      auto const& audioInstance = voice.instance;
 
       MutexLocker audioLocker(audioInstance->m_mutex);
 
@@ -347,14 +427,10 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
             finished = true;
         }
 
-        for (size_t s = 0; s < ramt / channels; ++s) {
-          float vol = lerp((float)s / frameCount, beginVolume * groupVolume * audioStopVolBegin, endVolume * groupEndVolume * audioStopVolEnd);
-          for (size_t c = 0; c < channels; ++c) {
-            float sample = m_mixBuffer[s * channels + c] * vol * audioState.positionalChannelVolumes[c] * audioInstance->m_volume.value;
-            int16_t& outSample = outBuffer[s * channels + c];
-            outSample = clamp(sample + outSample, -32767.0f, 32767.0f);
-          }
-        }
+        for (size_t c = 0; c < channels; ++c)
+          m_channelGains[c] = voice.positionalChannelVolumes[c] * audioInstance->m_volume.value;
+        mixVoice(m_mixBus.ptr(), m_mixBuffer.ptr(), ramt / channels, channels, m_channelGains.ptr(),
+            beginVolume * groupVolume * audioStopVolBegin, endVolume * groupEndVolume * audioStopVolEnd, frameCount);
       } catch (Star::AudioException const& e) {
         Logger::error("Error reading audio '{}': {}", audioInstance->m_audio.name(), e.what());
         finished = true;
@@ -365,6 +441,8 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
     }
   }
 
+  writeMixBus(outBuffer, m_mixBus.ptr(), bufferSize);
+
   if (extraMixFunction)
     extraMixFunction(outBuffer, frameCount, channels);
 
@@ -409,6 +487,24 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
   }
 }
 
+void Mixer::publishVoices() {
+  auto voices = new VoiceList;
+  voices->voices.reserve(m_audios.size());
+  for (auto const& p : m_audios)
+    voices->voices.append(Voice{p.first, p.second.positionalChannelVolumes});
+  // A list that read never picked up is still owned here.
+  delete m_pendingVoices.exchange(voices, std::memory_order_acq_rel);
+}
+
+void Mixer::freeRetiredVoices() {
+  auto voices = m_retiredVoices.exchange(nullptr, std::memory_order_acquire);
+  while (voices) {
+    auto next = voices->nextRetired;
+    delete voices;
+    voices = next;
+  }
+}
+
 Mixer::EffectFunction Mixer::lowpass(size_t avgSize) const {
   struct LowPass {
     LowPass(size_t avgSize) : avgSize(avgSize) {}
@@ -494,8 +590,11 @@ void Mixer::update(float, PositionalAttenuationFunction positionalAttenuationFun
         }
         return false;
       });
+    publishVoices();
   }
 
+  freeRetiredVoices();
+
   {
     MutexLocker locker(m_effectsMutex);
     eraseWhere(m_effects, [](auto const& p) {
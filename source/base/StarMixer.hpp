@@ -100,6 +100,7 @@ public:
   typedef function<float(unsigned, Vec2F, float)> PositionalAttenuationFunction;
 
   Mixer(unsigned sampleRate, unsigned channels);
+  ~Mixer();
 
   unsigned sampleRate() const;
   unsigned channels() const;
@@ -148,6 +149,24 @@ private:
     List<float> positionalChannelVolumes;
   };
 
+  // Immutable snapshot of the playing audio and its positional volumes,
+  // handed from play / update to read without read taking m_queueMutex.
+  struct Voice {
+    AudioInstancePtr instance;
+    List<float> positionalChannelVolumes;
+  };
+  struct VoiceList {
+    List<Voice> voices;
+    // Links lists that read has retired, waiting to be freed by update.
+    VoiceList* nextRetired = nullptr;
+  };
+
+  // Must be called with m_queueMutex held.
+  void publishVoices();
+  // Frees the lists read has finished with, and so releases their audio
+  // instances, off the audio thread.
+  void freeRetiredVoices();
+
   Mutex m_mutex;
   unsigned m_sampleRate;
   unsigned m_channels;
@@ -157,11 +176,22 @@ private:
   Mutex m_queueMutex;
 
   HashMap<AudioInstancePtr, AudioState> m_audios;
+  // Voice lists are handed over with plain atomic pointer exchanges, so that
+  // read never locks or frees memory.  The latest published list waits in
+  // m_pendingVoices until read swaps it for m_readVoices, which only read
+  // touches, and read pushes the list it replaces onto m_retiredVoices.
+  atomic<VoiceList*> m_pendingVoices;
+  VoiceList* m_readVoices;
+  atomic<VoiceList*> m_retiredVoices;
 
   Mutex m_effectsMutex;
   StringMap<shared_ptr<EffectInfo>> m_effects;
 
   List<int16_t> m_mixBuffer;
+  // All voices are summed here at full precision before being converted to
+  // the 16 bit output once.
+  List<float> m_mixBus;
+  List<float> m_channelGains;
 
   Map<MixerGroup, RampedValue> m_groupVolumes;
   atomic<float> m_speed;
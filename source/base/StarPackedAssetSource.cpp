@@ -9,7 +9,8 @@
 namespace Star {
 
 void PackedAssetSource::build(DirectoryAssetSource& directorySource, String const& targetPackedFile,
-    StringList const& extensionSorting, BuildProgressCallback progressCallback) {
+    StringList const& extensionSorting, BuildProgressCallback progressCallback,
+    List<pair<String, ByteArray>> const& generatedAssets) {
   FilePtr file = File::open(targetPackedFile, IOMode::ReadWrite | IOMode::Truncate);
 
   DataStreamIODevice ds(file);
@@ -59,6 +60,11 @@ void PackedAssetSource::build(DirectoryAssetSource& directorySource, String cons
     ds.writeBytes(contents);
   }
 
+  for (auto const& pair : generatedAssets) {
+    index.add(pair.first, {ds.pos(), pair.second.size()});
+    ds.writeBytes(pair.second);
+  }
+
   uint64_t indexStart = ds.pos();
   ds.writeData("INDEX", 5);
   ds.write(directorySource.metadata());
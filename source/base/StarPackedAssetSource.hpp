@@ -22,8 +22,12 @@ public:
   //
   // If given, 'progressCallback' will be called with the total number of
   // files, the current file number, the file name, and the asset path.
+  //
+  // 'generatedAssets' are additional asset paths and their contents to pack
+  // after all of the directory assets.
   static void build(DirectoryAssetSource& directorySource, String const& targetPackedFile,
-      StringList const& extensionSorting = {}, BuildProgressCallback progressCallback = {});
+      StringList const& extensionSorting = {}, BuildProgressCallback progressCallback = {},
+      List<pair<String, ByteArray>> const& generatedAssets = {});
 
   PackedAssetSource(String const& packedFileName);
 
@@ -4,6 +4,7 @@
 #include "StarFile.hpp"
 #include "StarEncode.hpp"
 #include "StarLogging.hpp"
+#include "StarMemoryTracker.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarRoot.hpp"
 #include "StarVersion.hpp"
@@ -369,6 +370,8 @@ void ClientApplication::update() {
 }
 
 void ClientApplication::render() {
+  static MemoryTracker::Tag const RenderingMemoryTag = MemoryTracker::tag("rendering");
+  MemoryTagScope tagScope(RenderingMemoryTag);
   auto config = m_root->configuration();
   auto assets = m_root->assets();
   auto& renderer = Application::renderer();
@@ -1146,6 +1149,14 @@ void ClientApplication::updateRunning(float dt) {
     float fps = appController()->renderFps();
     LogMap::set("client_render_rate", strf("{:4.2f} FPS ({:4.2f}ms)", fps, (1.0f / appController()->renderFps()) * 1000.0f));
     LogMap::set("client_update_rate", strf("{:4.2f}Hz", appController()->updateRate()));
+    auto assetsMetrics = m_root->assets()->metrics();
+    LogMap::set("assets_requests", strf("{} fast / {} locked / {} coalesced, {} queued",
+        assetsMetrics.fastHits, assetsMetrics.slowRequests, assetsMetrics.coalescedWaits, assetsMetrics.queued));
+    LogMap::set("assets_lock_contention", strf("{} waits ({:4.2f}ms)", assetsMetrics.lockContentions, assetsMetrics.lockWaitTime * 1000.0));
+    auto audioStats = Audio::cacheStats();
+    LogMap::set("audio_decoded", strf("{:.1f}MiB, {} hits / {} misses, {:.2f}s decoding",
+        audioStats.decodedBytes / 1048576.0, audioStats.decodedHits, audioStats.decodedMisses, audioStats.decodeTime));
+    LogMap::set("audio_read_ahead", strf("{} streams, {} underruns", audioStats.readAheadStreams, audioStats.readAheadUnderruns));
     LogMap::set("player_pos", strf("[ ^#f45;{:4.2f}^reset;, ^#49f;{:4.2f}^reset; ]", m_player->position()[0], m_player->position()[1]));
     LogMap::set("player_vel", strf("[ ^#f45;{:4.2f}^reset;, ^#49f;{:4.2f}^reset; ]", m_player->velocity()[0], m_player->velocity()[1]));
     LogMap::set("player_aim", strf("[ ^#f45;{:4.2f}^reset;, ^#49f;{:4.2f}^reset; ]", aimPosition[0], aimPosition[1]));
@@ -13,6 +13,10 @@
 #include "StarDataStreamDevices.hpp"
 #include "StarSha256.hpp"
 #include "StarEncode.hpp"
+#include "StarThread.hpp"
+#include "StarTime.hpp"
+#include "StarXXHash.hpp"
+#include "StarOrderedMap.hpp"
 
 namespace Star {
 
@@ -50,6 +54,33 @@ namespace {
 #endif
   };
 
+  // Samples decoded per read-ahead step.
+  size_t const ReadAheadChunkSamples = 8192;
+
+  std::atomic<int64_t> decodeMicroseconds{0};
+  std::atomic<uint64_t> readAheadUnderruns{0};
+
+  // Wakes the read-ahead thread to top up stream buffers.
+  void requestReadAhead();
+
+  // Fully decoded samples by the digest of their compressed data.  Live
+  // decodes are always found through the weak pointers, the most recently
+  // used ones are also kept alive up to maxRetainedBytes.
+  struct DecodedCache {
+    Mutex mutex;
+    HashMap<uint64_t, std::weak_ptr<ByteArray const>> live;
+    OrderedHashMap<uint64_t, ByteArrayConstPtr> retained;
+    size_t retainedBytes = 0;
+    size_t maxRetainedBytes = Audio::DefaultDecodedCacheSize;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  DecodedCache& decodedCache() {
+    static DecodedCache cache;
+    return cache;
+  }
+
   template <typename T>
   T readLEType(IODevicePtr const& device) {
     T t;
@@ -180,7 +211,8 @@ public:
         ,
         m_deviceCallbacks(m_audioData)// Pass reference to cloned data
         ,
-        m_vorbisInfo(nullptr) {
+        m_vorbisInfo(nullptr),
+        m_readAheadTime(impl.m_readAheadTime) {
     setupCallbacks();
 
     // Make sure data stream is ready to be read
@@ -220,10 +252,11 @@ public:
     return (long int)static_cast<ExternalBuffer*>(datasource)->pos();
   };
 
-    CompressedAudioImpl(CompressedAudioImpl const& impl) {
+  CompressedAudioImpl(CompressedAudioImpl const& impl) {
     m_audioData = impl.m_audioData;
     m_memoryFile.reset(m_audioData->ptr(), m_audioData->size());
     m_vorbisInfo = nullptr;
+    m_readAheadTime = impl.m_readAheadTime;
   }
 
   CompressedAudioImpl(IODevicePtr audioData) {
@@ -275,36 +308,131 @@ public:
   }
 
   double totalTime() {
+    MutexLocker decodeLocker(m_decodeMutex);
     return ov_time_total(&m_vorbisFile, -1);
   }
 
   uint64_t totalSamples() {
+    MutexLocker decodeLocker(m_decodeMutex);
     return ov_pcm_total(&m_vorbisFile, -1);
   }
 
   void seekTime(double time) {
+    MutexLocker decodeLocker(m_decodeMutex);
+    clearReadAhead();
     int ret = ov_time_seek(&m_vorbisFile, time);
 
     if (ret != 0)
       throw StarException("Cannot seek ogg stream Audio::seekTime");
+    if (m_readAheadRegistered)
+      requestReadAhead();
   }
 
   void seekSample(uint64_t pos) {
+    MutexLocker decodeLocker(m_decodeMutex);
+    clearReadAhead();
     int ret = ov_pcm_seek(&m_vorbisFile, pos);
 
     if (ret != 0)
       throw StarException("Cannot seek ogg stream in Audio::seekSample");
+    if (m_readAheadRegistered)
+      requestReadAhead();
   }
 
   double currentTime() {
-    return ov_time_tell(&m_vorbisFile);
+    MutexLocker decodeLocker(m_decodeMutex);
+    MutexLocker bufferLocker(m_bufferMutex);
+    if (m_buffered == 0)
+      return ov_time_tell(&m_vorbisFile);
+    return (double)tellSample() / m_vorbisInfo->rate;
   }
 
   uint64_t currentSample() {
-    return ov_pcm_tell(&m_vorbisFile);
+    MutexLocker decodeLocker(m_decodeMutex);
+    MutexLocker bufferLocker(m_bufferMutex);
+    return tellSample();
   }
 
+  // Copies out of the read-ahead buffer when it has samples, which only takes
+  // m_bufferMutex for the copy, so reads never wait on the read-ahead thread
+  // decoding.  Only an empty buffer falls back to decoding in place.
   size_t readPartial(int16_t* buffer, size_t bufferSize) {
+    if (size_t read = readBuffered(buffer, bufferSize))
+      return read;
+
+    MutexLocker decodeLocker(m_decodeMutex);
+    // The read-ahead thread may have filled the buffer while we waited.
+    if (size_t read = readBuffered(buffer, bufferSize))
+      return read;
+
+    {
+      MutexLocker bufferLocker(m_bufferMutex);
+      // Until the read-ahead thread has filled the buffer once since the
+      // stream started or was seeked, an empty buffer is expected.
+      if (m_readAheadPrimed && !m_endOfStream)
+        ++readAheadUnderruns;
+    }
+    return decode(buffer, bufferSize);
+  }
+
+  double readAheadTime() const {
+    return m_readAheadTime;
+  }
+
+  void setReadAheadTime(double seconds) {
+    m_readAheadTime = seconds;
+  }
+
+  // Marks this stream as serviced by the read-ahead thread, returns false if
+  // it already was or does not want read-ahead.
+  bool registerReadAhead() {
+    MutexLocker decodeLocker(m_decodeMutex);
+    if (m_readAheadRegistered || m_readAheadTime <= 0)
+      return false;
+    m_readAheadRegistered = true;
+    return true;
+  }
+
+  // Decodes one more chunk if the read-ahead buffer is not full, returns true
+  // if it did.  The chunk is decoded without m_bufferMutex held, and only
+  // appended under it.
+  bool fillReadAhead() {
+    MutexLocker decodeLocker(m_decodeMutex);
+    size_t target = readAheadTarget();
+    {
+      MutexLocker bufferLocker(m_bufferMutex);
+      if (m_endOfStream || m_buffered >= target) {
+        m_readAheadFull = !m_endOfStream;
+        return false;
+      }
+    }
+
+    List<int16_t> chunk(ReadAheadChunkSamples);
+    size_t read = decode(chunk.ptr(), chunk.size());
+    chunk.resize(read);
+
+    MutexLocker bufferLocker(m_bufferMutex);
+    if (read == 0) {
+      m_endOfStream = true;
+      return false;
+    }
+    m_readAhead.append(std::move(chunk));
+    m_buffered += read;
+    m_readAheadPrimed = true;
+    return true;
+  }
+
+  uint64_t dataDigest() const {
+  #ifdef STAR_STREAM_AUDIO
+    return xxHash64(m_audioData->clone()->readBytesAbsolute(0, (size_t)m_audioData->size()));
+  #else
+    return xxHash64(*m_audioData);
+  #endif
+  }
+
+  // Reads directly from the stream, bypassing the read-ahead buffer.
+  size_t decode(int16_t* buffer, size_t bufferSize) {
+    int64_t start = Time::monotonicMicroseconds();
     int bitstream;
     int read = OV_HOLE;
     // ov_read takes int parameter, so do some magic here to make sure we don't
@@ -319,12 +447,46 @@ public:
     } while (read == OV_HOLE);
     if (read < 0)
       throw AudioException::format("Error in Audio::read ({})", read);
-    
+    decodeMicroseconds += Time::monotonicMicroseconds() - start;
+
     // read in bytes, returning number of int16_t samples.
     return read / 2;
   }
-  
+
 private:
+  size_t readAheadTarget() const {
+    return (size_t)(m_readAheadTime * m_vorbisInfo->rate) * m_vorbisInfo->channels;
+  }
+
+  // Once the read-ahead thread has filled the buffer and gone idle, it is
+  // woken again when reads have drained the buffer by half.
+  size_t readBuffered(int16_t* buffer, size_t bufferSize) {
+    size_t read = 0;
+    bool wantsFill = false;
+    {
+      MutexLocker bufferLocker(m_bufferMutex);
+      while (read < bufferSize && !m_readAhead.empty()) {
+        auto& chunk = m_readAhead.first();
+        size_t amount = min(bufferSize - read, chunk.size() - m_readAheadOffset);
+        std::copy(chunk.begin() + m_readAheadOffset, chunk.begin() + m_readAheadOffset + amount, buffer + read);
+        read += amount;
+        m_readAheadOffset += amount;
+        if (m_readAheadOffset == chunk.size()) {
+          m_readAhead.takeFirst();
+          m_readAheadOffset = 0;
+        }
+      }
+      m_buffered -= read;
+      if (m_readAheadFull && m_buffered < readAheadTarget() / 2) {
+        m_readAheadFull = false;
+        wantsFill = true;
+      }
+    }
+    if (wantsFill)
+      requestReadAhead();
+    return read;
+  }
+
   #ifdef STAR_STREAM_AUDIO
   IODevicePtr m_audioData;  
   IODeviceCallbacks m_deviceCallbacks;
@@ -335,8 +497,145 @@ private:
   ov_callbacks m_callbacks;
   OggVorbis_File m_vorbisFile;
   vorbis_info* m_vorbisInfo;
+
+  // Must be called with m_decodeMutex held.
+  void clearReadAhead() {
+    MutexLocker bufferLocker(m_bufferMutex);
+    m_readAhead.clear();
+    m_readAheadOffset = 0;
+    m_buffered = 0;
+    m_endOfStream = false;
+    m_readAheadPrimed = false;
+    m_readAheadFull = false;
+  }
+
+  uint64_t tellSample() {
+    return ov_pcm_tell(&m_vorbisFile) - m_buffered / m_vorbisInfo->channels;
+  }
+
+  // Guards the vorbis stream, which the read-ahead thread decodes from.
+  // Taken before m_bufferMutex when both are needed.
+  Mutex m_decodeMutex;
+  double m_readAheadTime = 0.0;
+  bool m_readAheadRegistered = false;
+
+  // Guards the read-ahead buffer, which is only held for short copies.
+  Mutex m_bufferMutex;
+  Deque<List<int16_t>> m_readAhead;
+  size_t m_readAheadOffset = 0;
+  size_t m_buffered = 0;
+  bool m_endOfStream = false;
+  // Whether the buffer has been filled at all since the stream started or
+  // was last seeked, and whether the read-ahead thread found it full.
+  bool m_readAheadPrimed = false;
+  bool m_readAheadFull = false;
 };
 
+namespace {
+  // Keeps the read-ahead buffers of all registered streams topped up.  Owned
+  // by a function static that stops and joins the thread at exit, after
+  // which streams simply decode in place.
+  class ReadAheadThread {
+  public:
+    static ReadAheadThread* singleton() {
+      static ReadAheadThread thread;
+      return s_running ? &thread : nullptr;
+    }
+
+    ReadAheadThread() {
+      s_running = true;
+    }
+
+    ~ReadAheadThread() {
+      s_running = false;
+      {
+        MutexLocker locker(m_mutex);
+        m_stop = true;
+        m_wakeup.signal();
+      }
+      if (m_thread)
+        m_thread->finish();
+    }
+
+    void add(CompressedAudioImplPtr const& impl) {
+      MutexLocker locker(m_mutex);
+      if (m_stop)
+        return;
+      m_streams.append(impl);
+      if (!m_thread)
+        m_thread = Thread::invoke("Audio::readAhead", [this]() { run(); });
+      m_fillRequested = true;
+      m_wakeup.signal();
+    }
+
+    void requestFill() {
+      MutexLocker locker(m_mutex);
+      m_fillRequested = true;
+      m_wakeup.signal();
+    }
+
+    size_t streamCount() {
+      MutexLocker locker(m_mutex);
+      return m_streams.size();
+    }
+
+  private:
+    static std::atomic<bool> s_running;
+
+    void run() {
+      while (true) {
+        List<CompressedAudioImplPtr> streams;
+        {
+          MutexLocker locker(m_mutex);
+          if (m_stop)
+            return;
+          m_streams.filter([](auto const& stream) { return !stream.expired(); });
+          for (auto const& stream : m_streams) {
+            if (auto impl = stream.lock())
+              streams.append(std::move(impl));
+          }
+          // Sleeps until a stream is added, seeked, or drained by half, so
+          // paused and full streams cost nothing.
+          if (streams.empty() || !m_fillRequested) {
+            m_wakeup.wait(m_mutex);
+            continue;
+          }
+          m_fillRequested = false;
+        }
+
+        // Fill streams round-robin one chunk at a time, so one stream starting
+        // up does not starve the rest.
+        bool filled = true;
+        while (filled && !m_stop) {
+          filled = false;
+          for (auto const& impl : streams) {
+            try {
+              filled |= impl->fillReadAhead();
+            } catch (std::exception const& e) {
+              Logger::error("Error decoding audio ahead: {}", outputException(e, false));
+              impl->setReadAheadTime(0.0);
+            }
+          }
+        }
+      }
+    }
+
+    Mutex m_mutex;
+    ConditionVariable m_wakeup;
+    bool m_fillRequested = false;
+    std::atomic<bool> m_stop{false};
+    List<std::weak_ptr<CompressedAudioImpl>> m_streams;
+    Maybe<ThreadFunction<void>> m_thread;
+  };
+
+  std::atomic<bool> ReadAheadThread::s_running{false};
+
+  void requestReadAhead() {
+    if (auto thread = ReadAheadThread::singleton())
+      thread->requestFill();
+  }
+}
+
 class UncompressedAudioImpl {
 public:
   #ifdef STAR_STREAM_AUDIO
@@ -363,7 +662,7 @@ public:
 
     int16_t buffer[1024];
     while (true) {
-      size_t ramt = impl.readPartial(buffer, 1024);
+      size_t ramt = impl.decode(buffer, 1024);
       if (ramt == 0)
         break;
       memDevice->writeFull((char*)buffer, ramt * 2);
@@ -397,7 +696,7 @@ public:
     int16_t buffer[1024];
     Buffer uncompressBuffer;
     while (true) {
-      size_t ramt = impl.readPartial(buffer, 1024);
+      size_t ramt = impl.decode(buffer, 1024);
 
       if (ramt == 0) {
         // End of stream reached
@@ -423,6 +722,12 @@ public:
     return true;
   }
 
+  #ifndef STAR_STREAM_AUDIO
+  ByteArrayConstPtr const& data() const {
+    return m_audioData;
+  }
+  #endif
+
   unsigned channels() {
     return m_channels;
   }
@@ -510,6 +815,37 @@ private:
   #endif
 };
 
+auto Audio::cacheStats() -> CacheStats {
+  CacheStats stats;
+  {
+    auto& cache = decodedCache();
+    MutexLocker locker(cache.mutex);
+    stats.decodedBytes = 0;
+    for (auto const& p : cache.live) {
+      if (auto decoded = p.second.lock())
+        stats.decodedBytes += decoded->size();
+    }
+    stats.decodedHits = cache.hits;
+    stats.decodedMisses = cache.misses;
+  }
+  stats.decodeTime = decodeMicroseconds / 1000000.0;
+  stats.readAheadStreams = 0;
+  if (auto thread = ReadAheadThread::singleton())
+    stats.readAheadStreams = thread->streamCount();
+  stats.readAheadUnderruns = readAheadUnderruns;
+  return stats;
+}
+
+void Audio::setDecodedCacheSize(size_t bytes) {
+  auto& cache = decodedCache();
+  MutexLocker locker(cache.mutex);
+  cache.maxRetainedBytes = bytes;
+  while (cache.retainedBytes > cache.maxRetainedBytes) {
+    cache.retainedBytes -= cache.retained.first().second->size();
+    cache.retained.removeFirst();
+  }
+}
+
 Audio::Audio(IODevicePtr device, String name) {
   m_name = name;
   if (!device->isOpen())
@@ -591,10 +927,56 @@ bool Audio::compressed() const {
 }
 
 void Audio::uncompress() {
-  if (m_compressed) {
+  if (!m_compressed)
+    return;
+
+#ifdef STAR_STREAM_AUDIO
+  m_uncompressed = make_shared<UncompressedAudioImpl>(*m_compressed);
+#else
+  // Identical compressed audio shares one decoded copy, which stays alive in
+  // the cache for a while after its last user so that frequently played
+  // effects are not decoded each time they are loaded.
+  auto& cache = decodedCache();
+  uint64_t digest = m_compressed->dataDigest();
+  ByteArrayConstPtr decoded;
+  {
+    MutexLocker locker(cache.mutex);
+    if (auto i = cache.retained.find(digest); i != cache.retained.end())
+      decoded = cache.retained.toBack(i)->second;
+    else
+      decoded = cache.live.value(digest).lock();
+    if (decoded)
+      ++cache.hits;
+    else
+      ++cache.misses;
+  }
+
+  if (decoded) {
+    m_uncompressed = make_shared<UncompressedAudioImpl>(decoded, m_compressed->channels(), m_compressed->sampleRate());
+  } else {
+    m_compressed->seekSample(0);
     m_uncompressed = make_shared<UncompressedAudioImpl>(*m_compressed);
-    m_compressed.reset();
+    decoded = m_uncompressed->data();
+
+    MutexLocker locker(cache.mutex);
+    eraseWhere(cache.live, [](auto const& p) { return p.second.expired(); });
+    cache.live[digest] = decoded;
+    if (decoded->size() <= cache.maxRetainedBytes && !cache.retained.contains(digest)) {
+      cache.retained.add(digest, decoded);
+      cache.retainedBytes += decoded->size();
+      while (cache.retainedBytes > cache.maxRetainedBytes) {
+        cache.retainedBytes -= cache.retained.first().second->size();
+        cache.retained.removeFirst();
+      }
+    }
   }
+#endif
+  m_compressed.reset();
+}
+
+void Audio::setReadAhead(double seconds) {
+  if (m_compressed)
+    m_compressed->setReadAheadTime(seconds);
 }
 
 void Audio::seekTime(double time) {
@@ -631,8 +1013,12 @@ size_t Audio::readPartial(int16_t* buffer, size_t bufferSize) {
 
   if (m_uncompressed)
     return m_uncompressed->readPartial(buffer, bufferSize);
-  else
-    return m_compressed->readPartial(buffer, bufferSize);
+
+  if (m_compressed->readAheadTime() > 0 && m_compressed->registerReadAhead()) {
+    if (auto thread = ReadAheadThread::singleton())
+      thread->add(m_compressed);
+  }
+  return m_compressed->readPartial(buffer, bufferSize);
 }
 
 size_t Audio::read(int16_t* buffer, size_t bufferSize) {
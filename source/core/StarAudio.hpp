@@ -27,6 +27,30 @@ STAR_EXCEPTION(AudioException, StarException);
 // instances is not expensive.
 class Audio {
 public:
+  // Statistics shared by all Audio instances.
+  struct CacheStats {
+    // Decoded samples shared between uncompressed Audio decoded from
+    // identical compressed data, and how often uncompress found them already
+    // decoded.
+    size_t decodedBytes;
+    uint64_t decodedHits;
+    uint64_t decodedMisses;
+    // Total time spent decoding, both fully and in read-ahead.
+    double decodeTime;
+    // Streams decoding ahead on the background thread, and the number of
+    // reads that found their read-ahead buffer empty and decoded in place.
+    size_t readAheadStreams;
+    uint64_t readAheadUnderruns;
+  };
+
+  static CacheStats cacheStats();
+
+  static size_t const DefaultDecodedCacheSize = 32 * 1024 * 1024;
+
+  // Decoded samples stay cached up to this many bytes after the last Audio
+  // using them is gone.
+  static void setDecodedCacheSize(size_t bytes);
+
   explicit Audio(IODevicePtr device, String name = "");
   Audio(Audio const& audio);
   Audio(Audio&& audio);
@@ -57,6 +81,12 @@ public:
   // is irreversible.
   void uncompress();
 
+  // If compressed, once this is first read it is decoded in chunks on a
+  // shared background thread, keeping about the given number of seconds
+  // buffered so that reads do not decode.  Copies of this Audio inherit the
+  // setting, zero disables.
+  void setReadAhead(double seconds);
+
   // This function seeks the data stream to the given time in seconds.
   void seekTime(double time);
 
@@ -368,6 +368,7 @@ Image DirectivesGroup::applyNewImage(Image const& image) const {
 }
 
 void DirectivesGroup::applyExistingImage(Image& image) const {
+  List<ImageOperation const*> operations;
   forEach([&](auto const& entry, Directives const& directives) {
     ImageOperation const& operation = entry.loadOperation(*directives);
     if (auto error = operation.ptr<ErrorImageOperation>())
@@ -376,8 +377,9 @@ void DirectivesGroup::applyExistingImage(Image& image) const {
       else
         std::rethrow_exception(error->cause.get<std::exception_ptr>());
     else
-      processImageOperation(operation, image);
+      operations.append(&operation);
   });
+  processImageOperations(operations, image);
 }
 
 size_t DirectivesGroup::hash() const {
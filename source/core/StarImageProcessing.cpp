@@ -354,126 +354,203 @@ StringList imageOperationReferences(List<ImageOperation> const& operations) {
   return references;
 }
 
-void processImageOperation(ImageOperation const& operation, Image& image, ImageReferenceCallback refCallback) {
-  if (image.bytesPerPixel() == 3) {
-    // Convert to an image format that has alpha so certain operations function properly
-    image = image.convert(image.pixelFormat() == PixelFormat::BGR24 ? PixelFormat::BGRA32 : PixelFormat::RGBA32);
-  }
-  if (auto op = operation.ptr<HueShiftImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      if (pixel[3] != 0)
-        pixel = Color::hueShiftVec4B(pixel, op->hueShiftAmount);
-    });
-  } else if (auto op = operation.ptr<SaturationShiftImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      if (pixel[3] != 0) {
-        Color color = Color::rgba(pixel);
-        color.setSaturation(clamp(color.saturation() + op->saturationShiftAmount, 0.0f, 1.0f));
-        pixel = color.toRgba();
-      }
-    });
-  } else if (auto op = operation.ptr<BrightnessMultiplyImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      if (pixel[3] != 0) {
-        Color color = Color::rgba(pixel);
-        color.setValue(clamp(color.value() * op->brightnessMultiply, 0.0f, 1.0f));
-        pixel = color.toRgba();
-      }
-    });
-  } else if (auto op = operation.ptr<FadeToColorImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      pixel[0] = op->rTable[pixel[0]];
-      pixel[1] = op->gTable[pixel[1]];
-      pixel[2] = op->bTable[pixel[2]];
-    });
-  } else if (auto op = operation.ptr<ScanLinesImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned y, Vec4B& pixel) {
-      if (y % 2 == 0) {
-        pixel[0] = op->fade1.rTable[pixel[0]];
-        pixel[1] = op->fade1.gTable[pixel[1]];
-        pixel[2] = op->fade1.bTable[pixel[2]];
-      } else {
-        pixel[0] = op->fade2.rTable[pixel[0]];
-        pixel[1] = op->fade2.gTable[pixel[1]];
-        pixel[2] = op->fade2.bTable[pixel[2]];
-      }
-    });
-  } else if (auto op = operation.ptr<SetColorImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      pixel[0] = op->color[0];
-      pixel[1] = op->color[1];
-      pixel[2] = op->color[2];
-    });
-  } else if (auto op = operation.ptr<ColorReplaceImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      if (auto m = op->colorReplaceMap.maybe(pixel))
-        pixel = *m;
-    });
+namespace {
+  // A per pixel operation, along with any images it references.
+  struct PixelStage {
+    ImageOperation const* operation;
+    List<Image const*> references;
+  };
+}
 
-  } else if (auto op = operation.ptr<AlphaMaskImageOperation>()) {
+// Operations whose result for each pixel only depends on that pixel, its
+// position, and referenced images.  Runs of these are fused into a single pass.
+static bool isPixelOperation(ImageOperation const& operation) {
+  return operation.is<HueShiftImageOperation>()
+    || operation.is<SaturationShiftImageOperation>()
+    || operation.is<BrightnessMultiplyImageOperation>()
+    || operation.is<FadeToColorImageOperation>()
+    || operation.is<ScanLinesImageOperation>()
+    || operation.is<SetColorImageOperation>()
+    || operation.is<ColorReplaceImageOperation>()
+    || operation.is<AlphaMaskImageOperation>()
+    || operation.is<BlendImageOperation>()
+    || operation.is<MultiplyImageOperation>();
+}
+
+static bool isPositionIndependent(ImageOperation const& operation) {
+  return !operation.is<ScanLinesImageOperation>()
+    && !operation.is<AlphaMaskImageOperation>()
+    && !operation.is<BlendImageOperation>();
+}
+
+// Returns nothing if the operation does nothing.
+static Maybe<PixelStage> makePixelStage(ImageOperation const& operation, ImageReferenceCallback const& refCallback) {
+  PixelStage stage{&operation, {}};
+  if (auto op = operation.ptr<AlphaMaskImageOperation>()) {
     if (op->maskImages.empty())
-      return;
+      return {};
 
     if (!refCallback)
       throw StarException("Missing image ref callback during AlphaMaskImageOperation in ImageProcessor::process");
 
-    List<Image const*> maskImages;
     for (auto const& reference : op->maskImages)
-      maskImages.append(refCallback(reference));
-
-    image.forEachPixel([&op, &maskImages](unsigned x, unsigned y, Vec4B& pixel) {
-      uint8_t maskAlpha = 0;
-      Vec2U pos = Vec2U(Vec2I(x, y) + op->offset);
-      for (auto mask : maskImages) {
-        if (pos[0] < mask->width() && pos[1] < mask->height()) {
-          if (op->mode == AlphaMaskImageOperation::Additive) {
-            // We produce our mask alpha from the maximum alpha of any of
-            // the
-            // mask images.
-            maskAlpha = std::max(maskAlpha, mask->get(pos)[3]);
-          } else if (op->mode == AlphaMaskImageOperation::Subtractive) {
-            // We produce our mask alpha from the minimum alpha of any of
-            // the
-            // mask images.
-            maskAlpha = std::min(maskAlpha, mask->get(pos)[3]);
-          }
-        }
-      }
-      pixel[3] = std::min(pixel[3], maskAlpha);
-    });
+      stage.references.append(refCallback(reference));
 
   } else if (auto op = operation.ptr<BlendImageOperation>()) {
     if (op->blendImages.empty())
-      return;
+      return {};
 
     if (!refCallback)
       throw StarException("Missing image ref callback during BlendImageOperation in ImageProcessor::process");
 
-    List<Image const*> blendImages;
     for (auto const& reference : op->blendImages)
-      blendImages.append(refCallback(reference));
-
-    image.forEachPixel([&op, &blendImages](unsigned x, unsigned y, Vec4B& pixel) {
-      Vec2U pos = Vec2U(Vec2I(x, y) + op->offset);
-      Vec4F fpixel = Color::v4bToFloat(pixel);
-      for (auto blend : blendImages) {
-        if (pos[0] < blend->width() && pos[1] < blend->height()) {
-          Vec4F blendPixel = Color::v4bToFloat(blend->get(pos));
-          if (op->mode == BlendImageOperation::Multiply)
-            fpixel = fpixel.piecewiseMultiply(blendPixel);
-          else if (op->mode == BlendImageOperation::Screen)
-            fpixel = Vec4F::filled(1.0f) - (Vec4F::filled(1.0f) - fpixel).piecewiseMultiply(Vec4F::filled(1.0f) - blendPixel);
+      stage.references.append(refCallback(reference));
+  }
+  return stage;
+}
+
+static void applyPixelStage(PixelStage const& stage, unsigned x, unsigned y, Vec4B& pixel) {
+  ImageOperation const& operation = *stage.operation;
+  if (auto op = operation.ptr<HueShiftImageOperation>()) {
+    if (pixel[3] != 0)
+      pixel = Color::hueShiftVec4B(pixel, op->hueShiftAmount);
+  } else if (auto op = operation.ptr<SaturationShiftImageOperation>()) {
+    if (pixel[3] != 0) {
+      Color color = Color::rgba(pixel);
+      color.setSaturation(clamp(color.saturation() + op->saturationShiftAmount, 0.0f, 1.0f));
+      pixel = color.toRgba();
+    }
+  } else if (auto op = operation.ptr<BrightnessMultiplyImageOperation>()) {
+    if (pixel[3] != 0) {
+      Color color = Color::rgba(pixel);
+      color.setValue(clamp(color.value() * op->brightnessMultiply, 0.0f, 1.0f));
+      pixel = color.toRgba();
+    }
+  } else if (auto op = operation.ptr<FadeToColorImageOperation>()) {
+    pixel[0] = op->rTable[pixel[0]];
+    pixel[1] = op->gTable[pixel[1]];
+    pixel[2] = op->bTable[pixel[2]];
+  } else if (auto op = operation.ptr<ScanLinesImageOperation>()) {
+    if (y % 2 == 0) {
+      pixel[0] = op->fade1.rTable[pixel[0]];
+      pixel[1] = op->fade1.gTable[pixel[1]];
+      pixel[2] = op->fade1.bTable[pixel[2]];
+    } else {
+      pixel[0] = op->fade2.rTable[pixel[0]];
+      pixel[1] = op->fade2.gTable[pixel[1]];
+      pixel[2] = op->fade2.bTable[pixel[2]];
+    }
+  } else if (auto op = operation.ptr<SetColorImageOperation>()) {
+    pixel[0] = op->color[0];
+    pixel[1] = op->color[1];
+    pixel[2] = op->color[2];
+  } else if (auto op = operation.ptr<ColorReplaceImageOperation>()) {
+    if (auto m = op->colorReplaceMap.ptr(pixel))
+      pixel = *m;
+  } else if (auto op = operation.ptr<AlphaMaskImageOperation>()) {
+    uint8_t maskAlpha = 0;
+    Vec2U pos = Vec2U(Vec2I(x, y) + op->offset);
+    for (auto mask : stage.references) {
+      if (pos[0] < mask->width() && pos[1] < mask->height()) {
+        if (op->mode == AlphaMaskImageOperation::Additive) {
+          // We produce our mask alpha from the maximum alpha of any of
+          // the
+          // mask images.
+          maskAlpha = std::max(maskAlpha, mask->get(pos)[3]);
+        } else if (op->mode == AlphaMaskImageOperation::Subtractive) {
+          // We produce our mask alpha from the minimum alpha of any of
+          // the
+          // mask images.
+          maskAlpha = std::min(maskAlpha, mask->get(pos)[3]);
         }
       }
-      pixel = Color::v4fToByte(fpixel);
+    }
+    pixel[3] = std::min(pixel[3], maskAlpha);
+  } else if (auto op = operation.ptr<BlendImageOperation>()) {
+    Vec2U pos = Vec2U(Vec2I(x, y) + op->offset);
+    Vec4F fpixel = Color::v4bToFloat(pixel);
+    for (auto blend : stage.references) {
+      if (pos[0] < blend->width() && pos[1] < blend->height()) {
+        Vec4F blendPixel = Color::v4bToFloat(blend->get(pos));
+        if (op->mode == BlendImageOperation::Multiply)
+          fpixel = fpixel.piecewiseMultiply(blendPixel);
+        else if (op->mode == BlendImageOperation::Screen)
+          fpixel = Vec4F::filled(1.0f) - (Vec4F::filled(1.0f) - fpixel).piecewiseMultiply(Vec4F::filled(1.0f) - blendPixel);
+      }
+    }
+    pixel = Color::v4fToByte(fpixel);
+  } else if (auto op = operation.ptr<MultiplyImageOperation>()) {
+    pixel = pixel.combine(op->color, [](uint8_t a, uint8_t b) -> uint8_t {
+        return (uint8_t)(((int)a * (int)b) / 255);
+      });
+  }
+}
+
+// Applies every stage to each pixel in a single pass over the image.
+static void processPixelStages(List<PixelStage> const& stages, Image& image) {
+  if (stages.empty())
+    return;
+
+  bool positionIndependent = true;
+  for (auto const& stage : stages)
+    positionIndependent &= isPositionIndependent(*stage.operation);
+
+  if (!positionIndependent) {
+    image.forEachPixel([&stages](unsigned x, unsigned y, Vec4B& pixel) {
+      for (auto const& stage : stages)
+        applyPixelStage(stage, x, y, pixel);
     });
+    return;
+  }
 
-  } else if (auto op = operation.ptr<MultiplyImageOperation>()) {
-    image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      pixel = pixel.combine(op->color, [](uint8_t a, uint8_t b) -> uint8_t {
-          return (uint8_t)(((int)a * (int)b) / 255);
-        });
+  auto applyStages = [&stages](Vec4B pixel) {
+    for (auto const& stage : stages)
+      applyPixelStage(stage, 0, 0, pixel);
+    return pixel;
+  };
+
+  // Sprites use very few distinct colors, so the result of the whole chain is
+  // remembered per color in a small direct mapped table.  Every slot starts
+  // out holding the (valid) result for fully transparent black.
+  Array<uint32_t, 256> keys;
+  Array<Vec4B, 256> values;
+  keys.fill(0);
+  values.fill(applyStages(Vec4B::filled(0)));
+
+  auto lookup = [&](Vec4B& pixel) {
+    uint32_t key = (uint32_t)pixel[0] | (uint32_t)pixel[1] << 8 | (uint32_t)pixel[2] << 16 | (uint32_t)pixel[3] << 24;
+    size_t slot = (key * 2654435761u) >> 24;
+    if (keys[slot] != key) {
+      keys[slot] = key;
+      values[slot] = applyStages(pixel);
+    }
+    pixel = values[slot];
+  };
+
+  if (image.pixelFormat() == PixelFormat::RGBA32) {
+    uint8_t* data = image.data();
+    size_t pixelCount = (size_t)image.width() * image.height();
+    for (size_t i = 0; i < pixelCount; ++i) {
+      Vec4B pixel;
+      memcpy(pixel.ptr(), data + i * 4, 4);
+      lookup(pixel);
+      memcpy(data + i * 4, pixel.ptr(), 4);
+    }
+  } else {
+    image.forEachPixel([&lookup](unsigned, unsigned, Vec4B& pixel) {
+      lookup(pixel);
     });
+  }
+}
+
+void processImageOperation(ImageOperation const& operation, Image& image, ImageReferenceCallback refCallback) {
+  if (image.bytesPerPixel() == 3) {
+    // Convert to an image format that has alpha so certain operations function properly
+    image = image.convert(image.pixelFormat() == PixelFormat::BGR24 ? PixelFormat::BGRA32 : PixelFormat::RGBA32);
+  }
+  if (isPixelOperation(operation)) {
+    if (auto stage = makePixelStage(operation, refCallback))
+      processPixelStages({stage.take()}, image);
 
   } else if (auto op = operation.ptr<BorderImageOperation>()) {
     Image borderImage(image.size() + Vec2U::filled(op->pixels * 2), PixelFormat::RGBA32);
@@ -575,9 +652,35 @@ void processImageOperation(ImageOperation const& operation, Image& image, ImageR
   }
 }
 
+void processImageOperations(List<ImageOperation const*> const& operations, Image& image, ImageReferenceCallback refCallback) {
+  if (operations.empty())
+    return;
+
+  if (image.bytesPerPixel() == 3) {
+    // Convert to an image format that has alpha so certain operations function properly
+    image = image.convert(image.pixelFormat() == PixelFormat::BGR24 ? PixelFormat::BGRA32 : PixelFormat::RGBA32);
+  }
+
+  List<PixelStage> stages;
+  for (auto operation : operations) {
+    if (isPixelOperation(*operation)) {
+      if (auto stage = makePixelStage(*operation, refCallback))
+        stages.append(stage.take());
+    } else if (!operation->is<NullImageOperation>()) {
+      processPixelStages(stages, image);
+      stages.clear();
+      processImageOperation(*operation, image, refCallback);
+    }
+  }
+  processPixelStages(stages, image);
+}
+
 Image processImageOperations(List<ImageOperation> const& operations, Image image, ImageReferenceCallback refCallback) {
+  List<ImageOperation const*> operationPtrs;
+  operationPtrs.reserve(operations.size());
   for (auto const& operation : operations)
-    processImageOperation(operation, image, refCallback);
+    operationPtrs.append(&operation);
+  processImageOperations(operationPtrs, image, refCallback);
 
   return image;
 }
@@ -158,4 +158,8 @@ void processImageOperation(ImageOperation const& operation, Image& input, ImageR
 
 Image processImageOperations(List<ImageOperation> const& operations, Image input, ImageReferenceCallback refCallback = {});
 
+// Applies the operations in order to the given image.  Runs of consecutive per
+// pixel operations are fused into a single pass over the image.
+void processImageOperations(List<ImageOperation const*> const& operations, Image& image, ImageReferenceCallback refCallback = {});
+
 }
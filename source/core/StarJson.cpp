@@ -105,7 +105,7 @@ Json Json::ofType(Type t) {
 }
 
 Json Json::parse(String const& string) {
-  return inputUtf32Json<String::const_iterator>(string.begin(), string.end(), JsonParseType::Value);
+  return inputUtf8JsonBuffer(string.utf8Ptr(), string.utf8Ptr() + string.utf8Size(), JsonParseType::Value);
 }
 
 Json Json::parseSequence(String const& sequence) {
@@ -113,7 +113,7 @@ Json Json::parseSequence(String const& sequence) {
 }
 
 Json Json::parseJson(String const& json) {
-  return inputUtf32Json<String::const_iterator>(json.begin(), json.end(), JsonParseType::Top);
+  return inputUtf8JsonBuffer(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), JsonParseType::Top);
 }
 
 Json::Json() {}
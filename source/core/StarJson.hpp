@@ -267,6 +267,8 @@ public:
   void getHash(XXHash3& hasher) const;
 
 private:
+  friend class JsonInterner;
+
   Json const* ptr(size_t index) const;
   Json const* ptr(String const& key) const;
 
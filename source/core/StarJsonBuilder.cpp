@@ -1,8 +1,422 @@
 #include "StarJsonBuilder.hpp"
 #include "StarLexicalCast.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STAR_JSON_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 namespace Star {
 
+namespace {
+#ifdef STAR_JSON_SSE2
+  inline unsigned firstSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+#endif
+
+  // Recursive descent parser that mirrors JsonParser, but works on raw UTF-8
+  // bytes and constructs Json values in place.  Line and column information
+  // is only computed when an error is actually reported.
+  class Utf8JsonBufferParser {
+  public:
+    Utf8JsonBufferParser(char const* begin, char const* end)
+      : m_begin(begin), m_pos(begin), m_end(end), m_error(nullptr) {}
+
+    Json parse(JsonParseType parseType) {
+      Json result;
+      try {
+        white();
+        if (parseType == JsonParseType::Top) {
+          if (peek() != '{' && peek() != '[')
+            error("expected JSON object or array at top level");
+          result = value();
+        } else {
+          result = value();
+        }
+        white();
+      } catch (ParsingException const&) {
+        auto position = linePosition();
+        throw JsonParsingException(strf("Error parsing json: {} at {}:{}", m_error, position.first, position.second));
+      }
+
+      if (m_pos != m_end) {
+        auto position = linePosition();
+        throw JsonParsingException(strf("Error extra data at end of input at {}:{}", position.first, position.second));
+      }
+
+      return result;
+    }
+
+  private:
+    class ParsingException {};
+
+    char peek() const {
+      return m_pos != m_end ? *m_pos : 0;
+    }
+
+    Json value() {
+      switch (peek()) {
+        case '{':
+          return object();
+        case '[':
+          return array();
+        case '"':
+          return Json(string());
+        case '-':
+          return number();
+        case 0:
+          error("unexpected end of stream parsing value");
+        default:
+          if (*m_pos >= '0' && *m_pos <= '9')
+            return number();
+          return word();
+      }
+    }
+
+    Json object() {
+      ++m_pos;
+      white();
+      if (peek() == '}') {
+        ++m_pos;
+        return JsonObject();
+      }
+
+      // Members are inserted in reverse order, which is what JsonBuilderStream
+      // does, so that the resulting table iterates identically.
+      size_t membersStart = m_members.size();
+      while (true) {
+        String key = string();
+
+        white();
+        if (peek() != ':')
+          error("bad object, should be ':'");
+        ++m_pos;
+        white();
+
+        Json member = value();
+        m_members.append({std::move(key), std::move(member)});
+
+        white();
+        char c = peek();
+        if (c == '}') {
+          ++m_pos;
+          break;
+        } else if (c == ',') {
+          ++m_pos;
+          white();
+        } else if (c == 0) {
+          error("unexpected end of stream parsing object.");
+        } else {
+          error("bad object, should be '}' or ','");
+        }
+      }
+
+      JsonObject object;
+      object.reserve(m_members.size() - membersStart);
+      while (m_members.size() > membersStart) {
+        auto member = m_members.takeLast();
+        if (!object.insert(member.first, std::move(member.second)).second)
+          throw JsonParsingException(strf("Json object contains a duplicate entry for key '{}'", member.first));
+      }
+      return object;
+    }
+
+    Json array() {
+      ++m_pos;
+      JsonArray array;
+      white();
+      if (peek() == ']') {
+        ++m_pos;
+        return array;
+      }
+
+      while (true) {
+        array.append(value());
+        white();
+        char c = peek();
+        if (c == ']') {
+          ++m_pos;
+          return array;
+        } else if (c == ',') {
+          ++m_pos;
+          white();
+        } else if (c == 0) {
+          error("unexpected end of stream parsing array.");
+        } else {
+          error("bad array, should be ',' or ']'");
+        }
+      }
+    }
+
+    Json number() {
+      char const* start = m_pos;
+      bool isDouble = false;
+
+      if (peek() == '-')
+        ++m_pos;
+
+      if (peek() == '0') {
+        ++m_pos;
+      } else if (peek() > '0' && peek() <= '9') {
+        skipDigits();
+      } else {
+        error("bad number, must start with digit");
+      }
+
+      if (peek() == '.') {
+        isDouble = true;
+        ++m_pos;
+        skipDigits();
+      }
+
+      if (peek() == 'e' || peek() == 'E') {
+        isDouble = true;
+        ++m_pos;
+        if (peek() == '-' || peek() == '+')
+          ++m_pos;
+        skipDigits();
+      }
+
+      if (isDouble) {
+        double d;
+        if (!tryLexicalCast(d, start, m_pos))
+          error("bad double");
+        return Json(d);
+      } else {
+        long long i;
+        if (!tryLexicalCast(i, start, m_pos))
+          error("bad integer");
+        return Json(i);
+      }
+    }
+
+    void skipDigits() {
+      while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+        ++m_pos;
+    }
+
+    // true, false, or null
+    Json word() {
+      switch (*m_pos) {
+        case 't':
+          ++m_pos;
+          check("rue");
+          return Json(true);
+        case 'f':
+          ++m_pos;
+          check("alse");
+          return Json(false);
+        case 'n':
+          ++m_pos;
+          check("ull");
+          return Json();
+        default:
+          error("unexpected character parsing word");
+      }
+    }
+
+    void check(char const* rest) {
+      for (; *rest; ++rest) {
+        if (m_pos == m_end || *m_pos == 0)
+          error("unexpected end of stream parsing word");
+        if (*m_pos != *rest)
+          error("unexpected character in word");
+        ++m_pos;
+      }
+    }
+
+    // Returns a pointer to the first byte in [pos, end) that is a quote, a
+    // backslash, a null, or not ASCII.  Everything before it can be copied
+    // verbatim.
+    static char const* scanPlain(char const* pos, char const* end) {
+#ifdef STAR_JSON_SSE2
+      __m128i const quote = _mm_set1_epi8('"');
+      __m128i const backslash = _mm_set1_epi8('\\');
+      __m128i const zero = _mm_setzero_si128();
+      while (end - pos >= 16) {
+        __m128i chunk = _mm_loadu_si128((__m128i const*)pos);
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(chunk, zero));
+        // movemask picks up the high bit of every byte, which also catches
+        // the start of any multi byte UTF-8 sequence.
+        int mask = _mm_movemask_epi8(_mm_or_si128(special, chunk));
+        if (mask != 0)
+          return pos + firstSetBit((unsigned)mask);
+        pos += 16;
+      }
+#endif
+      while (pos != end) {
+        unsigned char c = *pos;
+        if (c == '"' || c == '\\' || c == 0 || c >= 0x80)
+          return pos;
+        ++pos;
+      }
+      return pos;
+    }
+
+    String string() {
+      if (peek() != '"')
+        error("bad string, should be '\"'");
+      ++m_pos;
+
+      std::string str;
+      while (true) {
+        char const* run = m_pos;
+        m_pos = scanPlain(m_pos, m_end);
+        str.append(run, m_pos);
+
+        unsigned char c = peek();
+        if (c == '"') {
+          ++m_pos;
+          return String(std::move(str));
+        } else if (c == '\\') {
+          ++m_pos;
+          escape(str);
+        } else if (c == 0) {
+          error("unexpected end of stream reading string!");
+        } else {
+          // Validate and copy a single multi byte UTF-8 sequence, throws
+          // UnicodeException just as U8ToU32Iterator would.
+          Utf32Type codepoint;
+          size_t len = utf8DecodeChar(m_pos, &codepoint, m_end - m_pos);
+          str.append(m_pos, len);
+          m_pos += len;
+        }
+      }
+    }
+
+    void escape(std::string& str) {
+      char c = peek();
+      if (c == 'u') {
+        ++m_pos;
+        Utf32Type codepoint = hexStringToUtf32(hexQuad());
+        if (isUtf16LeadSurrogate(codepoint)) {
+          check("\\u");
+          codepoint = hexStringToUtf32(hexQuad(), codepoint);
+        }
+        char buffer[6];
+        str.append(buffer, utf8EncodeChar(buffer, codepoint));
+        return;
+      }
+
+      switch (c) {
+        case '"':
+          str += '"';
+          break;
+        case '\\':
+          str += '\\';
+          break;
+        case '/':
+          str += '/';
+          break;
+        case 'b':
+          str += '\b';
+          break;
+        case 'f':
+          str += '\f';
+          break;
+        case 'n':
+          str += '\n';
+          break;
+        case 'r':
+          str += '\r';
+          break;
+        case 't':
+          str += '\t';
+          break;
+        default:
+          error("bad string escape character");
+      }
+      ++m_pos;
+    }
+
+    std::string hexQuad() {
+      std::string hexString;
+      for (int i = 0; i < 4; ++i) {
+        hexString.push_back(peek());
+        if (m_pos != m_end)
+          ++m_pos;
+      }
+      return hexString;
+    }
+
+    // Will skip whitespace and comments between tokens.
+    void white() {
+      while (m_pos != m_end) {
+        char c = *m_pos;
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+          ++m_pos;
+        } else if (c == '/') {
+          ++m_pos;
+          if (peek() == '/') {
+            while (m_pos != m_end && *m_pos != '\n')
+              ++m_pos;
+          } else if (peek() == '*') {
+            ++m_pos;
+            while (true) {
+              if (m_pos == m_end)
+                error("/* comment has no matching */");
+              if (*m_pos++ == '*' && peek() == '/') {
+                ++m_pos;
+                break;
+              }
+            }
+          } else {
+            error("/ character in whitespace is not followed by '/' or '*', invalid comment");
+          }
+        } else if (c == '\xef' && m_end - m_pos >= 3 && m_pos[1] == '\xbb' && m_pos[2] == '\xbf') {
+          // BOM or ZWNBSP
+          m_pos += 3;
+        } else {
+          break;
+        }
+      }
+    }
+
+    [[noreturn]] void error(char const* msg) {
+      m_error = msg;
+      throw ParsingException();
+    }
+
+    // One based line and column of the current position, where the column
+    // counts codepoints to match JsonParser.
+    pair<size_t, size_t> linePosition() const {
+      size_t line = 1;
+      size_t column = 1;
+      for (char const* p = m_begin; p != m_pos; ++p) {
+        if (*p == '\n') {
+          ++line;
+          column = 1;
+        } else if ((*p & 0xc0) != 0x80) {
+          ++column;
+        }
+      }
+      return {line, column};
+    }
+
+    char const* m_begin;
+    char const* m_pos;
+    char const* m_end;
+    char const* m_error;
+    List<pair<String, Json>> m_members;
+  };
+}
+
+Json inputUtf8JsonBuffer(char const* begin, char const* end, JsonParseType parseType) {
+  starAssert(parseType != JsonParseType::Sequence);
+  return Utf8JsonBufferParser(begin, end).parse(parseType);
+}
+
 void JsonBuilderStream::beginObject() {
   pushSentry();
 }
@@ -49,8 +49,19 @@ public:
   static void toJsonStream(Json const& val, JsonStream& stream, bool sort);
 };
 
+// Parses UTF-8 json directly out of a contiguous buffer into a Json value,
+// skipping the intermediate UTF-32 conversion and JsonStream calls.  Accepts
+// the same grammar and reports the same errors as JsonParser, but does not
+// support JsonParseType::Sequence.
+Json inputUtf8JsonBuffer(char const* begin, char const* end, JsonParseType parseType);
+
 template <typename InputIterator>
 Json inputUtf8Json(InputIterator begin, InputIterator end, JsonParseType parseType) {
+  if constexpr (std::is_convertible_v<InputIterator, char const*>) {
+    if (parseType != JsonParseType::Sequence)
+      return inputUtf8JsonBuffer(begin, end, parseType);
+  }
+
   typedef U8ToU32Iterator<InputIterator> Utf32Input;
   typedef JsonParser<Utf32Input> Parser;
 
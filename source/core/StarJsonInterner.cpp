@@ -0,0 +1,193 @@
+#include "StarJsonInterner.hpp"
+#include "StarAlgorithm.hpp"
+
+namespace Star {
+
+// Doubles are only identical if their representation is, so that -0.0 and
+// 0.0 are never merged.
+static bool bitsEqual(double a, double b) {
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+Json JsonInterner::intern(Json const& json) {
+  return internValue(json, false);
+}
+
+size_t JsonInterner::cleanup() {
+  // A single pass, objects before the arrays and strings they may hold, which
+  // may be in other shards.  Containers left referenced only by containers
+  // released here are released by the next cleanup.
+  size_t released = 0;
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    size_t sizeBefore = shard.objects.size();
+    eraseWhere(shard.objects, [](JsonObjectConstPtr const& o) { return o.unique(); });
+    released += sizeBefore - shard.objects.size();
+  }
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    size_t sizeBefore = shard.arrays.size();
+    eraseWhere(shard.arrays, [](JsonArrayConstPtr const& a) { return a.unique(); });
+    released += sizeBefore - shard.arrays.size();
+  }
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    size_t sizeBefore = shard.strings.size();
+    eraseWhere(shard.strings, [](StringConstPtr const& s) { return s.unique(); });
+    released += sizeBefore - shard.strings.size();
+  }
+  return released;
+}
+
+void JsonInterner::clear() {
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    shard.strings.clear();
+    shard.arrays.clear();
+    shard.objects.clear();
+  }
+}
+
+size_t JsonInterner::size() const {
+  size_t size = 0;
+  for (auto const& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    size += shard.strings.size() + shard.arrays.size() + shard.objects.size();
+  }
+  return size;
+}
+
+size_t JsonInterner::StringHash::operator()(StringConstPtr const& s) const {
+  return hash<String>()(*s);
+}
+
+bool JsonInterner::StringEquals::operator()(StringConstPtr const& a, StringConstPtr const& b) const {
+  return *a == *b;
+}
+
+size_t JsonInterner::ArrayHash::operator()(JsonArrayConstPtr const& a) const {
+  size_t h = a->size();
+  for (auto const& v : *a)
+    hashCombine(h, identityHash(v));
+  return h;
+}
+
+bool JsonInterner::ArrayEquals::operator()(JsonArrayConstPtr const& a, JsonArrayConstPtr const& b) const {
+  if (a->size() != b->size())
+    return false;
+  for (size_t i = 0; i < a->size(); ++i) {
+    if (!identical(a->at(i), b->at(i)))
+      return false;
+  }
+  return true;
+}
+
+size_t JsonInterner::ObjectHash::operator()(JsonObjectConstPtr const& o) const {
+  // Object iteration order depends on insertion history, so entries are
+  // combined in an order independent way.
+  size_t h = 0;
+  for (auto const& p : *o) {
+    size_t entry = hash<String>()(p.first);
+    hashCombine(entry, identityHash(p.second));
+    h += entry;
+  }
+  hashCombine(h, o->size());
+  return h;
+}
+
+bool JsonInterner::ObjectEquals::operator()(JsonObjectConstPtr const& a, JsonObjectConstPtr const& b) const {
+  if (a->size() != b->size())
+    return false;
+  for (auto const& p : *a) {
+    auto i = b->find(p.first);
+    if (i == b->end() || !identical(p.second, i->second))
+      return false;
+  }
+  return true;
+}
+
+size_t JsonInterner::identityHash(Json const& json) {
+  size_t h = json.m_data.typeIndex();
+  if (auto d = json.m_data.ptr<double>())
+    hashCombine(h, std::hash<double>()(*d));
+  else if (auto b = json.m_data.ptr<bool>())
+    hashCombine(h, *b);
+  else if (auto i = json.m_data.ptr<int64_t>())
+    hashCombine(h, std::hash<int64_t>()(*i));
+  else if (auto s = json.m_data.ptr<StringConstPtr>())
+    hashCombine(h, std::hash<void const*>()(s->get()));
+  else if (auto a = json.m_data.ptr<JsonArrayConstPtr>())
+    hashCombine(h, std::hash<void const*>()(a->get()));
+  else if (auto o = json.m_data.ptr<JsonObjectConstPtr>())
+    hashCombine(h, std::hash<void const*>()(o->get()));
+  return h;
+}
+
+bool JsonInterner::identical(Json const& a, Json const& b) {
+  if (a.m_data.typeIndex() != b.m_data.typeIndex())
+    return false;
+  if (auto d = a.m_data.ptr<double>())
+    return bitsEqual(*d, b.m_data.get<double>());
+  else if (auto v = a.m_data.ptr<bool>())
+    return *v == b.m_data.get<bool>();
+  else if (auto i = a.m_data.ptr<int64_t>())
+    return *i == b.m_data.get<int64_t>();
+  else if (auto s = a.m_data.ptr<StringConstPtr>())
+    return *s == b.m_data.get<StringConstPtr>();
+  else if (auto r = a.m_data.ptr<JsonArrayConstPtr>())
+    return *r == b.m_data.get<JsonArrayConstPtr>();
+  else if (auto o = a.m_data.ptr<JsonObjectConstPtr>())
+    return *o == b.m_data.get<JsonObjectConstPtr>();
+  return true;
+}
+
+Json JsonInterner::internValue(Json const& json, bool share) {
+  Json result;
+  if (auto s = json.m_data.ptr<StringConstPtr>()) {
+    result.m_data = share ? internString(*s) : *s;
+
+  } else if (auto a = json.m_data.ptr<JsonArrayConstPtr>()) {
+    auto array = make_shared<JsonArray>();
+    array->reserve((*a)->size());
+    for (auto const& v : **a)
+      array->append(internValue(v, true));
+    result.m_data = share ? internArray(std::move(array)) : JsonArrayConstPtr(std::move(array));
+
+  } else if (auto o = json.m_data.ptr<JsonObjectConstPtr>()) {
+    auto object = make_shared<JsonObject>();
+    object->reserve((*o)->size());
+    for (auto const& p : **o)
+      object->add(p.first, internValue(p.second, true));
+    result.m_data = share ? internObject(std::move(object)) : JsonObjectConstPtr(std::move(object));
+
+  } else {
+    result = json;
+  }
+  return result;
+}
+
+JsonInterner::Shard& JsonInterner::shard(size_t hash) {
+  // The sets bucket by the low bits of the hash, so shards are picked by the
+  // high bits, or every set would only ever use a sixteenth of its buckets.
+  return m_shards[(hash >> (sizeof(size_t) * 8 - 8)) % ShardCount];
+}
+
+StringConstPtr JsonInterner::internString(StringConstPtr const& string) {
+  auto& s = shard(StringHash()(string));
+  MutexLocker locker(s.mutex);
+  return *s.strings.insert(string).first;
+}
+
+JsonArrayConstPtr JsonInterner::internArray(JsonArrayConstPtr array) {
+  auto& s = shard(ArrayHash()(array));
+  MutexLocker locker(s.mutex);
+  return *s.arrays.insert(std::move(array)).first;
+}
+
+JsonObjectConstPtr JsonInterner::internObject(JsonObjectConstPtr object) {
+  auto& s = shard(ObjectHash()(object));
+  MutexLocker locker(s.mutex);
+  return *s.objects.insert(std::move(object)).first;
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "StarJson.hpp"
+#include "StarThread.hpp"
+#include "StarArray.hpp"
+
+namespace Star {
+
+STAR_CLASS(JsonInterner);
+
+// Deduplicates the storage of immutable Json values.  Interning a value
+// rebuilds it so that any string, array, or object anywhere inside it that is
+// identical to one inside a previously interned value shares the same storage,
+// and containers are allocated at exactly their final size.  Identical here
+// means the same type and representation, so 1 and 1.0, or 0.0 and -0.0, are
+// never merged.
+//
+// The top level container of an interned value is never shared, so that
+// Json::unique() on the result still reflects references held outside of the
+// interner.  The interner itself holds references to everything it has
+// interned until cleanup() is called.
+//
+// Object keys are stored by value inside each object, so they are only shared
+// along with the whole object they are in.
+//
+// JsonInterner is thread safe.  Interned storage is split into shards by
+// hash, each with its own lock, so that threads interning different documents
+// rarely wait on each other.
+class JsonInterner {
+public:
+  Json intern(Json const& json);
+
+  // Releases interned storage that is no longer referenced from outside of
+  // the interner, returns the number of entries released.  This is a single
+  // pass, storage only referenced by containers it releases is released by
+  // the following cleanup.
+  size_t cleanup();
+  void clear();
+
+  // Number of distinct strings, arrays, and objects currently interned.
+  size_t size() const;
+
+private:
+  struct StringHash {
+    size_t operator()(StringConstPtr const& s) const;
+  };
+  struct StringEquals {
+    bool operator()(StringConstPtr const& a, StringConstPtr const& b) const;
+  };
+  struct ArrayHash {
+    size_t operator()(JsonArrayConstPtr const& a) const;
+  };
+  struct ArrayEquals {
+    bool operator()(JsonArrayConstPtr const& a, JsonArrayConstPtr const& b) const;
+  };
+  struct ObjectHash {
+    size_t operator()(JsonObjectConstPtr const& o) const;
+  };
+  struct ObjectEquals {
+    bool operator()(JsonObjectConstPtr const& a, JsonObjectConstPtr const& b) const;
+  };
+
+  // Values of containers are always interned before the container, so
+  // containers may be hashed and compared shallowly by storage identity.
+  static size_t identityHash(Json const& json);
+  static bool identical(Json const& a, Json const& b);
+
+  Json internValue(Json const& json, bool share);
+  StringConstPtr internString(StringConstPtr const& string);
+  JsonArrayConstPtr internArray(JsonArrayConstPtr array);
+  JsonObjectConstPtr internObject(JsonObjectConstPtr object);
+
+  struct Shard {
+    mutable Mutex mutex;
+    HashSet<StringConstPtr, StringHash, StringEquals> strings;
+    HashSet<JsonArrayConstPtr, ArrayHash, ArrayEquals> arrays;
+    HashSet<JsonObjectConstPtr, ObjectHash, ObjectEquals> objects;
+  };
+  static size_t const ShardCount = 16;
+
+  Shard& shard(size_t hash);
+
+  Array<Shard, ShardCount> m_shards;
+};
+
+}
@@ -18,7 +18,7 @@ Json jsonPatch(Json const& base, JsonArray const& patch) {
 
 
 // Returns 0 if not found, index + 1 if found.
-size_t findJsonMatch(Json const& searchable, Json const& value, JsonPath::Pointer& pointer) {
+static size_t findJsonMatch(Json const& searchable, Json const& value, JsonPath::Pointer const& pointer) {
   if (searchable.isType(Json::Type::Array)) {
     auto array = searchable.toArray();
     for (size_t i = 0; i != array.size(); ++i) {
@@ -34,166 +34,206 @@ size_t findJsonMatch(Json const& searchable, Json const& value, JsonPath::Pointe
 
 namespace JsonPatching {
 
-  static const StringMap<std::function<Json(Json, Json)>> functionMap = StringMap<std::function<Json(Json, Json)>>{
-      {"test", std::bind(applyTestOperation, _1, _2)},
-      {"remove", std::bind(applyRemoveOperation, _1, _2)},
-      {"add", std::bind(applyAddOperation, _1, _2)},
-      {"replace", std::bind(applyReplaceOperation, _1, _2)},
-      {"move", std::bind(applyMoveOperation, _1, _2)},
-      {"copy", std::bind(applyCopyOperation, _1, _2)},
-      {"merge", std::bind(applyMergeOperation, _1, _2)},
+  static const StringMap<OperationType> operationTypes = StringMap<OperationType>{
+      {"test", OperationType::Test},
+      {"remove", OperationType::Remove},
+      {"add", OperationType::Add},
+      {"replace", OperationType::Replace},
+      {"move", OperationType::Move},
+      {"copy", OperationType::Copy},
+      {"merge", OperationType::Merge},
   };
 
-  Json applyOperation(Json const& base, Json const& op, Maybe<Json> const& external) {
+  CompiledOperation::CompiledOperation(Json const& op) : path(String()), inverse(false) {
     try {
       auto operation = op.getString("op");
-      return JsonPatching::functionMap.get(operation)(base, op);
+      if (auto t = operationTypes.maybe(operation))
+        type = *t;
+      else
+        throw JsonPatchException(strf("Invalid operation: {}", operation), false);
+
+      path = JsonPath::Pointer(op.getString("path"));
+      if (op.contains("search"))
+        search = op.get("search");
+
+      if (type == OperationType::Test) {
+        inverse = op.getBool("inverse", false);
+        value = op.opt("value");
+      } else if (type == OperationType::Add || type == OperationType::Replace || type == OperationType::Merge) {
+        value = op.get("value");
+      } else if (type == OperationType::Move || type == OperationType::Copy) {
+        from = JsonPath::Pointer(op.getString("from"));
+      }
+    } catch (JsonPatchException const&) {
+      throw;
     } catch (JsonException const& e) {
       throw JsonPatchException(strf("Could not apply operation to base. {}", e.what()), false);
-    } catch (MapException const&) {
-      throw JsonPatchException(strf("Invalid operation: {}", op.getString("op")), false);
     }
   }
 
-  Json applyTestOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto pointer = JsonPath::Pointer(path);
-    auto inverseTest = op.getBool("inverse", false);
-
+  static Json applyTest(Json const& base, CompiledOperation const& op) {
     try {
-      if (op.contains("search")) {
-        auto searchable = pointer.get(base);
-        auto searchValue = op.get("search");
-        bool found = findJsonMatch(searchable, searchValue, pointer);
-        if (found && inverseTest)
-          throw JsonPatchTestFail(strf("Test operation failure, expected {} to be missing.", searchValue), false);
-        else if (!found && !inverseTest)
-          throw JsonPatchTestFail(strf("Test operation failure, could not find {}.", searchValue), false);
+      if (op.search) {
+        auto searchable = op.path.get(base);
+        bool found = findJsonMatch(searchable, *op.search, op.path);
+        if (found && op.inverse)
+          throw JsonPatchTestFail(strf("Test operation failure, expected {} to be missing.", *op.search), false);
+        else if (!found && !op.inverse)
+          throw JsonPatchTestFail(strf("Test operation failure, could not find {}.", *op.search), false);
         return base;
       } else {
-        auto value = op.opt("value");
-        auto testValue = pointer.get(base);
-        if (!value) {
-          if (inverseTest)
-            throw JsonPatchTestFail(strf("Test operation failure, expected {} to be missing.", path), false);
+        auto testValue = op.path.get(base);
+        if (!op.value) {
+          if (op.inverse)
+            throw JsonPatchTestFail(strf("Test operation failure, expected {} to be missing.", op.path.path()), false);
           return base;
         }
 
-        if ((value && (testValue == *value)) ^ inverseTest)
+        if ((testValue == *op.value) ^ op.inverse)
           return base;
         else
-          throw JsonPatchTestFail(strf("Test operation failure, expected {} found {}.", value, testValue), false);
+          throw JsonPatchTestFail(strf("Test operation failure, expected {} found {}.", *op.value, testValue), false);
       }
     } catch (JsonPath::TraversalException& e) {
-      if (inverseTest)
+      if (op.inverse)
         return base;
       throw JsonPatchTestFail(strf("Test operation failure: {}", e.what()), false);
     }
   }
 
-  Json applyRemoveOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto pointer = JsonPath::Pointer(path);
-
-    if (op.contains("search")) {
-      auto searchable = pointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, pointer))
-        return pointer.add(pointer.remove(base), searchable.eraseIndex(index - 1));
+  static Json applyRemove(Json const& base, CompiledOperation const& op) {
+    if (op.search) {
+      auto searchable = op.path.get(base);
+      if (size_t index = findJsonMatch(searchable, *op.search, op.path))
+        return op.path.add(op.path.remove(base), searchable.eraseIndex(index - 1));
       else
         return base;
     } else {
-      return pointer.remove(base);
+      return op.path.remove(base);
     }
   }
 
-  Json applyAddOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto value = op.get("value");
-    auto pointer = JsonPath::Pointer(path);
-
-    if (op.contains("search")) {
-      auto searchable = pointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, pointer))
-        return pointer.add(pointer.remove(base), searchable.insert(index - 1, value));
+  static Json applyAdd(Json const& base, CompiledOperation const& op) {
+    if (op.search) {
+      auto searchable = op.path.get(base);
+      if (size_t index = findJsonMatch(searchable, *op.search, op.path))
+        return op.path.add(op.path.remove(base), searchable.insert(index - 1, *op.value));
       else
         return base;
     } else {
-      return pointer.add(base, value);
+      return op.path.add(base, *op.value);
     }
   }
 
-  Json applyReplaceOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto value = op.get("value");
-    auto pointer = JsonPath::Pointer(op.getString("path"));
-
-    if (op.contains("search")) {
-      auto searchable = pointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, pointer))
-        return pointer.add(pointer.remove(base), searchable.set(index - 1, value));
+  static Json applyReplace(Json const& base, CompiledOperation const& op) {
+    if (op.search) {
+      auto searchable = op.path.get(base);
+      if (size_t index = findJsonMatch(searchable, *op.search, op.path))
+        return op.path.add(op.path.remove(base), searchable.set(index - 1, *op.value));
       else
         return base;
     } else {
-      return pointer.add(pointer.remove(base), value);
+      return op.path.add(op.path.remove(base), *op.value);
     }
   }
 
-  Json applyMoveOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto toPointer = JsonPath::Pointer(path);
-    auto fromPointer = JsonPath::Pointer(op.getString("from"));
-
-    if (op.contains("search")) {
+  static Json applyMove(Json const& base, CompiledOperation const& op) {
+    auto const& fromPointer = *op.from;
+    if (op.search) {
       auto searchable = fromPointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, fromPointer)) {
-        auto result = toPointer.add(base, searchable.get(index - 1));
+      if (size_t index = findJsonMatch(searchable, *op.search, fromPointer)) {
+        auto result = op.path.add(base, searchable.get(index - 1));
         return fromPointer.add(result, searchable.eraseIndex(index - 1));
       }
       else
         return base;
     } else {
       Json value = fromPointer.get(base);
-      return toPointer.add(fromPointer.remove(base), value);
+      return op.path.add(fromPointer.remove(base), value);
     }
   }
 
-  Json applyCopyOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto toPointer = JsonPath::Pointer(path);
-    auto fromPointer = JsonPath::Pointer(op.getString("from"));
-
-    if (op.contains("search")) {
+  static Json applyCopy(Json const& base, CompiledOperation const& op) {
+    auto const& fromPointer = *op.from;
+    if (op.search) {
       auto searchable = fromPointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, fromPointer))
-        return toPointer.add(base, searchable.get(index - 1));
+      if (size_t index = findJsonMatch(searchable, *op.search, fromPointer))
+        return op.path.add(base, searchable.get(index - 1));
       else
         return base;
     } else {
       Json value = fromPointer.get(base);
-      return toPointer.add(base, value);
+      return op.path.add(base, value);
     }
   }
 
-  Json applyMergeOperation(Json const& base, Json const& op) {
-    String path = op.getString("path");
-    auto pointer = JsonPath::Pointer(path);
-
-    if (op.contains("search")) {
-      auto searchable = pointer.get(base);
-      auto searchValue = op.get("search");
-      if (size_t index = findJsonMatch(searchable, searchValue, pointer))
-        return pointer.add(pointer.remove(base), searchable.set(index - 1, jsonMerge(searchable.get(index - 1), op.get("value"))));
+  static Json applyMerge(Json const& base, CompiledOperation const& op) {
+    if (op.search) {
+      auto searchable = op.path.get(base);
+      if (size_t index = findJsonMatch(searchable, *op.search, op.path))
+        return op.path.add(op.path.remove(base), searchable.set(index - 1, jsonMerge(searchable.get(index - 1), *op.value)));
       else
         return base;
     } else {
-      return pointer.add(pointer.remove(base), jsonMerge(pointer.get(base), op.get("value")));
+      return op.path.add(op.path.remove(base), jsonMerge(op.path.get(base), *op.value));
+    }
+  }
+
+  Json CompiledOperation::apply(Json const& base) const {
+    try {
+      switch (type) {
+        case OperationType::Test:
+          return applyTest(base, *this);
+        case OperationType::Remove:
+          return applyRemove(base, *this);
+        case OperationType::Add:
+          return applyAdd(base, *this);
+        case OperationType::Replace:
+          return applyReplace(base, *this);
+        case OperationType::Move:
+          return applyMove(base, *this);
+        case OperationType::Copy:
+          return applyCopy(base, *this);
+        case OperationType::Merge:
+          return applyMerge(base, *this);
+      }
+      return base;
+    } catch (JsonException const& e) {
+      throw JsonPatchException(strf("Could not apply operation to base. {}", e.what()), false);
     }
   }
+
+  Json applyOperation(Json const& base, Json const& op, Maybe<Json> const&) {
+    return CompiledOperation(op).apply(base);
+  }
+
+  Json applyTestOperation(Json const& base, Json const& op) {
+    return applyTest(base, CompiledOperation(op));
+  }
+
+  Json applyRemoveOperation(Json const& base, Json const& op) {
+    return applyRemove(base, CompiledOperation(op));
+  }
+
+  Json applyAddOperation(Json const& base, Json const& op) {
+    return applyAdd(base, CompiledOperation(op));
+  }
+
+  Json applyReplaceOperation(Json const& base, Json const& op) {
+    return applyReplace(base, CompiledOperation(op));
+  }
+
+  Json applyMoveOperation(Json const& base, Json const& op) {
+    return applyMove(base, CompiledOperation(op));
+  }
+
+  Json applyCopyOperation(Json const& base, Json const& op) {
+    return applyCopy(base, CompiledOperation(op));
+  }
+
+  Json applyMergeOperation(Json const& base, Json const& op) {
+    return applyMerge(base, CompiledOperation(op));
+  }
 }
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarJson.hpp"
+#include "StarJsonPath.hpp"
 
 namespace Star {
 
@@ -12,6 +13,35 @@ STAR_EXCEPTION(JsonPatchTestFail, StarException);
 Json jsonPatch(Json const& base, JsonArray const& patch);
 
 namespace JsonPatching {
+  enum class OperationType : uint8_t {
+    Test,
+    Remove,
+    Add,
+    Replace,
+    Move,
+    Copy,
+    Merge
+  };
+
+  // A single operation with all of its fields read and its pointers built up
+  // front, so that the same patch can be applied to many documents without
+  // re-reading the operation each time.
+  struct CompiledOperation {
+    // Throws JsonPatchException if the operation is malformed.
+    CompiledOperation(Json const& op);
+
+    // Throws JsonPatchException on failure, or JsonPatchTestFail if this is a
+    // failing test operation.
+    Json apply(Json const& base) const;
+
+    OperationType type;
+    JsonPath::Pointer path;
+    Maybe<JsonPath::Pointer> from;
+    Maybe<Json> value;
+    Maybe<Json> search;
+    bool inverse;
+  };
+
   // Applies the given single operation
   Json applyOperation(Json const& base, Json const& op, Maybe<Json> const& external = {});
 
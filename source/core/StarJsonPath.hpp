@@ -78,12 +78,12 @@ namespace JsonPath {
     Path(PathParser parser, String const& path) : m_parser(parser), m_path(path) {}
 
     template <typename Jsonlike>
-    Jsonlike get(Jsonlike const& base) {
+    Jsonlike get(Jsonlike const& base) const {
       return pathGet(base, m_parser, m_path);
     }
 
     template <typename Jsonlike>
-    Jsonlike apply(Jsonlike const& base, JsonOp<Jsonlike> op) {
+    Jsonlike apply(Jsonlike const& base, JsonOp<Jsonlike> op) const {
       return pathApply(base, m_parser, m_path, op);
     }
 
@@ -91,23 +91,23 @@ namespace JsonPath {
     Jsonlike apply(Jsonlike const& base,
         EmptyPathOp<Jsonlike> emptyPathOp,
         ObjectOp<Jsonlike> objectOp,
-        ArrayOp<Jsonlike> arrayOp) {
+        ArrayOp<Jsonlike> arrayOp) const {
       JsonOp<Jsonlike> combinedOp = genericObjectArrayOp(m_path, emptyPathOp, objectOp, arrayOp);
       return pathApply(base, m_parser, m_path, combinedOp);
     }
 
     template <typename Jsonlike>
-    Jsonlike set(Jsonlike const& base, Jsonlike const& value) {
+    Jsonlike set(Jsonlike const& base, Jsonlike const& value) const {
       return pathSet(base, m_parser, m_path, value);
     }
 
     template <typename Jsonlike>
-    Jsonlike remove(Jsonlike const& base) {
+    Jsonlike remove(Jsonlike const& base) const {
       return pathRemove(base, m_parser, m_path);
     }
 
     template <typename Jsonlike>
-    Jsonlike add(Jsonlike const& base, Jsonlike const& value) {
+    Jsonlike add(Jsonlike const& base, Jsonlike const& value) const {
       return pathAdd(base, m_parser, m_path, value);
     }
 
@@ -1,6 +1,7 @@
 #include "StarLua.hpp"
 #include "StarArray.hpp"
 #include "StarTime.hpp"
+#include "StarMemoryTracker.hpp"
 
 namespace Star {
 
@@ -214,6 +215,7 @@ LuaEnginePtr LuaEngine::create(bool safe) {
   self->m_instructionCount = 0;
   self->m_recursionLevel = 0;
   self->m_recursionLimit = 0;
+  self->m_threadSlice = {};
   self->m_nullTerminated = 0;
 
   if (!self->m_state)
@@ -650,9 +652,33 @@ void LuaEngine::countHook(lua_State* state, lua_Debug* ar) {
         break;
     }
   }
+
+  // Yielding from a count hook is only possible when the hook is running on
+  // the thread being resumed with no C call boundary in between, and must be
+  // the last thing the hook does.
+  auto& slice = self->m_threadSlice;
+  if (slice.thread == state && self->m_instructionCount - slice.instructionStart >= slice.instructionBudget && lua_isyieldable(state)) {
+    slice.yielded = true;
+    lua_yield(state, 0);
+  }
 }
 
 void* LuaEngine::allocate(void*, void* ptr, size_t oldSize, size_t newSize) {
+  // Lua memory is charged to a "lua" sub-tag of whatever is current, so that
+  // world scripts count towards their world.  Sub-tags are looked up once per
+  // thread, as registering them takes a lock and allocates.
+  static thread_local bool t_luaTagKnown[MemoryTracker::MaxTags] = {};
+  static thread_local MemoryTracker::Tag t_luaTags[MemoryTracker::MaxTags] = {};
+  MemoryTracker::Tag luaTag = MemoryTracker::Untagged;
+  if (MemoryTracker::enabled()) {
+    MemoryTracker::Tag current = MemoryTracker::currentTag();
+    if (!t_luaTagKnown[current]) {
+      t_luaTags[current] = MemoryTracker::subTag(current, "lua");
+      t_luaTagKnown[current] = true;
+    }
+    luaTag = t_luaTags[current];
+  }
+  MemoryTagScope tagScope(luaTag);
   if (newSize == 0) {
     Star::free(ptr, oldSize);
     return nullptr;
@@ -1286,6 +1312,23 @@ void LuaEngine::updateCountHook() {
     lua_sethook(m_state, &LuaEngine::countHook, 0, 0);
 }
 
+LuaEngine::ThreadSlice LuaEngine::beginThreadSlice(lua_State* thread, uint64_t instructionBudget) {
+  ThreadSlice previous = m_threadSlice;
+  m_threadSlice.thread = thread;
+  m_threadSlice.instructionStart = m_instructionCount;
+  m_threadSlice.instructionBudget = instructionBudget;
+  m_threadSlice.yielded = false;
+  lua_sethook(thread, &LuaEngine::countHook, LUA_MASKCOUNT, m_instructionMeasureInterval);
+  return previous;
+}
+
+bool LuaEngine::endThreadSlice(ThreadSlice previous) {
+  bool yielded = m_threadSlice.yielded;
+  lua_sethook(m_threadSlice.thread, lua_gethook(m_state), lua_gethookmask(m_state), lua_gethookcount(m_state));
+  m_threadSlice = previous;
+  return yielded;
+}
+
 int LuaEngine::s_luaInstructionLimitExceptionKey = 0;
 int LuaEngine::s_luaRecursionLimitExceptionKey = 0;
 
@@ -245,6 +245,13 @@ public:
   // thread has finished execution
   template <typename Ret = LuaValue, typename... Args>
   Maybe<Ret> resume(Args const&... args) const;
+  // Like resume, but the thread is forcibly yielded once it has executed
+  // roughly 'instructionBudget' instructions, measured at the engine's
+  // instruction measure interval.  A forced yield returns nothing and leaves
+  // the thread Active, resuming it again continues where it left off.  A
+  // budget of 0 behaves exactly like resume.
+  template <typename Ret = LuaValue, typename... Args>
+  Maybe<Ret> resumeBudgeted(uint64_t instructionBudget, Args const&... args) const;
   void pushFunction(LuaFunction const& func) const;
   Status status() const;
 };
@@ -665,6 +672,8 @@ private:
 
   template <typename... Args>
   Maybe<LuaDetail::LuaFunctionReturn> resumeThread(int handleIndex, Args const&... args);
+  template <typename... Args>
+  Maybe<LuaDetail::LuaFunctionReturn> resumeThreadBudgeted(int handleIndex, uint64_t instructionBudget, Args const&... args);
   void threadPushFunction(int threadIndex, int functionIndex);
   LuaThread::Status threadStatus(int handleIndex);
 
@@ -714,6 +723,21 @@ private:
 
   void updateCountHook();
 
+  // The thread currently being resumed with an instruction budget, which the
+  // count hook will force to yield once the budget is spent.
+  struct ThreadSlice {
+    lua_State* thread = nullptr;
+    uint64_t instructionStart = 0;
+    uint64_t instructionBudget = 0;
+    bool yielded = false;
+  };
+
+  // Installs the count hook on the given thread and makes it the current
+  // slice, returning the previous slice to be restored with endThreadSlice.
+  // endThreadSlice returns whether the thread was forcibly yielded.
+  ThreadSlice beginThreadSlice(lua_State* thread, uint64_t instructionBudget);
+  bool endThreadSlice(ThreadSlice previous);
+
   // The following fields exist to use their addresses as unique lightuserdata,
   // as is recommended by the lua docs.
   static int s_luaInstructionLimitExceptionKey;
@@ -737,6 +761,7 @@ private:
   uint64_t m_instructionCount;
   unsigned m_recursionLevel;
   unsigned m_recursionLimit;
+  ThreadSlice m_threadSlice;
   int m_nullTerminated;
   HashMap<tuple<String, unsigned>, shared_ptr<LuaProfileEntry>> m_profileEntries;
   lua_Debug m_debugInfo;
@@ -1770,6 +1795,14 @@ Maybe<Ret> LuaThread::resume(Args const&... args) const {
   return LuaDetail::FromFunctionReturn<Ret>::convert(engine(), res.take());
 }
 
+template <typename Ret, typename... Args>
+Maybe<Ret> LuaThread::resumeBudgeted(uint64_t instructionBudget, Args const&... args) const {
+  auto res = engine().resumeThreadBudgeted(handleIndex(), instructionBudget, args...);
+  if (!res)
+    return {};
+  return LuaDetail::FromFunctionReturn<Ret>::convert(engine(), res.take());
+}
+
 inline void LuaThread::pushFunction(LuaFunction const& func) const {
   engine().threadPushFunction(handleIndex(), func.handleIndex());
 }
@@ -2009,6 +2042,11 @@ LuaDetail::LuaFunctionReturn LuaEngine::callFunction(int handleIndex, Args const
 
 template <typename... Args>
 Maybe<LuaDetail::LuaFunctionReturn> LuaEngine::resumeThread(int handleIndex, Args const&... args) {
+  return resumeThreadBudgeted(handleIndex, 0, args...);
+}
+
+template <typename... Args>
+Maybe<LuaDetail::LuaFunctionReturn> LuaEngine::resumeThreadBudgeted(int handleIndex, uint64_t instructionBudget, Args const&... args) {
   lua_checkstack(m_state, 1);
 
   pushHandle(m_state, handleIndex);
@@ -2021,13 +2059,24 @@ Maybe<LuaDetail::LuaFunctionReturn> LuaEngine::resumeThread(int handleIndex, Arg
 
   size_t argSize = pushArguments(threadState, args...);
   incrementRecursionLevel();
-  int res = lua_resume(threadState, nullptr, argSize);
+  bool forcedYield = false;
+  int res;
+  if (instructionBudget != 0) {
+    auto previousSlice = beginThreadSlice(threadState, instructionBudget);
+    res = lua_resume(threadState, nullptr, argSize);
+    forcedYield = endThreadSlice(previousSlice);
+  } else {
+    res = lua_resume(threadState, nullptr, argSize);
+  }
   decrementRecursionLevel();
   if (res != LUA_OK && res != LUA_YIELD) {
     propagateErrorWithTraceback(threadState, m_state);
     handleError(m_state, res);
   }
 
+  if (forcedYield && res == LUA_YIELD)
+    return {};
+
   int returnValues = lua_gettop(threadState);
   if (returnValues == 0) {
     return LuaDetail::LuaFunctionReturn();
@@ -1,4 +1,5 @@
 #include "StarMemory.hpp"
+#include "StarMemoryTracker.hpp"
 
 #ifdef STAR_USE_JEMALLOC
 #include "jemalloc/jemalloc.h"
@@ -20,90 +21,155 @@ namespace Star {
 
 #ifdef STAR_USE_JEMALLOC
 #ifdef STAR_JEMALLOC_IS_PREFIXED
-  void* malloc(size_t size) {
+  static void* systemMalloc(size_t size) {
     return je_malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* systemRealloc(void* ptr, size_t size) {
     return je_realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void systemFree(void* ptr) {
     je_free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void systemFree(void* ptr, size_t size) {
     if (ptr)
       je_sdallocx(ptr, size, 0);
   }
 #else
-  void* malloc(size_t size) {
+  static void* systemMalloc(size_t size) {
     return ::malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* systemRealloc(void* ptr, size_t size) {
     return ::realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void systemFree(void* ptr) {
     ::free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void systemFree(void* ptr, size_t size) {
     if (ptr)
       je_sdallocx(ptr, size, 0);
   }
 #endif
 #elif STAR_USE_MIMALLOC
-  void* malloc(size_t size) {
+  static void* systemMalloc(size_t size) {
   return mi_malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* systemRealloc(void* ptr, size_t size) {
     return mi_realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void systemFree(void* ptr) {
     return mi_free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void systemFree(void* ptr, size_t size) {
     return mi_free_size(ptr, size);
   }
 #elif STAR_USE_RPMALLOC
-  void* malloc(size_t size) {
+  static void* systemMalloc(size_t size) {
     return rpmalloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* systemRealloc(void* ptr, size_t size) {
     return rprealloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void systemFree(void* ptr) {
     return rpfree(ptr);
   }
 
-  void free(void* ptr, size_t) {
+  static void systemFree(void* ptr, size_t) {
     return rpfree(ptr);
   }
 #else
-  void* malloc(size_t size) {
+  static void* systemMalloc(size_t size) {
     return ::malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* systemRealloc(void* ptr, size_t size) {
     return ::realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void systemFree(void* ptr) {
     return ::free(ptr);
   }
 
-  void free(void* ptr, size_t) {
+  static void systemFree(void* ptr, size_t) {
     return ::free(ptr);
   }
 #endif
 
+
+#ifdef STAR_MEMORY_TRACKING
+  // Every allocation is prefixed with its size and the tag it was charged to,
+  // so that it is credited back to the same tag whichever thread frees it.
+  // Sixteen bytes keeps the alignment the system allocator guarantees.
+  struct alignas(16) AllocationHeader {
+    size_t size;
+    MemoryTracker::Tag tag;
+  };
+
+  void* malloc(size_t size) {
+    auto header = (AllocationHeader*)systemMalloc(size + sizeof(AllocationHeader));
+    if (!header)
+      return nullptr;
+    header->size = size;
+    header->tag = MemoryTracker::recordAllocation(size);
+    return header + 1;
+  }
+
+  void* realloc(void* ptr, size_t size) {
+    if (!ptr)
+      return malloc(size);
+    auto header = (AllocationHeader*)ptr - 1;
+    AllocationHeader previous = *header;
+    header = (AllocationHeader*)systemRealloc(header, size + sizeof(AllocationHeader));
+    if (!header)
+      return nullptr;
+    MemoryTracker::recordFree(previous.tag, previous.size);
+    header->size = size;
+    header->tag = MemoryTracker::recordAllocation(size);
+    return header + 1;
+  }
+
+  void free(void* ptr) {
+    if (!ptr)
+      return;
+    auto header = (AllocationHeader*)ptr - 1;
+    MemoryTracker::recordFree(header->tag, header->size);
+    systemFree(header);
+  }
+
+  void free(void* ptr, size_t) {
+    if (!ptr)
+      return;
+    auto header = (AllocationHeader*)ptr - 1;
+    MemoryTracker::recordFree(header->tag, header->size);
+    systemFree(header, header->size + sizeof(AllocationHeader));
+  }
+#else
+  void* malloc(size_t size) {
+    return systemMalloc(size);
+  }
+
+  void* realloc(void* ptr, size_t size) {
+    return systemRealloc(ptr, size);
+  }
+
+  void free(void* ptr) {
+    systemFree(ptr);
+  }
+
+  void free(void* ptr, size_t size) {
+    systemFree(ptr, size);
+  }
+#endif
 }
 
 #ifndef  STAR_USE_RPMALLOC
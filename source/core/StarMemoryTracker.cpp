@@ -0,0 +1,190 @@
+#include "StarMemoryTracker.hpp"
+#include "StarMap.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+MemoryTracker::Tag const MemoryTracker::Untagged;
+size_t const MemoryTracker::MaxTags;
+
+#ifdef STAR_MEMORY_TRACKING
+
+namespace {
+  // Nothing here may allocate through Star::malloc, as it is called from
+  // within it, so the counters are fixed arrays that threads claim a slot in.
+  size_t const MaxThreads = 64;
+
+  struct TagCounters {
+    atomic<int64_t> allocations{0};
+    atomic<int64_t> allocatedBytes{0};
+    atomic<int64_t> frees{0};
+    atomic<int64_t> freedBytes{0};
+  };
+
+  struct ThreadCounters {
+    atomic<bool> claimed{false};
+    TagCounters tags[MemoryTracker::MaxTags];
+  };
+
+  // Threads beyond MaxThreads, and threads that have exited, share the last
+  // slot.
+  ThreadCounters s_threadCounters[MaxThreads + 1];
+  ThreadCounters& s_sharedCounters = s_threadCounters[MaxThreads];
+
+  thread_local ThreadCounters* t_counters = nullptr;
+  thread_local MemoryTracker::Tag t_currentTag = MemoryTracker::Untagged;
+
+  // Folds the thread's counters into the shared slot when the thread exits,
+  // so that the slot can be claimed again.
+  struct ThreadCountersReleaser {
+    ~ThreadCountersReleaser() {
+      ThreadCounters* counters = t_counters;
+      t_counters = &s_sharedCounters;
+      if (!counters || counters == &s_sharedCounters)
+        return;
+      for (size_t i = 0; i < MemoryTracker::MaxTags; ++i) {
+        auto& from = counters->tags[i];
+        auto& to = s_sharedCounters.tags[i];
+        to.allocations += from.allocations.exchange(0);
+        to.allocatedBytes += from.allocatedBytes.exchange(0);
+        to.frees += from.frees.exchange(0);
+        to.freedBytes += from.freedBytes.exchange(0);
+      }
+      counters->claimed = false;
+    }
+  };
+  thread_local ThreadCountersReleaser t_countersReleaser;
+
+  ThreadCounters& threadCounters() {
+    if (!t_counters) {
+      t_counters = &s_sharedCounters;
+      for (size_t i = 0; i < MaxThreads; ++i) {
+        bool claimed = false;
+        if (s_threadCounters[i].claimed.compare_exchange_strong(claimed, true)) {
+          t_counters = &s_threadCounters[i];
+          // Constructs the releaser, so that it runs when the thread exits.
+          (void)&t_countersReleaser;
+          break;
+        }
+      }
+    }
+    return *t_counters;
+  }
+
+  struct TagRegistry {
+    Mutex mutex;
+    StringList names = {"untagged"};
+    StringMap<MemoryTracker::Tag> tags = {{"untagged", MemoryTracker::Untagged}};
+  };
+
+  TagRegistry& tagRegistry() {
+    static TagRegistry registry;
+    return registry;
+  }
+}
+
+MemoryTracker::Tag MemoryTracker::tag(String const& name) {
+  auto& registry = tagRegistry();
+  MutexLocker locker(registry.mutex);
+  if (auto tag = registry.tags.maybe(name))
+    return *tag;
+  if (registry.names.size() >= MaxTags)
+    return Untagged;
+  Tag tag = registry.names.size();
+  registry.names.append(name);
+  registry.tags.add(name, tag);
+  return tag;
+}
+
+MemoryTracker::Tag MemoryTracker::subTag(Tag parent, String const& name) {
+  if (parent == Untagged)
+    return tag(name);
+  String parentName;
+  {
+    auto& registry = tagRegistry();
+    MutexLocker locker(registry.mutex);
+    parentName = registry.names.at(parent);
+  }
+  return tag(strf("{}/{}", parentName, name));
+}
+
+MemoryTracker::Tag MemoryTracker::currentTag() {
+  return t_currentTag;
+}
+
+MemoryTracker::Tag MemoryTracker::setCurrentTag(Tag tag) {
+  Tag previous = t_currentTag;
+  t_currentTag = tag;
+  return previous;
+}
+
+List<MemoryTracker::TagStats> MemoryTracker::stats() {
+  StringList names;
+  {
+    auto& registry = tagRegistry();
+    MutexLocker locker(registry.mutex);
+    names = registry.names;
+  }
+
+  List<TagStats> stats;
+  for (size_t i = 0; i < names.size(); ++i) {
+    int64_t allocations = 0, allocatedBytes = 0, frees = 0, freedBytes = 0;
+    for (auto const& counters : s_threadCounters) {
+      auto const& tag = counters.tags[i];
+      allocations += tag.allocations.load(std::memory_order_relaxed);
+      allocatedBytes += tag.allocatedBytes.load(std::memory_order_relaxed);
+      frees += tag.frees.load(std::memory_order_relaxed);
+      freedBytes += tag.freedBytes.load(std::memory_order_relaxed);
+    }
+    if (allocations != 0)
+      stats.append({names[i], allocatedBytes - freedBytes, allocations - frees, (uint64_t)allocations, (uint64_t)allocatedBytes});
+  }
+  sortByComputedValue(stats, [](TagStats const& s) { return -s.liveBytes; });
+  return stats;
+}
+
+MemoryTracker::Tag MemoryTracker::recordAllocation(size_t size) {
+  Tag tag = t_currentTag;
+  auto& counters = threadCounters().tags[tag];
+  counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  return tag;
+}
+
+void MemoryTracker::recordFree(Tag tag, size_t size) {
+  auto& counters = threadCounters().tags[tag];
+  counters.frees.fetch_add(1, std::memory_order_relaxed);
+  counters.freedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#else
+
+MemoryTracker::Tag MemoryTracker::tag(String const&) {
+  return Untagged;
+}
+
+MemoryTracker::Tag MemoryTracker::subTag(Tag, String const&) {
+  return Untagged;
+}
+
+MemoryTracker::Tag MemoryTracker::currentTag() {
+  return Untagged;
+}
+
+MemoryTracker::Tag MemoryTracker::setCurrentTag(Tag) {
+  return Untagged;
+}
+
+List<MemoryTracker::TagStats> MemoryTracker::stats() {
+  return {};
+}
+
+MemoryTracker::Tag MemoryTracker::recordAllocation(size_t) {
+  return Untagged;
+}
+
+void MemoryTracker::recordFree(Tag, size_t) {}
+
+#endif
+
+}
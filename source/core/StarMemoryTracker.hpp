@@ -0,0 +1,99 @@
+#pragma once
+
+#include "StarString.hpp"
+
+namespace Star {
+
+STAR_CLASS(MemoryTracker);
+
+// Charges every allocation made through Star::malloc and Star::realloc, and
+// so operator new unless rpmalloc replaces it, to the memory tag that is
+// current on the allocating thread, so that memory can be broken down by
+// world, Lua, assets, networking, rendering and so on.  Frees are credited
+// back to the tag the memory was allocated under, whichever thread frees it.
+// Counters are kept per thread and merged when stats are taken.
+//
+// Tracking is only compiled in when STAR_MEMORY_TRACKING is defined, as it
+// adds a header to every allocation.  Otherwise tags are all Untagged, stats
+// are empty and tag scopes compile to nothing.
+class MemoryTracker {
+public:
+  typedef uint16_t Tag;
+
+  // Allocations made outside of any tag scope, and under tags registered
+  // after MaxTags have been.
+  static Tag const Untagged = 0;
+  static size_t const MaxTags = 256;
+
+  struct TagStats {
+    String name;
+    // Live bytes and allocations may be briefly off while a thread is
+    // exiting.
+    int64_t liveBytes;
+    int64_t liveAllocations;
+    // Totals since the process started.
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+  };
+
+  static constexpr bool enabled();
+
+  // Returns the tag with the given name, registering it the first time.
+  static Tag tag(String const& name);
+  // Returns the tag named "<parent>/<name>", so that memory a subsystem
+  // allocates on behalf of something else is still attributed to it.  Sub-tags
+  // of Untagged are just named <name>.
+  static Tag subTag(Tag parent, String const& name);
+
+  static Tag currentTag();
+  // Sets the tag the calling thread's allocations are charged to, returning
+  // the previous one.
+  static Tag setCurrentTag(Tag tag);
+
+  // Every tag that has had memory allocated under it, most live bytes first.
+  static List<TagStats> stats();
+
+  // Called by Star::malloc and Star::free for every allocation, returning
+  // the tag the allocation was charged to.
+  static Tag recordAllocation(size_t size);
+  static void recordFree(Tag tag, size_t size);
+};
+
+// Charges the calling thread's allocations to the given tag until it goes out
+// of scope.  Scopes may nest.
+class MemoryTagScope {
+public:
+  explicit MemoryTagScope(MemoryTracker::Tag tag);
+  ~MemoryTagScope();
+
+  MemoryTagScope(MemoryTagScope const&) = delete;
+  MemoryTagScope& operator=(MemoryTagScope const&) = delete;
+
+private:
+#ifdef STAR_MEMORY_TRACKING
+  MemoryTracker::Tag m_previous;
+#endif
+};
+
+constexpr bool MemoryTracker::enabled() {
+#ifdef STAR_MEMORY_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef STAR_MEMORY_TRACKING
+inline MemoryTagScope::MemoryTagScope(MemoryTracker::Tag tag)
+  : m_previous(MemoryTracker::setCurrentTag(tag)) {}
+
+inline MemoryTagScope::~MemoryTagScope() {
+  MemoryTracker::setCurrentTag(m_previous);
+}
+#else
+inline MemoryTagScope::MemoryTagScope(MemoryTracker::Tag) {}
+
+inline MemoryTagScope::~MemoryTagScope() {}
+#endif
+
+}
@@ -4,4 +4,6 @@ namespace Star {
 
 VersionNumber const OpenProtocolVersion = 3;
 
+uint32_t const SupportedNetFeatures = (uint32_t)NetFeature::ReplicatedTrajectories;
+
 }
\ No newline at end of file
@@ -6,6 +6,18 @@ namespace Star {
 
 extern VersionNumber const OpenProtocolVersion;
 
+// Optional extensions to the protocol that both ends announce when
+// connecting, so that peers supporting them can use them without raising
+// OpenProtocolVersion for everyone.
+enum class NetFeature : uint32_t {
+  // Slaves of projectiles that opt in predict their trajectories between
+  // corrections from the master.
+  ReplicatedTrajectories = 1 << 0
+};
+
+// Every NetFeature this build supports.
+extern uint32_t const SupportedNetFeatures;
+
 constexpr VersionNumber AnyVersion = 0xFFFFFFFF;
 constexpr VersionNumber LegacyVersion = 0;
 
@@ -13,19 +25,25 @@ class NetCompatibilityRules {
 public:
   NetCompatibilityRules();
   NetCompatibilityRules(uint64_t) = delete;
+  // Rules for a peer on the given version, with no optional features.
   NetCompatibilityRules(VersionNumber version);
 
   VersionNumber version() const;
   void setVersion(VersionNumber version);
   bool isLegacy() const;
 
+  uint32_t features() const;
+  void setFeatures(uint32_t features);
+  bool hasFeature(NetFeature feature) const;
+
   bool operator==(NetCompatibilityRules const& a) const;
 
 private:
   VersionNumber m_version = OpenProtocolVersion;
+  uint32_t m_features = 0;
 };
 
-inline NetCompatibilityRules::NetCompatibilityRules() : m_version(OpenProtocolVersion) {}
+inline NetCompatibilityRules::NetCompatibilityRules() : m_version(OpenProtocolVersion), m_features(SupportedNetFeatures) {}
 
 inline NetCompatibilityRules::NetCompatibilityRules(VersionNumber v) : m_version(v) {}
 
@@ -41,14 +59,26 @@ inline bool NetCompatibilityRules::isLegacy() const {
   return m_version == LegacyVersion;
 }
 
+inline uint32_t NetCompatibilityRules::features() const {
+  return m_features;
+}
+
+inline void NetCompatibilityRules::setFeatures(uint32_t features) {
+  m_features = features;
+}
+
+inline bool NetCompatibilityRules::hasFeature(NetFeature feature) const {
+  return m_features & (uint32_t)feature;
+}
+
 inline bool NetCompatibilityRules::operator==(NetCompatibilityRules const& a) const {
-  return m_version == a.m_version;
+  return m_version == a.m_version && m_features == a.m_features;
 }
 
 template <>
 struct hash<NetCompatibilityRules> {
   size_t operator()(NetCompatibilityRules const& s) const {
-    return s.version();
+    return hashOf(s.version(), s.features());
   }
 };
 
@@ -0,0 +1,197 @@
+#include "StarProfiler.hpp"
+#include "StarArray.hpp"
+#include "StarMap.hpp"
+#include "StarMathCommon.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+namespace {
+  // Four buckets per power of two, so that durations are kept to within 25%
+  // whatever their size.
+  size_t const HistogramBuckets = 128;
+
+  size_t histogramBucket(int64_t duration) {
+    uint64_t d = (uint64_t)clamp<int64_t>(duration, 0, 0xffffffff);
+    if (d < 4)
+      return d;
+    unsigned exponent = 2;
+    while ((d >> (exponent + 1)) != 0)
+      ++exponent;
+    return (exponent - 1) * 4 + ((d >> (exponent - 2)) & 3);
+  }
+
+  int64_t histogramBucketMax(size_t bucket) {
+    if (bucket < 4)
+      return bucket;
+    unsigned exponent = bucket / 4 + 1;
+    int64_t bucketMin = (int64_t)(4 + bucket % 4) << (exponent - 2);
+    return bucketMin + ((int64_t)1 << (exponent - 2)) - 1;
+  }
+
+  struct PhaseHistogram {
+    uint64_t count = 0;
+    int64_t total = 0;
+    int64_t max = 0;
+    Array<uint64_t, HistogramBuckets> buckets = Array<uint64_t, HistogramBuckets>::filled(0);
+  };
+
+  struct ProfileEvent {
+    char const* phase;
+    int64_t start;
+    int64_t duration;
+  };
+
+  // Only ever written by its own thread, the mutex is uncontended except
+  // while stats or a trace are being collected.
+  struct ThreadProfile {
+    Mutex mutex;
+    String group;
+    List<ProfileEvent> events;
+    size_t nextEvent = 0;
+    HashMap<char const*, PhaseHistogram> histograms;
+  };
+  typedef shared_ptr<ThreadProfile> ThreadProfilePtr;
+
+  Mutex s_profilesMutex;
+  List<ThreadProfilePtr> s_profiles;
+  size_t s_threadCount = 0;
+
+  // Drops the thread's profile when the thread exits, so worlds being shut
+  // down and started again do not accumulate.
+  struct ThreadProfileHolder {
+    ~ThreadProfileHolder() {
+      if (profile) {
+        MutexLocker locker(s_profilesMutex);
+        s_profiles.remove(profile);
+      }
+    }
+
+    ThreadProfilePtr profile;
+    String group;
+  };
+  thread_local ThreadProfileHolder t_profile;
+
+  ThreadProfile& threadProfile() {
+    if (!t_profile.profile) {
+      auto profile = make_shared<ThreadProfile>();
+      profile->events.reserve(Profiler::RingSize);
+      MutexLocker locker(s_profilesMutex);
+      profile->group = t_profile.group.empty() ? strf("thread {}", ++s_threadCount) : t_profile.group;
+      s_profiles.append(profile);
+      t_profile.profile = std::move(profile);
+    }
+    return *t_profile.profile;
+  }
+}
+
+atomic<bool> Profiler::s_enabled(false);
+size_t const Profiler::RingSize;
+
+void Profiler::setEnabled(bool enabled) {
+  s_enabled = enabled;
+}
+
+void Profiler::setThreadGroup(String group) {
+  if (auto const& profile = t_profile.profile) {
+    MutexLocker locker(profile->mutex);
+    profile->group = group;
+  }
+  t_profile.group = std::move(group);
+}
+
+void Profiler::record(char const* phase, int64_t start, int64_t duration) {
+  auto& profile = threadProfile();
+  MutexLocker locker(profile.mutex);
+
+  if (profile.events.size() < RingSize)
+    profile.events.append({phase, start, duration});
+  else
+    profile.events[profile.nextEvent] = {phase, start, duration};
+  profile.nextEvent = (profile.nextEvent + 1) % RingSize;
+
+  auto& histogram = profile.histograms[phase];
+  ++histogram.count;
+  histogram.total += duration;
+  histogram.max = max(histogram.max, duration);
+  ++histogram.buckets[histogramBucket(duration)];
+}
+
+List<Profiler::PhaseStats> Profiler::stats(String const& groupFilter) {
+  // Phases are merged by name, as the same literal may have a different
+  // address in different translation units, and several threads may share a
+  // group.
+  Map<pair<String, String>, PhaseHistogram> merged;
+  {
+    MutexLocker locker(s_profilesMutex);
+    for (auto const& profile : s_profiles) {
+      MutexLocker profileLocker(profile->mutex);
+      if (!profile->group.contains(groupFilter))
+        continue;
+      for (auto const& pair : profile->histograms) {
+        auto& histogram = merged[{profile->group, pair.first}];
+        histogram.count += pair.second.count;
+        histogram.total += pair.second.total;
+        histogram.max = max(histogram.max, pair.second.max);
+        for (size_t i = 0; i < HistogramBuckets; ++i)
+          histogram.buckets[i] += pair.second.buckets[i];
+      }
+    }
+  }
+
+  auto percentile = [](PhaseHistogram const& histogram, double fraction) -> int64_t {
+    uint64_t target = ceil(histogram.count * fraction);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HistogramBuckets; ++i) {
+      seen += histogram.buckets[i];
+      if (seen >= target)
+        return min(histogramBucketMax(i), histogram.max);
+    }
+    return histogram.max;
+  };
+
+  List<PhaseStats> stats;
+  for (auto const& pair : merged) {
+    auto const& histogram = pair.second;
+    stats.append({pair.first.first, pair.first.second, histogram.count, histogram.total,
+        percentile(histogram, 0.5), percentile(histogram, 0.95), percentile(histogram, 0.99), histogram.max});
+  }
+  sortByComputedValue(stats, [](PhaseStats const& s) { return make_tuple(s.group, -s.total); });
+  return stats;
+}
+
+Json Profiler::chromeTrace() {
+  JsonArray traceEvents;
+  MutexLocker locker(s_profilesMutex);
+  for (size_t tid = 0; tid < s_profiles.size(); ++tid) {
+    auto const& profile = s_profiles[tid];
+    MutexLocker profileLocker(profile->mutex);
+    traceEvents.append(JsonObject{
+        {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", tid}, {"args", JsonObject{{"name", profile->group}}}
+      });
+
+    // Oldest first once the ring has wrapped.
+    size_t first = profile->events.size() < RingSize ? 0 : profile->nextEvent;
+    for (size_t i = 0; i < profile->events.size(); ++i) {
+      auto const& event = profile->events[(first + i) % profile->events.size()];
+      traceEvents.append(JsonObject{
+          {"name", event.phase}, {"cat", profile->group}, {"ph", "X"},
+          {"ts", event.start}, {"dur", event.duration}, {"pid", 1}, {"tid", tid}
+        });
+    }
+  }
+
+  return JsonObject{{"traceEvents", std::move(traceEvents)}, {"displayTimeUnit", "ms"}};
+}
+
+void Profiler::reset() {
+  MutexLocker locker(s_profilesMutex);
+  for (auto const& profile : s_profiles) {
+    MutexLocker profileLocker(profile->mutex);
+    profile->events.clear();
+    profile->nextEvent = 0;
+    profile->histograms.clear();
+  }
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "StarJson.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+STAR_CLASS(Profiler);
+
+// Records how long the phases of each tick take, so that a slow tick can be
+// broken down into entity updates, scripts, liquids, wiring, storage, packet
+// generation and so on.  Every thread keeps a ring buffer of its most recent
+// phases and a histogram of the durations of each phase, reported under the
+// thread's group (a world, the universe, the client).  Profiling is off by
+// default, and while it is off a phase costs a single relaxed atomic load.
+class Profiler {
+public:
+  static size_t const RingSize = 8192;
+
+  struct PhaseStats {
+    String group;
+    String phase;
+    uint64_t count;
+    // In microseconds, percentiles are the upper bound of the histogram
+    // bucket they land in.
+    int64_t total;
+    int64_t p50;
+    int64_t p95;
+    int64_t p99;
+    int64_t max;
+  };
+
+  static bool enabled();
+  // Turning profiling on or off keeps everything recorded so far.
+  static void setEnabled(bool enabled);
+
+  // Sets the group that phases recorded by the calling thread are reported
+  // under.  Threads that never set one are reported as "thread <n>".
+  static void setThreadGroup(String group);
+
+  // Records a phase on the calling thread that started and lasted the given
+  // number of monotonic microseconds.  Phase names are kept by pointer, and
+  // must be string literals.
+  static void record(char const* phase, int64_t start, int64_t duration);
+
+  // Statistics for every phase of every group containing 'groupFilter',
+  // sorted by group and then by total time spent, highest first.
+  static List<PhaseStats> stats(String const& groupFilter = {});
+
+  // The phases in every ring buffer, in the Chrome trace event format that
+  // chrome://tracing and Perfetto load, one trace thread per group.
+  static Json chromeTrace();
+
+  // Forgets every recorded phase and histogram.
+  static void reset();
+
+private:
+  static atomic<bool> s_enabled;
+};
+
+// Records the time between its construction and its destruction as a phase
+// on the calling thread, if profiling is enabled.  Scopes may nest.
+class ProfileScope {
+public:
+  explicit ProfileScope(char const* phase);
+  ~ProfileScope();
+
+  ProfileScope(ProfileScope const&) = delete;
+  ProfileScope& operator=(ProfileScope const&) = delete;
+
+  // Ends the current phase and starts the next one, for timing a sequence of
+  // steps without a nested block around each.
+  void next(char const* phase);
+
+private:
+  char const* m_phase;
+  int64_t m_start;
+};
+
+inline bool Profiler::enabled() {
+  return s_enabled.load(std::memory_order_relaxed);
+}
+
+inline ProfileScope::ProfileScope(char const* phase)
+  : m_phase(phase), m_start(Profiler::enabled() ? Time::monotonicMicroseconds() : -1) {}
+
+inline ProfileScope::~ProfileScope() {
+  if (m_start >= 0)
+    Profiler::record(m_phase, m_start, Time::monotonicMicroseconds() - m_start);
+}
+
+inline void ProfileScope::next(char const* phase) {
+  if (m_start >= 0) {
+    int64_t now = Time::monotonicMicroseconds();
+    Profiler::record(m_phase, m_start, now - m_start);
+    m_start = now;
+  } else if (Profiler::enabled()) {
+    m_start = Time::monotonicMicroseconds();
+  }
+  m_phase = phase;
+}
+
+}
@@ -154,16 +154,17 @@ CelestialBaseInformation CelestialMasterDatabase::baseInformation() const {
 }
 
 CelestialResponse CelestialMasterDatabase::respondToRequest(CelestialRequest const& request) {
-  RecursiveMutexLocker locker(m_mutex);
-
   if (auto chunkLocation = request.maybeLeft()) {
     auto chunk = getChunk(*chunkLocation);
     // System objects are sent by separate system requests.
-    chunk.systemObjects.clear();
-    return makeLeft(std::move(chunk));
+    CelestialChunk response;
+    response.chunkIndex = chunk->chunkIndex;
+    response.constellations = chunk->constellations;
+    response.systemParameters = chunk->systemParameters;
+    return makeLeft(std::move(response));
   } else if (auto systemLocation = request.maybeRight()) {
-    auto const& chunk = getChunk(chunkIndexFor(*systemLocation));
-    CelestialSystemObjects systemObjects = {*systemLocation, chunk.systemObjects.get(*systemLocation)};
+    auto chunk = getChunk(chunkIndexFor(*systemLocation));
+    CelestialSystemObjects systemObjects = {*systemLocation, chunk->systemObjects.get(*systemLocation)};
     return makeRight(std::move(systemObjects));
   } else {
     return CelestialResponse();
@@ -171,8 +172,12 @@ CelestialResponse CelestialMasterDatabase::respondToRequest(CelestialRequest con
 }
 
 void CelestialMasterDatabase::cleanupAndCommit() {
-  RecursiveMutexLocker locker(m_mutex);
-  m_chunkCache.cleanup();
+  for (auto& shard : m_chunkCacheShards) {
+    MutexLocker shardLocker(shard.mutex);
+    shard.chunks.cleanup();
+  }
+
+  MutexLocker locker(m_commitMutex);
   if (m_database.isOpen() && m_commitTimer.timeUp()) {
     m_database.commit();
     m_commitTimer.restart(m_commitInterval);
@@ -180,14 +185,12 @@ void CelestialMasterDatabase::cleanupAndCommit() {
 }
 
 bool CelestialMasterDatabase::coordinateValid(CelestialCoordinate const& coordinate) {
-  RecursiveMutexLocker locker(m_mutex);
-
   if (!coordinate)
     return false;
 
-  auto const& chunk = getChunk(chunkIndexFor(coordinate));
+  auto chunk = getChunk(chunkIndexFor(coordinate));
 
-  auto systemObjects = chunk.systemObjects.ptr(coordinate.location());
+  auto systemObjects = chunk->systemObjects.ptr(coordinate.location());
   if (!systemObjects)
     return false;
 
@@ -231,22 +234,20 @@ Maybe<CelestialCoordinate> CelestialMasterDatabase::findRandomWorld(unsigned tri
 }
 
 Maybe<CelestialParameters> CelestialMasterDatabase::parameters(CelestialCoordinate const& coordinate) {
-  RecursiveMutexLocker locker(m_mutex);
-
   if (!coordinateValid(coordinate))
     throw CelestialException("CelestialMasterDatabase::parameters called on invalid coordinate");
 
-  auto const& chunk = getChunk(chunkIndexFor(coordinate));
+  auto chunk = getChunk(chunkIndexFor(coordinate));
 
   if (coordinate.isSatelliteBody())
-    return chunk.systemObjects.get(coordinate.location())
+    return chunk->systemObjects.get(coordinate.location())
         .get(coordinate.parent().orbitNumber())
         .satelliteParameters.get(coordinate.orbitNumber());
 
   if (coordinate.isPlanetaryBody())
-    return chunk.systemObjects.get(coordinate.location()).get(coordinate.orbitNumber()).planetParameters;
+    return chunk->systemObjects.get(coordinate.location()).get(coordinate.orbitNumber()).planetParameters;
 
-  return chunk.systemParameters.get(coordinate.location());
+  return chunk->systemParameters.get(coordinate.location());
 }
 
 Maybe<String> CelestialMasterDatabase::name(CelestialCoordinate const& coordinate) {
@@ -254,12 +255,11 @@ Maybe<String> CelestialMasterDatabase::name(CelestialCoordinate const& coordinat
 }
 
 Maybe<bool> CelestialMasterDatabase::hasChildren(CelestialCoordinate const& coordinate) {
-  RecursiveMutexLocker locker(m_mutex);
-
   if (!coordinateValid(coordinate))
     throw CelestialException("CelestialMasterDatabase::hasChildren called on invalid coordinate");
 
-  auto const& systemObjects = getChunk(chunkIndexFor(coordinate)).systemObjects.get(coordinate.location());
+  auto chunk = getChunk(chunkIndexFor(coordinate));
+  auto const& systemObjects = chunk->systemObjects.get(coordinate.location());
 
   if (coordinate.isSystem())
     return !systemObjects.empty();
@@ -275,12 +275,11 @@ List<CelestialCoordinate> CelestialMasterDatabase::children(CelestialCoordinate
 }
 
 List<int> CelestialMasterDatabase::childOrbits(CelestialCoordinate const& coordinate) {
-  RecursiveMutexLocker locker(m_mutex);
-
   if (!coordinateValid(coordinate))
     throw CelestialException("CelestialMasterDatabase::childOrbits called on invalid coordinate");
 
-  auto const& systemObjects = getChunk(chunkIndexFor(coordinate)).systemObjects.get(coordinate.location());
+  auto chunk = getChunk(chunkIndexFor(coordinate));
+  auto const& systemObjects = chunk->systemObjects.get(coordinate.location());
 
   if (coordinate.isSystem())
     return systemObjects.keys();
@@ -292,17 +291,10 @@ List<int> CelestialMasterDatabase::childOrbits(CelestialCoordinate const& coordi
 }
 
 List<CelestialCoordinate> CelestialMasterDatabase::scanSystems(RectI const& region, Maybe<StringSet> const& includedTypes) {
-  RecursiveMutexLocker locker(m_mutex);
-
   List<CelestialCoordinate> systems;
   for (auto const& chunkLocation : chunkIndexesFor(region)) {
-    auto const& chunkData = getChunk(chunkLocation, [&](std::function<void()>&& func) {
-      locker.unlock();
-      func();
-      locker.lock();
-    });
-    locker.unlock();
-    for (auto const& pair : chunkData.systemParameters) {
+    auto chunkData = getChunk(chunkLocation);
+    for (auto const& pair : chunkData->systemParameters) {
       Vec3I systemLocation = pair.first;
       if (region.contains(systemLocation.vec2())) {
         if (includedTypes) {
@@ -313,18 +305,15 @@ List<CelestialCoordinate> CelestialMasterDatabase::scanSystems(RectI const& regi
         systems.append(CelestialCoordinate(systemLocation));
       }
     }
-    locker.lock();
   }
   return systems;
 }
 
 List<pair<Vec2I, Vec2I>> CelestialMasterDatabase::scanConstellationLines(RectI const& region) {
-  RecursiveMutexLocker locker(m_mutex);
-
   List<pair<Vec2I, Vec2I>> lines;
   for (auto const& chunkLocation : chunkIndexesFor(region)) {
-    auto const& chunkData = getChunk(chunkLocation);
-    for (auto const& constellation : chunkData.constellations) {
+    auto chunkData = getChunk(chunkLocation);
+    for (auto const& constellation : chunkData->constellations) {
       for (auto const& line : constellation) {
         if (region.intersects(Line2I(line.first, line.second)))
           lines.append(line);
@@ -339,13 +328,13 @@ bool CelestialMasterDatabase::scanRegionFullyLoaded(RectI const&) {
 }
 
 void CelestialMasterDatabase::updateParameters(CelestialCoordinate const& coordinate, CelestialParameters const& parameters) {
-  RecursiveMutexLocker locker(m_mutex);
+  MutexLocker updateLocker(m_updateMutex);
 
   if (!coordinateValid(coordinate))
     throw CelestialException("CelestialMasterDatabase::updateParameters called on invalid coordinate");
 
   auto chunkIndex = chunkIndexFor(coordinate);
-  auto chunk = getChunk(chunkIndex);
+  CelestialChunk chunk = *getChunk(chunkIndex);
 
   bool updated = false;
   if (coordinate.isSatelliteBody()) {
@@ -361,9 +350,16 @@ void CelestialMasterDatabase::updateParameters(CelestialCoordinate const& coordi
   if (updated && m_database.isOpen()) {
     auto versioningDatabase = Root::singleton().versioningDatabase();
     auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", chunk.toJson());
-    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
 
-    m_chunkCache.remove(chunkIndex);
+    // Wait out any load of this chunk that is still in flight, it may have
+    // read the chunk from before the update and would cache it afterwards.
+    auto& shard = chunkCacheShard(chunkIndex);
+    MutexLocker shardLocker(shard.mutex);
+    while (shard.pending.contains(chunkIndex))
+      shard.loaded.wait(shard.mutex);
+
+    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
+    shard.chunks.remove(chunkIndex);
   } else {
     updated = false;
   }
@@ -381,36 +377,64 @@ Maybe<CelestialOrbitRegion> CelestialMasterDatabase::orbitRegion(
   return {};
 }
 
-CelestialChunk const& CelestialMasterDatabase::getChunk(Vec2I const& chunkIndex, UnlockDuringFunction unlockDuring) {
-  return m_chunkCache.get(chunkIndex, [&](Vec2I const& chunkIndex) -> CelestialChunk {
-      auto versioningDatabase = Root::singleton().versioningDatabase();
+CelestialMasterDatabase::ChunkCacheShard& CelestialMasterDatabase::chunkCacheShard(Vec2I const& chunkIndex) {
+  return m_chunkCacheShards[hash<Vec2I>()(chunkIndex) % ChunkCacheShards];
+}
 
-      if (m_database.isOpen()) {
-        if (auto chunkData = m_database.find(DataStreamBuffer::serialize(chunkIndex))) {
-          auto versionedChunk = DataStreamBuffer::deserialize<VersionedJson>(uncompressData(chunkData.take()));
-          if (!versioningDatabase->versionedJsonCurrent(versionedChunk)) {
-            versionedChunk = versioningDatabase->updateVersionedJson(versionedChunk);
-            m_database.insert(DataStreamBuffer::serialize(chunkIndex),
-                compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
-          }
-          return CelestialChunk(versionedChunk.content);
-        }
-      }
+CelestialChunkConstPtr CelestialMasterDatabase::getChunk(Vec2I const& chunkIndex) {
+  auto& shard = chunkCacheShard(chunkIndex);
+  MutexLocker locker(shard.mutex);
+  while (true) {
+    if (auto chunk = shard.chunks.ptr(chunkIndex))
+      return *chunk;
+    if (!shard.pending.contains(chunkIndex))
+      break;
+    shard.loaded.wait(shard.mutex);
+  }
 
-      CelestialChunk newChunk;
-      auto producer = [&]() { newChunk = produceChunk(chunkIndex); };
-      if (unlockDuring)
-        unlockDuring(producer);
-      else
-        producer();
-      if (m_database.isOpen()) {
-        auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", newChunk.toJson());
+  shard.pending.add(chunkIndex);
+  locker.unlock();
+
+  CelestialChunkConstPtr chunk;
+  try {
+    chunk = make_shared<CelestialChunk>(loadChunk(chunkIndex));
+  } catch (...) {
+    locker.lock();
+    shard.pending.remove(chunkIndex);
+    shard.loaded.broadcast();
+    throw;
+  }
+
+  locker.lock();
+  shard.chunks.set(chunkIndex, chunk);
+  shard.pending.remove(chunkIndex);
+  shard.loaded.broadcast();
+  return chunk;
+}
+
+CelestialChunk CelestialMasterDatabase::loadChunk(Vec2I const& chunkIndex) {
+  auto versioningDatabase = Root::singleton().versioningDatabase();
+
+  if (m_database.isOpen()) {
+    if (auto chunkData = m_database.find(DataStreamBuffer::serialize(chunkIndex))) {
+      auto versionedChunk = DataStreamBuffer::deserialize<VersionedJson>(uncompressData(chunkData.take()));
+      if (!versioningDatabase->versionedJsonCurrent(versionedChunk)) {
+        versionedChunk = versioningDatabase->updateVersionedJson(versionedChunk);
         m_database.insert(DataStreamBuffer::serialize(chunkIndex),
             compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
       }
+      return CelestialChunk(versionedChunk.content);
+    }
+  }
+
+  CelestialChunk newChunk = produceChunk(chunkIndex);
+  if (m_database.isOpen()) {
+    auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", newChunk.toJson());
+    m_database.insert(DataStreamBuffer::serialize(chunkIndex),
+        compressData(DataStreamBuffer::serialize<VersionedJson>(versionedChunk)));
+  }
 
-      return newChunk;
-    });
+  return newChunk;
 }
 
 CelestialChunk CelestialMasterDatabase::produceChunk(Vec2I const& chunkIndex) const {
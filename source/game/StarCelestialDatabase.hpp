@@ -161,8 +161,26 @@ protected:
   static Maybe<CelestialOrbitRegion> orbitRegion(
       List<CelestialOrbitRegion> const& orbitRegions, int planetaryOrbitNumber);
 
-  typedef std::function<void(std::function<void()>&&)>&& UnlockDuringFunction;
-  CelestialChunk const& getChunk(Vec2I const& chunkLocation, UnlockDuringFunction unlockDuring = {});
+  // The chunk cache is split into shards by chunk index, each with its own
+  // lock, so that requests for different chunks never wait on each other.
+  // Chunks that are being loaded or generated are marked pending in their
+  // shard, and any other request for the same chunk waits for that one load
+  // rather than producing it again.
+  struct ChunkCacheShard {
+    Mutex mutex;
+    ConditionVariable loaded;
+    HashTtlCache<Vec2I, CelestialChunkConstPtr> chunks;
+    HashSet<Vec2I> pending;
+  };
+
+  static size_t const ChunkCacheShards = 16;
+
+  ChunkCacheShard& chunkCacheShard(Vec2I const& chunkIndex);
+
+  CelestialChunkConstPtr getChunk(Vec2I const& chunkIndex);
+  // Reads the chunk from the database if it is stored there, otherwise
+  // produces it and stores it.  Called without any shard lock held.
+  CelestialChunk loadChunk(Vec2I const& chunkIndex);
 
   CelestialChunk produceChunk(Vec2I const& chunkLocation) const;
   Maybe<pair<CelestialParameters, HashMap<int, CelestialPlanet>>> produceSystem(
@@ -172,11 +190,14 @@ protected:
 
   GenerationInformation m_generationInformation;
 
-  mutable RecursiveMutex m_mutex;
-
-  HashTtlCache<Vec2I, CelestialChunk> m_chunkCache;
+  Array<ChunkCacheShard, ChunkCacheShards> m_chunkCacheShards;
   BTreeSha256Database m_database;
 
+  // Serializes updateParameters, so that two updates to the same chunk can't
+  // each overwrite the other.
+  Mutex m_updateMutex;
+
+  Mutex m_commitMutex;
   float m_commitInterval;
   Timer m_commitTimer;
 };
@@ -79,6 +79,21 @@ struct CollisionBlock {
   RectF polyBounds;
 };
 
+// A collision block found by a batch collision query.  The vertices are not
+// translated and are only valid for the duration of the query callback, the
+// bounds are already translated to be near the query region.
+struct CollisionCandidate {
+  CollisionKind kind;
+  Vec2I space;
+  Vec2F translation;
+  RectF polyBounds;
+  Vec2F const* vertices;
+  size_t vertexCount;
+};
+
+// Called with the index of the query region and a block found for it.
+typedef function<void(size_t, CollisionCandidate const&)> CollisionCandidateCallback;
+
 inline CollisionSet::CollisionSet()
   : m_kinds(0) {}
 
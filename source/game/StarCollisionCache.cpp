@@ -0,0 +1,117 @@
+#include "StarCollisionCache.hpp"
+
+namespace Star {
+
+static int sectorIndex(int position) {
+  return position >= 0 ? position / CollisionCache::SectorSize : -((CollisionCache::SectorSize - 1 - position) / CollisionCache::SectorSize);
+}
+
+CollisionCache::CollisionCache(WorldGeometry const& geometry, BlockSource blockSource)
+  : m_geometry(geometry), m_blockSource(std::move(blockSource)) {}
+
+void CollisionCache::invalidate(RectI const& region) {
+  if (region.isEmpty())
+    return;
+
+  forEachSector(region, [this](Vec2I const& sector) {
+      m_sectors.remove(sector);
+    });
+}
+
+void CollisionCache::clear() {
+  m_sectors.clear();
+}
+
+size_t CollisionCache::sectorCount() const {
+  return m_sectors.size();
+}
+
+void CollisionCache::query(List<RectF> const& regions, CollisionCandidateCallback const& callback) {
+  for (auto& p : m_querySectors)
+    p.second.clear();
+
+  for (size_t i = 0; i < regions.size(); ++i) {
+    // Collision polys extend at most one tile outside of their space.
+    forEachSector(RectI::integral(regions[i].padded(1)), [&](Vec2I const& sector) {
+        m_querySectors[sector].append(i);
+      });
+  }
+
+  CollisionCandidate candidate;
+  for (auto const& p : m_querySectors) {
+    if (p.second.empty())
+      continue;
+
+    Sector const& sector = this->sector(p.first);
+    for (size_t b = 0; b < sector.kinds.size(); ++b) {
+      RectF const& bounds = sector.bounds[b];
+      Vec2F const& basePosition = sector.vertices[sector.vertexStarts[b]];
+      for (size_t regionIndex : p.second) {
+        RectF const& region = regions[regionIndex];
+        Vec2F translation = m_geometry.nearestTo(region.min(), basePosition) - basePosition;
+        if (!region.intersects(bounds.translated(translation)))
+          continue;
+
+        candidate.kind = sector.kinds[b];
+        candidate.space = sector.spaces[b];
+        candidate.translation = translation;
+        candidate.polyBounds = bounds.translated(translation);
+        candidate.vertices = sector.vertices.ptr() + sector.vertexStarts[b];
+        candidate.vertexCount = sector.vertexStarts[b + 1] - sector.vertexStarts[b];
+        callback(regionIndex, candidate);
+      }
+    }
+  }
+
+  // Keep the per sector lists around between queries, but not indefinitely.
+  if (m_querySectors.size() > 1024)
+    m_querySectors.clear();
+}
+
+Vec2I CollisionCache::sectorFor(Vec2I const& position) const {
+  return Vec2I(sectorIndex(m_geometry.xwrap(position[0])), sectorIndex(position[1]));
+}
+
+RectI CollisionCache::sectorRegion(Vec2I const& sector) const {
+  RectI region = RectI::withSize(sector * SectorSize, Vec2I::filled(SectorSize));
+  // The last sector before the wrap point may be narrower than the rest.
+  if (m_geometry.wrapsX() && region.xMin() >= 0 && region.xMin() < (int)m_geometry.width())
+    region.setXMax(min<int>(region.xMax(), m_geometry.width()));
+  return region;
+}
+
+template <typename Function>
+void CollisionCache::forEachSector(RectI const& region, Function&& function) const {
+  int x = region.xMin();
+  while (x < region.xMax()) {
+    Vec2I first = sectorFor(Vec2I(x, region.yMin()));
+    Vec2I last = sectorFor(Vec2I(x, region.yMax() - 1));
+    for (int y = first[1]; y <= last[1]; ++y)
+      function(Vec2I(first[0], y));
+
+    RectI sectorRegion = this->sectorRegion(first);
+    x += sectorRegion.xMax() - m_geometry.xwrap(x);
+  }
+}
+
+auto CollisionCache::sector(Vec2I const& sectorPosition) -> Sector const& {
+  if (auto sector = m_sectors.ptr(sectorPosition))
+    return *sector;
+
+  Sector& sector = m_sectors[sectorPosition];
+  sector.vertexStarts.append(0);
+  m_blockSource(sectorRegion(sectorPosition), [&sector](CollisionBlock const& block) {
+      if (block.kind == CollisionKind::None || block.poly.isNull())
+        return;
+
+      sector.kinds.append(block.kind);
+      sector.spaces.append(block.space);
+      sector.bounds.append(block.polyBounds);
+      sector.vertices.appendAll(block.poly.vertexes());
+      sector.vertexStarts.append(sector.vertices.size());
+    });
+
+  return sector;
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "StarCollisionBlock.hpp"
+#include "StarWorldGeometry.hpp"
+
+namespace Star {
+
+STAR_CLASS(CollisionCache);
+
+// Collision geometry of a world flattened into contiguous arrays per sector,
+// so that many collision queries can be answered without visiting every tile
+// of their regions.  Sectors are built on demand from the world's own
+// collision blocks and must be invalidated whenever those blocks change.
+class CollisionCache {
+public:
+  static int const SectorSize = 32;
+
+  // Produces every collision block for the tiles in the given region,
+  // including null blocks for unloaded tiles or tiles outside of the world.
+  typedef function<void(RectI const&, function<void(CollisionBlock const&)> const&)> BlockSource;
+
+  CollisionCache(WorldGeometry const& geometry, BlockSource blockSource);
+
+  // Drops every sector containing tiles in the given region.
+  void invalidate(RectI const& region);
+  void clear();
+
+  size_t sectorCount() const;
+
+  // Finds every non-empty block whose poly intersects each of the given
+  // regions.  Regions are grouped by the sectors they cover, so each sector's
+  // blocks are scanned once for all the regions that need them.
+  void query(List<RectF> const& regions, CollisionCandidateCallback const& callback);
+
+private:
+  struct Sector {
+    List<CollisionKind> kinds;
+    List<Vec2I> spaces;
+    List<RectF> bounds;
+    // Offsets into vertices for each block, with one trailing entry.
+    List<uint32_t> vertexStarts;
+    List<Vec2F> vertices;
+  };
+
+  Vec2I sectorFor(Vec2I const& position) const;
+  RectI sectorRegion(Vec2I const& sector) const;
+  // Calls 'function' for every sector covering the given region, once each.
+  template <typename Function>
+  void forEachSector(RectI const& region, Function&& function) const;
+
+  Sector const& sector(Vec2I const& sector);
+
+  WorldGeometry m_geometry;
+  BlockSource m_blockSource;
+  HashMap<Vec2I, Sector> m_sectors;
+
+  HashMap<Vec2I, List<size_t>> m_querySectors;
+};
+
+}
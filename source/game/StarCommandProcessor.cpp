@@ -11,6 +11,8 @@
 #include "StarItemDrop.hpp"
 #include "StarTreasure.hpp"
 #include "StarLogging.hpp"
+#include "StarProfiler.hpp"
+#include "StarFile.hpp"
 #include "StarPlayer.hpp"
 #include "StarMonster.hpp"
 #include "StarStagehand.hpp"
@@ -25,7 +27,7 @@
 namespace Star {
 
 CommandProcessor::CommandProcessor(UniverseServer* universe, LuaRootPtr luaRoot)
-  : m_universe(universe) {
+  : m_universe(universe), m_lastMemoryStatsTime(Time::monotonicMilliseconds()) {
   auto assets = Root::singleton().assets();
   m_scriptComponent.addCallbacks("universe", LuaBindings::makeUniverseServerCallbacks(m_universe));
   m_scriptComponent.addCallbacks("CommandProcessor", makeCommandCallbacks());
@@ -250,6 +252,191 @@ String CommandProcessor::tickrate(ConnectionId connectionId, String const& argum
   return strf("Set tick rate to {:4.2f}Hz", tickRate);
 }
 
+String CommandProcessor::profiler(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "profile the server"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? "" : arguments[0].toLower();
+
+  if (action == "start") {
+    Profiler::setEnabled(true);
+    return "Profiling started";
+  } else if (action == "stop") {
+    Profiler::setEnabled(false);
+    return "Profiling stopped";
+  } else if (action == "reset") {
+    Profiler::reset();
+    return "Profiling data cleared";
+  } else if (action == "stats") {
+    auto stats = Profiler::stats(arguments.size() > 1 ? arguments[1] : "");
+    if (stats.empty())
+      return "No phases recorded";
+
+    auto ms = [](int64_t microseconds) { return microseconds / 1000.0; };
+    StringList lines;
+    String group;
+    for (auto const& phase : stats) {
+      if (phase.group != group) {
+        group = phase.group;
+        lines.append(group);
+      }
+      lines.append(strf("  {}: {} calls, mean {:.3f}ms, p50 {:.3f}ms, p95 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms",
+          phase.phase, phase.count, ms(phase.total) / phase.count, ms(phase.p50), ms(phase.p95), ms(phase.p99), ms(phase.max)));
+    }
+    return lines.join("\n");
+  } else if (action == "trace") {
+    // Traces only ever go in the profiles directory of storage.
+    String fileName = arguments.size() > 1
+      ? File::baseName(arguments[1])
+      : strf("trace-{}.json", Time::printCurrentDateAndTime("<year><month><day>-<hours><minutes><seconds>"));
+    String directory = Root::singleton().toStoragePath("profiles");
+    if (!File::isDirectory(directory))
+      File::makeDirectoryRecursive(directory);
+    String path = File::relativeTo(directory, fileName);
+    File::writeFile(Profiler::chromeTrace().repr(), path);
+    return strf("Wrote trace to {}", path);
+  }
+
+  return strf("Profiling is {}. Use /profiler <start|stop|reset|stats [group]|trace [file]>", Profiler::enabled() ? "on" : "off");
+}
+
+String CommandProcessor::entityCpu(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "account entity usage"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? "top" : arguments[0].toLower();
+  size_t nextArgument = 1;
+  size_t count = 10;
+  if (arguments.size() > nextArgument) {
+    if (auto parsedCount = maybeLexicalCast<size_t>(arguments[nextArgument])) {
+      count = *parsedCount;
+      ++nextArgument;
+    }
+  }
+
+  // Runs on the given world, or on the world of whoever sent the command.
+  Maybe<WorldId> worldId;
+  if (arguments.size() > nextArgument) {
+    try {
+      worldId = parseWorldId(arguments[nextArgument]);
+    } catch (StarException const& e) {
+      return strf("Invalid world id {}: {}", arguments[nextArgument], e.what());
+    }
+  }
+
+  String result;
+  auto command = [&](WorldServer* world) {
+    if (action == "start") {
+      world->setEntityCpuAccounting(true);
+      result = "Entity usage accounting started";
+    } else if (action == "stop") {
+      world->setEntityCpuAccounting(false);
+      result = "Entity usage accounting stopped";
+    } else if (action == "reset") {
+      world->resetEntityCpuAccounting();
+      result = "Entity usage accounting reset";
+    } else if (action == "top" || action == "names") {
+      double accountedTime = world->entityCpuAccountedTime();
+      if (accountedTime <= 0.0) {
+        result = "No entity usage accounted, use /entitycpu start";
+        return;
+      }
+
+      // Milliseconds of each second of world time.
+      auto share = [accountedTime](int64_t time) { return time / 1000.0 / accountedTime; };
+      StringList lines = {strf("Entity usage over {:.1f}s, in ms per second{}:", accountedTime, world->entityCpuAccounting() ? "" : " (stopped)")};
+      for (auto const& usage : world->topEntityCpuUsage(count, action == "names")) {
+        String subject = usage.entityId == NullEntityId
+          ? strf("{} ({} entities)", usage.name, usage.entityCount)
+          : strf("{} {} at {:.0f}, {:.0f}", usage.entityId, usage.name, usage.position[0], usage.position[1]);
+        lines.append(strf("  {}: {:.3f} (update {:.3f}, messages {:.3f}, net state {:.3f})", subject,
+            share(usage.totalTime()), share(usage.updateTime), share(usage.messageTime), share(usage.netStateTime)));
+      }
+      result = lines.join("\n");
+    } else if (action == "slices") {
+      // Scripts whose updates overrun their instruction budget, when update
+      // slicing is enabled.
+      List<pair<EntityPtr, LuaUpdateStatistics>> sliced;
+      world->forEachEntity(RectF(Vec2F(), Vec2F(world->geometry().size())), [&](EntityPtr const& entity) {
+          if (auto scriptedEntity = as<ScriptedEntity>(entity)) {
+            auto statistics = scriptedEntity->scriptUpdateStatistics();
+            if (statistics && (statistics->slicedUpdates != 0 || statistics->abandonedUpdates != 0))
+              sliced.append({entity, *statistics});
+          }
+        });
+      if (sliced.empty()) {
+        result = "No sliced script updates";
+        return;
+      }
+
+      sortByComputedValue(sliced, [](pair<EntityPtr, LuaUpdateStatistics> const& p) {
+          return make_tuple(-(int64_t)p.second.abandonedUpdates, -(int64_t)p.second.slicedUpdates);
+        });
+      StringList lines = {"Sliced script updates:"};
+      for (auto const& p : sliced.slice(0, count)) {
+        auto const& statistics = p.second;
+        lines.append(strf("  {} {} at {:.0f}, {:.0f}: {} abandoned, {} of {} updates sliced, {} slices, at most {} in one update",
+            p.first->entityId(), EntityTypeNames.getRight(p.first->entityType()), p.first->position()[0], p.first->position()[1],
+            statistics.abandonedUpdates, statistics.slicedUpdates, statistics.updates, statistics.slices, statistics.maxSlices));
+      }
+      result = lines.join("\n");
+    } else {
+      result = "Use /entitycpu <start|stop|reset|top [count]|names [count]|slices [count]> [world id]";
+    }
+  };
+
+  if (worldId) {
+    if (!m_universe->executeForWorld(*worldId, command))
+      return strf("World {} is not active", *worldId);
+  } else if (!m_universe->executeForClient(connectionId, [&](WorldServer* world, PlayerPtr const&) { command(world); })) {
+    return "Not in a world, a world id must be given";
+  }
+  return result;
+}
+
+String CommandProcessor::memory(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "report memory usage"))
+    return *errorMsg;
+
+  if (!MemoryTracker::enabled())
+    return "Memory tracking is not compiled in, build with STAR_MEMORY_TRACKING";
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String filter = arguments.empty() ? "" : arguments[0];
+
+  // Rates are over the time since the last /memory, whatever its filter.
+  auto stats = MemoryTracker::stats();
+  int64_t now = Time::monotonicMilliseconds();
+  double seconds = max<int64_t>(now - m_lastMemoryStatsTime, 1) / 1000.0;
+
+  auto megabytes = [](double bytes) { return bytes / (1024 * 1024); };
+  StringList lines;
+  StringMap<MemoryTracker::TagStats> lastStats;
+  int64_t totalLiveBytes = 0;
+  for (auto const& tag : stats) {
+    lastStats[tag.name] = tag;
+    totalLiveBytes += tag.liveBytes;
+    if (!tag.name.contains(filter))
+      continue;
+
+    uint64_t allocations = tag.allocations;
+    uint64_t allocatedBytes = tag.allocatedBytes;
+    if (auto last = m_lastMemoryStats.ptr(tag.name)) {
+      allocations -= last->allocations;
+      allocatedBytes -= last->allocatedBytes;
+    }
+    lines.append(strf("{}: {:.2f}MB live in {} allocations, {:.0f} allocations/s, {:.2f}MB/s allocated",
+        tag.name, megabytes(tag.liveBytes), tag.liveAllocations, allocations / seconds, megabytes(allocatedBytes / seconds)));
+  }
+  lines.insertAt(0, strf("{:.2f}MB live over {} tags, rates over the last {:.1f}s", megabytes(totalLiveBytes), stats.size(), seconds));
+
+  m_lastMemoryStats = std::move(lastStats);
+  m_lastMemoryStatsTime = now;
+  return lines.join("\n");
+}
+
 String CommandProcessor::setTileProtection(ConnectionId connectionId, String const& argumentString) {
   if (auto errorMsg = adminCheck(connectionId, "modify world properties")) {
     return *errorMsg;
@@ -936,6 +1123,12 @@ String CommandProcessor::handleCommand(ConnectionId connectionId, String const&
     return timescale(connectionId, argumentString);
   } else if (command == "tickrate") {
     return tickrate(connectionId, argumentString);
+  } else if (command == "profiler") {
+    return profiler(connectionId, argumentString);
+  } else if (command == "entitycpu") {
+    return entityCpu(connectionId, argumentString);
+  } else if (command == "memory") {
+    return memory(connectionId, argumentString);
   } else if (command == "settileprotection") {
     return setTileProtection(connectionId, argumentString);
   } else if (command == "setdungeonid") {
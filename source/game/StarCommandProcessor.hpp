@@ -4,6 +4,7 @@
 #include "StarShellParser.hpp"
 #include "StarLuaComponents.hpp"
 #include "StarLuaRoot.hpp"
+#include "StarMemoryTracker.hpp"
 
 namespace Star {
 
@@ -30,6 +31,9 @@ private:
   String timewarp(ConnectionId connectionId, String const& argumentString);
   String timescale(ConnectionId connectionId, String const& argumentString);
   String tickrate(ConnectionId connectionId, String const& argumentString);
+  String profiler(ConnectionId connectionId, String const& argumentString);
+  String entityCpu(ConnectionId connectionId, String const& argumentString);
+  String memory(ConnectionId connectionId, String const& argumentString);
   String setTileProtection(ConnectionId connectionId, String const& argumentString);
   String setDungeonId(ConnectionId connectionId, String const& argumentString);
   String setPlayerStart(ConnectionId connectionId, String const& argumentString);
@@ -70,6 +74,10 @@ private:
   UniverseServer* m_universe;
   ShellParser m_parser;
 
+  // Memory stats as of the last /memory, to report allocation rates since.
+  StringMap<MemoryTracker::TagStats> m_lastMemoryStats;
+  int64_t m_lastMemoryStatsTime;
+
   LuaBaseComponent m_scriptComponent;
 };
 
@@ -0,0 +1,35 @@
+#include "StarDamageBroadPhase.hpp"
+
+namespace Star {
+
+float const DamageBroadPhase::CellSize = 16.0f;
+
+void DamageBroadPhase::clear(WorldGeometry const& geometry) {
+  m_geometry = geometry;
+  m_bounds.clear();
+  m_cells.clear();
+}
+
+size_t DamageBroadPhase::addTarget(RectF const& bounds) {
+  m_bounds.append(bounds);
+  return m_bounds.size() - 1;
+}
+
+void DamageBroadPhase::build() {
+  m_cells.clear();
+  for (uint32_t i = 0; i < m_bounds.size(); ++i) {
+    if (m_bounds[i].isNull())
+      continue;
+
+    for (auto const& rect : m_geometry.splitRect(m_bounds[i])) {
+      RectI range = cellRange(rect);
+      for (int x = range.xMin(); x <= range.xMax(); ++x) {
+        for (int y = range.yMin(); y <= range.yMax(); ++y)
+          m_cells.append({cellKey(x, y), i});
+      }
+    }
+  }
+  sort(m_cells);
+}
+
+}
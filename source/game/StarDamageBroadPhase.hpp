@@ -0,0 +1,108 @@
+#pragma once
+
+#include "StarWorldGeometry.hpp"
+
+namespace Star {
+
+STAR_CLASS(DamageBroadPhase);
+
+// Uniform grid of the bound boxes of everything that can be hit by damage,
+// rebuilt once per tick, so that each damage source only visits the targets
+// in the cells it covers.  Cells are kept as a sorted flat list rather than a
+// map, so rebuilding reuses the previous tick's storage.
+class DamageBroadPhase {
+public:
+  static float const CellSize;
+
+  // Removes every target, and sets the geometry of the world they are in.
+  void clear(WorldGeometry const& geometry);
+
+  // Adds a target with the given bound box in world space, targets are
+  // numbered in the order they are added.
+  size_t addTarget(RectF const& bounds);
+  size_t targetCount() const;
+  RectF const& targetBounds(size_t target) const;
+
+  // Must be called after adding targets and before querying.
+  void build();
+
+  // Calls 'function' with the index of every target whose bound box
+  // intersects the given bound box, once each and in increasing order.
+  template <typename Function>
+  void forEachTarget(RectF const& bounds, Function&& function);
+
+private:
+  static uint64_t cellKey(int x, int y);
+  static RectI cellRange(RectF const& rect);
+
+  WorldGeometry m_geometry;
+  List<RectF> m_bounds;
+  // Cell key and target index for every cell covered by every target.
+  List<pair<uint64_t, uint32_t>> m_cells;
+  List<uint32_t> m_found;
+};
+
+inline size_t DamageBroadPhase::targetCount() const {
+  return m_bounds.size();
+}
+
+inline RectF const& DamageBroadPhase::targetBounds(size_t target) const {
+  return m_bounds.at(target);
+}
+
+inline uint64_t DamageBroadPhase::cellKey(int x, int y) {
+  return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+inline RectI DamageBroadPhase::cellRange(RectF const& rect) {
+  return RectI(floor(rect.xMin() / CellSize), floor(rect.yMin() / CellSize),
+      floor(rect.xMax() / CellSize), floor(rect.yMax() / CellSize));
+}
+
+template <typename Function>
+void DamageBroadPhase::forEachTarget(RectF const& bounds, Function&& function) {
+  if (bounds.isNull() || m_bounds.empty())
+    return;
+
+  auto splitBounds = m_geometry.splitRect(bounds);
+
+  size_t cellCount = 0;
+  for (auto const& rect : splitBounds) {
+    RectI range = cellRange(rect);
+    cellCount += (size_t)(range.width() + 1) * (range.height() + 1);
+  }
+
+  m_found.clear();
+  if (cellCount > m_bounds.size()) {
+    // Bigger than every target put together, just check them all.
+    for (size_t i = 0; i < m_bounds.size(); ++i) {
+      if (m_geometry.rectIntersectsRect(m_bounds[i], bounds))
+        m_found.append(i);
+    }
+  } else {
+    auto keyLess = [](pair<uint64_t, uint32_t> const& cell, uint64_t key) { return cell.first < key; };
+    for (auto const& rect : splitBounds) {
+      RectI range = cellRange(rect);
+      for (int x = range.xMin(); x <= range.xMax(); ++x) {
+        for (int y = range.yMin(); y <= range.yMax(); ++y) {
+          uint64_t key = cellKey(x, y);
+          for (auto i = std::lower_bound(m_cells.begin(), m_cells.end(), key, keyLess); i != m_cells.end() && i->first == key; ++i) {
+            if (m_geometry.rectIntersectsRect(m_bounds[i->second], bounds))
+              m_found.append(i->second);
+          }
+        }
+      }
+    }
+    sort(m_found);
+  }
+
+  uint32_t prev = highest<uint32_t>();
+  for (uint32_t target : m_found) {
+    if (target == prev)
+      continue;
+    prev = target;
+    function(target);
+  }
+}
+
+}
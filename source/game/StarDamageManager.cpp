@@ -56,6 +56,16 @@ DataStream& operator>>(DataStream& ds, RemoteDamageNotification& damageNotificat
   return ds;
 }
 
+// Only these entity types can be hit, every other type uses the default
+// Entity::queryHit, which never hits.
+static bool canBeHit(EntityType entityType) {
+  return entityType == EntityType::Object
+    || entityType == EntityType::Vehicle
+    || entityType == EntityType::Monster
+    || entityType == EntityType::Npc
+    || entityType == EntityType::Player;
+}
+
 DamageManager::DamageManager(World* world, ConnectionId connectionId) : m_world(world), m_connectionId(connectionId) {}
 
 void DamageManager::update(float dt) {
@@ -63,68 +73,99 @@ void DamageManager::update(float dt) {
 
   auto damageIt = makeSMutableMapIterator(m_recentEntityDamages);
   while (damageIt.hasNext()) {
-    auto& events = damageIt.next().second;
-    auto eventIt = makeSMutableIterator(events);
-    while (eventIt.hasNext()) {
-      auto& event = eventIt.next();
-      event.timeout -= dt;
-      auto entityIdTimeoutGroup = event.timeoutGroup.maybe<EntityId>();
-      if (event.timeout <= 0.0f || (entityIdTimeoutGroup && !m_world->entity(*entityIdTimeoutGroup)))
-        eventIt.remove();
-    }
-    if (events.empty())
+    auto& damages = damageIt.next().second;
+    eraseWhere(damages.causingEntities, [this, dt](auto& p) {
+        p.second -= dt;
+        return p.second <= 0.0f || !m_world->entity(p.first);
+      });
+    eraseWhere(damages.repeatGroups, [dt](auto& p) {
+        p.second -= dt;
+        return p.second <= 0.0f;
+      });
+    if (damages.causingEntities.empty() && damages.repeatGroups.empty())
       damageIt.remove();
   }
 
-  m_world->forAllEntities([&](EntityPtr const& causingEntity) {
-    for (auto& damageSource : causingEntity->damageSources()) {
+  m_broadPhase.clear(m_world->geometry());
+  m_world->forAllEntities([&](EntityPtr const& entity) {
+    for (auto& damageSource : entity->damageSources()) {
       if (damageSource.trackSourceEntity)
-        damageSource.translate(causingEntity->position());
+        damageSource.translate(entity->position());
 
       if (auto poly = damageSource.damageArea.ptr<PolyF>())
         SpatialLogger::logPoly("world", *poly, Color::Orange.toRgba());
       else if (auto line = damageSource.damageArea.ptr<Line2F>())
         SpatialLogger::logLine("world", *line, Color::Orange.toRgba());
 
-      for (auto const& hitResultPair : queryHit(damageSource, causingEntity->entityId())) {
-        auto targetEntity = m_world->entity(hitResultPair.first);
-        if (!isAuthoritative(causingEntity, targetEntity))
-          continue;
+      m_sources.append({entity, std::move(damageSource)});
+    }
+
+    if (canBeHit(entity->entityType())) {
+      m_targets.append(entity);
+      m_broadPhase.addTarget(entity->metaBoundBox().translated(entity->position()));
+    }
+
+    for (auto const& damageNotification : entity->selfDamageNotifications())
+      addDamageNotification({entity->entityId(), damageNotification});
+  });
+
+  if (!m_sources.empty())
+    m_broadPhase.build();
+
+  auto const& geometry = m_world->geometry();
+  for (auto const& pendingSource : m_sources) {
+    auto const& causingEntity = pendingSource.causingEntity;
+    auto const& damageSource = pendingSource.source;
+
+    RectF bounds = RectF::null();
+    Line2F const* line = damageSource.damageArea.ptr<Line2F>();
+    if (auto poly = damageSource.damageArea.ptr<PolyF>())
+      bounds = poly->boundBox();
+    else if (line)
+      bounds = RectF::boundBoxOf(line->min(), line->max());
+
+    m_broadPhase.forEachTarget(bounds, [&](size_t target) {
+        auto const& targetEntity = m_targets[target];
+        if (line && !geometry.lineIntersectsRect(*line, m_broadPhase.targetBounds(target)))
+          return;
+
+        if (!targetEntity->inWorld() || !isAuthoritative(causingEntity, targetEntity))
+          return;
 
-        auto& eventList = m_recentEntityDamages[hitResultPair.first];
         // Guard against rapidly repeating damages by either the causing
         // entity id, or optionally the repeat group if specified.
-        bool allowDamage = true;
-        for (auto const& event : eventList) {
+        if (auto damages = m_recentEntityDamages.ptr(targetEntity->entityId())) {
           if (damageSource.damageRepeatGroup) {
-            if (event.timeoutGroup == *damageSource.damageRepeatGroup)
-              allowDamage = false;
-          } else {
-            if (event.timeoutGroup == causingEntity->entityId())
-              allowDamage = false;
+            if (damages->repeatGroups.contains(*damageSource.damageRepeatGroup))
+              return;
+          } else if (damages->causingEntities.contains(causingEntity->entityId())) {
+            return;
           }
         }
-        if (allowDamage) {
-          float timeout = damageSource.damageRepeatTimeout.value(DefaultDamageTimeout);
-          if (damageSource.damageRepeatGroup)
-            eventList.append({*damageSource.damageRepeatGroup, timeout});
-          else
-            eventList.append({causingEntity->entityId(), timeout});
-
-          auto damageRequest = DamageRequest(hitResultPair.second, damageSource.damageType, damageSource.damage,
-              damageSource.knockbackMomentum(m_world->geometry(), targetEntity->position()),
-              damageSource.sourceEntityId, damageSource.damageSourceKind, damageSource.statusEffects);
-          addHitRequest({causingEntity->entityId(), targetEntity->entityId(), damageRequest});
-
-          if (damageSource.damageType != NoDamage)
-            addDamageRequest({causingEntity->entityId(), targetEntity->entityId(), std::move(damageRequest)});
-        }
-      }
-    }
 
-    for (auto const& damageNotification : causingEntity->selfDamageNotifications())
-      addDamageNotification({causingEntity->entityId(), damageNotification});
-  });
+        auto hitType = queryHit(damageSource, causingEntity->entityId(), targetEntity);
+        if (!hitType)
+          return;
+
+        float timeout = damageSource.damageRepeatTimeout.value(DefaultDamageTimeout);
+        auto& damages = m_recentEntityDamages[targetEntity->entityId()];
+        if (damageSource.damageRepeatGroup)
+          damages.repeatGroups[*damageSource.damageRepeatGroup] = timeout;
+        else
+          damages.causingEntities[causingEntity->entityId()] = timeout;
+
+        auto damageRequest = DamageRequest(*hitType, damageSource.damageType, damageSource.damage,
+            damageSource.knockbackMomentum(geometry, targetEntity->position()),
+            damageSource.sourceEntityId, damageSource.damageSourceKind, damageSource.statusEffects);
+        addHitRequest({causingEntity->entityId(), targetEntity->entityId(), damageRequest});
+
+        if (damageSource.damageType != NoDamage)
+          addDamageRequest({causingEntity->entityId(), targetEntity->entityId(), std::move(damageRequest)});
+      });
+  }
+
+  m_sources.clear();
+  m_targets.clear();
 }
 
 void DamageManager::pushRemoteHitRequest(RemoteHitRequest const& remoteHitRequest) {
@@ -174,44 +215,35 @@ List<DamageNotification> DamageManager::pullPendingNotifications() {
   return take(m_pendingNotifications);
 }
 
-SmallList<pair<EntityId, HitType>, 4> DamageManager::queryHit(DamageSource const& source, EntityId causingId) const {
-  SmallList<pair<EntityId, HitType>, 4> resultList;
-  auto doQueryHit = [&source, &resultList, causingId, this](EntityPtr const& targetEntity) {
-    if (targetEntity->entityId() == causingId)
-      return;
+Maybe<HitType> DamageManager::queryHit(DamageSource const& source, EntityId causingId, EntityPtr const& targetEntity) const {
+  if (targetEntity->entityId() == causingId)
+    return {};
 
-    if (!source.team.canDamage(targetEntity->getTeam(), targetEntity->entityId() == source.sourceEntityId))
-      return;
+  if (!source.team.canDamage(targetEntity->getTeam(), targetEntity->entityId() == source.sourceEntityId))
+    return {};
 
-    if (source.rayCheck) {
-      if (auto poly = source.damageArea.ptr<PolyF>()) {
-        if (auto sourceEntity = m_world->entity(source.sourceEntityId)) {
-          auto overlap = m_world->geometry().rectOverlap(targetEntity->metaBoundBox().translated(targetEntity->position()), poly->boundBox());
-          if (!overlap.isEmpty() && m_world->lineTileCollision(overlap.center(), sourceEntity->position()))
-            return;
-        }
-      } else if (auto line = source.damageArea.ptr<Line2F>()) {
-        if (auto hitPoly = targetEntity->hitPoly()) {
-          if (auto intersection = m_world->geometry().lineIntersectsPolyAt(*line, *hitPoly)) {
-            if (m_world->lineTileCollision(line->min(), *intersection))
-              return;
-          }
+  auto hitResult = targetEntity->queryHit(source);
+  if (!hitResult)
+    return {};
+
+  if (source.rayCheck) {
+    if (auto poly = source.damageArea.ptr<PolyF>()) {
+      if (auto sourceEntity = m_world->entity(source.sourceEntityId)) {
+        auto overlap = m_world->geometry().rectOverlap(targetEntity->metaBoundBox().translated(targetEntity->position()), poly->boundBox());
+        if (!overlap.isEmpty() && m_world->lineTileCollision(overlap.center(), sourceEntity->position()))
+          return {};
+      }
+    } else if (auto line = source.damageArea.ptr<Line2F>()) {
+      if (auto hitPoly = targetEntity->hitPoly()) {
+        if (auto intersection = m_world->geometry().lineIntersectsPolyAt(*line, *hitPoly)) {
+          if (m_world->lineTileCollision(line->min(), *intersection))
+            return {};
         }
       }
     }
+  }
 
-    if (auto hitResult = targetEntity->queryHit(source))
-      resultList.append({targetEntity->entityId(), *hitResult});
-
-    return;
-  };
-
-  if (auto poly = source.damageArea.ptr<PolyF>())
-    m_world->forEachEntity(poly->boundBox(), doQueryHit);
-  else if (auto line = source.damageArea.ptr<Line2F>())
-    m_world->forEachEntityLine(line->min(), line->max(), doQueryHit);
-
-  return resultList;
+  return hitResult;
 }
 
 bool DamageManager::isAuthoritative(EntityPtr const& causingEntity, EntityPtr const& targetEntity) {
@@ -2,6 +2,7 @@
 
 #include "StarDamage.hpp"
 #include "StarDamageTypes.hpp"
+#include "StarDamageBroadPhase.hpp"
 
 namespace Star {
 
@@ -65,14 +66,23 @@ public:
   List<DamageNotification> pullPendingNotifications();
 
 private:
-  struct EntityDamageEvent {
-    Variant<EntityId, String> timeoutGroup;
-    float timeout;
+  // Recent damage a single target has received, keyed either by the causing
+  // entity or by the damage repeat group, with the time left until the same
+  // key may damage it again.
+  struct RecentDamages {
+    HashMap<EntityId, float> causingEntities;
+    StringMap<float> repeatGroups;
   };
 
-  // Searches for and queries for hit to any entity within range of the
-  // damage source.  Skips over source.sourceEntityId, if set.
-  SmallList<pair<EntityId, HitType>, 4> queryHit(DamageSource const& source, EntityId causingId) const;
+  struct PendingDamageSource {
+    EntityPtr causingEntity;
+    DamageSource source;
+  };
+
+  // Narrow phase test of a single source and target that have passed the
+  // broad phase.  Skips over the causing entity, and does the source's ray
+  // check only once it is known to hit.
+  Maybe<HitType> queryHit(DamageSource const& source, EntityId causingId, EntityPtr const& targetEntity) const;
 
   bool isAuthoritative(EntityPtr const& causingEntity, EntityPtr const& targetEntity);
 
@@ -83,9 +93,15 @@ private:
   World* m_world;
   ConnectionId m_connectionId;
 
-  // Maps target entity to all of the recent damage events that entity has
-  // received, to prevent rapidly repeating damage.
-  HashMap<EntityId, List<EntityDamageEvent>> m_recentEntityDamages;
+  // Maps target entity to the recent damage it has received, to prevent
+  // rapidly repeating damage.
+  HashMap<EntityId, RecentDamages> m_recentEntityDamages;
+
+  // Per update state, every damage source in the world and every entity that
+  // could be hit by them.
+  List<PendingDamageSource> m_sources;
+  List<EntityPtr> m_targets;
+  DamageBroadPhase m_broadPhase;
 
   List<RemoteHitRequest> m_pendingRemoteHitRequests;
   List<RemoteDamageRequest> m_pendingRemoteDamageRequests;
@@ -5,22 +5,27 @@
 
 namespace Star {
 
-float const EntityMapSpatialHashSectorSize = 16.0f;
+float const EntityMap::SectorSize = 16.0f;
 int const EntityMap::MaximumEntityBoundBox = 10000;
 
 EntityMap::EntityMap(Vec2U const& worldSize, bool const& xWrap, bool const& yWrap, EntityId beginIdSpace, EntityId endIdSpace)
   : m_geometry(worldSize,xWrap,yWrap),
-    m_spatialMap(EntityMapSpatialHashSectorSize),
+    m_slotCount(0),
+    m_addCount(0),
+    m_sleepingCount(0),
     m_nextId(beginIdSpace),
     m_beginIdSpace(beginIdSpace),
-    m_endIdSpace(endIdSpace) {}
+    m_endIdSpace(endIdSpace) {
+  m_sectorCount = Vec2I(max<int>(1, ceil(worldSize[0] / SectorSize)), max<int>(1, ceil(worldSize[1] / SectorSize)));
+  m_sectors.resize(m_sectorCount[0] * m_sectorCount[1]);
+}
 
 EntityId EntityMap::reserveEntityId() {
-  if (m_spatialMap.size() >= (size_t)(m_endIdSpace - m_beginIdSpace))
+  if (m_entitySlots.size() >= (size_t)(m_endIdSpace - m_beginIdSpace))
     throw EntityMapException("No more entity id space in EntityMap::reserveEntityId");
 
   EntityId id = m_nextId;
-  while (m_spatialMap.contains(id))
+  while (m_entitySlots.contains(id))
     id = cycleIncrement(id, m_beginIdSpace, m_endIdSpace);
   m_nextId = cycleIncrement(id, m_beginIdSpace, m_endIdSpace);
 
@@ -28,10 +33,10 @@ EntityId EntityMap::reserveEntityId() {
 }
 
 Maybe<EntityId> EntityMap::maybeReserveEntityId(EntityId entityId) {
-  if (m_spatialMap.size() >= (size_t)(m_endIdSpace - m_beginIdSpace))
+  if (m_entitySlots.size() >= (size_t)(m_endIdSpace - m_beginIdSpace))
     throw EntityMapException("No more entity id space in EntityMap::reserveEntityId");
 
-  if (entityId == NullEntityId || m_spatialMap.contains(entityId))
+  if (entityId == NullEntityId || m_entitySlots.contains(entityId))
     return {};
   else
     return entityId;
@@ -54,7 +59,7 @@ void EntityMap::addEntity(EntityPtr entity) {
   auto entityId = entity->entityId();
   auto uniqueId = entity->uniqueId();
 
-  if (m_spatialMap.contains(entityId))
+  if (m_entitySlots.contains(entityId))
     throw EntityMapException::format("Duplicate entity id '{}' in EntityMap::addEntity", entityId);
 
   if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
@@ -68,30 +73,65 @@ void EntityMap::addEntity(EntityPtr entity) {
   if (uniqueId && m_uniqueMap.hasLeftValue(*uniqueId))
     throw EntityMapException::format("Duplicate entity unique id ({}) on entity id ({}) in EntityMap::addEntity", *uniqueId, entityId);
 
-  m_spatialMap.set(entityId, m_geometry.splitRect(boundBox, position), std::move(entity));
+  uint32_t entitySlot = allocateSlot();
+  slot(entitySlot).entity = std::move(entity);
+  slot(entitySlot).added = m_addCount++;
+  m_entitySlots.add(entityId, entitySlot);
+  setRects(entitySlot, m_geometry.splitRect(boundBox, position));
   if (uniqueId)
     m_uniqueMap.add(*uniqueId, entityId);
 }
 
 EntityPtr EntityMap::removeEntity(EntityId entityId) {
-  if (auto entity = m_spatialMap.remove(entityId)) {
+  if (auto entitySlot = m_entitySlots.maybeTake(entityId)) {
     m_uniqueMap.removeRight(entityId);
-    return entity.take();
+
+    removeSpatial(*entitySlot);
+    auto& removed = slot(*entitySlot);
+    removed.rects.clear();
+    if (take(removed.sleeping))
+      --m_sleepingCount;
+    ++removed.generation;
+    m_freeSlots.append(*entitySlot);
+    return take(removed.entity);
   }
   return {};
 }
 
 size_t EntityMap::size() const {
-  return m_spatialMap.size();
+  return m_entitySlots.size();
 }
 
 List<EntityId> EntityMap::entityIds() const {
-  return m_spatialMap.keys();
+  return m_entitySlots.keys();
+}
+
+void EntityMap::setSleeping(EntityId entityId, bool sleeping) {
+  if (auto entitySlot = m_entitySlots.ptr(entityId)) {
+    auto& sleeper = slot(*entitySlot);
+    if (sleeper.sleeping != sleeping) {
+      sleeper.sleeping = sleeping;
+      if (sleeping)
+        ++m_sleepingCount;
+      else
+        --m_sleepingCount;
+    }
+  }
+}
+
+bool EntityMap::isSleeping(EntityId entityId) const {
+  if (auto entitySlot = m_entitySlots.ptr(entityId))
+    return slot(*entitySlot).sleeping;
+  return false;
+}
+
+size_t EntityMap::sleepingCount() const {
+  return m_sleepingCount;
 }
 
 void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder) {
-  auto updateEntityInfo = [&](SpatialMap::Entry const& entry) {
-    auto const& entity = entry.value;
+  auto updateEntityInfo = [&](uint32_t entitySlot) {
+    auto const& entity = slot(entitySlot).entity;
 
     auto position = entity->position();
     auto boundBox = entity->metaBoundBox();
@@ -105,9 +145,7 @@ void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(
     if (entityId == NullEntityId)
       throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
 
-    auto rects = m_geometry.splitRect(boundBox, position);
-    if (!containersEqual(rects, entry.rects))
-      m_spatialMap.set(entityId, rects);
+    setRects(entitySlot, m_geometry.splitRect(boundBox, position));
 
     auto uniqueId = entity->uniqueId();
     if (uniqueId) {
@@ -123,22 +161,31 @@ void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(
     }
   };
 
-  // Even if there is no sort order, we still copy pointers to a temporary
-  // list, so that it is safe to call addEntity from the callback.
-  m_entrySortBuffer.clear();
-  for (auto const& entry : m_spatialMap.entries())
-    m_entrySortBuffer.append(&entry.second);
+  // Even if there is no sort order, we still copy handles to a temporary
+  // list, so that it is safe to call addEntity from the callback.  Entities
+  // removed by the callback are skipped, as their handles no longer match.
+  m_entitySortBuffer.clear();
+  for (uint32_t i = 0; i < m_slotCount; ++i) {
+    auto const& entitySlot = slot(i);
+    if (entitySlot.entity && !entitySlot.sleeping)
+      m_entitySortBuffer.append({i, entitySlot.generation});
+  }
 
   if (sortOrder) {
-    m_entrySortBuffer.sort([&sortOrder](auto a, auto b) {
-        return sortOrder(a->value, b->value);
+    m_entitySortBuffer.sort([&](EntityHandle const& a, EntityHandle const& b) {
+        return sortOrder(slot(a.slot).entity, slot(b.slot).entity);
       });
   }
 
-  for (auto entry : m_entrySortBuffer) {
-    if (callback)
-      callback(entry->value);
-    updateEntityInfo(*entry);
+  for (auto handle : m_entitySortBuffer) {
+    if (slot(handle.slot).generation != handle.generation)
+      continue;
+    if (callback) {
+      callback(slot(handle.slot).entity);
+      if (slot(handle.slot).generation != handle.generation)
+        continue;
+    }
+    updateEntityInfo(handle.slot);
   }
 }
 
@@ -147,8 +194,11 @@ EntityId EntityMap::uniqueEntityId(String const& uniqueId) const {
 }
 
 EntityPtr EntityMap::entity(EntityId entityId) const {
-  auto entity = m_spatialMap.value(entityId);
-  starAssert(!entity || entity->entityId() == entityId);
+  auto entitySlot = m_entitySlots.ptr(entityId);
+  if (!entitySlot)
+    return {};
+  auto const& entity = slot(*entitySlot).entity;
+  starAssert(entity->entityId() == entityId);
   return entity;
 }
 
@@ -184,11 +234,23 @@ List<TileEntityPtr> EntityMap::entitiesAtTile(Vec2I const& pos, EntityFilterOf<T
 }
 
 void EntityMap::forEachEntity(RectF const& boundBox, EntityCallback const& callback) const {
-  m_spatialMap.forEach(m_geometry.splitRect(boundBox), callback);
+  forEachSlot(m_geometry.splitRect(boundBox), [&](EntitySlot const& entitySlot) {
+      callback(entitySlot.entity);
+    });
+}
+
+void EntityMap::forEachEntity(List<RectF> const& boundBoxes, EntityCallback const& callback) const {
+  SmallList<RectF, 16> rects;
+  for (auto const& boundBox : boundBoxes)
+    rects.appendAll(m_geometry.splitRect(boundBox));
+  forEachSlot(rects, [&](EntitySlot const& entitySlot) {
+      callback(entitySlot.entity);
+    });
 }
 
 void EntityMap::forEachEntityLine(Vec2F const& begin, Vec2F const& end, EntityCallback const& callback) const {
-  return m_spatialMap.forEach(m_geometry.splitRect(RectF::boundBoxOf(begin, end)), [&](EntityPtr const& entity) {
+  forEachSlot(m_geometry.splitRect(RectF::boundBoxOf(begin, end)), [&](EntitySlot const& entitySlot) {
+      auto const& entity = entitySlot.entity;
       if (m_geometry.lineIntersectsRect({begin, end}, entity->metaBoundBox().translated(entity->position())))
         callback(entity);
     });
@@ -210,9 +272,12 @@ void EntityMap::forAllEntities(EntityCallback const& callback, function<bool(Ent
   // Even if there is no sort order, we still copy pointers to a temporary
   // list, so that it is safe to call addEntity from the callback.
   List<EntityPtr const*> allEntities;
-  allEntities.reserve(m_spatialMap.size());
-  for (auto const& entry : m_spatialMap.entries())
-    allEntities.append(&entry.second.value);
+  allEntities.reserve(m_entitySlots.size());
+  for (uint32_t i = 0; i < m_slotCount; ++i) {
+    auto const& entitySlot = slot(i);
+    if (entitySlot.entity)
+      allEntities.append(&entitySlot.entity);
+  }
 
   if (sortOrder) {
     allEntities.sort([&sortOrder](EntityPtr const* a, EntityPtr const* b) {
@@ -274,7 +339,7 @@ EntityPtr EntityMap::closestEntity(Vec2F const& center, float radius, EntityFilt
   float distSquared = square(radius);
   RectF boundBox(center[0] - radius, center[1] - radius, center[0] + radius, center[1] + radius);
 
-  m_spatialMap.forEach(m_geometry.splitRect(boundBox), [&](EntityPtr const& entity) {
+  forEachEntity(boundBox, [&](EntityPtr const& entity) {
       Vec2F pos = entity->position();
       float thisDistSquared = m_geometry.diff(center, pos).magnitudeSquared();
       if (distSquared > thisDistSquared) {
@@ -293,7 +358,7 @@ InteractiveEntityPtr EntityMap::interactiveEntityNear(Vec2F const& pos, float ma
   InteractiveEntityPtr interactiveEntity;
   double bestDistance = maxRadius + 100;
   double bestCenterDistance = maxRadius + 100;
-  m_spatialMap.forEach(m_geometry.splitRect(rect), [&](EntityPtr const& entity) {
+  forEachEntity(rect, [&](EntityPtr const& entity) {
       if (auto ie = as<InteractiveEntity>(entity)) {
         if (ie->isInteractive()) {
           if (auto tileEntity = as<TileEntity>(entity)) {
@@ -341,16 +406,98 @@ bool EntityMap::tileIsOccupied(Vec2I const& pos, bool includeEphemeral) const {
 }
 
 bool EntityMap::spaceIsOccupied(RectF const& rect, bool includesEphemeral) const {
-  for (auto const& entity : entityQuery(rect)) {
-    if (!includesEphemeral && entity->ephemeral())
+  bool occupied = false;
+  forEachEntity(rect, [&](EntityPtr const& entity) {
+      if (occupied || (!includesEphemeral && entity->ephemeral()))
+        return;
+
+      for (RectF const& c : m_geometry.splitRect(entity->collisionArea(), entity->position())) {
+        if (!c.isNull() && rect.intersects(c))
+          occupied = true;
+      }
+    });
+  return occupied;
+}
+
+uint32_t EntityMap::allocateSlot() {
+  if (!m_freeSlots.empty())
+    return m_freeSlots.takeLast();
+
+  if (m_slotCount % SlotChunkSize == 0)
+    m_slotChunks.append(make_unique<EntitySlot[]>(SlotChunkSize));
+  return m_slotCount++;
+}
+
+void EntityMap::setRects(uint32_t entitySlot, StaticList<RectF, 4> const& rects) {
+  auto& changed = slot(entitySlot);
+  if (containersEqual(rects, changed.rects))
+    return;
+
+  // Most movement stays within the same sectors, in which case the entries
+  // are updated in place.
+  bool sameSectors = rects.size() == changed.rects.size();
+  for (size_t r = 0; r < rects.size() && sameSectors; ++r)
+    sameSectors = rects[r].isNull() == changed.rects[r].isNull() && (rects[r].isNull() || sectorRange(rects[r]) == sectorRange(changed.rects[r]));
+
+  if (sameSectors) {
+    for (uint32_t r = 0; r < rects.size(); ++r) {
+      changed.rects[r] = rects[r];
+      if (rects[r].isNull())
+        continue;
+      RectI range = sectorRange(rects[r]);
+      for (int y = range.yMin(); y <= range.yMax(); ++y) {
+        for (int x = range.xMin(); x <= range.xMax(); ++x) {
+          for (auto& entry : sector(x, y)) {
+            if (entry.slot == entitySlot && entry.rectIndex == r) {
+              entry.rect = rects[r];
+              break;
+            }
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  removeSpatial(entitySlot);
+  changed.rects.clear();
+  changed.rects.appendAll(rects);
+  addSpatial(entitySlot);
+}
+
+void EntityMap::addSpatial(uint32_t entitySlot) {
+  auto const& rects = slot(entitySlot).rects;
+  for (uint32_t r = 0; r < rects.size(); ++r) {
+    if (rects[r].isNull())
       continue;
+    RectI range = sectorRange(rects[r]);
+    for (int y = range.yMin(); y <= range.yMax(); ++y) {
+      for (int x = range.xMin(); x <= range.xMax(); ++x)
+        sector(x, y).append({rects[r], entitySlot, r});
+    }
+  }
+}
 
-    for (RectF const& c : m_geometry.splitRect(entity->collisionArea(), entity->position())) {
-      if (!c.isNull() && rect.intersects(c))
-        return true;
+void EntityMap::removeSpatial(uint32_t entitySlot) {
+  auto const& rects = slot(entitySlot).rects;
+  for (uint32_t r = 0; r < rects.size(); ++r) {
+    if (rects[r].isNull())
+      continue;
+    RectI range = sectorRange(rects[r]);
+    for (int y = range.yMin(); y <= range.yMax(); ++y) {
+      for (int x = range.xMin(); x <= range.xMax(); ++x) {
+        // Order within a sector does not matter, swap the last entry in.
+        auto& entries = sector(x, y);
+        for (size_t i = 0; i < entries.size(); ++i) {
+          if (entries[i].slot == entitySlot && entries[i].rectIndex == r) {
+            entries[i] = entries.last();
+            entries.removeLast();
+            break;
+          }
+        }
+      }
     }
   }
-  return false;
 }
 
 }
@@ -1,7 +1,7 @@
 #pragma once
 
-#include "StarSpatialHash2D.hpp"
 #include "StarEntity.hpp"
+#include "StarWorldGeometry.hpp"
 
 namespace Star {
 
@@ -12,16 +12,18 @@ STAR_CLASS(InteractiveEntity);
 STAR_EXCEPTION(EntityMapException, StarException);
 
 // Class used by WorldServer and WorldClient to store entites organized in a
-// spatial hash.  Provides convenient ways of querying entities based on
-// different selection criteria.
+// flat grid of sectors covering the world.  Provides convenient ways of
+// querying entities based on different selection criteria.
 //
 // Several of the methods in EntityMap take callbacks or filters that will be
 // called while iterating over internal structures.  They are all designed so
 // that adding new entities is safe to do from the callback, but removing
-// entities is never safe to do from any callback function.
+// entities is never safe to do from any callback function.  The EntityPtr
+// given to a callback refers to the map's own storage and stays valid until
+// that entity is removed.
 class EntityMap {
 public:
-  static float const SpatialHashSectorSize;
+  static float const SectorSize;
   static int const MaximumEntityBoundBox;
 
   // beginIdSpace and endIdSpace is the *inclusive* range for new enittyIds.
@@ -42,6 +44,13 @@ public:
   size_t size() const;
   List<EntityId> entityIds() const;
 
+  // Sleeping entities are skipped by updateAllEntities and keep the spatial
+  // information they had when put to sleep, they are still found by every
+  // query.
+  void setSleeping(EntityId entityId, bool sleeping);
+  bool isSleeping(EntityId entityId) const;
+  size_t sleepingCount() const;
+
   // Iterates through the entity map optionally in the given order, updating
   // the spatial information for each entity along the way.
   void updateAllEntities(EntityCallback const& callback = {}, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder = {});
@@ -66,6 +75,9 @@ public:
 
   // Callback versions of query functions.
   void forEachEntity(RectF const& boundBox, EntityCallback const& callback) const;
+  // Calls the callback once for each entity in any of the given bound boxes,
+  // even where they overlap.
+  void forEachEntity(List<RectF> const& boundBoxes, EntityCallback const& callback) const;
   void forEachEntityLine(Vec2F const& begin, Vec2F const& end, EntityCallback const& callback) const;
   // Returns tile-based entities that occupy the given tile position.
   void forEachEntityAtTile(Vec2I const& pos, EntityCallbackOf<TileEntity> const& callback) const;
@@ -116,18 +128,78 @@ public:
   List<shared_ptr<EntityT>> atTile(Vec2I const& pos) const;
 
 private:
-  typedef SpatialHash2D<EntityId, float, EntityPtr> SpatialMap;
+  // Entities live in slots that are never moved, in chunks, so that adding
+  // entities from a callback leaves the slots being iterated over in place.
+  // Freed slots are reused, and each reuse bumps the slot's generation so
+  // that a handle to the entity that was there before can be told apart.
+  struct EntityHandle {
+    uint32_t slot;
+    uint32_t generation;
+  };
+
+  struct EntitySlot {
+    EntityPtr entity;
+    uint32_t generation = 0;
+    bool sleeping = false;
+    // Value of m_addCount when the entity was added, so that queries can
+    // leave out entities added by their own callbacks.
+    uint64_t added = 0;
+    // The entity's bound box in world space, split at the world wrap.
+    SmallList<RectF, 4> rects;
+  };
+
+  // Every sector keeps a dense list of the entity rects that overlap it, so
+  // that queries only touch slots for the entities that they return.
+  struct SectorEntry {
+    RectF rect;
+    uint32_t slot;
+    uint32_t rectIndex;
+  };
+
+  static size_t const SlotChunkSize = 256;
+
+  EntitySlot& slot(uint32_t slot);
+  EntitySlot const& slot(uint32_t slot) const;
+  uint32_t allocateSlot();
+
+  // Sector holding the given position, clamped to the grid, and the
+  // inclusive range of the sectors a rect overlaps.
+  Vec2I sectorFor(Vec2F const& pos) const;
+  RectI sectorRange(RectF const& rect) const;
+  List<SectorEntry>& sector(int x, int y);
+  List<SectorEntry> const& sector(int x, int y) const;
+
+  void setRects(uint32_t slot, StaticList<RectF, 4> const& rects);
+  void addSpatial(uint32_t slot);
+  void removeSpatial(uint32_t slot);
+
+  // Calls function(EntitySlot const&) for every entity whose bound box
+  // intersects any of the given rects, once each.  Rather than collecting and
+  // de-duplicating results, an entity is only reported from the sector that
+  // holds the lowest corner of the first overlap of its rects with the query
+  // rects, so this never allocates and is safe to nest.
+  template <typename RectCollection, typename Function>
+  void forEachSlot(RectCollection const& rects, Function&& function) const;
 
   WorldGeometry m_geometry;
 
-  SpatialMap m_spatialMap;
+  Vec2I m_sectorCount;
+  List<List<SectorEntry>> m_sectors;
+
+  List<unique_ptr<EntitySlot[]>> m_slotChunks;
+  uint32_t m_slotCount;
+  List<uint32_t> m_freeSlots;
+  uint64_t m_addCount;
+  size_t m_sleepingCount;
+  HashMap<EntityId, uint32_t> m_entitySlots;
+
   BiHashMap<String, EntityId> m_uniqueMap;
 
   EntityId m_nextId;
   EntityId m_beginIdSpace;
   EntityId m_endIdSpace;
 
-  List<SpatialMap::Entry const*> m_entrySortBuffer;
+  List<EntityHandle> m_entitySortBuffer;
 };
 
 template <typename EntityT>
@@ -187,4 +259,83 @@ List<shared_ptr<EntityT>> EntityMap::atTile(Vec2I const& pos) const {
   return list;
 }
 
+
+inline EntityMap::EntitySlot& EntityMap::slot(uint32_t slot) {
+  return m_slotChunks[slot / SlotChunkSize][slot % SlotChunkSize];
+}
+
+inline EntityMap::EntitySlot const& EntityMap::slot(uint32_t slot) const {
+  return m_slotChunks[slot / SlotChunkSize][slot % SlotChunkSize];
+}
+
+inline Vec2I EntityMap::sectorFor(Vec2F const& pos) const {
+  return Vec2I(clamp<int>(floor(pos[0] / SectorSize), 0, m_sectorCount[0] - 1),
+      clamp<int>(floor(pos[1] / SectorSize), 0, m_sectorCount[1] - 1));
+}
+
+inline RectI EntityMap::sectorRange(RectF const& rect) const {
+  return RectI(sectorFor(rect.min()), sectorFor(rect.max()));
+}
+
+inline List<EntityMap::SectorEntry>& EntityMap::sector(int x, int y) {
+  return m_sectors[y * m_sectorCount[0] + x];
+}
+
+inline List<EntityMap::SectorEntry> const& EntityMap::sector(int x, int y) const {
+  return m_sectors[y * m_sectorCount[0] + x];
+}
+
+template <typename RectCollection, typename Function>
+void EntityMap::forEachSlot(RectCollection const& rects, Function&& function) const {
+  // Whether the entity's rect 'rectIndex' overlapping query rect 'queryIndex'
+  // is the first overlap between the two.
+  auto firstOverlap = [&rects](EntitySlot const& entitySlot, size_t queryIndex, size_t rectIndex) {
+    size_t q = 0;
+    for (RectF const& query : rects) {
+      if (q > queryIndex)
+        break;
+      for (size_t r = 0; r < entitySlot.rects.size(); ++r) {
+        if (q == queryIndex && r == rectIndex)
+          return true;
+        if (!query.isNull() && entitySlot.rects[r].intersects(query))
+          return false;
+      }
+      ++q;
+    }
+    return true;
+  };
+
+  uint64_t addCount = m_addCount;
+  size_t queryIndex = 0;
+  for (RectF const& query : rects) {
+    if (!query.isNull()) {
+      RectI range = sectorRange(query);
+      for (int y = range.yMin(); y <= range.yMax(); ++y) {
+        for (int x = range.xMin(); x <= range.xMax(); ++x) {
+          // Indexed rather than iterated, callbacks may add entities to this
+          // sector.
+          auto const& entries = sector(x, y);
+          for (size_t i = 0, count = entries.size(); i < count; ++i) {
+            SectorEntry entry = entries[i];
+            if (!entry.rect.intersects(query))
+              continue;
+
+            if (sectorFor(vmax(entry.rect.min(), query.min())) != Vec2I(x, y))
+              continue;
+
+            auto const& entitySlot = slot(entry.slot);
+            if (entitySlot.added >= addCount)
+              continue;
+            if ((queryIndex != 0 || entry.rectIndex != 0) && !firstOverlap(entitySlot, queryIndex, entry.rectIndex))
+              continue;
+
+            function(entitySlot);
+          }
+        }
+      }
+    }
+    ++queryIndex;
+  }
+}
+
 }
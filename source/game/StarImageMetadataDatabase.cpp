@@ -23,6 +23,11 @@ ImageMetadataDatabase::ImageMetadataDatabase() {
 }
 
 Vec2U ImageMetadataDatabase::imageSize(AssetPath const& path) const {
+  if (!path.subPath && path.directives.empty()) {
+    if (auto metadata = Root::singleton().assets()->imageMetadata(path.basePath))
+      return metadata->size;
+  }
+
   MutexLocker locker(m_mutex);
   if (auto cached = m_sizeCache.ptr(path))
     return *cached;
@@ -53,9 +58,21 @@ List<Vec2I> ImageMetadataDatabase::imageSpaces(AssetPath const& path, Vec2F posi
 
   locker.unlock();
 
-  auto image = Root::singleton().assets()->image(filteredPath);
-  int imageWidth = image->width();
-  int imageHeight = image->height();
+  int imageWidth;
+  int imageHeight;
+  function<bool(int, int)> opaque;
+  ImageConstPtr image;
+  Maybe<ImageMetadataIndex::AlphaMask> mask = indexedAlphaMask(filteredPath);
+  if (mask) {
+    imageWidth = mask->size[0];
+    imageHeight = mask->size[1];
+    opaque = [&mask](int x, int y) { return mask->get(x, y); };
+  } else {
+    image = Root::singleton().assets()->image(filteredPath);
+    imageWidth = image->width();
+    imageHeight = image->height();
+    opaque = [&image](int x, int y) { return image->get(x, y)[3] > 0; };
+  }
 
   Vec2I min((position / TilePixels).floor());
   Vec2I max(((Vec2F(imageWidth, imageHeight) + position) / TilePixels).ceil());
@@ -79,7 +96,7 @@ List<Vec2I> ImageMetadataDatabase::imageSpaces(AssetPath const& path, Vec2F posi
           if (xpixel < 0 || xpixel >= imageWidth)
             continue;
 
-          if (image->get(xpixel, ypixel)[3] > 0)
+          if (opaque(xpixel, ypixel))
             fillRatio += 1.0f / square(TilePixels);
         }
       }
@@ -97,25 +114,39 @@ List<Vec2I> ImageMetadataDatabase::imageSpaces(AssetPath const& path, Vec2F posi
 }
 
 RectU ImageMetadataDatabase::nonEmptyRegion(AssetPath const& path) const {
+  auto filteredPath = filterProcessing(path);
+  if (!filteredPath.subPath && filteredPath.directives.empty()) {
+    if (auto metadata = Root::singleton().assets()->imageMetadata(filteredPath.basePath))
+      return metadata->nonEmptyRegion;
+  }
+
   MutexLocker locker(m_mutex);
-  
+
   if (auto cached = m_regionCache.ptr(path)) {
     return *cached;
   }
 
-  auto filteredPath = filterProcessing(path);
   if (auto cached = m_regionCache.ptr(filteredPath)) {
     m_regionCache.set(path, *cached);
     return *cached;
   }
 
   locker.unlock();
-  auto image = Root::singleton().assets()->image(filteredPath);
   RectU region = RectU::null();
-  image->forEachPixel([&region](unsigned x, unsigned y, Vec4B const& pixel) {
-    if (pixel[3] > 0)
-      region.combine(RectU::withSize({x, y}, {1, 1}));
-  });
+  if (auto mask = indexedAlphaMask(filteredPath)) {
+    for (unsigned y = 0; y < mask->size[1]; ++y) {
+      for (unsigned x = 0; x < mask->size[0]; ++x) {
+        if (mask->get(x, y))
+          region.combine(RectU::withSize({x, y}, {1, 1}));
+      }
+    }
+  } else {
+    auto image = Root::singleton().assets()->image(filteredPath);
+    image->forEachPixel([&region](unsigned x, unsigned y, Vec4B const& pixel) {
+      if (pixel[3] > 0)
+        region.combine(RectU::withSize({x, y}, {1, 1}));
+    });
+  }
 
   locker.lock();
   m_regionCache.set(path, region);
@@ -155,6 +186,24 @@ AssetPath ImageMetadataDatabase::filterProcessing(AssetPath const& path) {
   return newPath;
 }
 
+Maybe<ImageMetadataIndex::AlphaMask> ImageMetadataDatabase::indexedAlphaMask(AssetPath const& path) {
+  if (!path.directives.empty())
+    return {};
+
+  auto assets = Root::singleton().assets();
+  auto mask = assets->imageAlphaMask(path.basePath);
+  if (!mask || !path.subPath)
+    return mask;
+
+  auto frames = assets->imageFrames(path.basePath);
+  if (!frames)
+    return {};
+  auto rect = frames->getRect(*path.subPath);
+  if (!rect)
+    return {};
+  return ImageMetadataIndex::frameAlphaMask(*mask, *rect);
+}
+
 Vec2U ImageMetadataDatabase::calculateImageSize(AssetPath const& path) const {
   // Carefully calculate an image's size while trying not to actually load it.
   // In error cases, this will fall back to calling Assets::image, so that image
@@ -187,6 +236,8 @@ Vec2U ImageMetadataDatabase::calculateImageSize(AssetPath const& path) const {
     MutexLocker locker(m_mutex);
     if (auto size = m_sizeCache.ptr(path.basePath)) {
       imageSize = *size;
+    } else if (auto metadata = assets->imageMetadata(path.basePath)) {
+      imageSize = metadata->size;
     } else {
       locker.unlock();
       auto file = assets->openFile(path.basePath);
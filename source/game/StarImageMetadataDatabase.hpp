@@ -6,6 +6,7 @@
 #include "StarThread.hpp"
 #include "StarAssetPath.hpp"
 #include "StarTtlCache.hpp"
+#include "StarImageMetadataIndex.hpp"
 
 namespace Star {
 
@@ -14,6 +15,10 @@ STAR_CLASS(ImageMetadataDatabase);
 // Caches image size, image spaces, and nonEmptyRegion completely until a
 // reload, does not expire cached values in a TTL based way like Assets,
 // because they are expensive to compute and cheap to keep around.
+//
+// Images from packed asset sources with an image metadata index are answered
+// from the index without decoding them, and sizes and non-empty regions of
+// such images are returned without taking the cache lock.
 class ImageMetadataDatabase {
 public:
   ImageMetadataDatabase();
@@ -29,6 +34,10 @@ private:
 
   Vec2U calculateImageSize(AssetPath const& path) const;
 
+  // Alpha mask of the given path from the image metadata index, only
+  // possible if the path has no directives.
+  static Maybe<ImageMetadataIndex::AlphaMask> indexedAlphaMask(AssetPath const& path);
+
   // Path, position, fillLimit, and flip
   typedef tuple<AssetPath, Vec2I, float, bool> SpacesEntry;
 
@@ -146,6 +146,8 @@ void Monster::init(World* world, EntityId entityId, EntityMode mode) {
     m_scriptComponent.addCallbacks("status", LuaBindings::makeStatusControllerCallbacks(m_statusController.get()));
     m_scriptComponent.addCallbacks("behavior", LuaBindings::makeBehaviorLuaCallbacks(&m_behaviors));
     m_scriptComponent.addActorMovementCallbacks(m_movementController.get());
+    if (world->isServer())
+      m_scriptComponent.setUpdateSlicing(world->luaRoot()->updateSlicing(m_monsterVariant.parameters.get("scriptUpdateSlicing", Json())));
     m_scriptComponent.init(world);
   }
 
@@ -830,6 +832,10 @@ Maybe<LuaValue> Monster::evalScript(String const& code) {
   return m_scriptComponent.eval(code);
 }
 
+LuaUpdateStatistics const* Monster::scriptUpdateStatistics() const {
+  return &m_scriptComponent.updateStatistics();
+}
+
 Vec2F Monster::mouthPosition() const {
   return mouthOffset() + position();
 }
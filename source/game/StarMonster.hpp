@@ -118,6 +118,7 @@ public:
 
   Maybe<LuaValue> callScript(String const& func, LuaVariadic<LuaValue> const& args) override;
   Maybe<LuaValue> evalScript(String const& code) override;
+  LuaUpdateStatistics const* scriptUpdateStatistics() const override;
 
   virtual Vec2F mouthPosition() const override;
   virtual Vec2F mouthPosition(bool ignoreAdjustments) const override;
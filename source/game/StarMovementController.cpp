@@ -1086,25 +1086,15 @@ void MovementController::queryCollisions(RectF const& region) {
       return m_workingCollisions.emplaceAppend(CollisionPoly{});
   };
 
-  auto geometry = world()->geometry();
-
-  world()->forEachCollisionBlock(RectI::integral(region.padded(1)), [&](CollisionBlock const& block) {
-      if (block.kind != CollisionKind::None && !block.poly.isNull()) {
-        RectF polyBounds = block.polyBounds;
-        Vec2F basePosition = block.poly.vertex(0);
-        Vec2F nearTranslation = geometry.nearestTo(region.min(), basePosition) - basePosition;
-        polyBounds.translate(nearTranslation);
-
-        if (region.intersects(polyBounds)) {
-          CollisionPoly& collisionPoly = newCollisionPoly();
-          collisionPoly.poly = block.poly;
-          collisionPoly.poly.translate(nearTranslation);
-          collisionPoly.polyBounds = polyBounds;
-          collisionPoly.sortPosition = centerOfTile(block.space);
-          collisionPoly.movingCollisionId = {};
-          collisionPoly.collisionKind = block.kind;
-        }
-      }
+  world()->forEachCollisionCandidate({region}, [&](size_t, CollisionCandidate const& candidate) {
+      CollisionPoly& collisionPoly = newCollisionPoly();
+      collisionPoly.poly.clear();
+      for (size_t i = 0; i < candidate.vertexCount; ++i)
+        collisionPoly.poly.add(candidate.vertices[i] + candidate.translation);
+      collisionPoly.polyBounds = candidate.polyBounds;
+      collisionPoly.sortPosition = centerOfTile(candidate.space);
+      collisionPoly.movingCollisionId = {};
+      collisionPoly.collisionKind = candidate.kind;
     });
 
   forEachMovingCollision(region, [&](MovingCollisionId id, PhysicsMovingCollision mc, PolyF poly, RectF bounds) {
@@ -187,6 +187,8 @@ void Npc::init(World* world, EntityId entityId, EntityMode mode) {
     m_scriptComponent.addCallbacks("status", LuaBindings::makeStatusControllerCallbacks(m_statusController.get()));
     m_scriptComponent.addCallbacks("behavior", LuaBindings::makeBehaviorLuaCallbacks(&m_behaviors));
     m_scriptComponent.addActorMovementCallbacks(m_movementController.get());
+    if (world->isServer())
+      m_scriptComponent.setUpdateSlicing(world->luaRoot()->updateSlicing(m_npcVariant.scriptConfig.query("scriptUpdateSlicing", Json())));
     m_scriptComponent.init(world);
   }
 }
@@ -561,6 +563,10 @@ Maybe<LuaValue> Npc::evalScript(String const& code) {
   return m_scriptComponent.eval(code);
 }
 
+LuaUpdateStatistics const* Npc::scriptUpdateStatistics() const {
+  return &m_scriptComponent.updateStatistics();
+}
+
 Vec2F Npc::getAbsolutePosition(Vec2F relativePosition) const {
   if (m_humanoid.facingDirection() == Direction::Left)
     relativePosition[0] *= -1;
@@ -114,6 +114,7 @@ public:
 
   Maybe<LuaValue> callScript(String const& func, LuaVariadic<LuaValue> const& args) override;
   Maybe<LuaValue> evalScript(String const& code) override;
+  LuaUpdateStatistics const* scriptUpdateStatistics() const override;
 
   Vec2F mouthPosition() const override;
   Vec2F mouthPosition(bool ignoreAdjustments) const override;
@@ -200,6 +200,8 @@ void Object::init(World* world, EntityId entityId, EntityMode mode) {
     m_scriptComponent.addCallbacks("config", LuaBindings::makeConfigCallbacks(bind(&Object::configValue, this, _1, _2)));
     m_scriptComponent.addCallbacks("entity", LuaBindings::makeEntityCallbacks(this));
     m_scriptComponent.addCallbacks("animator", LuaBindings::makeNetworkedAnimatorCallbacks(m_networkedAnimator.get()));
+    if (world->isServer())
+      m_scriptComponent.setUpdateSlicing(world->luaRoot()->updateSlicing(configValue("scriptUpdateSlicing")));
     m_scriptComponent.init(world);
   }
 
@@ -412,6 +414,21 @@ void Object::update(float dt, uint64_t) {
     m_scriptedAnimator.update();
 }
 
+Maybe<float> Object::sleepTime() const {
+  // Without scripts or animation, a master object only recovers from tile
+  // damage and checks its liquid level, and both damage and liquid changes
+  // wake it.
+  if (!inWorld() || !isMaster() || !m_scriptComponent.scripts().empty() || m_tileDamageStatus->damaged())
+    return {};
+  if (!m_networkedAnimator->stateTypes().empty())
+    return {};
+  if (auto orientation = currentOrientation()) {
+    if (orientation->frames > 1)
+      return {};
+  }
+  return highest<float>();
+}
+
 void Object::render(RenderCallback* renderCallback) {
   renderParticles(renderCallback);
   renderSounds(renderCallback);
@@ -1199,6 +1216,10 @@ Maybe<LuaValue> Object::evalScript(String const& code) {
   return m_scriptComponent.eval(code);
 }
 
+LuaUpdateStatistics const* Object::scriptUpdateStatistics() const {
+  return &m_scriptComponent.updateStatistics();
+}
+
 Vec2F Object::mouthPosition() const {
   if (auto orientation = currentOrientation()) {
     auto pos = position() + Vec2F(orientation->boundBox.center()[0], orientation->boundBox.max()[1]);
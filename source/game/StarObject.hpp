@@ -63,6 +63,7 @@ public:
   virtual void destroy(RenderCallback* renderCallback) override;
 
   virtual void update(float dt, uint64_t currentStep) override;
+  virtual Maybe<float> sleepTime() const override;
 
   virtual void render(RenderCallback* renderCallback) override;
 
@@ -114,6 +115,7 @@ public:
 
   Maybe<LuaValue> callScript(String const& func, LuaVariadic<LuaValue> const& args) override;
   Maybe<LuaValue> evalScript(String const& code) override;
+  LuaUpdateStatistics const* scriptUpdateStatistics() const override;
 
   virtual Vec2F mouthPosition() const override;
   virtual Vec2F mouthPosition(bool ignoreAdjustments) const override;
@@ -5,7 +5,9 @@
 namespace Star {
 
 ParticleManager::ParticleManager(WorldGeometry const& worldGeometry, ClientTileSectorArrayPtr const& tileSectorArray)
-  : m_worldGeometry(worldGeometry), m_undergroundLevel(0.0f), m_tileSectorArray(tileSectorArray) {}
+  : m_workerPool("ParticleManager"), m_worldGeometry(worldGeometry), m_undergroundLevel(0.0f), m_tileSectorArray(tileSectorArray) {
+  m_workerPool.start(clamp<unsigned>(Thread::numberOfProcessors() / 2, 1, 4));
+}
 
 void ParticleManager::add(Particle particle) {
   m_particles.push_back(std::move(particle));
@@ -33,28 +35,93 @@ void ParticleManager::update(float dt, RectF const& cullRegion, float wind) {
 
   auto cullRects = m_worldGeometry.splitRect(cullRegion);
 
-  for (auto& particle : m_particles) {
-    bool inRegion = false;
+  m_activeIndexes.clear();
+  for (size_t i = 0; i < m_particles.size(); ++i) {
+    auto& particle = m_particles[i];
     Vec2F worldPos = m_worldGeometry.wrap(particle.position);
     for (auto cullRect : cullRects) {
       if (cullRect.contains(worldPos)) {
-        inRegion = true;
+        // Animations load their config from assets, do that here rather than
+        // on the worker threads.
+        if (particle.type == Particle::Type::Animated)
+          particle.initializeAnimation();
+        m_activeIndexes.append(i);
         break;
       }
     }
-    if (!inRegion)
-      continue;
+  }
+  m_activeTileTypes.resize(m_activeIndexes.size());
+
+  size_t activeCount = m_activeIndexes.size();
+  for (size_t begin = UpdateBatchSize; begin < activeCount; begin += UpdateBatchSize) {
+    size_t end = min(begin + UpdateBatchSize, activeCount);
+    m_batches.append(m_workerPool.addWork([this, begin, end, dt, wind]() {
+        updateBatch(begin, end, dt, Vec2F(wind, 0));
+      }));
+  }
+  updateBatch(0, min(UpdateBatchSize, activeCount), dt, Vec2F(wind, 0));
+  for (auto const& batch : take(m_batches))
+    batch.finish();
+
+  // Particles outside of the cull region are dropped and the survivors are
+  // compacted in place, keeping their order.  Trails are static copies that
+  // only live through their destruction, they go after every survivor.
+  size_t survivors = 0;
+  for (size_t i = 0; i < activeCount; ++i) {
+    size_t index = m_activeIndexes[i];
+    auto& particle = m_particles[index];
+
+    if (particle.trail && particle.timeToLive >= 0.0f) {
+      auto trail = particle;
+      trail.trail = false;
+      trail.timeToLive = 0;
+      trail.velocity = {};
+      m_trailParticles.append(std::move(trail));
+    }
+
+    if (!particle.dead()) {
+      if (survivors != index)
+        m_particles[survivors] = std::move(particle);
+      ++survivors;
+    }
+  }
+
+  m_particles.erase(m_particles.begin() + survivors, m_particles.end());
+  m_particles.appendAll(take(m_trailParticles));
+}
+
+List<Particle> const& ParticleManager::particles() const {
+  return m_particles;
+}
+
+List<pair<Vec2F, Vec3F>> ParticleManager::lightSources() const {
+  List<pair<Vec2F, Vec3F>> lsources;
+  for (auto const& particle : m_particles) {
+    if (particle.light != Color::Clear)
+      lsources.append({particle.position, particle.light.toRgbF()});
+  }
+  return lsources;
+}
+
+void ParticleManager::updateBatch(size_t begin, size_t end, float dt, Vec2F const& wind) {
+  // Move every particle first and then look up all of their tiles, so that
+  // the particle and tile passes each stay in their own part of the cache.
+  for (size_t i = begin; i < end; ++i)
+    m_particles[m_activeIndexes[i]].update(dt, wind);
 
-    particle.update(dt, Vec2F(wind, 0));
-    Vec2I pos(particle.position.floor());
-    TileType tiletype;
-    auto const& tile = m_tileSectorArray->tile(pos);
+  for (size_t i = begin; i < end; ++i) {
+    auto const& tile = m_tileSectorArray->tile(Vec2I(m_particles[m_activeIndexes[i]].position.floor()));
     if (isSolidColliding(tile.getCollision()))
-      tiletype = TileType::Colliding;
+      m_activeTileTypes[i] = TileType::Colliding;
     else if (tile.liquid.level > 0.5f)
-      tiletype = TileType::Water;
+      m_activeTileTypes[i] = TileType::Water;
     else
-      tiletype = TileType::Empty;
+      m_activeTileTypes[i] = TileType::Empty;
+  }
+
+  for (size_t i = begin; i < end; ++i) {
+    auto& particle = m_particles[m_activeIndexes[i]];
+    TileType tiletype = m_activeTileTypes[i];
 
     if (particle.collidesForeground && tiletype == TileType::Colliding) {
       RectF colRect;
@@ -82,34 +149,7 @@ void ParticleManager::update(float dt, RectF const& cullRegion, float wind) {
 
     if (particle.collidesLiquid && tiletype == TileType::Water)
       particle.destroy(false);
-
-    if (particle.trail && particle.timeToLive >= 0.0f) {
-      auto trail = particle;
-      trail.trail = false;
-      trail.timeToLive = 0;
-      trail.velocity = {};
-      m_nextParticles.append(std::move(trail));
-    }
-
-    if (!particle.dead())
-      m_nextParticles.append(std::move(particle));
   }
-
-  m_particles.clear();
-  swap(m_particles, m_nextParticles);
-}
-
-List<Particle> const& ParticleManager::particles() const {
-  return m_particles;
-}
-
-List<pair<Vec2F, Vec3F>> ParticleManager::lightSources() const {
-  List<pair<Vec2F, Vec3F>> lsources;
-  for (auto const& particle : m_particles) {
-    if (particle.light != Color::Clear)
-      lsources.append({particle.position, particle.light.toRgbF()});
-  }
-  return lsources;
 }
 
 }
@@ -3,6 +3,7 @@
 #include "StarWorldGeometry.hpp"
 #include "StarParticle.hpp"
 #include "StarWorldTiles.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -10,6 +11,10 @@ STAR_CLASS(ParticleManager);
 
 class ParticleManager {
 public:
+  // Particles in the cull region are updated in batches of this size, every
+  // batch past the first is run on the particle worker pool.
+  static size_t const UpdateBatchSize = 2048;
+
   ParticleManager(WorldGeometry const& worldGeometry, ClientTileSectorArrayPtr const& tileSectorArray);
 
   void add(Particle particle);
@@ -27,10 +32,21 @@ public:
   List<pair<Vec2F, Vec3F>> lightSources() const;
 
 private:
-  enum class TileType { Colliding, Water, Empty };
+  enum class TileType : uint8_t { Colliding, Water, Empty };
+
+  // Updates, classifies and collides the active particles in [begin, end),
+  // only touches state belonging to those particles.
+  void updateBatch(size_t begin, size_t end, float dt, Vec2F const& wind);
 
   List<Particle> m_particles;
-  List<Particle> m_nextParticles;
+  List<Particle> m_trailParticles;
+
+  // Indexes of the particles inside the cull region and the tile type under
+  // each after moving, rebuilt every update.
+  List<size_t> m_activeIndexes;
+  List<TileType> m_activeTileTypes;
+  List<WorkerPoolHandle> m_batches;
+  WorkerPool m_workerPool;
 
   WorldGeometry m_worldGeometry;
   float m_undergroundLevel;
@@ -739,6 +739,14 @@ void Plant::update(float dt, uint64_t) {
   }
 }
 
+Maybe<float> Plant::sleepTime() const {
+  // Wind only matters to rendering, so an undamaged master plant has nothing
+  // to do until it is damaged again.
+  if (isMaster() && !m_tileDamageStatus.damaged())
+    return highest<float>();
+  return {};
+}
+
 void Plant::render(RenderCallback* renderCallback) {
   float damageXOffset = Random::randf(-0.1f, 0.1f) * m_tileDamageStatus.damageEffectPercentage();
 
@@ -96,6 +96,7 @@ public:
   List<Vec2I> roots() const override;
 
   void update(float dt, uint64_t currentStep) override;
+  Maybe<float> sleepTime() const override;
 
   void render(RenderCallback* renderCallback) override;
 
@@ -4,6 +4,7 @@
 #include "StarWorld.hpp"
 #include "StarLiquidTypes.hpp"
 #include "StarJsonExtra.hpp"
+#include "StarXXHash.hpp"
 
 namespace Star {
 
@@ -28,6 +29,15 @@ namespace PlatformerAStar {
   // errors.
   float const BoundBoxRoundingErrorScaling = 0.99f;
 
+  // Navigation cache expansions are grouped into square sectors of this many
+  // tiles.
+  int const NavigationSectorSize = 16;
+  size_t const MaxCachedExpansions = 65536;
+  size_t const MaxCachedResults = 256;
+  // Shared search results are only reused for this many world steps, as they
+  // also depend on liquids.
+  uint64_t const CachedResultLifetime = 300;
+
   CollisionSet const CollisionSolid{CollisionKind::Null, CollisionKind::Slippery, CollisionKind::Block, CollisionKind::Slippery};
 
   CollisionSet const CollisionFloorOnly{CollisionKind::Null, CollisionKind::Block, CollisionKind::Slippery, CollisionKind::Platform};
@@ -40,6 +50,105 @@ namespace PlatformerAStar {
       CollisionKind::Slippery,
       CollisionKind::Block};
 
+  NavigationCache::NavigationCache(WorldGeometry const& geometry)
+    : m_geometry(geometry), m_influence(0.0f), m_expansionCount(0) {}
+
+  void NavigationCache::invalidate(RectI const& region) {
+    if (region.isNull())
+      return;
+
+    RectI padded = region.padded(ceil(m_influence));
+    HashSet<Vec2I> sectors;
+    // Walk every column rather than every sector, as the last sector before
+    // the x wrap point may be narrower than the rest.
+    for (int x = padded.xMin(); x < padded.xMax(); ++x) {
+      for (int y = padded.yMin(); y < padded.yMax() + NavigationSectorSize; y += NavigationSectorSize)
+        sectors.add(sectorFor(Vec2F(x, min(y, padded.yMax() - 1))));
+    }
+
+    for (auto const& sector : sectors) {
+      if (auto p = m_sectors.ptr(sector)) {
+        m_expansionCount -= p->expansions.size();
+        m_sectors.remove(sector);
+      }
+    }
+
+    RectF paddedRegion = RectF(padded);
+    eraseWhere(m_results, [&](auto const& p) {
+        return m_geometry.rectIntersectsRect(p.second.bounds, paddedRegion);
+      });
+  }
+
+  void NavigationCache::clear() {
+    m_sectors.clear();
+    m_expansionCount = 0;
+    m_results.clear();
+  }
+
+  size_t NavigationCache::expansionCount() const {
+    return m_expansionCount;
+  }
+
+  size_t NavigationCache::resultCount() const {
+    return m_results.size();
+  }
+
+  List<Edge> const* NavigationCache::expansion(uint64_t movementClass, Node const& node) {
+    auto sector = sectorFor(node.position);
+    auto p = m_sectors.ptr(sector);
+    if (!p)
+      return nullptr;
+
+    auto edges = p->expansions.ptr({movementClass, node});
+    if (edges)
+      m_sectors.toBack(sector);
+    return edges;
+  }
+
+  void NavigationCache::setExpansion(uint64_t movementClass, float influence, Node const& node, List<Edge> const& edges) {
+    m_influence = max(m_influence, influence);
+
+    auto sectorPosition = sectorFor(node.position);
+    auto& sector = m_sectors[sectorPosition];
+    m_sectors.toBack(sectorPosition);
+    if (sector.expansions.insert({movementClass, node}, edges).second)
+      ++m_expansionCount;
+
+    // Evict whole sectors, least recently used first, never the one just
+    // written to.
+    while (m_expansionCount > MaxCachedExpansions && m_sectors.size() > 1) {
+      m_expansionCount -= m_sectors.first().second.expansions.size();
+      m_sectors.removeFirst();
+    }
+  }
+
+  auto NavigationCache::result(ResultKey const& key, uint64_t currentStep) -> ResultConstPtr {
+    auto p = m_results.ptr(key);
+    if (!p)
+      return {};
+
+    if (currentStep - p->step > CachedResultLifetime) {
+      m_results.remove(key);
+      return {};
+    }
+
+    m_results.toBack(key);
+    return p->result;
+  }
+
+  auto NavigationCache::setResult(ResultKey const& key, uint64_t currentStep, RectF const& bounds, Result result) -> ResultConstPtr {
+    auto shared = make_shared<Result const>(std::move(result));
+    m_results.set(key, CachedResult{shared, currentStep, bounds});
+    m_results.toBack(key);
+    while (m_results.size() > MaxCachedResults)
+      m_results.removeFirst();
+    return shared;
+  }
+
+  Vec2I NavigationCache::sectorFor(Vec2F const& position) const {
+    return Vec2I(floor(m_geometry.xwrap(position[0]) / NavigationSectorSize), floor(position[1] / NavigationSectorSize));
+  }
+
   PathFinder::PathFinder(World* world,
       Vec2F searchFrom,
       Vec2F searchTo,
@@ -50,6 +159,7 @@ namespace PlatformerAStar {
       m_searchTo(searchTo),
       m_movementParams(std::move(movementParameters)),
       m_searchParams(std::move(searchParameters)) {
+    initMovementClass();
     initAStar();
   }
 
@@ -63,18 +173,86 @@ namespace PlatformerAStar {
     m_searchTo = rhs.m_searchTo;
     m_movementParams = rhs.m_movementParams;
     m_searchParams = rhs.m_searchParams;
+    m_navigationCache = rhs.m_navigationCache;
+    m_movementClass = rhs.m_movementClass;
+    m_queryClass = rhs.m_queryClass;
+    m_influence = rhs.m_influence;
     initAStar();
     return *this;
   }
 
   Maybe<bool> PathFinder::explore(Maybe<unsigned> maxExploreNodes) {
-    return m_astar->explore(maxExploreNodes);
+    if (m_sharedResult)
+      return m_sharedResult->found;
+
+    auto explored = m_astar->explore(maxExploreNodes);
+    if (explored && m_navigationCache) {
+      NavigationCache::ResultKey key{m_queryClass, roundToNode(m_searchFrom), roundToNode(m_searchTo)};
+      m_sharedResult = m_navigationCache->setResult(key, m_world->currentStep(), searchBounds(*explored, m_astar->result()), {*explored, m_astar->result()});
+    }
+    return explored;
   }
 
   Maybe<Path> const& PathFinder::result() const {
+    if (m_sharedResult)
+      return m_sharedResult->path;
     return m_astar->result();
   }
 
+  void PathFinder::initMovementClass() {
+    // Everything that changes the neighbors of a node is part of the movement
+    // class, everything else that changes the outcome of a search is part of
+    // the query class.
+    auto pushMaybe = [](XXHash64& hash, Maybe<float> const& value) {
+      xxHash64Push(hash, value.isValid());
+      xxHash64Push(hash, value.value());
+    };
+    auto pushRect = [](XXHash64& hash, Maybe<RectF> const& rect) {
+      RectF value = rect.value(RectF::null());
+      xxHash64Push(hash, rect.isValid());
+      xxHash64Push(hash, value.xMin());
+      xxHash64Push(hash, value.yMin());
+      xxHash64Push(hash, value.xMax());
+      xxHash64Push(hash, value.yMax());
+    };
+
+    XXHash64 movementHash(0);
+    xxHash64Push(movementHash, m_movementParams.toJson().repr(0, true));
+    xxHash64Push(movementHash, m_searchParams.enableWalkSpeedJumps);
+    xxHash64Push(movementHash, m_searchParams.enableVerticalJumpAirControl);
+    pushMaybe(movementHash, m_searchParams.swimCost);
+    pushMaybe(movementHash, m_searchParams.jumpCost);
+    pushMaybe(movementHash, m_searchParams.liquidJumpCost);
+    pushMaybe(movementHash, m_searchParams.dropCost);
+    pushRect(movementHash, m_searchParams.boundBox);
+    pushRect(movementHash, m_searchParams.standingBoundBox);
+    pushRect(movementHash, m_searchParams.droppingBoundBox);
+    pushMaybe(movementHash, m_searchParams.smallJumpMultiplier);
+    pushMaybe(movementHash, m_searchParams.jumpDropXMultiplier);
+    pushMaybe(movementHash, m_searchParams.maxLandingVelocity);
+    m_movementClass = movementHash.digest();
+
+    XXHash64 queryHash(m_movementClass);
+    pushMaybe(queryHash, m_searchParams.maxDistance);
+    xxHash64Push(queryHash, m_searchParams.returnBest);
+    xxHash64Push(queryHash, m_searchParams.mustEndOnGround);
+    xxHash64Push(queryHash, m_searchParams.maxFScore.isValid());
+    xxHash64Push(queryHash, m_searchParams.maxFScore.value());
+    xxHash64Push(queryHash, m_searchParams.maxNodesToSearch.isValid());
+    xxHash64Push(queryHash, m_searchParams.maxNodesToSearch.value());
+    m_queryClass = queryHash.digest();
+
+    // Neighbors are found by looking at the bound boxes of the node and of
+    // nodes up to a tile or so away, along with the collision polys of the
+    // tiles around them.
+    RectF bounds = boundBox(Vec2F(), BoundBoxKind::Full);
+    bounds.combine(boundBox(Vec2F(), BoundBoxKind::Stand));
+    bounds.combine(boundBox(Vec2F(), BoundBoxKind::Drop));
+    m_influence = max({abs(bounds.xMin()), abs(bounds.xMax()), abs(bounds.yMin()), abs(bounds.yMax())}) + 3.0f;
+
+    m_navigationCache = m_world->navigationCache();
+  }
+
   void PathFinder::initAStar() {
     auto heuristicCostFn = [this](Node const& fromNode, Node const& toNode) -> float {
       return heuristicCost(fromNode.position, toNode.position);
@@ -88,7 +266,7 @@ namespace PlatformerAStar {
       auto neighborFilter = [this](Edge const& edge) -> bool {
         return distance(edge.source.position, m_searchFrom) <= m_searchParams.maxDistance.value(DefaultMaxDistance);
       };
-      neighbors(node, result);
+      cachedNeighbors(node, result);
       result.filter(neighborFilter);
     };
     auto validateEndFn = [this](Edge const& edge) -> bool {
@@ -100,6 +278,10 @@ namespace PlatformerAStar {
     Vec2F roundedFrom = roundToNode(m_searchFrom);
     Vec2F roundedTo = roundToNode(m_searchTo);
 
+    m_sharedResult = {};
+    if (m_navigationCache)
+      m_sharedResult = m_navigationCache->result({m_queryClass, roundedFrom, roundedTo}, m_world->currentStep());
+
     m_astar = AStar::Search<Edge, Node>(heuristicCostFn,
         neighborsFn,
         goalReachedFn,
@@ -156,6 +338,35 @@ namespace PlatformerAStar {
     }
   }
 
+  void PathFinder::cachedNeighbors(Node const& node, List<Edge>& neighbors) const {
+    if (!m_navigationCache || m_world->liquidLevel(boundBox(node.position).padded(2.0f)).level > 0.0f)
+      return this->neighbors(node, neighbors);
+
+    if (auto edges = m_navigationCache->expansion(m_movementClass, node)) {
+      neighbors.appendAll(*edges);
+      return;
+    }
+
+    this->neighbors(node, neighbors);
+    m_navigationCache->setExpansion(m_movementClass, m_influence, node, neighbors);
+  }
+
+  RectF PathFinder::searchBounds(bool found, Maybe<Path> const& path) const {
+    // A failed search depends on everything it could have explored, a
+    // successful one only on the path it found.
+    if (!found || !path) {
+      float maxDistance = m_searchParams.maxDistance.value(DefaultMaxDistance);
+      return RectF::withCenter(m_searchFrom, Vec2F::filled(maxDistance * 2)).padded(m_influence);
+    }
+
+    RectF bounds = RectF::withSize(m_searchFrom, Vec2F());
+    for (auto const& edge : *path) {
+      bounds.combine(edge.source.position);
+      bounds.combine(edge.target.position);
+    }
+    return bounds.padded(m_influence);
+  }
+
   void PathFinder::getDropNeighbors(Node const& node, List<Edge>& neighbors) const {
     auto dropPosition = node.position + Vec2F(0, -1);
     // The physics of platforms don't allow us to drop through platforms resting
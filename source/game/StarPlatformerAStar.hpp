@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarBiMap.hpp"
+#include "StarOrderedMap.hpp"
 #include "StarAStar.hpp"
 #include "StarWorld.hpp"
 #include "StarActorMovementController.hpp"
@@ -10,6 +11,65 @@ namespace Star {
 namespace PlatformerAStar {
 
   STAR_CLASS(PathFinder);
+  STAR_CLASS(NavigationCache);
+
+  // Node expansions and finished searches shared between every PathFinder in
+  // a world.  Expansions form a navigation graph of walkable surfaces and
+  // jump arcs for each movement class (the movement and search parameters
+  // that shape the graph), grouped by sector so that tile changes only
+  // discard the part of the graph that could depend on them.  Finished
+  // searches are reused by identical queries for a short time.
+  class NavigationCache {
+  public:
+    struct Result {
+      bool found;
+      Maybe<Path> path;
+    };
+    typedef shared_ptr<Result const> ResultConstPtr;
+
+    // Searches are identified by a hash of the movement class and search
+    // limits, along with their start and end nodes.
+    typedef tuple<uint64_t, Vec2F, Vec2F> ResultKey;
+
+    NavigationCache(WorldGeometry const& geometry);
+
+    // Discards everything that might depend on tiles in the given region.
+    void invalidate(RectI const& region);
+    void clear();
+
+    size_t expansionCount() const;
+    size_t resultCount() const;
+
+    // Neighbors of the given node for the given movement class, if cached.
+    List<Edge> const* expansion(uint64_t movementClass, Node const& node);
+    // 'influence' is how far from the node tiles can affect its neighbors.
+    void setExpansion(uint64_t movementClass, float influence, Node const& node, List<Edge> const& edges);
+
+    ResultConstPtr result(ResultKey const& key, uint64_t currentStep);
+    // 'bounds' covers every tile the result depends on.
+    ResultConstPtr setResult(ResultKey const& key, uint64_t currentStep, RectF const& bounds, Result result);
+
+  private:
+    struct Sector {
+      HashMap<pair<uint64_t, Node>, List<Edge>> expansions;
+    };
+
+    struct CachedResult {
+      ResultConstPtr result;
+      uint64_t step;
+      RectF bounds;
+    };
+
+    Vec2I sectorFor(Vec2F const& position) const;
+
+    WorldGeometry m_geometry;
+    float m_influence;
+
+    OrderedHashMap<Vec2I, Sector> m_sectors;
+    size_t m_expansionCount;
+
+    OrderedHashMap<ResultKey, CachedResult> m_results;
+  };
 
   class PathFinder {
   public:
@@ -30,6 +90,12 @@ namespace PlatformerAStar {
     enum class BoundBoxKind { Full, Drop, Stand };
 
     void initAStar();
+    void initMovementClass();
+
+    // Same as neighbors, but goes through the navigation cache when the node
+    // is away from liquids, which change without invalidating it.
+    void cachedNeighbors(Node const& node, List<Edge>& neighbors) const;
+    RectF searchBounds(bool found, Maybe<Path> const& path) const;
 
     float heuristicCost(Vec2F const& fromPosition, Vec2F const& toPosition) const;
     Edge defaultCostEdge(Action action, Node const& source, Node const& target) const;
@@ -72,6 +138,12 @@ namespace PlatformerAStar {
     ActorMovementParameters m_movementParams;
     Parameters m_searchParams;
     Maybe<AStar::Search<Edge, Node>> m_astar;
+
+    NavigationCachePtr m_navigationCache;
+    uint64_t m_movementClass;
+    uint64_t m_queryClass;
+    float m_influence;
+    NavigationCache::ResultConstPtr m_sharedResult;
   };
 }
 }
@@ -144,6 +144,14 @@ inline bool operator!=(Parameters const& lhs, Parameters const& rhs) {
 }
 
 }
+
+template <>
+struct hash<PlatformerAStar::Node> {
+  size_t operator()(PlatformerAStar::Node const& node) const {
+    return hashOf(node.position, node.velocity);
+  }
+};
+
 }
 
 template <> struct fmt::formatter<Star::PlatformerAStar::Node> : ostream_formatter {};
@@ -39,6 +39,12 @@ Projectile::Projectile(ProjectileConfigPtr const& config, DataStreamBuffer& data
   data.read(m_initialSpeed);
   data.read(m_powerMultiplier);
   setTeam(data.read<EntityDamageTeam>());
+
+  if (rules.hasFeature(NetFeature::ReplicatedTrajectories)) {
+    data.read(m_replicateTrajectory);
+    if (m_replicateTrajectory)
+      data.read(m_referenceVelocity);
+  }
 }
 
 ByteArray Projectile::netStore(NetCompatibilityRules rules) const {
@@ -55,6 +61,12 @@ ByteArray Projectile::netStore(NetCompatibilityRules rules) const {
   ds.write(m_powerMultiplier);
   ds.write(getTeam());
 
+  if (rules.hasFeature(NetFeature::ReplicatedTrajectories)) {
+    ds.write(m_replicateTrajectory);
+    if (m_replicateTrajectory)
+      ds.write(m_referenceVelocity);
+  }
+
   return ds.data();
 }
 
@@ -70,6 +82,10 @@ void Projectile::init(World* world, EntityId entityId, EntityMode mode) {
   m_timeToLive = m_parameters.getFloat("timeToLive", m_config->timeToLive);
   setSourceEntity(m_sourceEntity, m_trackSourceEntity);
 
+  if (isMaster())
+    m_replicateTrajectory = m_config->replicateTrajectory && m_config->scripts.empty() && !m_trackSourceEntity;
+  m_trajectory.reset(m_movementController->position(), m_movementController->velocity());
+
   m_periodicActions.clear();
   if (m_parameters.contains("periodicActions")) {
     for (auto const& c : m_parameters.getArray("periodicActions", {}))
@@ -340,6 +356,35 @@ void Projectile::update(float dt, uint64_t) {
         m_lastNonCollidingTile = m_collisionTile;
       }
     }
+
+    // Peers predict the trajectory between corrections.  Collisions depend
+    // on tiles and physics entities that they may see differently, so are
+    // always corrected, anything else such as friction or liquids only once
+    // the projectile strays too far from the prediction.
+    if (m_replicateTrajectory) {
+      advanceTrajectory(dt);
+      if (m_movementController->isColliding()) {
+        m_trajectory.reset(m_movementController->position(), m_movementController->velocity());
+        m_trajectoryNetElement.correct();
+      } else if (m_trajectory.correct(world()->geometry(), m_movementController->position(), m_movementController->velocity())) {
+        m_trajectoryNetElement.correct();
+      }
+    }
+  } else if (m_replicateTrajectory) {
+    m_netGroup.tickNetInterpolation(dt);
+    m_movementController->tickSlave(dt);
+
+    // The master only sends corrections, follow the same prediction it
+    // checks against in between.
+    advanceTrajectory(dt);
+    m_movementController->setPosition(m_trajectory.position());
+    m_movementController->setVelocity(m_trajectory.velocity());
+    m_travelLine.min() = m_travelLine.max();
+    m_travelLine.max() = m_movementController->position();
+
+    m_timeToLive -= dt;
+
+    tickShared(dt);
   } else {
     m_netGroup.tickNetInterpolation(dt);
     m_movementController->tickSlave(dt);
@@ -950,6 +995,7 @@ void Projectile::setup() {
   m_initialSpeed = m_parameters.getFloat("speed", m_config->initialSpeed);
   m_sourceEntity = NullEntityId;
   m_trackSourceEntity = false;
+  m_replicateTrajectory = false;
   m_bounces = m_parameters.getInt("bounces", m_config->bounces);
 
   m_frame = 0;
@@ -981,7 +1027,7 @@ void Projectile::setup() {
     m_netGroup.addNetElement(&p.second.enabled);
 
   m_netGroup.addNetElement(&m_collisionEvent);
-  m_netGroup.addNetElement(m_movementController.get());
+  m_netGroup.addNetElement(&m_trajectoryNetElement);
   m_netGroup.addNetElement(m_effectEmitter.get());
 }
 
@@ -1018,4 +1064,76 @@ void Projectile::renderPendingRenderables(RenderCallback* renderCallback) {
   m_pendingRenderables.clear();
 }
 
+void Projectile::advanceTrajectory(float dt) {
+  // Resting projectiles stay where they are, gravity and all.
+  if (m_movementController->stickingDirection() || m_movementController->onGround())
+    return;
+
+  auto const& parameters = m_movementController->parameters();
+  Vec2F acceleration = (m_trajectory.velocity() - m_referenceVelocity.value()).normalized() * m_acceleration;
+  if (parameters.gravityEnabled.value(true)) {
+    float buoyancy = parameters.airBuoyancy.value(0.0f);
+    acceleration[1] -= world()->gravity(m_trajectory.position()) * parameters.gravityMultiplier.value(1.0f) * (1.0f - buoyancy);
+  }
+  m_trajectory.advance(acceleration, dt);
+}
+
+Projectile::TrajectoryNetElement::TrajectoryNetElement(Projectile* projectile)
+  : m_projectile(projectile) {}
+
+void Projectile::TrajectoryNetElement::correct() {
+  m_correctedVersion = m_netVersion ? m_netVersion->current() : 0;
+}
+
+void Projectile::TrajectoryNetElement::initNetVersion(NetElementVersion const* version) {
+  m_netVersion = version;
+  m_correctedVersion = 0;
+  m_projectile->m_movementController->initNetVersion(version);
+}
+
+void Projectile::TrajectoryNetElement::netStore(DataStream& ds, NetCompatibilityRules rules) const {
+  m_projectile->m_movementController->netStore(ds, rules);
+}
+
+void Projectile::TrajectoryNetElement::netLoad(DataStream& ds, NetCompatibilityRules rules) {
+  m_projectile->m_movementController->netLoad(ds, rules);
+}
+
+void Projectile::TrajectoryNetElement::enableNetInterpolation(float extrapolationHint) {
+  m_projectile->m_movementController->enableNetInterpolation(extrapolationHint);
+}
+
+void Projectile::TrajectoryNetElement::disableNetInterpolation() {
+  m_projectile->m_movementController->disableNetInterpolation();
+}
+
+void Projectile::TrajectoryNetElement::tickNetInterpolation(float dt) {
+  m_projectile->m_movementController->tickNetInterpolation(dt);
+}
+
+bool Projectile::TrajectoryNetElement::writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCompatibilityRules rules) const {
+  // The movement controller sends everything that changed since the peer
+  // last heard, so a correction or the final state leaves it exactly where
+  // the master is.
+  if (fromVersion != 0 && m_projectile->m_replicateTrajectory && rules.hasFeature(NetFeature::ReplicatedTrajectories)
+      && m_correctedVersion < fromVersion && !m_projectile->shouldDestroy())
+    return false;
+  return m_projectile->m_movementController->writeNetDelta(ds, fromVersion, rules);
+}
+
+void Projectile::TrajectoryNetElement::readNetDelta(DataStream& ds, float interpolationTime, NetCompatibilityRules rules) {
+  // Corrections replace the predicted state outright, rather than being
+  // interpolated towards.
+  bool replicated = m_projectile->m_replicateTrajectory && rules.hasFeature(NetFeature::ReplicatedTrajectories);
+  if (replicated)
+    interpolationTime = 0.0f;
+  m_projectile->m_movementController->readNetDelta(ds, interpolationTime, rules);
+  if (replicated)
+    m_projectile->m_trajectory.reset(m_projectile->m_movementController->position(), m_projectile->m_movementController->velocity());
+}
+
+void Projectile::TrajectoryNetElement::blankNetDelta(float interpolationTime) {
+  m_projectile->m_movementController->blankNetDelta(interpolationTime);
+}
+
 }
@@ -10,6 +10,7 @@
 #include "StarMovementController.hpp"
 #include "StarParticle.hpp"
 #include "StarLuaComponents.hpp"
+#include "StarReplicatedTrajectory.hpp"
 
 namespace Star {
 
@@ -111,8 +112,41 @@ private:
     NetElementBool enabled;
   };
 
+  // Forwards to the movement controller, but once the full state has been
+  // sent, only sends deltas to peers that simulate a replicated trajectory
+  // themselves when the master corrects it, and for the final state.
+  class TrajectoryNetElement : public NetElement {
+  public:
+    TrajectoryNetElement(Projectile* projectile);
+
+    // Marks the movement state as something peers could not have predicted,
+    // so that it is sent with the next delta.
+    void correct();
+
+    void initNetVersion(NetElementVersion const* version = nullptr) override;
+
+    void netStore(DataStream& ds, NetCompatibilityRules rules) const override;
+    void netLoad(DataStream& ds, NetCompatibilityRules rules) override;
+
+    void enableNetInterpolation(float extrapolationHint = 0.0f) override;
+    void disableNetInterpolation() override;
+    void tickNetInterpolation(float dt) override;
+
+    bool writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCompatibilityRules rules) const override;
+    void readNetDelta(DataStream& ds, float interpolationTime = 0.0f, NetCompatibilityRules rules = {}) override;
+    void blankNetDelta(float interpolationTime) override;
+
+  private:
+    Projectile* m_projectile;
+    NetElementVersion const* m_netVersion = nullptr;
+    uint64_t m_correctedVersion = 0;
+  };
+
   static List<Particle> sparkBlock(World* world, Vec2I const& position, Vec2F const& damageSource);
 
+  // Advances the replicated trajectory the same way on master and slaves.
+  void advanceTrajectory(float dt);
+
   int getFrame() const;
   void setFrame(int frame);
   String drawableFrame();
@@ -159,6 +193,7 @@ private:
 
   NetElementTopGroup m_netGroup;
   MovementControllerPtr m_movementController;
+  TrajectoryNetElement m_trajectoryNetElement{this};
   EffectEmitterPtr m_effectEmitter;
   float m_timeToLive;
 
@@ -167,6 +202,12 @@ private:
   bool m_trackSourceEntity;
   Vec2F m_lastEntityPosition;
 
+  // Set for unscripted projectiles that opt in with 'replicateTrajectory',
+  // when peers support it slaves then predict movement between corrections
+  // rather than receiving movement deltas.
+  bool m_replicateTrajectory;
+  ReplicatedTrajectory m_trajectory;
+
   int m_bounces;
 
   int m_frame;
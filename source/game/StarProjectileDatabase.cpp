@@ -159,6 +159,7 @@ ProjectileConfigPtr ProjectileDatabase::readConfig(String const& path) {
 
   projectileConfig->clientEntityMode = ClientEntityModeNames.getLeft(config.getString("clientEntityMode", "ClientMasterAllowed"));
   projectileConfig->masterOnly = config.getBool("masterOnly", false);
+  projectileConfig->replicateTrajectory = config.getBool("replicateTrajectory", false);
 
   projectileConfig->scripts =
       jsonToStringList(config.get("scripts", JsonArray())).transformed(bind(AssetPath::relativeTo, path, _1));
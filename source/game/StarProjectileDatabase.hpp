@@ -88,6 +88,8 @@ struct ProjectileConfig {
   bool onlyHitTerrain = false;
   ClientEntityMode clientEntityMode = ClientEntityMode::ClientMasterAllowed;
   bool masterOnly = false;
+  // Only honored for projectiles without scripts, see Projectile.
+  bool replicateTrajectory = false;
 
   StringList scripts;
 
@@ -0,0 +1,34 @@
+#include "StarReplicatedTrajectory.hpp"
+
+namespace Star {
+
+ReplicatedTrajectory::ReplicatedTrajectory(float tolerance)
+  : m_tolerance(tolerance) {}
+
+Vec2F ReplicatedTrajectory::position() const {
+  return m_position;
+}
+
+Vec2F ReplicatedTrajectory::velocity() const {
+  return m_velocity;
+}
+
+void ReplicatedTrajectory::reset(Vec2F const& position, Vec2F const& velocity) {
+  m_position = position;
+  m_velocity = velocity;
+}
+
+void ReplicatedTrajectory::advance(Vec2F const& acceleration, float dt) {
+  m_position += m_velocity * dt;
+  m_velocity += acceleration * dt;
+}
+
+bool ReplicatedTrajectory::correct(WorldGeometry const& geometry, Vec2F const& position, Vec2F const& velocity) {
+  if (geometry.diff(position, m_position).magnitudeSquared() <= square(m_tolerance))
+    return false;
+
+  reset(position, velocity);
+  return true;
+}
+
+}
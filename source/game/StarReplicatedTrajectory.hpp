@@ -0,0 +1,34 @@
+#pragma once
+
+#include "StarWorldGeometry.hpp"
+
+namespace Star {
+
+// Dead reckoning for movement that peers can mostly predict.  Every end
+// advances the last known state by its velocity and the acceleration it is
+// given, and the master only has to send its real state again once that has
+// strayed further than the tolerance from the prediction.
+class ReplicatedTrajectory {
+public:
+  explicit ReplicatedTrajectory(float tolerance = 0.25f);
+
+  Vec2F position() const;
+  Vec2F velocity() const;
+
+  // Restarts the prediction from a known state, when spawned or corrected.
+  void reset(Vec2F const& position, Vec2F const& velocity);
+
+  // Moves along the current velocity for one step, then accelerates.
+  void advance(Vec2F const& acceleration, float dt);
+
+  // Returns true and restarts the prediction from the given real state if it
+  // is too far from where the prediction has it.
+  bool correct(WorldGeometry const& geometry, Vec2F const& position, Vec2F const& velocity);
+
+private:
+  float m_tolerance;
+  Vec2F m_position;
+  Vec2F m_velocity;
+};
+
+}
@@ -362,8 +362,10 @@ void Root::fullyLoad() {
 
   {
     MutexLocker locker(m_assetsMutex);
-    if (m_assets)
+    if (m_assets) {
+      m_assets->savePersistentCache();
       m_assets->clearCache();
+    }
   }
 }
 
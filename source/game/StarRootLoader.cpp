@@ -11,8 +11,21 @@ Json const BaseAssetsSettings = Json::parseJson(R"JSON(
       // In seconds, audio less than this long will be decompressed in memory.
       "audioDecompressLimit" : 4.0,
 
+      // In seconds, longer audio is decoded this far ahead of playback on a
+      // background thread.
+      "audioReadAhead" : 1.0,
+
       "workerPoolSize" : 2,
 
+      // Relative to the storage directory, parsed and patched json assets
+      // loaded during startup are kept here between runs to speed up startup,
+      // for example "assets.cache".  Disabled when null.
+      "persistentCacheFile" : null,
+
+      // In bytes, processed images are kept in memory regardless of their
+      // time to live until they exceed this size.
+      "processedImageCacheSize" : 67108864,
+
       "pathIgnore" : [
         "/\\.",
         "/~",
@@ -72,6 +85,11 @@ R"JSON(
       "scriptInstructionLimit" : 10000000,
       "scriptProfilingEnabled" : false,
       "scriptInstructionMeasureInterval" : 10000,
+      "scriptUpdateSlicing" : {
+        "instructionBudget" : 200000,
+        "maxSlices" : 30,
+        "maxUpdateDelta" : 60
+      },
 
       "allowAdminCommands" : true,
       "allowAdminCommandsFromAnyone" : false,
@@ -164,11 +182,14 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
     Root::Settings rootSettings;
     rootSettings.assetsSettings.assetTimeToLive = assetsSettings.getInt("assetTimeToLive");
     rootSettings.assetsSettings.audioDecompressLimit = assetsSettings.getFloat("audioDecompressLimit");
+    rootSettings.assetsSettings.audioReadAhead = assetsSettings.getFloat("audioReadAhead");
+    rootSettings.assetsSettings.audioDecodedCacheSize = assetsSettings.getUInt("audioDecodedCacheSize", Audio::DefaultDecodedCacheSize);
     rootSettings.assetsSettings.workerPoolSize = assetsSettings.getUInt("workerPoolSize");
     rootSettings.assetsSettings.missingImage = assetsSettings.optString("missingImage");
     rootSettings.assetsSettings.missingAudio = assetsSettings.optString("missingAudio");
     rootSettings.assetsSettings.pathIgnore = jsonToStringList(assetsSettings.get("pathIgnore"));
     rootSettings.assetsSettings.digestIgnore = jsonToStringList(assetsSettings.get("digestIgnore"));
+    rootSettings.assetsSettings.processedImageCacheSize = assetsSettings.getUInt("processedImageCacheSize");
 
     rootSettings.assetDirectories = jsonToStringList(bootConfig.get("assetDirectories", JsonArray()));
     rootSettings.assetSources     = jsonToStringList(bootConfig.get("assetSources",     JsonArray()));
@@ -180,6 +201,8 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
       );
 
     rootSettings.storageDirectory = bootConfig.getString("storageDirectory");
+    if (auto cacheFile = assetsSettings.optString("persistentCacheFile"))
+      rootSettings.assetsSettings.persistentCacheFile = File::relativeTo(rootSettings.storageDirectory, *cacheFile);
     rootSettings.logDirectory = bootConfig.optString("logDirectory");
     rootSettings.logFile = options.parameters.value("logfile").maybeFirst().orMaybe(m_defaults.logFile);
     rootSettings.logFileBackups = bootConfig.getUInt("logFileBackups", 10);
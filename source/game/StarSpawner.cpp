@@ -33,6 +33,11 @@ Spawner::Spawner() {
   m_spawnProhibitedCheckPadding = config.getFloat("spawnProhibitedCheckPadding");
 
   m_spawnCellLifetime = config.getFloat("spawnCellLifetime");
+  // Cells expire a fixed time after they are evaluated, however often they
+  // are used or patched, which bounds how long any tile write that is never
+  // reported can go unnoticed.
+  m_spawnCellTiles.setTimeToLive(config.getFloat("spawnCellTilesLifetime", 60.0f) * 1000);
+  m_spawnCellTiles.setTtlUpdateEnabled(false);
   m_windowActivationBorder = config.getUInt("windowActivationBorder");
 
   m_active = config.getBool("defaultActive", true);
@@ -42,12 +47,14 @@ Spawner::Spawner() {
 
 void Spawner::init(SpawnerFacadePtr facade) {
   m_facade = std::move(facade);
+  m_spawnCellTiles.clear();
 }
 
 void Spawner::uninit() {
   for (auto entityId : m_spawnedEntities)
     m_facade->despawnEntity(entityId);
   m_facade.reset();
+  m_spawnCellTiles.clear();
 }
 
 bool Spawner::active() const {
@@ -85,6 +92,7 @@ void Spawner::update(float dt) {
   eraseWhere(m_activeSpawnCells, [dt](auto& p) {
     return (p.second -= dt) < 0.0f;
   });
+  m_spawnCellTiles.cleanup();
 
   eraseWhere(m_spawnedEntities, [this](EntityId entityId) {
       auto entity = m_facade->getEntity(entityId);
@@ -103,6 +111,54 @@ void Spawner::update(float dt) {
     debugShowSpawnCells();
 }
 
+void Spawner::tileModified(Vec2I const& position) {
+  // Covers every tile whose near-surface or near-ceiling check can reach
+  // this one, with a tile of slack either way.
+  updateSpawnTiles(position[0], position[1] - (int)m_spawnCellNearCeilingDistance - 1,
+      position[1] + (int)m_spawnCellNearSurfaceDistance + 1);
+}
+
+void Spawner::liquidModified(Vec2I const& position) {
+  if (!m_facade || m_spawnCellTiles.currentSize() == 0)
+    return;
+
+  // Liquid only affects the tile's own liquid type, and only if it is empty.
+  Maybe<bool> liquid;
+  forEachCachedTile(position, [&](SpawnCellTiles& cellTiles, uint8_t& tile) {
+      if (!(tile & (1 << EmptyTile)))
+        return;
+      if (!liquid)
+        liquid = m_facade->liquidLevel(position).level > m_minimumLiquidLevel;
+      bool wasLiquid = tile & (1 << LiquidTile);
+      if (*liquid != wasLiquid) {
+        tile ^= 1 << LiquidTile;
+        cellTiles.counts[LiquidTile] += *liquid ? 1 : -1;
+      }
+    });
+}
+
+void Spawner::regionModified(RectI const& region) {
+  if (!m_facade || m_spawnCellTiles.currentSize() == 0)
+    return;
+
+  // Cells see past their own tiles by the near-surface and near-ceiling
+  // distances vertically, and the last cell of a wrapping world can extend
+  // past its edge.
+  int width = m_facade->geometry().width();
+  m_spawnCellTiles.removeWhere([&](Vec2I const& cellIndex, SpawnCellTiles&) {
+      auto cellRegion = RectI::withSize(cellIndex * m_spawnCellSize, Vec2I::filled(m_spawnCellSize));
+      cellRegion.setYMin(cellRegion.yMin() - m_spawnCellNearSurfaceDistance);
+      cellRegion.setYMax(cellRegion.yMax() + m_spawnCellNearCeilingDistance);
+      return cellRegion.intersects(region, false) || cellRegion.intersects(region.translated({width, 0}), false);
+    });
+}
+
+Maybe<SpawnParameters> Spawner::cellSpawnParameters(Vec2F const& position) {
+  if (!m_facade)
+    return {};
+  return spawnParametersForCell(cellIndexForPosition(m_facade->geometry().xwrap(position)));
+}
+
 Vec2I Spawner::cellIndexForPosition(Vec2F const& position) const {
   return Vec2I::floor(position / m_spawnCellSize);
 }
@@ -124,62 +180,14 @@ RectF Spawner::cellRegion(Vec2I const& cellIndex) const {
   return RectF::withSize(Vec2F(cellIndex) * m_spawnCellSize, Vec2F::filled(m_spawnCellSize));
 }
 
-Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) const {
-  unsigned emptyCount = 0;
-  unsigned nearSurfaceCount = 0;
-  unsigned nearCeilingCount = 0;
-  unsigned airCount = 0;
-  unsigned liquidCount = 0;
-  unsigned exposedCount = 0;
-
-  auto region = RectI::withSize(cellIndex * m_spawnCellSize, Vec2I::filled(m_spawnCellSize));
-  for (int x = region.xMin(); x < region.xMax(); ++x) {
-    for (int y = region.yMin(); y < region.yMax(); ++y) {
-      // Only empty blocks count towards spawn totals
-      if (m_facade->collision({x, y}) == CollisionKind::None) {
-        ++emptyCount;
-
-        if (m_facade->liquidLevel({x, y}).level > m_minimumLiquidLevel)
-          ++liquidCount;
-
-        if (m_facade->isBackgroundEmpty({x, y}))
-          ++exposedCount;
-
-        // The empty block will will either count as an air block, a
-        // "near-surface" block, or a "near-ceiling" block.  It will count as a
-        // near-surface block if it is within the NearSurfaceDistance of a
-        // CollsionKind::Block or CollisionKind::Platform block. If it is not a
-        // near-surface block, it will count as a near-ceiling block if it is
-        // within the NearCeilingDistance of a CollisionKind::Block.
-        bool nearSurface = false;
-        for (unsigned sd = 1; sd <= m_spawnCellNearSurfaceDistance; ++sd) {
-          auto collision = m_facade->collision({x, y - sd});
-          if (BlockCollisionSet.contains(collision) || collision == CollisionKind::Platform) {
-            nearSurface = true;
-            break;
-          }
-        }
-
-        bool nearCeiling = false;
-        if (!nearSurface) {
-          for (unsigned cd = 1; cd <= m_spawnCellNearCeilingDistance; ++cd) {
-            auto collision = m_facade->collision({x, y + cd});
-            if (BlockCollisionSet.contains(collision)) {
-              nearCeiling = true;
-              break;
-            }
-          }
-        }
-
-        if (nearSurface)
-          ++nearSurfaceCount;
-        else if (nearCeiling)
-          ++nearCeilingCount;
-        else
-          ++airCount;
-      }
-    }
-  }
+Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) {
+  auto const& counts = spawnCellTiles(cellIndex).counts;
+  unsigned emptyCount = counts[EmptyTile];
+  unsigned nearSurfaceCount = counts[NearSurfaceTile];
+  unsigned nearCeilingCount = counts[NearCeilingTile];
+  unsigned airCount = counts[AirTile];
+  unsigned liquidCount = counts[LiquidTile];
+  unsigned exposedCount = counts[ExposedTile];
 
   Set<SpawnParameters::Area> spawnAreas;
   if (liquidCount > m_spawnCellMinimumLiquidTiles)
@@ -207,6 +215,155 @@ Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) c
   return SpawnParameters(spawnAreas, spawnRegion, spawnTime);
 }
 
+Spawner::SpawnCellTiles const& Spawner::spawnCellTiles(Vec2I const& cellIndex) {
+  return m_spawnCellTiles.get(cellIndex, [this](Vec2I const& cellIndex) {
+      return evaluateSpawnCell(cellIndex);
+    });
+}
+
+Spawner::SpawnCellTiles Spawner::evaluateSpawnCell(Vec2I const& cellIndex) const {
+  SpawnCellTiles cellTiles;
+  cellTiles.tiles.resize(m_spawnCellSize * m_spawnCellSize);
+  cellTiles.counts.fill(0);
+
+  int below = m_spawnCellNearSurfaceDistance;
+  int above = m_spawnCellNearCeilingDistance;
+  auto region = RectI::withSize(cellIndex * m_spawnCellSize, Vec2I::filled(m_spawnCellSize));
+
+  // The collision of each column of the cell, along with the tiles below and
+  // above it that the near-surface and near-ceiling checks can reach.
+  List<CollisionKind> column(m_spawnCellSize + below + above);
+  List<uint8_t> nearSurface(m_spawnCellSize);
+  List<uint8_t> nearCeiling(m_spawnCellSize);
+
+  for (int x = region.xMin(); x < region.xMax(); ++x) {
+    for (size_t i = 0; i < column.size(); ++i)
+      column[i] = m_facade->collision({x, region.yMin() - below + (int)i});
+
+    int lastSurface = -1;
+    for (int i = 0; i < below + (int)m_spawnCellSize; ++i) {
+      if (i >= below)
+        nearSurface[i - below] = lastSurface >= 0 && i - lastSurface <= below;
+      if (BlockCollisionSet.contains(column[i]) || column[i] == CollisionKind::Platform)
+        lastSurface = i;
+    }
+
+    int nextCeiling = -1;
+    for (int i = column.size() - 1; i >= below; --i) {
+      if (i < below + (int)m_spawnCellSize)
+        nearCeiling[i - below] = nextCeiling >= 0 && nextCeiling - i <= above;
+      if (BlockCollisionSet.contains(column[i]))
+        nextCeiling = i;
+    }
+
+    for (unsigned j = 0; j < m_spawnCellSize; ++j) {
+      if (column[below + j] != CollisionKind::None)
+        continue;
+
+      Vec2I position(x, region.yMin() + j);
+      uint8_t types = 1 << EmptyTile;
+      if (m_facade->liquidLevel(position).level > m_minimumLiquidLevel)
+        types |= 1 << LiquidTile;
+      if (m_facade->isBackgroundEmpty(position))
+        types |= 1 << ExposedTile;
+      if (nearSurface[j])
+        types |= 1 << NearSurfaceTile;
+      else if (nearCeiling[j])
+        types |= 1 << NearCeilingTile;
+      else
+        types |= 1 << AirTile;
+
+      cellTiles.tiles[(x - region.xMin()) * m_spawnCellSize + j] = types;
+      for (size_t t = 0; t < SpawnTileTypeCount; ++t)
+        cellTiles.counts[t] += (types >> t) & 1;
+    }
+  }
+
+  return cellTiles;
+}
+
+uint8_t Spawner::spawnTileTypes(Vec2I const& position) const {
+  // Only empty blocks count towards spawn totals
+  if (m_facade->collision(position) != CollisionKind::None)
+    return 0;
+
+  uint8_t types = 1 << EmptyTile;
+
+  if (m_facade->liquidLevel(position).level > m_minimumLiquidLevel)
+    types |= 1 << LiquidTile;
+
+  if (m_facade->isBackgroundEmpty(position))
+    types |= 1 << ExposedTile;
+
+  // The empty block will will either count as an air block, a "near-surface"
+  // block, or a "near-ceiling" block.  It will count as a near-surface block
+  // if it is within the NearSurfaceDistance of a CollsionKind::Block or
+  // CollisionKind::Platform block. If it is not a near-surface block, it will
+  // count as a near-ceiling block if it is within the NearCeilingDistance of
+  // a CollisionKind::Block.
+  bool nearSurface = false;
+  for (unsigned sd = 1; sd <= m_spawnCellNearSurfaceDistance; ++sd) {
+    auto collision = m_facade->collision(position - Vec2I(0, sd));
+    if (BlockCollisionSet.contains(collision) || collision == CollisionKind::Platform) {
+      nearSurface = true;
+      break;
+    }
+  }
+
+  bool nearCeiling = false;
+  if (!nearSurface) {
+    for (unsigned cd = 1; cd <= m_spawnCellNearCeilingDistance; ++cd) {
+      auto collision = m_facade->collision(position + Vec2I(0, cd));
+      if (BlockCollisionSet.contains(collision)) {
+        nearCeiling = true;
+        break;
+      }
+    }
+  }
+
+  if (nearSurface)
+    types |= 1 << NearSurfaceTile;
+  else if (nearCeiling)
+    types |= 1 << NearCeilingTile;
+  else
+    types |= 1 << AirTile;
+
+  return types;
+}
+
+void Spawner::updateSpawnTiles(int x, int yMin, int yMax) {
+  if (!m_facade || m_spawnCellTiles.currentSize() == 0)
+    return;
+
+  for (int y = yMin; y <= yMax; ++y) {
+    Maybe<uint8_t> types;
+    forEachCachedTile({x, y}, [&](SpawnCellTiles& cellTiles, uint8_t& tile) {
+        if (!types)
+          types = spawnTileTypes({x, y});
+        for (size_t t = 0; t < SpawnTileTypeCount; ++t)
+          cellTiles.counts[t] += ((*types >> t) & 1) - ((tile >> t) & 1);
+        tile = *types;
+      });
+  }
+}
+
+template <typename Function>
+void Spawner::forEachCachedTile(Vec2I const& position, Function&& function) {
+  auto geometry = m_facade->geometry();
+  int x = geometry.xwrap(position[0]);
+  // The last cell of a wrapping world can extend past its edge, so the tile
+  // may also be in that cell under its unwrapped position.
+  for (int cellX : {x, x + (int)geometry.width()}) {
+    Vec2I cellIndex = cellIndexForPosition(Vec2F(cellX, position[1]));
+    auto cellTiles = m_spawnCellTiles.ptr(cellIndex);
+    if (!cellTiles)
+      continue;
+
+    Vec2I offset = Vec2I(cellX, position[1]) - cellIndex * m_spawnCellSize;
+    function(*cellTiles, cellTiles->tiles[offset[0] * m_spawnCellSize + offset[1]]);
+  }
+}
+
 Maybe<Vec2F> Spawner::adjustSpawnRegion(RectF const& spawnRegion, RectF const& boundBox, SpawnParameters const& spawnParameters) const {
   auto checkPosition = [&](Vec2F const& position) -> bool {
     RectF region = RectF(boundBox).translated(position);
@@ -61,6 +61,21 @@ public:
 
   void update(float dt);
 
+  // Must be called whenever the foreground, background or collision of the
+  // given tile changes, or just its liquid for liquidModified, to keep the
+  // tile counts of already evaluated spawn cells up to date.
+  void tileModified(Vec2I const& position);
+  void liquidModified(Vec2I const& position);
+  // Must be called when the tiles of a whole region are written without
+  // going through tileModified, such as when sectors are generated, loaded or
+  // terraformed.  Evaluated spawn cells that can see the region are dropped.
+  void regionModified(RectI const& region);
+
+  // The spawn parameters of the spawn cell containing the given position, or
+  // nothing if the cell cannot be spawned in.  Evaluates the cell if it has
+  // not been evaluated recently.
+  Maybe<SpawnParameters> cellSpawnParameters(Vec2F const& position);
+
 private:
   struct SpawnCellDebugInfo {
     SpawnParameters spawnParameters;
@@ -68,12 +83,45 @@ private:
     int spawnAttempts;
   };
 
+  // Each tile in a spawn cell is a set of these, every empty tile is also
+  // exactly one of air, near-surface or near-ceiling.
+  enum SpawnTileType : uint8_t {
+    EmptyTile,
+    LiquidTile,
+    ExposedTile,
+    NearSurfaceTile,
+    NearCeilingTile,
+    AirTile,
+    SpawnTileTypeCount
+  };
+
+  // The types of every tile in an evaluated spawn cell, as bits, column by
+  // column, along with how many tiles are of each type.  Kept for a fixed
+  // time after the cell is evaluated and patched as tiles change, so that
+  // re-activating a cell doesn't have to walk its tiles again.
+  struct SpawnCellTiles {
+    List<uint8_t> tiles;
+    Array<unsigned, SpawnTileTypeCount> counts;
+  };
+
   Vec2I cellIndexForPosition(Vec2F const& position) const;
   List<Vec2I> cellIndexesForRange(RectF const& range) const;
   RectF cellRegion(Vec2I const& cellIndex) const;
 
   // Is the cell spawnable, and if so, what are the valid spawn parameters for it?
-  Maybe<SpawnParameters> spawnParametersForCell(Vec2I const& cellIndex) const;
+  Maybe<SpawnParameters> spawnParametersForCell(Vec2I const& cellIndex);
+
+  SpawnCellTiles const& spawnCellTiles(Vec2I const& cellIndex);
+  // Evaluates every tile in the cell a column at a time, reading each
+  // collision once rather than once per neighbouring tile.
+  SpawnCellTiles evaluateSpawnCell(Vec2I const& cellIndex) const;
+  uint8_t spawnTileTypes(Vec2I const& position) const;
+  // Re-evaluates the given tiles of a column in any cached cell they are in.
+  void updateSpawnTiles(int x, int yMin, int yMax);
+  // Calls the function with the cell and type bits of the tile in every
+  // cached cell it is in.
+  template <typename Function>
+  void forEachCachedTile(Vec2I const& position, Function&& function);
 
   // Finds a position for the given bounding box inside the given spawn cell
   // which matches the given spawn parameters.
@@ -108,6 +156,7 @@ private:
   SpawnerFacadePtr m_facade;
   HashSet<EntityId> m_spawnedEntities;
   HashMap<Vec2I, float> m_activeSpawnCells;
+  HashTtlCache<Vec2I, SpawnCellTiles> m_spawnCellTiles;
 
   bool m_debug;
   HashMap<Vec2I, SpawnCellDebugInfo> m_debugSpawnInfo;
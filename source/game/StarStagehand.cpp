@@ -44,6 +44,8 @@ void Stagehand::init(World* world, EntityId entityId, EntityMode mode) {
       }));
     m_scriptComponent.addCallbacks("entity", LuaBindings::makeEntityCallbacks(this));
     m_scriptComponent.addCallbacks("behavior", LuaBindings::makeBehaviorLuaCallbacks(&m_behaviors));
+    if (world->isServer())
+      m_scriptComponent.setUpdateSlicing(world->luaRoot()->updateSlicing(m_config.get("scriptUpdateSlicing", Json())));
     m_scriptComponent.init(world);
   }
 }
@@ -111,6 +113,10 @@ Maybe<LuaValue> Stagehand::evalScript(String const& code) {
   return m_scriptComponent.eval(code);
 }
 
+LuaUpdateStatistics const* Stagehand::scriptUpdateStatistics() const {
+  return &m_scriptComponent.updateStatistics();
+}
+
 Stagehand::Stagehand() {
   setPersistent(true);
 
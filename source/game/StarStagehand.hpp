@@ -40,6 +40,7 @@ public:
 
   Maybe<LuaValue> callScript(String const& func, LuaVariadic<LuaValue> const& args) override;
   Maybe<LuaValue> evalScript(String const& code) override;
+  LuaUpdateStatistics const* scriptUpdateStatistics() const override;
 
   String typeName() const;
 
@@ -99,13 +99,13 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
   else if (!protocolResponsePacket->allowed)
     return String(strf("Join failed! Server does not support connections with protocol version {}", StarProtocolVersion));
 
-  NetCompatibilityRules compatibilityRules;
-  compatibilityRules.setVersion(LegacyVersion);
+  NetCompatibilityRules compatibilityRules(LegacyVersion);
   bool legacyServer = protocolResponsePacket->compressionMode() != PacketCompressionMode::Enabled;
   if (!legacyServer) {
     auto compressedSocket = as<CompressedPacketSocket>(&connection.packetSocket());
     if (protocolResponsePacket->info) {
       compatibilityRules.setVersion(protocolResponsePacket->info.getUInt("openProtocolVersion", 1));
+      compatibilityRules.setFeatures(protocolResponsePacket->info.getUInt("netFeatures", 0) & SupportedNetFeatures);
       auto compressionName = protocolResponsePacket->info.getString("compression", "None");
       if (compressedSocket) {
         auto compressionMode = NetCompressionModeNames.maybeLeft(compressionName);
@@ -129,7 +129,8 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
       m_mainPlayer->log()->introComplete(), account);
   clientConnect->info = JsonObject{
     {"brand", "BopenStarbound"},
-    {"openProtocolVersion", OpenProtocolVersion }
+    {"openProtocolVersion", OpenProtocolVersion },
+    {"netFeatures", SupportedNetFeatures}
   };
   connection.pushSingle(std::move(clientConnect));
   connection.sendAll(timeout);
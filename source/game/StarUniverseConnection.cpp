@@ -1,5 +1,6 @@
 #include "StarUniverseConnection.hpp"
 #include "StarLogging.hpp"
+#include "StarMemoryTracker.hpp"
 
 namespace Star {
 
@@ -124,6 +125,7 @@ Maybe<PacketStats> UniverseConnection::outgoingStats() const {
 UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetReceiver)
   : m_packetReceiver(std::move(packetReceiver)), m_shutdown(false) {
   m_processingLoop = Thread::invoke("UniverseConnectionServer::processingLoop", [this]() {
+      MemoryTracker::setCurrentTag(MemoryTracker::tag("net"));
       RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
       try {
         while (!m_shutdown) {
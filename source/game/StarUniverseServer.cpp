@@ -1,6 +1,7 @@
 #include "StarUniverseServer.hpp"
 #include "StarFile.hpp"
 #include "StarLogging.hpp"
+#include "StarProfiler.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarEncode.hpp"
 #include "StarRoot.hpp"
@@ -376,6 +377,17 @@ bool UniverseServer::executeForClient(ConnectionId clientId, function<void(World
   return success;
 }
 
+bool UniverseServer::executeForWorld(WorldId const& worldId, function<void(WorldServer*)> action) {
+  RecursiveMutexLocker locker(m_mainLock);
+  if (auto world = getWorld(worldId)) {
+    world->executeAction([&action](WorldServerThread*, WorldServer* worldServer) {
+        action(worldServer);
+      });
+    return true;
+  }
+  return false;
+}
+
 void UniverseServer::disconnectClient(ConnectionId clientId, String const& reason) {
   RecursiveMutexLocker locker(m_mainLock);
   m_pendingDisconnections.add(clientId, reason);
@@ -500,6 +512,7 @@ bool UniverseServer::sendPacket(ConnectionId clientId, PacketPtr packet) {
 
 void UniverseServer::run() {
   Logger::info("UniverseServer: Starting UniverseServer with UUID: {}", m_universeSettings->uuid().hex());
+  Profiler::setThreadGroup("universe");
 
   int mainWakeupInterval = Root::singleton().assets()->json("/universe_server.config:mainWakeupInterval").toInt();
 
@@ -543,25 +556,46 @@ void UniverseServer::run() {
     LogMap::set("universe_time", m_universeClock->time());
 
     try {
+      ProfileScope tick("UniverseServer::run");
+      ProfileScope phase("updateLua");
       updateLua();
+      phase.next("processUniverseFlags");
       processUniverseFlags();
+      phase.next("removeTimedBan");
       removeTimedBan();
+      phase.next("sendPendingChat");
       sendPendingChat();
+      phase.next("updateTeams");
       updateTeams();
+      phase.next("updateShips");
       updateShips();
+      phase.next("sendClockUpdates");
       sendClockUpdates();
+      phase.next("kickErroredPlayers");
       kickErroredPlayers();
+      phase.next("reapConnections");
       reapConnections();
+      phase.next("processPlanetTypeChanges");
       processPlanetTypeChanges();
+      phase.next("warpPlayers");
       warpPlayers();
+      phase.next("flyShips");
       flyShips();
+      phase.next("arriveShips");
       arriveShips();
+      phase.next("processChat");
       processChat();
+      phase.next("sendClientContextUpdates");
       sendClientContextUpdates();
+      phase.next("respondToCelestialRequests");
       respondToCelestialRequests();
+      phase.next("clearBrokenWorlds");
       clearBrokenWorlds();
+      phase.next("handleWorldMessages");
       handleWorldMessages();
+      phase.next("shutdownInactiveWorlds");
       shutdownInactiveWorlds();
+      phase.next("doTriggeredStorage");
       doTriggeredStorage();
     } catch (std::exception const& e) {
       Logger::error("UniverseServer: exception caught: {}", outputException(e, true));
@@ -1594,7 +1628,8 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
     useCompressionStream = compressionMode == NetCompressionMode::Zstd;
     protocolResponse->info = JsonObject{
       {"compression", NetCompressionModeNames.getRight(compressionMode)},
-      {"openProtocolVersion", OpenProtocolVersion}
+      {"openProtocolVersion", OpenProtocolVersion},
+      {"netFeatures", SupportedNetFeatures}
     };
   }
   connection.pushSingle(protocolResponse);
@@ -1695,10 +1730,11 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
   if (Json& info = clientConnect->info) {
     if (auto openProtocolVersion = info.optUInt("openProtocolVersion"))
       netRules.setVersion(*openProtocolVersion);
+    netRules.setFeatures(info.getUInt("netFeatures", 0) & SupportedNetFeatures);
     if (Json brand = info.get("brand", "custom"))
       connectionLog += strf(" ({} client)", brand.toString());
     if (info.getBool("legacy", false))
-      netRules.setVersion(LegacyVersion);
+      netRules = NetCompatibilityRules(LegacyVersion);
   }
   connection.packetSocket().setNetRules(netRules);
   Logger::log(LogLevel::Info, connectionLog.utf8Ptr());
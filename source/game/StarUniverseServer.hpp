@@ -98,6 +98,10 @@ public:
   // Returns true if function was called, false if client was not found or in
   // an invalid connection state.
   bool executeForClient(ConnectionId clientId, function<void(WorldServer*, PlayerPtr)> action);
+  // If the world is active and has finished loading, executes the given
+  // function on it in a thread safe way.  Returns true if the function was
+  // called.
+  bool executeForWorld(WorldId const& worldId, function<void(WorldServer*)> action);
   void disconnectClient(ConnectionId clientId, String const& reason);
   void banUser(ConnectionId clientId, String const& reason, pair<bool, bool> banType, Maybe<int> timeout);
   bool unbanIp(String const& addressString);
@@ -189,6 +189,8 @@ void Vehicle::init(World* world, EntityId entityId, EntityMode mode) {
     m_scriptComponent.addCallbacks("entity", LuaBindings::makeEntityCallbacks(this));
     m_scriptComponent.addCallbacks("mcontroller", LuaBindings::makeMovementControllerCallbacks(&m_movementController));
     m_scriptComponent.addCallbacks("animator", LuaBindings::makeNetworkedAnimatorCallbacks(&m_networkedAnimator));
+    if (world->isServer())
+      m_scriptComponent.setUpdateSlicing(world->luaRoot()->updateSlicing(configValue("scriptUpdateSlicing")));
     m_scriptComponent.init(world);
   } else {
     m_slaveHeartbeatTimer.reset();
@@ -560,6 +562,10 @@ Maybe<LuaValue> Vehicle::evalScript(String const& code) {
   return m_scriptComponent.eval(code);
 }
 
+LuaUpdateStatistics const* Vehicle::scriptUpdateStatistics() const {
+  return &m_scriptComponent.updateStatistics();
+}
+
 void Vehicle::setPosition(Vec2F const& position) {
   m_movementController.setPosition(position);
 }
@@ -78,6 +78,7 @@ public:
 
   Maybe<LuaValue> callScript(String const& func, LuaVariadic<LuaValue> const& args) override;
   Maybe<LuaValue> evalScript(String const& code) override;
+  LuaUpdateStatistics const* scriptUpdateStatistics() const override;
 
   void setPosition(Vec2F const& position);
 
@@ -8,12 +8,73 @@ namespace Star {
 
 WireProcessor::WireProcessor(WorldStoragePtr worldStorage) {
   m_worldStorage = worldStorage;
+  m_invalidated = true;
+}
+
+void WireProcessor::invalidate() {
+  m_invalidated = true;
 }
 
 void WireProcessor::process() {
+  if (m_invalidated) {
+    rebuild();
+  } else {
+    for (auto& network : m_networks) {
+      syncNetworkTtl(network);
+      network.changed = false;
+    }
+  }
+
+  // Take the output states every entity will read from during this step, and
+  // note which networks they have changed in.
+  for (auto& p : m_workingWireEntities) {
+    auto& wes = p.second;
+    if (wes.network == NPos)
+      continue;
+    for (size_t i = 0; i < wes.outputStates.size(); ++i) {
+      bool state = wes.wireEntity->nodeState({WireDirection::Output, i});
+      if (wes.outputStates[i] != state) {
+        wes.outputStates[i] = state;
+        m_networks[wes.network].changed = true;
+      }
+    }
+  }
+
+  // Wire entities only react to changes in their inputs, and every input
+  // comes from an output in the same network, so unchanged networks have
+  // nothing to do.  Entities only read the output states taken above, so the
+  // order of evaluation does not matter.
+  for (auto const& network : m_networks) {
+    if (network.changed) {
+      for (auto const& pos : network.entities) {
+        auto const& wireEntity = m_workingWireEntities.get(pos).wireEntity;
+        wireEntity->evaluate(this);
+        m_evaluatedEntities.append(wireEntity->entityId());
+      }
+    }
+  }
+}
+
+List<EntityId> WireProcessor::pullEvaluatedEntities() {
+  return take(m_evaluatedEntities);
+}
+
+bool WireProcessor::readInputConnection(WireConnection const& connection) {
+  if (auto wes = m_workingWireEntities.ptr(connection.entityLocation))
+    return wes->outputStates.get(connection.nodeIndex);
+  return false;
+}
+
+void WireProcessor::rebuild() {
+  // Loading networks may load more wire entities and invalidate again, which
+  // will just rebuild once more on the next step.
+  m_invalidated = false;
+  m_workingWireEntities.clear();
+  m_networks.clear();
+
   // First, populate all the working entities that are already live
   m_worldStorage->entityMap()->forAllEntities([&](EntityPtr const& entity) {
-    if (auto wireEntity = as<WireEntity>(entity.get()))
+    if (auto wireEntity = as<WireEntity>(entity))
       populateWorking(wireEntity);
   });
 
@@ -33,21 +94,10 @@ void WireProcessor::process() {
     if (m_workingWireEntities.size() == oldWorkingSize)
       break;
   }
-
-  for (auto const& p : m_workingWireEntities)
-    p.second.wireEntity->evaluate(this);
-
-  m_workingWireEntities.clear();
-}
-
-bool WireProcessor::readInputConnection(WireConnection const& connection) {
-  if (auto wes = m_workingWireEntities.ptr(connection.entityLocation))
-    return wes->outputStates.get(connection.nodeIndex);
-  return false;
 }
 
-void WireProcessor::populateWorking(WireEntity* wireEntity) {
-  auto p = m_workingWireEntities.insert(wireEntity->tilePosition(), WireEntityState{nullptr, {}, false});
+void WireProcessor::populateWorking(WireEntityPtr const& wireEntity) {
+  auto p = m_workingWireEntities.insert(wireEntity->tilePosition(), WireEntityState{nullptr, {}, false, NPos});
   if (!p.second) {
     if (p.first->second.wireEntity != wireEntity)
       Logger::debug("Multiple wire entities share tile position: {}", wireEntity->position());
@@ -64,6 +114,8 @@ void WireProcessor::populateWorking(WireEntity* wireEntity) {
 void WireProcessor::loadNetwork(Vec2I tilePosition) {
   HashSet<WorldStorage::Sector> networkSectors;
   Maybe<float> highestTtl;
+  size_t networkIndex = m_networks.size();
+  m_networks.append(WireNetwork{{}, {}, true});
 
   // Recursively load a given WireEntity at the given position.  Returns true
   // if that wire entity was found.
@@ -84,7 +136,7 @@ void WireProcessor::loadNetwork(Vec2I tilePosition) {
     } else {
       m_worldStorage->loadSector(*sector);
       m_worldStorage->entityMap()->forEachEntity(RectF(*m_worldStorage->regionForSector(*sector)), [&](EntityPtr const& entity) {
-          if (auto wireEntity = as<WireEntity>(entity.get()))
+          if (auto wireEntity = as<WireEntity>(entity))
             populateWorking(wireEntity);
         });
     }
@@ -96,6 +148,8 @@ void WireProcessor::loadNetwork(Vec2I tilePosition) {
       return true;
 
     wes->networkLoaded = true;
+    wes->network = networkIndex;
+    m_networks[networkIndex].entities.append(pos);
     networkSectors.add(*sector);
 
     // Recursively descend into all the inbound and outbound nodes, and if we
@@ -120,6 +174,12 @@ void WireProcessor::loadNetwork(Vec2I tilePosition) {
 
   doLoad(tilePosition);
 
+  if (m_networks[networkIndex].entities.empty()) {
+    m_networks.removeLast();
+    return;
+  }
+  m_networks[networkIndex].sectors = networkSectors.values();
+
   // Set the sector ttl for the entire network to be equal to the highest
   // entry, so that the entire network either lives or dies together, but
   // without artificially extending the lifetime of the network.
@@ -129,4 +189,22 @@ void WireProcessor::loadNetwork(Vec2I tilePosition) {
   }
 }
 
+void WireProcessor::syncNetworkTtl(WireNetwork const& network) {
+  Maybe<float> highestTtl;
+  for (auto const& sector : network.sectors) {
+    if (m_worldStorage->sectorLoadLevel(sector) == SectorLoadLevel::Loaded) {
+      auto ttl = *m_worldStorage->sectorTimeToLive(sector);
+      if (highestTtl)
+        highestTtl = max(*highestTtl, ttl);
+      else
+        highestTtl = ttl;
+    }
+  }
+
+  if (highestTtl) {
+    for (auto const& sector : network.sectors)
+      m_worldStorage->setSectorTimeToLive(sector, *highestTtl);
+  }
+}
+
 }
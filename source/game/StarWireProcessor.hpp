@@ -11,31 +11,60 @@ STAR_CLASS(WireProcessor);
 
 // Propogates WireEntity signals, and keeps networks of WireEntities alive
 // together.
+//
+// The loaded wire entities and the connected networks they form are kept
+// between steps, and are only rebuilt after invalidate() is called.  A
+// network is only evaluated when one of its output states has changed since
+// the last step, or when it has just been rebuilt.
 class WireProcessor : public WireCoordinator {
 public:
   WireProcessor(WorldStoragePtr worldStorage);
 
+  // Must be called whenever a wire entity is added to or removed from the
+  // world, or when any wire connection changes.
+  void invalidate();
+
   void process();
 
+  // Every wire entity evaluated by process() since the last call.
+  List<EntityId> pullEvaluatedEntities();
+
   bool readInputConnection(WireConnection const& connection) override;
 
 private:
   struct WireEntityState {
-    WireEntity* wireEntity;
+    WireEntityPtr wireEntity;
     List<bool> outputStates;
     bool networkLoaded;
+    size_t network;
   };
 
+  struct WireNetwork {
+    List<Vec2I> entities;
+    List<Vec2S> sectors;
+    bool changed;
+  };
+
+  // Drops every working entity and network, then finds all the live wire
+  // entities and loads their networks.
+  void rebuild();
+
   // Add the given WireEntity to the working entities set, populating inbound /
   // outbound nodes and states.
-  void populateWorking(WireEntity* wireEntity);
+  void populateWorking(WireEntityPtr const& wireEntity);
   // Scans a wire network, starting at an entity at the given position, while
   // also loading any unloaded entries in the network and marking each entry as
-  // now having been 'networkLoaded'.
+  // now having been 'networkLoaded'.  Records the scanned entries as a new
+  // network.
   void loadNetwork(Vec2I tilePosition);
+  // Sets the sector ttl of every sector in the network to the highest of them.
+  void syncNetworkTtl(WireNetwork const& network);
 
   WorldStoragePtr m_worldStorage;
   StableHashMap<Vec2I, WireEntityState> m_workingWireEntities;
+  List<WireNetwork> m_networks;
+  bool m_invalidated;
+  List<EntityId> m_evaluatedEntities;
 };
 
 }
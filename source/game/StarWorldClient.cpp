@@ -1,6 +1,7 @@
 #include "StarWorldClient.hpp"
 #include "StarIterator.hpp"
 #include "StarLogging.hpp"
+#include "StarProfiler.hpp"
 #include "StarBiome.hpp"
 #include "StarMaterialRenderProfile.hpp"
 #include "StarLiquidTypes.hpp"
@@ -21,6 +22,7 @@
 #include "StarStoredFunctions.hpp"
 #include "StarInspectableEntity.hpp"
 #include "StarCurve25519.hpp"
+#include "StarPlatformerAStar.hpp"
 
 namespace Star {
 
@@ -34,6 +36,9 @@ WorldClient::WorldClient(PlayerPtr mainPlayer, LuaRootPtr luaRoot) {
 
   m_clientConfig = assets->json("/client.config");
 
+  // The client world is updated on the thread it is created on.
+  Profiler::setThreadGroup("client");
+
   m_currentStep = 0;
   m_currentTime = 0;
   m_fullBright = false;
@@ -314,6 +319,17 @@ bool WorldClient::rectTileCollision(RectI const& region, CollisionSet const& col
   return WorldImpl::rectTileCollision(m_tileArray, region, collisionSet);
 }
 
+PlatformerAStar::NavigationCachePtr WorldClient::navigationCache() const {
+  return m_navigationCache;
+}
+
+void WorldClient::forEachCollisionCandidate(List<RectF> const& regions, CollisionCandidateCallback const& callback) const {
+  if (!inWorld())
+    return;
+
+  m_collisionCache->query(regions, callback);
+}
+
 LiquidLevel WorldClient::liquidLevel(Vec2I const& pos) const {
   if (!inWorld())
     return {};
@@ -1081,6 +1097,9 @@ void WorldClient::update(float dt) {
   if (!inWorld())
     return;
 
+  ProfileScope tick("WorldClient::update");
+  ProfileScope phase("predictedTiles");
+
   auto assets = Root::singleton().assets();
 
   float expireTime = min(float(m_latency + 800), 2000.f);
@@ -1107,6 +1126,7 @@ void WorldClient::update(float dt) {
   // Temporary: Backwards compatibility with StarExtensions
   m_mainPlayer->effectsAnimator()->setGlobalTag("\0SE_VOICE_SIGNING_KEY"s, publicKeyString);
 
+  phase.next("timers");
   ++m_currentStep;
   m_currentTime += dt;
   m_interpolationTracker.update(m_currentTime);
@@ -1123,6 +1143,7 @@ void WorldClient::update(float dt) {
   for (auto const& action : triggeredActions)
     action(this);
 
+  phase.next("entities");
   List<EntityId> toRemove;
   List<EntityId> clientPresenceEntities;
   m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
@@ -1145,9 +1166,11 @@ void WorldClient::update(float dt) {
   m_clientState.setPlayer(m_mainPlayer->entityId());
   m_clientState.setClientPresenceEntities(std::move(clientPresenceEntities));
 
+  phase.next("damage");
   m_damageManager->update(dt);
   handleDamageNotifications();
 
+  phase.next("skyAndWeather");
   m_sky->setAltitude(m_clientState.windowCenter()[1]);
   m_sky->update(dt);
 
@@ -1156,6 +1179,7 @@ void WorldClient::update(float dt) {
   m_weather.setVisibleRegion(particleRegion);
   m_weather.update(dt);
 
+  phase.next("itemDrops");
   if (!m_mainPlayer->isDead()) {
     // Clear m_requestedDrops every so often in case of entity id reuse or
     // desyncs etc
@@ -1181,11 +1205,13 @@ void WorldClient::update(float dt) {
     m_requestedDrops.clear();
   }
 
+  phase.next("particles");
   sparkDamagedBlocks();
 
   m_particles->addParticles(m_weather.pullNewParticles());
   m_particles->update(dt, RectF(particleRegion), m_weather.wind());
 
+  phase.next("audio");
   if (auto audioSample = m_ambientSounds.updateAmbient(currentAmbientNoises(), m_sky->isDayTime()))
     m_samples.append(audioSample);
   if (auto audioSample = m_ambientSounds.updateWeather(currentWeatherNoises()))
@@ -1226,6 +1252,7 @@ void WorldClient::update(float dt) {
   if (auto audioSample = m_musicTrack.updateAmbient(currentMusicTrack(), m_sky->isDayTime()))
     m_music.append(audioSample);
 
+  phase.next("packets");
   for (EntityId entityId : toRemove)
     removeEntity(entityId, true);
 
@@ -1238,6 +1265,7 @@ void WorldClient::update(float dt) {
 
   LogMap::set("client_ping", m_latency);
 
+  phase.next("sectors");
   // Remove active sectors that are outside of the current monitoring region
   Set<ClientTileSectorArray::Sector> neededSectors;
   auto monitoredRegions = m_clientState.monitoringRegions([this](EntityId entityId) -> Maybe<RectI> {
@@ -1250,8 +1278,11 @@ void WorldClient::update(float dt) {
 
   auto loadedSectors = m_tileArray->loadedSectors();
   for (auto sector : loadedSectors) {
-    if (!neededSectors.contains(sector))
+    if (!neededSectors.contains(sector)) {
       m_tileArray->unloadSector(sector);
+      m_collisionCache->invalidate(m_tileArray->sectorRegion(sector));
+      m_navigationCache->invalidate(m_tileArray->sectorRegion(sector));
+    }
   }
 
   if (m_collisionDebug)
@@ -1772,6 +1803,10 @@ void WorldClient::initWorld(WorldStartPacket const& startPacket) {
   m_geometry = WorldGeometry(m_worldTemplate->size(), m_worldTemplate->wrapsX(), m_worldTemplate->wrapsY());
 
   m_particles = make_shared<ParticleManager>(m_geometry, m_tileArray);
+  m_navigationCache = make_shared<PlatformerAStar::NavigationCache>(m_geometry);
+  m_collisionCache = make_shared<CollisionCache>(m_geometry, [this](RectI const& region, auto const& iterator) {
+      forEachCollisionBlock(region, iterator);
+    });
   m_particles->setUndergroundLevel(m_worldTemplate->undergroundLevel());
 
   setupForceRegions();
@@ -1835,6 +1870,8 @@ void WorldClient::clearWorld() {
   m_tileArray.reset();
 
   m_damageManager.reset();
+  m_navigationCache.reset();
+  m_collisionCache.reset();
 
   m_particles.reset();
 
@@ -2019,6 +2056,11 @@ void WorldClient::dirtyCollision(RectI const& region) {
         tile->collisionCacheDirty = true;
     }
   }
+
+  if (m_collisionCache)
+    m_collisionCache->invalidate(dirtyRegion);
+  if (m_navigationCache)
+    m_navigationCache->invalidate(dirtyRegion);
 }
 
 void WorldClient::freshenCollision(RectI const& region) {
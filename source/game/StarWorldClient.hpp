@@ -8,6 +8,7 @@
 #include "StarWeather.hpp"
 #include "StarInterpolationTracker.hpp"
 #include "StarWorldStructure.hpp"
+#include "StarCollisionCache.hpp"
 #include "StarChatAction.hpp"
 #include "StarWiring.hpp"
 #include "StarEntityRendering.hpp"
@@ -72,6 +73,8 @@ public:
   Maybe<pair<Vec2F, Vec2I>> lineTileCollisionPoint(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
   List<Vec2I> collidingTilesAlongLine(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet, int maxSize = -1, bool includeEdges = true) const override;
   bool rectTileCollision(RectI const& region, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
+  PlatformerAStar::NavigationCachePtr navigationCache() const override;
+  void forEachCollisionCandidate(List<RectF> const& regions, CollisionCandidateCallback const& callback) const override;
   TileDamageResult damageTiles(List<Vec2I> const& pos, TileLayer layer, Vec2F const& sourcePosition, TileDamage const& tileDamage, Maybe<EntityId> sourceEntity = {}) override;
   InteractiveEntityPtr getInteractiveInRange(Vec2F const& targetPosition, Vec2F const& sourcePosition, float maxRange) const override;
   bool canReachEntity(Vec2F const& position, float radius, EntityId targetEntity, bool preferInteractive = true) const override;
@@ -262,6 +265,8 @@ private:
   ClientTileSectorArrayPtr m_tileArray;
   ClientTileGetter m_tileGetterFunction;
   DamageManagerPtr m_damageManager;
+  PlatformerAStar::NavigationCachePtr m_navigationCache;
+  CollisionCachePtr m_collisionCache;
   LuaRootPtr m_luaRoot;
 
   WorldGeometry m_geometry;
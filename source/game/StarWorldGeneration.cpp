@@ -663,6 +663,10 @@ void WorldGenerator::generateSectorLevel(WorldStorage* worldStorage, Sector cons
       prepareSectorBiomeBlocks(worldStorage, sector);
     m_worldServer->activateLiquidRegion(worldStorage->tileArray()->sectorRegion(sector));
   }
+
+  // Generation writes tiles directly, without dirtying collision.
+  m_worldServer->invalidateCachedGeometry(worldStorage->tileArray()->sectorRegion(sector));
+  m_worldServer->invalidateSpawnCells(worldStorage->tileArray()->sectorRegion(sector));
 }
 
 void WorldGenerator::sectorLoadLevelChanged(WorldStorage* worldStorage, Sector const& sector, SectorLoadLevel loadLevel) {
@@ -670,11 +674,17 @@ void WorldGenerator::sectorLoadLevelChanged(WorldStorage* worldStorage, Sector c
     if (worldStorage->sectorGenerationLevel(sector) == SectorGenerationLevel::Complete)
       m_worldServer->activateLiquidRegion(worldStorage->tileArray()->sectorRegion(sector));
   }
+
+  m_worldServer->invalidateCachedGeometry(worldStorage->tileArray()->sectorRegion(sector));
+  m_worldServer->invalidateSpawnCells(worldStorage->tileArray()->sectorRegion(sector));
 }
 
 void WorldGenerator::terraformSector(WorldStorage* worldStorage, Sector const& sector) {
   // Logger::info("terraforming sector {}...", sector);
   reapplyBiome(worldStorage, sector);
+
+  m_worldServer->invalidateCachedGeometry(worldStorage->tileArray()->sectorRegion(sector));
+  m_worldServer->invalidateSpawnCells(worldStorage->tileArray()->sectorRegion(sector));
 }
 
 void WorldGenerator::initEntity(WorldStorage*, EntityId entityId, EntityPtr const& entity) {
@@ -688,6 +698,10 @@ void WorldGenerator::destructEntity(WorldStorage*, EntityPtr const& entity) {
     throw StarException("Cannot destruct slave entity in WorldStorage, something has gone wrong!");
   if (auto tileEntity = as<TileEntity>(entity))
     m_worldServer->updateTileEntityTiles(tileEntity, true, false);
+  m_worldServer->retireEntityCpuUsage(entity->entityId());
+  // Entities unloaded while asleep must not stay in the sleeping set, it is
+  // already gone from the entity map so this only drops the entry.
+  m_worldServer->wakeEntity(entity->entityId());
   entity->uninit();
 }
 
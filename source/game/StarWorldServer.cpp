@@ -1,5 +1,6 @@
 #include "StarWorldServer.hpp"
 #include "StarLogging.hpp"
+#include "StarProfiler.hpp"
 #include "StarIterator.hpp"
 #include "StarDataStreamExtra.hpp"
 #include "StarBiome.hpp"
@@ -17,6 +18,10 @@
 #include "StarPhysicsEntity.hpp"
 #include "StarProjectile.hpp"
 #include "StarPlayer.hpp"
+#include "StarMonster.hpp"
+#include "StarNpc.hpp"
+#include "StarStagehand.hpp"
+#include "StarVehicle.hpp"
 #include "StarEntityFactory.hpp"
 #include "StarBiomeDatabase.hpp"
 #include "StarLiquidTypes.hpp"
@@ -24,6 +29,7 @@
 #include "StarWarpTargetEntity.hpp"
 #include "StarUniverseSettings.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
+#include "StarPlatformerAStar.hpp"
 
 namespace Star {
 
@@ -34,6 +40,14 @@ EnumMap<WorldServerFidelity> const WorldServerFidelityNames{
   {WorldServerFidelity::High, "high"}
 };
 
+static void addEntityCpuUsageByName(StringMap<WorldServer::EntityCpuUsage>& names, WorldServer::EntityCpuUsage const& usage) {
+  auto& total = names.insert(usage.name, {NullEntityId, usage.name, Vec2F(), 0, 0, 0, 0}).first->second;
+  total.entityCount += usage.entityCount;
+  total.updateTime += usage.updateTime;
+  total.messageTime += usage.messageTime;
+  total.netStateTime += usage.netStateTime;
+}
+
 WorldServer::WorldServer(WorldTemplatePtr const& worldTemplate, IODevicePtr storage) {
   m_worldTemplate = worldTemplate;
   m_worldStorage = make_shared<WorldStorage>(m_worldTemplate->size(), m_worldTemplate->wrapsX(), m_worldTemplate->wrapsY(), storage, make_shared<WorldGenerator>(this));
@@ -472,6 +486,7 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
             connectedEntity->removeNodeConnection({otherWireDirection(disconnectWires->wireNode.direction), connection.nodeIndex}, WireConnection{disconnectWires->entityPosition, disconnectWires->wireNode.nodeIndex});
         }
       }
+      m_wireProcessor->invalidate();
 
     } else if (auto connectWire = as<ConnectWirePacket>(packet)) {
       for (auto source : atTile<WireEntity>(connectWire->inputConnection.entityLocation)) {
@@ -480,6 +495,7 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
           target->addNodeConnection(WireNode{WireDirection::Output, connectWire->outputConnection.nodeIndex}, connectWire->inputConnection);
         }
       }
+      m_wireProcessor->invalidate();
 
     } else if (auto findUniqueEntity = as<FindUniqueEntityPacket>(packet)) {
       clientInfo->outgoingPackets.append(make_shared<FindUniqueEntityResponsePacket>(findUniqueEntity->uniqueEntityId,
@@ -496,7 +512,10 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
         clientInfo->outgoingPackets.append(make_shared<EntityMessageResponsePacket>(makeLeft("Unknown entity"), entityMessagePacket->uuid));
       } else {
         if (entity->isMaster()) {
+          wakeEntity(entity->entityId());
+          int64_t cpuStart = entityCpuStart();
           auto response = entity->receiveMessage(clientId, entityMessagePacket->message, entityMessagePacket->args);
+          chargeEntityCpu(entity, &EntityCpuUsage::messageTime, cpuStart);
           if (response)
             clientInfo->outgoingPackets.append(make_shared<EntityMessageResponsePacket>(makeRight(response.take()), entityMessagePacket->uuid));
           else
@@ -589,6 +608,9 @@ void WorldServer::setExpiryTime(float expiryTime) {
 }
 
 void WorldServer::update(float dt) {
+  ProfileScope tick("WorldServer::update");
+  ProfileScope phase("timers");
+
   m_currentTime += dt;
   ++m_currentStep;
   for (auto const& pair : m_clientInfo)
@@ -605,17 +627,47 @@ void WorldServer::update(float dt) {
   for (auto const& action : triggeredActions)
     action(this);
 
+  phase.next("spawner");
   m_spawner.update(dt);
 
+  phase.next("entities");
   bool doBreakChecks = m_tileEntityBreakCheckTimer.wrapTick(m_currentTime) && m_needsGlobalBreakCheck;
   if (doBreakChecks)
     m_needsGlobalBreakCheck = false;
 
+  // Entities near players are kept awake, so that anything a player does
+  // around them is seen straight away.
+  List<RectF> playerRegions;
+  if (m_entitySleepMaxTime > 0) {
+    for (auto const& pair : m_clientInfo) {
+      if (auto player = get<Player>(pair.second->clientState.playerId()))
+        playerRegions.append(RectF::withCenter(player->position(), Vec2F::filled(m_entitySleepPlayerDistance * 2)));
+    }
+  }
+
+  if (!m_sleepingEntities.empty()) {
+    List<EntityId> woken;
+    for (auto const& pair : m_sleepingEntities) {
+      if (pair.second.wakeTime <= m_currentTime)
+        woken.append(pair.first);
+    }
+    for (auto entityId : woken)
+      wakeEntity(entityId);
+    for (auto const& region : playerRegions)
+      wakeEntities(region);
+  }
+
+  if (m_entityCpuAccounting)
+    m_entityCpuAccountedTime += dt;
+
   List<EntityId> toRemove;
   m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
+      int64_t cpuStart = entityCpuStart();
       entity->update(dt, m_currentStep);
+      chargeEntityCpu(entity, &EntityCpuUsage::updateTime, cpuStart);
 
-      if (auto tileEntity = as<TileEntity>(entity)) {
+      auto tileEntity = as<TileEntity>(entity);
+      if (tileEntity) {
         // Only do break checks on objects if all sectors the object touches
         // *and surrounding sectors* are active.  Objects that this object
         // rests on can be up to an entire sector large in any direction.
@@ -624,19 +676,45 @@ void WorldServer::update(float dt) {
         updateTileEntityTiles(tileEntity);
       }
 
-      if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master)
+      if (entity->entityMode() != EntityMode::Master)
+        return;
+
+      if (entity->shouldDestroy()) {
         toRemove.append(entity->entityId());
+
+      } else if (m_entitySleepMaxTime > 0 && !(tileEntity && m_needsGlobalBreakCheck)) {
+        // Tile entities stay awake until a pending break check has run.
+        if (auto sleepTime = entity->sleepTime()) {
+          RectF bounds = entity->metaBoundBox().translated(entity->position());
+          bool nearPlayer = false;
+          for (auto const& region : playerRegions)
+            nearPlayer = nearPlayer || m_geometry.rectIntersectsRect(region, bounds);
+
+          if (!nearPlayer) {
+            m_entityMap->setSleeping(entity->entityId(), true);
+            m_sleepingEntities[entity->entityId()] = {m_currentTime + min(*sleepTime, m_entitySleepMaxTime), {}};
+          }
+        }
+      }
     }, [](EntityPtr const& a, EntityPtr const& b) {
       return a->entityType() < b->entityType();
     });
 
+  phase.next("scripts");
   for (auto& pair : m_scriptContexts)
     pair.second->update(pair.second->updateDt(dt));
 
+  phase.next("damage");
   updateDamage(dt);
-  if (shouldRunThisStep("wiringUpdate"))
+
+  phase.next("wiring");
+  if (shouldRunThisStep("wiringUpdate")) {
     m_wireProcessor->process();
+    for (auto entityId : m_wireProcessor->pullEvaluatedEntities())
+      wakeEntity(entityId);
+  }
 
+  phase.next("skyAndWeather");
   m_sky->update(dt);
 
   List<RectI> clientWindows;
@@ -652,21 +730,26 @@ void WorldServer::update(float dt) {
   for (auto projectile : m_weather.pullNewProjectiles())
     addEntity(std::move(projectile));
 
+  phase.next("liquids");
   if (shouldRunThisStep("liquidUpdate")) {
     m_liquidEngine->setProcessingLimit(m_fidelityConfig.optUInt("liquidEngineBackgroundProcessingLimit"));
     m_liquidEngine->setNoProcessingLimitRegions(clientMonitoringRegions);
     m_liquidEngine->update();
   }
 
+  phase.next("fallingBlocks");
   if (shouldRunThisStep("fallingBlocksUpdate"))
     m_fallingBlocksAgent->update();
 
+  phase.next("blockDamage");
   if (auto delta = shouldRunThisStep("blockDamageUpdate"))
     updateDamagedBlocks(*delta * dt);
 
+  phase.next("storage");
   if (auto delta = shouldRunThisStep("worldStorageTick"))
     m_worldStorage->tick(*delta * GlobalTimestep, &m_worldId);
 
+  phase.next("generation");
   if (auto delta = shouldRunThisStep("worldStorageGenerate")) {
     m_worldStorage->generateQueue(m_fidelityConfig.optUInt("worldStorageGenerationLevelLimit"), [this](WorldStorage::Sector a, WorldStorage::Sector b) {
         auto distanceToClosestPlayer = [this](WorldStorage::Sector sector) {
@@ -683,9 +766,11 @@ void WorldServer::update(float dt) {
       });
   }
 
+  phase.next("removal");
   for (EntityId entityId : toRemove)
     removeEntity(entityId, true);
 
+  phase.next("packets");
   bool sendRemoteUpdates = m_entityUpdateTimer.wrapTick(dt);
   for (auto const& pair : m_clientInfo) {
     for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap))
@@ -699,7 +784,7 @@ void WorldServer::update(float dt) {
 
   m_expiryTimer.tick(dt);
 
-  LogMap::set(strf("server_{}_entities", m_worldId), strf("{} in {} sectors", m_entityMap->size(), m_tileArray->loadedSectorCount()));
+  LogMap::set(strf("server_{}_entities", m_worldId), strf("{} in {} sectors, {} sleeping", m_entityMap->size(), m_tileArray->loadedSectorCount(), m_entityMap->sleepingCount()));
   LogMap::set(strf("server_{}_time", m_worldId), strf("age = {:4.2f}, day = {:4.2f}/{:4.2f}s", epochTime(), timeOfDay(), dayLength()));
   LogMap::set(strf("server_{}_active_liquid", m_worldId), m_liquidEngine->activeCells());
   LogMap::set(strf("server_{}_lua_mem", m_worldId), m_luaRoot->luaMemoryUsage());
@@ -829,6 +914,14 @@ bool WorldServer::rectTileCollision(RectI const& region, CollisionSet const& col
   return WorldImpl::rectTileCollision(m_tileArray, region, collisionSet);
 }
 
+PlatformerAStar::NavigationCachePtr WorldServer::navigationCache() const {
+  return m_navigationCache;
+}
+
+void WorldServer::forEachCollisionCandidate(List<RectF> const& regions, CollisionCandidateCallback const& callback) const {
+  m_collisionCache->query(regions, callback);
+}
+
 LiquidLevel WorldServer::liquidLevel(Vec2I const& pos) const {
   return m_tileArray->tile(pos).liquid;
 }
@@ -853,6 +946,76 @@ void WorldServer::setSpawningEnabled(bool spawningEnabled) {
   m_spawner.setActive(spawningEnabled);
 }
 
+void WorldServer::wakeEntity(EntityId entityId) {
+  if (m_sleepingEntities.remove(entityId))
+    m_entityMap->setSleeping(entityId, false);
+}
+
+size_t WorldServer::sleepingEntityCount() const {
+  return m_entityMap->sleepingCount();
+}
+
+Maybe<LuaValue> WorldServer::callScriptedEntity(EntityId entityId, String const& function, LuaVariadic<LuaValue> const& args) {
+  auto entity = as<ScriptedEntity>(m_entityMap->entity(entityId));
+  if (!entity || !entity->isMaster())
+    throw WorldServerException::format("Entity {} does not exist or is not a local master scripted entity", entityId);
+
+  wakeEntity(entityId);
+  int64_t cpuStart = entityCpuStart();
+  auto result = entity->callScript(function, args);
+  chargeEntityCpu(entity, &EntityCpuUsage::messageTime, cpuStart);
+  return result;
+}
+
+int64_t WorldServer::EntityCpuUsage::totalTime() const {
+  return updateTime + messageTime + netStateTime;
+}
+
+void WorldServer::setEntityCpuAccounting(bool enabled) {
+  m_entityCpuAccounting = enabled;
+}
+
+bool WorldServer::entityCpuAccounting() const {
+  return m_entityCpuAccounting;
+}
+
+double WorldServer::entityCpuAccountedTime() const {
+  return m_entityCpuAccountedTime;
+}
+
+void WorldServer::resetEntityCpuAccounting() {
+  m_entityCpuAccountedTime = 0;
+  m_entityCpu.clear();
+  m_removedEntityCpu.clear();
+}
+
+List<WorldServer::EntityCpuUsage> WorldServer::topEntityCpuUsage(size_t count, bool byName) const {
+  List<EntityCpuUsage> usage;
+  if (byName) {
+    StringMap<EntityCpuUsage> names = m_removedEntityCpu;
+    for (auto const& pair : m_entityCpu)
+      addEntityCpuUsageByName(names, pair.second);
+    usage = names.values();
+  } else {
+    for (auto const& pair : m_entityCpu) {
+      usage.append(pair.second);
+      if (auto entity = m_entityMap->entity(pair.first))
+        usage.last().position = entity->position();
+    }
+  }
+
+  sortByComputedValue(usage, [](EntityCpuUsage const& u) { return -u.totalTime(); });
+  if (usage.size() > count)
+    usage.resize(count);
+  return usage;
+}
+
+void WorldServer::retireEntityCpuUsage(EntityId entityId) {
+  // Retired entities only count towards their name from now on.
+  if (auto usage = m_entityCpu.maybeTake(entityId))
+    addEntityCpuUsageByName(m_removedEntityCpu, *usage);
+}
+
 void WorldServer::setPropertyListener(String const& propertyName, WorldPropertyListener listener) {
   m_worldPropertyListeners[propertyName] = listener;
 }
@@ -900,6 +1063,7 @@ TileDamageResult WorldServer::damageTiles(List<Vec2I> const& positions, TileLaye
 
         for (auto entity : m_entityMap->entitiesAtTile(entityDamagePos)) {
           if (!damagedEntities.contains(entity)) {
+            wakeEntity(entity->entityId());
             Set<Vec2I> entitySpacesSet;
             for (auto const& space : entity->spaces())
               entitySpacesSet.add(m_geometry.wrap(entity->tilePosition() + space));
@@ -1042,6 +1206,8 @@ ItemDescriptor WorldServer::collectLiquid(List<Vec2I> const& tilePositions, Liqu
         if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
           pair.second->pendingLiquidUpdates.add(pos);
       }
+      m_spawner.liquidModified(pos);
+      wakeEntities(RectF(Vec2F(pos), Vec2F(pos + Vec2I(1, 1))).padded(1));
       m_liquidEngine->visitLocation(pos);
     }
   }
@@ -1292,11 +1458,17 @@ void WorldServer::init(bool firstTime) {
   m_currentTime = 0;
   m_currentStep = 0;
   m_generatingDungeon = false;
+  m_entityCpuAccounting = false;
+  m_entityCpuAccountedTime = 0;
   m_geometry = WorldGeometry(m_worldTemplate->size(),m_worldTemplate->wrapsX(),m_worldTemplate->wrapsY());
   m_entityMap = m_worldStorage->entityMap();
   m_tileArray = m_worldStorage->tileArray();
   m_tileGetterFunction = [&](Vec2I pos) -> ServerTile const& { return m_tileArray->tile(pos); };
   m_damageManager = make_shared<DamageManager>(this, ServerConnectionId);
+  m_navigationCache = make_shared<PlatformerAStar::NavigationCache>(m_geometry);
+  m_collisionCache = make_shared<CollisionCache>(m_geometry, [this](RectI const& region, auto const& iterator) {
+      forEachCollisionBlock(region, iterator);
+    });
   m_wireProcessor = make_shared<WireProcessor>(m_worldStorage);
   m_luaRoot = make_shared<LuaRoot>();
   m_luaRoot->luaEngine().setNullTerminated(false);
@@ -1314,6 +1486,8 @@ void WorldServer::init(bool firstTime) {
 
   m_entityUpdateTimer = GameTimer(m_serverConfig.query("interpolationSettings.normal").getFloat("entityUpdateDelta") / 60.f);
   m_tileEntityBreakCheckTimer = GameTimer(m_serverConfig.getFloat("tileEntityBreakCheckInterval"));
+  m_entitySleepMaxTime = m_serverConfig.getFloat("entitySleepMaxTime", 10.0f);
+  m_entitySleepPlayerDistance = m_serverConfig.getFloat("entitySleepPlayerDistance", 50.0f);
 
   m_liquidEngine = make_shared<LiquidCellEngine<LiquidId>>(liquidsDatabase->liquidEngineParameters(), make_shared<LiquidWorld>(this));
   for (auto liquidSettings : liquidsDatabase->allLiquidSettings())
@@ -1538,6 +1712,9 @@ void WorldServer::updateTileEntityTiles(TileEntityPtr const& entity, bool removi
   // for and maybe we shouldn't allow tile entity configurations to specify
   // material spaces outside of their spaces
 
+  if (m_wireProcessor && (removing || !m_tileEntitySpaces.contains(entity->entityId())) && is<WireEntity>(entity))
+    m_wireProcessor->invalidate();
+
   auto& spaces = m_tileEntitySpaces[entity->entityId()];
 
   List<MaterialSpace> newMaterialSpaces = removing ? List<MaterialSpace>() : entity->materialSpaces();
@@ -1733,6 +1910,8 @@ void WorldServer::setLiquid(Vec2I const& pos, LiquidId liquid, float level, floa
         if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
           pair.second->pendingLiquidUpdates.add(pos);
       }
+      m_spawner.liquidModified(pos);
+      wakeEntities(RectF(Vec2F(pos), Vec2F(pos + Vec2I(1, 1))).padded(1));
     }
   }
 }
@@ -1870,14 +2049,20 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdat
   }
   clientInfo->pendingLiquidUpdates.clear();
 
-  HashSet<EntityPtr> monitoredEntities;
+  // Nothing is added to or removed from the entity map below, so the entities
+  // can be referred to in place rather than copied.
+  List<RectF> monitoredRegions;
   for (auto const& monitoredRegion : clientInfo->monitoringRegions(m_entityMap))
-    monitoredEntities.addAll(m_entityMap->entityQuery(RectF(monitoredRegion)));
+    monitoredRegions.append(RectF(monitoredRegion));
+  List<EntityPtr const*> monitoredEntities;
+  m_entityMap->forEachEntity(monitoredRegions, [&](EntityPtr const& entity) {
+      monitoredEntities.append(&entity);
+    });
 
   auto entityFactory = Root::singleton().entityFactory();
   auto outOfMonitoredRegionsEntities = HashSet<EntityId>::from(clientInfo->clientSlavesNetVersion.keys());
-  for (auto const& monitoredEntity : monitoredEntities)
-    outOfMonitoredRegionsEntities.remove(monitoredEntity->entityId());
+  for (auto monitoredEntity : monitoredEntities)
+    outOfMonitoredRegionsEntities.remove((*monitoredEntity)->entityId());
   for (auto entityId : outOfMonitoredRegionsEntities) {
     clientInfo->outgoingPackets.append(make_shared<EntityDestroyPacket>(entityId, ByteArray(), false));
     clientInfo->clientSlavesNetVersion.remove(entityId);
@@ -1891,26 +2076,43 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdat
       updateSetPackets.add(p.first, make_shared<EntityUpdateSetPacket>(p.first));
   }
 
-  for (auto const& monitoredEntity : monitoredEntities) {
+  for (auto monitoredEntityPtr : monitoredEntities) {
+    auto const& monitoredEntity = *monitoredEntityPtr;
     EntityId entityId = monitoredEntity->entityId();
     ConnectionId connectionId = connectionForEntity(entityId);
     if (connectionId != clientId) {
       auto netRules = clientInfo->clientState.netCompatibilityRules();
       if (auto version = clientInfo->clientSlavesNetVersion.ptr(entityId)) {
         if (auto updateSetPacket = updateSetPackets.value(connectionId)) {
+          // A sleeping entity does not change, so once a client has its
+          // latest state there is nothing more to write.
+          EntitySleep* sleep = nullptr;
+          if (m_entityMap->isSleeping(entityId)) {
+            sleep = m_sleepingEntities.ptr(entityId);
+            if (sleep && sleep->netVersion == *version)
+              continue;
+          }
+
           auto pair = make_pair(entityId, *version);
           auto& cache = m_netStateCache[netRules];
           auto i = cache.find(pair);
-          if (i == cache.end())
+          if (i == cache.end()) {
+            int64_t cpuStart = entityCpuStart();
             i = cache.insert(pair, monitoredEntity->writeNetState(*version, netRules)).first;
+            chargeEntityCpu(monitoredEntity, &EntityCpuUsage::netStateTime, cpuStart);
+          }
           const auto& netState = i->second;
           if (!netState.first.empty())
             updateSetPacket->deltas[entityId] = netState.first;
           *version = netState.second;
+          if (sleep)
+            sleep->netVersion = netState.second;
         }
       } else if (!monitoredEntity->masterOnly()) {
         // Client was unaware of this entity until now
+        int64_t cpuStart = entityCpuStart();
         auto firstUpdate = monitoredEntity->writeNetState(0, netRules);
+        chargeEntityCpu(monitoredEntity, &EntityCpuUsage::netStateTime, cpuStart);
         clientInfo->clientSlavesNetVersion.add(entityId, firstUpdate.second);
         clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(monitoredEntity->entityType(),
               entityFactory->netStoreEntity(monitoredEntity, netRules), std::move(firstUpdate.first), entityId));
@@ -1925,8 +2127,9 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdat
 void WorldServer::updateDamage(float dt) {
   m_damageManager->update(dt);
 
-  // Do nothing with damage notifications at the moment.
-  m_damageManager->pullPendingNotifications();
+  // Damage notifications are only used to wake the entities that were hit.
+  for (auto const& notification : m_damageManager->pullPendingNotifications())
+    wakeEntity(notification.targetEntityId);
 
   for (auto const& remoteHitRequest : m_damageManager->pullRemoteHitRequests())
     m_clientInfo.get(remoteHitRequest.destinationConnection())
@@ -2021,11 +2224,57 @@ void WorldServer::checkEntityBreaks(RectF const& rect) {
     tileEntity->checkBroken();
 }
 
+void WorldServer::wakeEntities(RectF const& region) {
+  if (m_sleepingEntities.empty())
+    return;
+  m_entityMap->forEachEntity(region, [&](EntityPtr const& entity) {
+      wakeEntity(entity->entityId());
+    });
+}
+
+int64_t WorldServer::entityCpuStart() const {
+  return m_entityCpuAccounting ? Time::monotonicMicroseconds() : 0;
+}
+
+void WorldServer::chargeEntityCpu(EntityPtr const& entity, int64_t EntityCpuUsage::*time, int64_t start) {
+  if (!m_entityCpuAccounting)
+    return;
+  int64_t elapsed = Time::monotonicMicroseconds() - start;
+
+  auto i = m_entityCpu.find(entity->entityId());
+  if (i == m_entityCpu.end()) {
+    String name;
+    if (auto object = as<Object>(entity))
+      name = object->name();
+    else if (auto monster = as<Monster>(entity))
+      name = monster->typeName();
+    else if (auto npc = as<Npc>(entity))
+      name = npc->npcType();
+    else if (auto projectile = as<Projectile>(entity))
+      name = projectile->typeName();
+    else if (auto stagehand = as<Stagehand>(entity))
+      name = stagehand->typeName();
+    else if (auto vehicle = as<Vehicle>(entity))
+      name = vehicle->name();
+    else if (auto itemDrop = as<ItemDrop>(entity))
+      name = itemDrop->item()->name();
+    else if (auto player = as<Player>(entity))
+      name = player->name();
+
+    String typeName = EntityTypeNames.getRight(entity->entityType());
+    name = name.empty() ? typeName : strf("{}:{}", typeName, name);
+    i = m_entityCpu.insert(entity->entityId(), {entity->entityId(), std::move(name), Vec2F(), 1, 0, 0, 0}).first;
+  }
+  i->second.*time += elapsed;
+}
+
 void WorldServer::queueTileUpdates(Vec2I const& pos) {
   for (auto const& pair : m_clientInfo) {
     if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
       pair.second->pendingTileUpdates.add(pos);
   }
+  m_spawner.tileModified(pos);
+  wakeEntities(RectF(Vec2F(pos), Vec2F(pos + Vec2I(1, 1))).padded(1));
 }
 
 void WorldServer::queueTileDamageUpdates(Vec2I const& pos, TileLayer layer) {
@@ -2062,6 +2311,19 @@ void WorldServer::dirtyCollision(RectI const& region) {
         tile->collisionCacheDirty = true;
     }
   }
+
+  invalidateCachedGeometry(dirtyRegion);
+}
+
+void WorldServer::invalidateCachedGeometry(RectI const& region) {
+  if (m_collisionCache)
+    m_collisionCache->invalidate(region);
+  if (m_navigationCache)
+    m_navigationCache->invalidate(region);
+}
+
+void WorldServer::invalidateSpawnCells(RectI const& region) {
+  m_spawner.regionModified(region);
 }
 
 void WorldServer::freshenCollision(RectI const& region) {
@@ -2112,6 +2374,9 @@ void WorldServer::removeEntity(EntityId entityId, bool andDie) {
     }
   }
 
+  retireEntityCpuUsage(entityId);
+
+  m_sleepingEntities.remove(entityId);
   m_entityMap->removeEntity(entityId);
   entity->uninit();
 }
@@ -2266,7 +2531,11 @@ RpcPromise<Json> WorldServer::sendEntityMessage(Variant<EntityId, String> const&
   if (!entity) {
     return RpcPromise<Json>::createFailed("Unknown entity");
   } else if (entity->isMaster()) {
-    if (auto resp = entity->receiveMessage(ServerConnectionId, message, args))
+    wakeEntity(entity->entityId());
+    int64_t cpuStart = entityCpuStart();
+    auto resp = entity->receiveMessage(ServerConnectionId, message, args);
+    chargeEntityCpu(entity, &EntityCpuUsage::messageTime, cpuStart);
+    if (resp)
       return RpcPromise<Json>::createFulfilled(resp.take());
     else
       return RpcPromise<Json>::createFailed("Message not handled by entity");
@@ -2454,8 +2723,10 @@ bool WorldServer::canReachEntity(Vec2F const& position, float radius, EntityId t
 }
 
 RpcPromise<InteractAction> WorldServer::interact(InteractRequest const& request) {
-  if (auto entity = as<InteractiveEntity>(m_entityMap->entity(request.targetId)))
+  if (auto entity = as<InteractiveEntity>(m_entityMap->entity(request.targetId))) {
+    wakeEntity(request.targetId);
     return RpcPromise<InteractAction>::createFulfilled(entity->interact(request));
+  }
   else
     return RpcPromise<InteractAction>::createFulfilled(InteractAction());
 }
@@ -3,6 +3,7 @@
 #include "StarWorld.hpp"
 #include "StarWorldClientState.hpp"
 #include "StarCollisionGenerator.hpp"
+#include "StarCollisionCache.hpp"
 #include "StarSpawner.hpp"
 #include "StarNetPackets.hpp"
 #include "StarCellularLighting.hpp"
@@ -154,6 +155,8 @@ public:
   Maybe<pair<Vec2F, Vec2I>> lineTileCollisionPoint(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
   List<Vec2I> collidingTilesAlongLine(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet, int maxSize = -1, bool includeEdges = true) const override;
   bool rectTileCollision(RectI const& region, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
+  PlatformerAStar::NavigationCachePtr navigationCache() const override;
+  void forEachCollisionCandidate(List<RectF> const& regions, CollisionCandidateCallback const& callback) const override;
   TileDamageResult damageTiles(List<Vec2I> const& pos, TileLayer layer, Vec2F const& sourcePosition, TileDamage const& tileDamage, Maybe<EntityId> sourceEntity = {}) override;
   InteractiveEntityPtr getInteractiveInRange(Vec2F const& targetPosition, Vec2F const& sourcePosition, float maxRange) const override;
   bool canReachEntity(Vec2F const& position, float radius, EntityId targetEntity, bool preferInteractive = true) const override;
@@ -224,6 +227,14 @@ public:
 
   bool isVisibleToPlayer(RectF const& region) const;
   void activateLiquidRegion(RectI const& region);
+  // Drops the cached collision geometry and navigation data around the given
+  // region, for tile changes that happen without dirtying collision, such as
+  // sector generation and loading.
+  void invalidateCachedGeometry(RectI const& region);
+  // Drops the spawner's tile counts for cells that can see the given region,
+  // for tile writes that bypass queueTileUpdates, such as sector generation,
+  // loading and terraforming.
+  void invalidateSpawnCells(RectI const& region);
   void activateLiquidLocation(Vec2I const& location);
 
   // if blocks cascade, we'll need to do a break check across all tile entities
@@ -232,6 +243,50 @@ public:
 
   void setSpawningEnabled(bool spawningEnabled);
 
+  // Master entities that report a sleepTime are put to sleep when no player is
+  // near them, and are then not updated and not asked for net state.  Must be
+  // called on a sleeping entity before anything changes it other than the
+  // messages, interaction, wiring, damage, tile and liquid changes the world
+  // already wakes entities for.
+  void wakeEntity(EntityId entityId);
+  size_t sleepingEntityCount() const;
+
+  // Calls a function in the script of a master scripted entity directly, as
+  // world.callScriptedEntity does.  Wakes the entity and charges the time to
+  // its message time.
+  Maybe<LuaValue> callScriptedEntity(EntityId entityId, String const& function, LuaVariadic<LuaValue> const& args);
+
+  // Time spent on each entity, in microseconds, either for a single entity or
+  // for every entity with the same name.  Names are the entity type and
+  // config name, such as "monster:poptop" or "object:wiredlight".
+  struct EntityCpuUsage {
+    int64_t totalTime() const;
+
+    EntityId entityId;
+    String name;
+    Vec2F position;
+    size_t entityCount;
+    int64_t updateTime;
+    int64_t messageTime;
+    int64_t netStateTime;
+  };
+
+  // Accounting of the time spent updating entities, handling messages sent to
+  // them and writing their net state.  Off by default, as it reads the clock
+  // several times for every entity every tick.
+  void setEntityCpuAccounting(bool enabled);
+  bool entityCpuAccounting() const;
+  // Seconds of world time that entity usage has been accounted for.
+  double entityCpuAccountedTime() const;
+  void resetEntityCpuAccounting();
+  // The 'count' entities, or names if 'byName' is set, that have used the
+  // most time since accounting was last reset, highest first.  Entities that
+  // have since been removed only count towards their names.
+  List<EntityCpuUsage> topEntityCpuUsage(size_t count, bool byName) const;
+  // Folds the usage of an entity leaving the world into the totals for its
+  // name, whether it was removed or unloaded with its sector.
+  void retireEntityCpuUsage(EntityId entityId);
+
   void setPropertyListener(String const& propertyName, WorldPropertyListener listener);
 
   // Write all active sectors to disk without unloading them
@@ -324,6 +379,8 @@ private:
 
   // Check for any newly broken entities in this rect
   void checkEntityBreaks(RectF const& rect);
+  // Wakes every sleeping entity whose bound box touches the given region.
+  void wakeEntities(RectF const& region);
   // Push modified tile data to each client.
   void queueTileUpdates(Vec2I const& pos);
   void queueTileDamageUpdates(Vec2I const& pos, TileLayer layer);
@@ -365,6 +422,8 @@ private:
 
   HashSet<Vec2I> m_damagedBlocks;
   DamageManagerPtr m_damageManager;
+  PlatformerAStar::NavigationCachePtr m_navigationCache;
+  CollisionCachePtr m_collisionCache;
   WireProcessorPtr m_wireProcessor;
   LuaRootPtr m_luaRoot;
 
@@ -398,6 +457,26 @@ private:
 
   List<pair<float, WorldAction>> m_timers;
 
+  struct EntitySleep {
+    // m_currentTime at which the entity must be woken.
+    double wakeTime;
+    // The net version last written for the entity while asleep, clients
+    // already at this version have nothing to be sent.
+    Maybe<uint64_t> netVersion;
+  };
+  HashMap<EntityId, EntitySleep> m_sleepingEntities;
+  float m_entitySleepMaxTime;
+  float m_entitySleepPlayerDistance;
+
+  // Returns the time to charge an entity from, if entity usage is accounted.
+  int64_t entityCpuStart() const;
+  void chargeEntityCpu(EntityPtr const& entity, int64_t EntityCpuUsage::*time, int64_t start);
+
+  bool m_entityCpuAccounting;
+  double m_entityCpuAccountedTime;
+  HashMap<EntityId, EntityCpuUsage> m_entityCpu;
+  StringMap<EntityCpuUsage> m_removedEntityCpu;
+
   bool m_needsGlobalBreakCheck;
 
   bool m_generatingDungeon;
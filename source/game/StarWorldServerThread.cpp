@@ -3,11 +3,25 @@
 #include "StarNpc.hpp"
 #include "StarRoot.hpp"
 #include "StarLogging.hpp"
+#include "StarProfiler.hpp"
+#include "StarMemoryTracker.hpp"
 #include "StarAssets.hpp"
 #include "StarPlayer.hpp"
 
 namespace Star {
 
+// Worlds are tagged by kind rather than individually, as memory tags are
+// never released and a server may load any number of worlds over its life.
+static String memoryTagName(WorldId const& worldId) {
+  if (worldId.is<CelestialWorldId>())
+    return "world celestial";
+  if (worldId.is<ClientShipWorldId>())
+    return "world ship";
+  if (auto instanceWorldId = worldId.ptr<InstanceWorldId>())
+    return strf("world instance:{}", instanceWorldId->instance);
+  return "world";
+}
+
 WorldServerThread::WorldServerThread(WorldServerPtr server, WorldId worldId)
   : Thread("WorldServerThread: " + printWorldId(worldId)),
     m_worldServer(std::move(server)),
@@ -194,6 +208,9 @@ WorldChunks WorldServerThread::readChunks() {
 
 void WorldServerThread::run() {
   try {
+    Profiler::setThreadGroup(strf("world {}", m_worldId));
+    MemoryTracker::setCurrentTag(MemoryTracker::tag(memoryTagName(m_worldId)));
+
     auto& root = Root::singleton();
     double updateMeasureWindow = root.assets()->json("/universe_server.config:updateMeasureWindow").toDouble();
     double fidelityDecrementScore = root.assets()->json("/universe_server.config:fidelityDecrementScore").toDouble();
@@ -221,6 +238,7 @@ void WorldServerThread::run() {
       tickApproacher.tick();
 
       if (storageTimer.timeUp()) {
+        ProfileScope phase("WorldServerThread::sync");
         sync();
         storageTimer.restart(storageInterval);
       }
@@ -252,6 +270,8 @@ void WorldServerThread::run() {
 
 void WorldServerThread::update(WorldServerFidelity fidelity) {
   RecursiveMutexLocker locker(m_mutex);
+  ProfileScope tick("WorldServerThread::update");
+  ProfileScope phase("incomingPackets");
   auto unerroredClientIds = m_worldServer->clientIds();
   for (auto clientId : unerroredClientIds) {
     RecursiveMutexLocker queueLocker(m_queueMutex);
@@ -268,11 +288,13 @@ void WorldServerThread::update(WorldServerFidelity fidelity) {
     }
   }
 
+  phase.next("worldUpdate");
   float dt = ServerGlobalTimestep * GlobalTimescale;
   m_worldServer->setFidelity(fidelity);
   if (dt > 0.0f && (!m_pause || *m_pause == false))
     m_worldServer->update(dt);
 
+  phase.next("messages");
   List<Message> messages;
   {
     RecursiveMutexLocker locker(m_messageMutex);
@@ -285,6 +307,7 @@ void WorldServerThread::update(WorldServerFidelity fidelity) {
       message.promise.fail("Message not handled by world");
   }
 
+  phase.next("outgoingPackets");
   for (auto& clientId : unerroredClientIds) {
     auto outgoingPackets = m_worldServer->getOutgoingPackets(clientId);
     RecursiveMutexLocker queueLocker(m_queueMutex);
@@ -114,6 +114,10 @@ Maybe<Json> Entity::receiveMessage(ConnectionId, String const&, JsonArray const&
 
 void Entity::update(float, uint64_t) {}
 
+Maybe<float> Entity::sleepTime() const {
+  return {};
+}
+
 void Entity::render(RenderCallback*) {}
 
 void Entity::renderLightSources(RenderCallback*) {}
@@ -151,6 +151,15 @@ public:
 
   virtual void update(float dt, uint64_t currentStep);
 
+  // Master entities that have nothing to do until something happens to them
+  // can say so here, and the world may then stop updating them and writing
+  // their net state.  Returns the longest time the entity may go without an
+  // update, or nothing if it needs updating every step.  Sleeping entities
+  // are woken early by messages, interaction, wiring, damage, nearby tile and
+  // liquid changes and nearby players, so entities should only sleep while
+  // nothing else can change them.  Default returns nothing.
+  virtual Maybe<float> sleepTime() const;
+
   virtual void render(RenderCallback* renderer);
 
   virtual void renderLightSources(RenderCallback* renderer);
@@ -6,6 +6,7 @@
 namespace Star {
 
 STAR_CLASS(ScriptedEntity);
+STAR_STRUCT(LuaUpdateStatistics);
 
 // All ScriptedEntity methods should only be called on master entities
 class ScriptedEntity : public virtual Entity {
@@ -17,6 +18,14 @@ public:
   // Execute the given code directly in the underlying context, return nothing
   // on failure.
   virtual Maybe<LuaValue> evalScript(String const& code) = 0;
+
+  // Statistics of sliced script updates, for entities whose scripts can be
+  // update sliced.
+  virtual LuaUpdateStatistics const* scriptUpdateStatistics() const;
 };
 
+inline LuaUpdateStatistics const* ScriptedEntity::scriptUpdateStatistics() const {
+  return nullptr;
+}
+
 }
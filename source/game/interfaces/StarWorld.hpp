@@ -15,6 +15,10 @@ STAR_CLASS(World);
 STAR_CLASS(TileEntity);
 STAR_CLASS(ScriptedEntity);
 
+namespace PlatformerAStar {
+  STAR_CLASS(NavigationCache);
+}
+
 typedef function<void(World*)> WorldAction;
 
 class World {
@@ -104,6 +108,15 @@ public:
   // Returns whether the given rect contains any colliding tiles.
   virtual bool rectTileCollision(RectI const& region, CollisionSet const& collisionSet = DefaultCollisionSet) const = 0;
 
+  // Path finding state shared by every PlatformerAStar::PathFinder in this
+  // world, may be null if the world is not initialized.
+  virtual PlatformerAStar::NavigationCachePtr navigationCache() const = 0;
+
+  // Batch collision query: finds every non-empty collision block whose poly
+  // intersects each of the given regions, from collision geometry cached per
+  // sector rather than by visiting every tile.
+  virtual void forEachCollisionCandidate(List<RectF> const& regions, CollisionCandidateCallback const& callback) const = 0;
+
   // Damage multiple tiles, avoiding duplication (objects or plants that occupy
   // more than one tile
   // position are only damaged once)
@@ -108,6 +108,12 @@ void ContainerObject::update(float dt, uint64_t currentStep) {
   }
 }
 
+Maybe<float> ContainerObject::sleepTime() const {
+  // Scripts on the master side move items in and out directly, without
+  // anything that would wake a sleeping container.
+  return {};
+}
+
 void ContainerObject::render(RenderCallback* renderCallback) {
   auto assets = Root::singleton().assets();
 
@@ -57,6 +57,22 @@ void FarmableObject::update(float dt, uint64_t currentStep) {
   }
 }
 
+Maybe<float> FarmableObject::sleepTime() const {
+  auto sleepTime = Object::sleepTime();
+  if (!sleepTime || m_nextStageTime == 0)
+    return {};
+
+  // The immersion window only stops changing once it is full of the current
+  // fill level, and liquid changes wake the farmable.
+  if (m_immersion.currentMin != m_immersion.currentMax || m_immersion.currentMax != liquidFillLevel())
+    return {};
+
+  // Stages are entered by epoch time, so waking for the next one is enough.
+  if (m_finalStage)
+    return sleepTime;
+  return min<float>(*sleepTime, m_nextStageTime - world()->epochTime());
+}
+
 bool FarmableObject::damageTiles(List<Vec2I> const& position, Vec2F const& sourcePosition, TileDamage const& tileDamage) {
   if ((tileDamage.type != TileDamageType::Beamish && tileDamage.type != TileDamageType::Blockish && tileDamage.type != TileDamageType::Plantish) || !harvest())
     return Object::damageTiles(position, sourcePosition, tileDamage);
@@ -7,6 +7,16 @@
 
 namespace Star {
 
+Json LuaUpdateStatistics::toJson() const {
+  return JsonObject{
+    {"updates", updates},
+    {"slicedUpdates", slicedUpdates},
+    {"slices", slices},
+    {"maxSlices", maxSlices},
+    {"abandonedUpdates", abandonedUpdates}
+  };
+}
+
 LuaBaseComponent::LuaBaseComponent() {
   addCallbacks("sb", LuaBindings::makeUtilityCallbacks());
   addCallbacks("root", LuaBindings::makeRootCallbacks());
@@ -5,6 +5,7 @@
 #include "StarListener.hpp"
 #include "StarWorld.hpp"
 #include "StarWorldLuaBindings.hpp"
+#include "StarLuaRoot.hpp"
 
 namespace Star {
 
@@ -125,10 +126,41 @@ private:
   JsonObject m_storage;
 };
 
+// Counters for sliced script updates, to find scripts that regularly run over
+// their instruction budget.
+struct LuaUpdateStatistics {
+  Json toJson() const;
+
+  // Updates that ran to completion
+  uint64_t updates = 0;
+  // Completed updates that needed more than one slice
+  uint64_t slicedUpdates = 0;
+  // Total number of resumes of update threads
+  uint64_t slices = 0;
+  // Most slices taken by any single update
+  unsigned maxSlices = 0;
+  // Updates that were dropped for running over the slice limit
+  uint64_t abandonedUpdates = 0;
+};
+
 // Wraps a basic lua component with an 'update' method and an embedded tick
 // rate.  Every call to 'update' here will only call the internal script
 // 'update' at the configured delta.  Adds a update tick controls under the
 // 'script' callback table.
+//
+// If update slicing is enabled, the script 'update' runs inside a LuaThread
+// which is yielded once it spends its instruction budget.  While an update is
+// in progress, calls to 'update' resume it rather than starting a new one (the
+// arguments of the original call are the ones the script sees).  If an update
+// does not finish within the maximum number of slices, it is abandoned and
+// the update delta of the script is doubled to throttle it.
+//
+// A suspended update does not lock the context.  Message handlers, interact
+// and damage callbacks and any other invoke still run in the same context
+// between slices, and see whatever state the update has only partly changed,
+// so only scripts that tolerate this should be update sliced.  Entities opt
+// their scripts in through their 'scriptUpdateSlicing' config, see
+// LuaRoot::updateSlicing.
 template <typename Base>
 class LuaUpdatableComponent : public Base {
 public:
@@ -146,9 +178,30 @@ public:
   template <typename Ret = LuaValue, typename... V>
   Maybe<Ret> update(V&&... args);
 
+  LuaUpdateSlicing const& updateSlicing() const;
+  void setUpdateSlicing(LuaUpdateSlicing updateSlicing);
+
+  // Returns true if a sliced update has yielded and will be resumed on the
+  // next call to 'update'.
+  bool updateInProgress() const;
+
+  LuaUpdateStatistics const& updateStatistics() const;
+
+protected:
+  virtual void contextShutdown() override;
+
 private:
+  template <typename Ret, typename... V>
+  Maybe<Ret> resumeUpdate(V&&... args);
+  void abandonUpdate();
+
   Periodic m_updatePeriodic;
   mutable float m_lastDt;
+
+  LuaUpdateSlicing m_updateSlicing;
+  Maybe<LuaThread> m_updateThread;
+  unsigned m_updateSlices;
+  LuaUpdateStatistics m_updateStatistics;
 };
 
 // Wraps a basic lua component so that world callbacks are added on init, and
@@ -249,6 +302,7 @@ void LuaStorableComponent<Base>::contextShutdown() {
 template <typename Base>
 LuaUpdatableComponent<Base>::LuaUpdatableComponent() {
   m_updatePeriodic.setStepCount(1);
+  m_updateSlices = 0;
 
   LuaCallbacks scriptCallbacks;
   scriptCallbacks.registerCallback("updateDt", [this]() {
@@ -292,10 +346,107 @@ bool LuaUpdatableComponent<Base>::updateReady() const {
 template <typename Base>
 template <typename Ret, typename... V>
 Maybe<Ret> LuaUpdatableComponent<Base>::update(V&&... args) {
+  if (m_updateThread)
+    return resumeUpdate<Ret>();
+
   if (!m_updatePeriodic.tick())
     return {};
 
-  return Base::template invoke<Ret>("update", std::forward<V>(args)...);
+  if (m_updateSlicing.instructionBudget == 0)
+    return Base::template invoke<Ret>("update", std::forward<V>(args)...);
+
+  if (!Base::checkInitialization())
+    return {};
+
+  try {
+    auto& context = *Base::context();
+    auto method = context.getPath("update");
+    if (method == LuaNil)
+      return {};
+    LuaThread thread = context.engine().createThread();
+    thread.pushFunction(context.template luaTo<LuaFunction>(std::move(method)));
+    m_updateThread = std::move(thread);
+    m_updateSlices = 0;
+  } catch (LuaException const& e) {
+    Logger::error("Exception while invoking lua function 'update'. {}", outputException(e, true));
+    Base::setError(printException(e, false));
+    return {};
+  }
+
+  return resumeUpdate<Ret>(std::forward<V>(args)...);
+}
+
+template <typename Base>
+LuaUpdateSlicing const& LuaUpdatableComponent<Base>::updateSlicing() const {
+  return m_updateSlicing;
+}
+
+template <typename Base>
+void LuaUpdatableComponent<Base>::setUpdateSlicing(LuaUpdateSlicing updateSlicing) {
+  m_updateSlicing = std::move(updateSlicing);
+}
+
+template <typename Base>
+bool LuaUpdatableComponent<Base>::updateInProgress() const {
+  return m_updateThread.isValid();
+}
+
+template <typename Base>
+LuaUpdateStatistics const& LuaUpdatableComponent<Base>::updateStatistics() const {
+  return m_updateStatistics;
+}
+
+template <typename Base>
+void LuaUpdatableComponent<Base>::contextShutdown() {
+  m_updateThread.reset();
+  Base::contextShutdown();
+}
+
+template <typename Base>
+template <typename Ret, typename... V>
+Maybe<Ret> LuaUpdatableComponent<Base>::resumeUpdate(V&&... args) {
+  // Resuming may re-enter this component through callbacks, so the thread is
+  // held locally until the slice is finished.
+  LuaThread thread = *m_updateThread;
+  Maybe<Ret> result;
+  try {
+    result = thread.template resumeBudgeted<Ret>(m_updateSlicing.instructionBudget, std::forward<V>(args)...);
+  } catch (LuaException const& e) {
+    m_updateThread.reset();
+    Logger::error("Exception while invoking lua function 'update'. {}", outputException(e, true));
+    Base::setError(printException(e, false));
+    return {};
+  }
+
+  ++m_updateSlices;
+  ++m_updateStatistics.slices;
+
+  if (thread.status() == LuaThread::Status::Active) {
+    if (m_updateSlicing.maxSlices != 0 && m_updateSlices >= m_updateSlicing.maxSlices)
+      abandonUpdate();
+    return {};
+  }
+
+  m_updateThread.reset();
+  ++m_updateStatistics.updates;
+  if (m_updateSlices > 1)
+    ++m_updateStatistics.slicedUpdates;
+  m_updateStatistics.maxSlices = max(m_updateStatistics.maxSlices, m_updateSlices);
+  return result;
+}
+
+template <typename Base>
+void LuaUpdatableComponent<Base>::abandonUpdate() {
+  m_updateThread.reset();
+  ++m_updateStatistics.abandonedUpdates;
+  m_updateStatistics.maxSlices = max(m_updateStatistics.maxSlices, m_updateSlices);
+
+  unsigned delta = updateDelta();
+  if (delta < m_updateSlicing.maxUpdateDelta)
+    setUpdateDelta(min(max(delta, 1u) * 2, m_updateSlicing.maxUpdateDelta));
+
+  Logger::warn("Lua update for scripts [{}] did not finish within {} slices, abandoning update and throttling update delta to {}",
+      Base::scripts().join(", "), m_updateSlices, updateDelta());
 }
 
 template <typename Base>
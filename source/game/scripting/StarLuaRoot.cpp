@@ -3,6 +3,17 @@
 
 namespace Star {
 
+LuaUpdateSlicing::LuaUpdateSlicing()
+  : instructionBudget(0), maxSlices(0), maxUpdateDelta(0) {}
+
+LuaUpdateSlicing::LuaUpdateSlicing(Json const& config) : LuaUpdateSlicing() {
+  if (config.isNull())
+    return;
+  instructionBudget = config.getUInt("instructionBudget", 0);
+  maxSlices = config.getUInt("maxSlices", 0);
+  maxUpdateDelta = config.getUInt("maxUpdateDelta", 0);
+}
+
 LuaRoot::LuaRoot() {
   auto& root = Root::singleton();
   m_scriptCache = make_shared<ScriptCache>();
@@ -44,6 +55,7 @@ void LuaRoot::restart() {
   m_luaEngine->setInstructionLimit(root.configuration()->get("scriptInstructionLimit").toUInt());
   m_luaEngine->setProfilingEnabled(root.configuration()->get("scriptProfilingEnabled").toBool());
   m_luaEngine->setInstructionMeasureInterval(root.configuration()->get("scriptInstructionMeasureInterval").toUInt());
+  m_updateSlicing = LuaUpdateSlicing(root.configuration()->get("scriptUpdateSlicing"));
 }
 
 void LuaRoot::shutdown() {
@@ -156,6 +168,20 @@ LuaEngine& LuaRoot::luaEngine() const {
   return *m_luaEngine;
 }
 
+LuaUpdateSlicing LuaRoot::updateSlicing(Json const& scriptUpdateSlicing) const {
+  if (scriptUpdateSlicing.isType(Json::Type::Bool))
+    return scriptUpdateSlicing.toBool() ? m_updateSlicing : LuaUpdateSlicing();
+
+  if (!scriptUpdateSlicing.isType(Json::Type::Object))
+    return {};
+
+  LuaUpdateSlicing updateSlicing = m_updateSlicing;
+  updateSlicing.instructionBudget = scriptUpdateSlicing.getUInt("instructionBudget", updateSlicing.instructionBudget);
+  updateSlicing.maxSlices = scriptUpdateSlicing.getUInt("maxSlices", updateSlicing.maxSlices);
+  updateSlicing.maxUpdateDelta = scriptUpdateSlicing.getUInt("maxUpdateDelta", updateSlicing.maxUpdateDelta);
+  return updateSlicing;
+}
+
 void LuaRoot::ScriptCache::loadScript(LuaEngine& engine, String const& assetPath) {
   auto assets = Root::singleton().assets();
   RecursiveMutexLocker locker(mutex);
@@ -8,6 +8,22 @@ namespace Star {
 
 STAR_CLASS(LuaRoot);
 
+// Controls running script updates as time sliced lua threads, see
+// LuaUpdatableComponent.  An instructionBudget of 0 disables slicing.
+struct LuaUpdateSlicing {
+  LuaUpdateSlicing();
+  explicit LuaUpdateSlicing(Json const& config);
+
+  // Instructions an update may run for per tick before being yielded.
+  uint64_t instructionBudget;
+  // Number of ticks an update may be spread across before it is abandoned, 0
+  // for no limit.
+  unsigned maxSlices;
+  // Scripts that have updates abandoned have their update delta doubled, up
+  // to this value.
+  unsigned maxUpdateDelta;
+};
+
 // Loads and caches lua scripts from assets.  Automatically clears cache on
 // root reload.  Uses an internal LuaEngine, so this and all contexts are meant
 // for single threaded access and have no locking.
@@ -44,6 +60,13 @@ public:
   void addCallbacks(String const& groupName, LuaCallbacks const& callbacks);
 
   LuaEngine& luaEngine() const;
+
+  // Update slicing settings for a script, given the 'scriptUpdateSlicing'
+  // value of the entity that runs it.  Scripts are only sliced if they opt in,
+  // either with true to use the 'scriptUpdateSlicing' configuration, or with
+  // an object overriding parts of it.
+  LuaUpdateSlicing updateSlicing(Json const& scriptUpdateSlicing) const;
+
 private:
   class ScriptCache {
   public:
@@ -60,6 +83,7 @@ private:
   };
 
   LuaEnginePtr m_luaEngine;
+  LuaUpdateSlicing m_updateSlicing;
   StringMap<LuaCallbacks> m_luaCallbacks;
   shared_ptr<ScriptCache> m_scriptCache;
 
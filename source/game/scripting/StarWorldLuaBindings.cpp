@@ -1125,6 +1125,7 @@ namespace LuaBindings {
   bool ServerWorldCallbacks::breakObject(WorldServer* world, EntityId arg1, bool arg2) {
     if (auto entity = world->get<Object>(arg1)) {
       bool smash = arg2;
+      world->wakeEntity(arg1);
       entity->breakObject(smash);
       return true;
     }
@@ -1168,6 +1169,7 @@ namespace LuaBindings {
 
   void ServerWorldCallbacks::setUniqueId(WorldServer* world, EntityId entityId, Maybe<String> const& uniqueId) {
     auto entity = world->entity(entityId);
+    world->wakeEntity(entityId);
     if (auto npc = as<Npc>(entity.get()))
       npc->setUniqueId(uniqueId);
     else if (auto monster = as<Monster>(entity.get()))
@@ -1776,6 +1778,9 @@ namespace LuaBindings {
   }
 
   Maybe<LuaValue> WorldEntityCallbacks::callScriptedEntity(World* world, EntityId entityId, String const& function, LuaVariadic<LuaValue> const& args) {
+    if (auto serverWorld = as<WorldServer>(world))
+      return serverWorld->callScriptedEntity(entityId, function, args);
+
     auto entity = as<ScriptedEntity>(world->entity(entityId));
     if (!entity || !entity->isMaster())
       throw StarException::format("Entity {} does not exist or is not a local master scripted entity", entityId);
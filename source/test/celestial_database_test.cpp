@@ -0,0 +1,117 @@
+#include "StarCelestialDatabase.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarFile.hpp"
+#include "StarJsonExtra.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // Responses produced for the same request by different databases are
+  // compared through this, as their maps may not iterate in the same order.
+  Json describeResponse(CelestialResponse const& response) {
+    if (auto chunk = response.leftPtr())
+      return chunk->toJson();
+
+    auto const& systemObjects = response.right();
+    JsonArray planets;
+    for (auto orbit : sorted(systemObjects.planets.keys()))
+      planets.append(strf("{}:{}", orbit, systemObjects.planets.get(orbit).planetParameters.seed()));
+    return JsonObject{{"system", jsonFromVec3I(systemObjects.systemLocation)}, {"planets", std::move(planets)}};
+  }
+
+  // Every chunk in a small block of the universe and every system in it, the
+  // way a handful of clients opening their navigation screens on the same
+  // neighbourhood would ask for them.
+  List<CelestialRequest> neighbourhoodRequests(CelestialMasterDatabase& database) {
+    int chunkSize = database.baseInformation().chunkSize;
+    List<CelestialRequest> requests;
+    for (int x = 0; x < 3; ++x) {
+      for (int y = 0; y < 3; ++y)
+        requests.append(makeLeft(Vec2I(x, y)));
+    }
+    for (auto const& system : database.scanSystems(RectI(0, 0, chunkSize * 3, chunkSize * 3)))
+      requests.append(makeRight(system.location()));
+    return requests;
+  }
+
+  // Sends the requests from 'clients' simultaneous clients, each in its own
+  // order, through a pool of threads like the universe server does.
+  List<List<Json>> requestBurst(CelestialMasterDatabase& database, WorkerPool& workerPool,
+      List<CelestialRequest> const& requests, size_t clients, uint64_t seed) {
+    RandomSource random(seed);
+    List<List<size_t>> orders;
+    List<List<WorkerPoolPromise<CelestialResponse>>> promises;
+    for (size_t c = 0; c < clients; ++c) {
+      List<size_t> order;
+      for (size_t i = 0; i < requests.size(); ++i)
+        order.append(i);
+      random.shuffle(order);
+
+      List<WorkerPoolPromise<CelestialResponse>> clientPromises;
+      for (size_t i : order) {
+        clientPromises.append(workerPool.addProducer<CelestialResponse>([&database, request = requests[i]]() {
+            return database.respondToRequest(request);
+          }));
+      }
+      orders.append(std::move(order));
+      promises.append(std::move(clientPromises));
+    }
+
+    List<List<Json>> responses;
+    for (size_t c = 0; c < clients; ++c) {
+      List<Json> clientResponses(requests.size());
+      for (size_t i = 0; i < orders[c].size(); ++i)
+        clientResponses[orders[c][i]] = describeResponse(promises[c][i].get());
+      responses.append(std::move(clientResponses));
+    }
+    return responses;
+  }
+}
+
+TEST(CelestialDatabaseTest, ConcurrentRequests) {
+  CelestialMasterDatabase reference;
+  auto requests = neighbourhoodRequests(reference);
+  ASSERT_GT(requests.size(), 9u);
+
+  List<Json> expected;
+  for (auto const& request : requests)
+    expected.append(describeResponse(reference.respondToRequest(request)));
+
+  // Every client asks for every chunk at once, so most requests land on a
+  // chunk that another thread is already generating.
+  CelestialMasterDatabase database;
+  WorkerPool workerPool("CelestialDatabaseTest", 4);
+  for (auto const& responses : requestBurst(database, workerPool, requests, 8, 1234))
+    EXPECT_EQ(responses, expected);
+
+  // An update made while other threads are loading the same chunks is never
+  // lost to a load that read the chunk from before it.
+  String databaseFile = File::temporaryFileName();
+  {
+    CelestialMasterDatabase stored(databaseFile);
+    Maybe<CelestialCoordinate> planet;
+    for (auto const& request : requests) {
+      if (auto system = request.rightPtr()) {
+        auto children = stored.children(CelestialCoordinate(*system));
+        if (!children.empty()) {
+          planet = children.first();
+          break;
+        }
+      }
+    }
+    ASSERT_TRUE(planet.isValid());
+
+    auto parameters = *stored.parameters(*planet);
+    auto burst = Thread::invoke("CelestialDatabaseTest::burst", [&]() {
+        requestBurst(stored, workerPool, requests, 8, 5678);
+      });
+    stored.updateParameters(*planet, CelestialParameters(*planet, parameters.seed(), "Renamed", parameters.parameters()));
+    burst.finish();
+
+    EXPECT_EQ(stored.name(*planet), String("Renamed"));
+  }
+  File::remove(databaseFile);
+}
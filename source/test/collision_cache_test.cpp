@@ -0,0 +1,122 @@
+#include "StarCollisionCache.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A world 100 tiles wide, so that the last sector before the wrap point is
+  // narrower than the rest, with solid tiles scattered about and null blocks
+  // above and below the world.
+  struct TestWorld {
+    TestWorld() : geometry(Vec2U(100, 64), true, false), solid(100 * 64, 0) {
+      RandomSource random(1234);
+      for (auto& tile : solid)
+        tile = random.randb();
+    }
+
+    CollisionBlock block(Vec2I const& space) const {
+      Vec2I tile = geometry.xwrap(space);
+      CollisionBlock block;
+      block.space = tile;
+      if (tile[1] < 0 || tile[1] >= 64)
+        block.kind = CollisionKind::Null;
+      else if (solid[tile[1] * 100 + tile[0]])
+        block.kind = CollisionKind::Block;
+      else
+        block.kind = CollisionKind::None;
+      if (block.kind != CollisionKind::None)
+        block.poly = PolyF(RectF(Vec2F(tile), Vec2F(tile + Vec2I(1, 1))));
+      block.polyBounds = block.poly.boundBox();
+      return block;
+    }
+
+    void forEachBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
+      for (int x = region.xMin(); x < region.xMax(); ++x) {
+        for (int y = region.yMin(); y < region.yMax(); ++y)
+          iterator(block({x, y}));
+      }
+    }
+
+    // Same filtering as the per tile collision query used by movement.
+    List<pair<Vec2I, RectF>> expected(RectF const& region) const {
+      List<pair<Vec2I, RectF>> result;
+      forEachBlock(RectI::integral(region.padded(1)), [&](CollisionBlock const& block) {
+          if (block.kind == CollisionKind::None)
+            return;
+          Vec2F basePosition = block.poly.vertex(0);
+          RectF bounds = block.polyBounds.translated(geometry.nearestTo(region.min(), basePosition) - basePosition);
+          if (region.intersects(bounds))
+            result.append({block.space, bounds});
+        });
+      return result;
+    }
+
+    WorldGeometry geometry;
+    List<uint8_t> solid;
+  };
+
+  List<pair<Vec2I, RectF>> sorted(List<pair<Vec2I, RectF>> list) {
+    sort(list, [](auto const& a, auto const& b) {
+        return a.first < b.first;
+      });
+    return list;
+  }
+}
+
+TEST(CollisionCacheTest, MatchesTileQueries) {
+  TestWorld world;
+  CollisionCache cache(world.geometry, [&world](RectI const& region, auto const& iterator) {
+      world.forEachBlock(region, iterator);
+    });
+
+  List<RectF> regions = {
+    RectF(10.5f, 10.5f, 14.0f, 13.5f),
+    RectF(97.0f, 30.0f, 103.5f, 33.0f),
+    RectF(-3.5f, 60.0f, 2.0f, 68.0f),
+    RectF(94.2f, -5.0f, 99.9f, 2.0f),
+    RectF(30.0f, 20.0f, 70.0f, 40.0f)
+  };
+
+  List<List<pair<Vec2I, RectF>>> found(regions.size());
+  cache.query(regions, [&](size_t index, CollisionCandidate const& candidate) {
+      EXPECT_GT(candidate.vertexCount, 0u);
+      found[index].append({candidate.space, candidate.polyBounds});
+    });
+
+  for (size_t i = 0; i < regions.size(); ++i)
+    EXPECT_EQ(sorted(found[i]), sorted(world.expected(regions[i])));
+}
+
+TEST(CollisionCacheTest, Invalidation) {
+  TestWorld world;
+  size_t built = 0;
+  CollisionCache cache(world.geometry, [&](RectI const& region, auto const& iterator) {
+      ++built;
+      world.forEachBlock(region, iterator);
+    });
+
+  RectF region(97.0f, 30.0f, 99.0f, 32.0f);
+  auto count = [&]() {
+    size_t count = 0;
+    cache.query({region}, [&](size_t, CollisionCandidate const&) { ++count; });
+    return count;
+  };
+
+  world.solid[31 * 100 + 98] = 0;
+  size_t before = count();
+  size_t sectors = cache.sectorCount();
+  EXPECT_EQ(built, sectors);
+
+  // Cached geometry does not change until invalidated.
+  world.solid[31 * 100 + 98] = 1;
+  EXPECT_EQ(count(), before);
+  EXPECT_EQ(built, sectors);
+
+  // Invalidating through an unwrapped position reaches the narrow sector at
+  // the wrap point.
+  cache.invalidate(RectI::withSize(Vec2I(-2, 31), Vec2I(1, 1)));
+  EXPECT_EQ(count(), before + 1);
+  EXPECT_EQ(built, sectors + 1);
+}
@@ -0,0 +1,40 @@
+#include "StarDamageBroadPhase.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  RectF randomRect(RandomSource& random, RectF const& region, float maxSize) {
+    Vec2F min(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+    return RectF::withSize(min, Vec2F(random.randf(0.5f, maxSize), random.randf(0.5f, maxSize)));
+  }
+}
+
+TEST(DamageBroadPhaseTest, MatchesBruteForce) {
+  // Targets and sources straddle the wrap point of a 1000 tile wide world.
+  WorldGeometry geometry(Vec2U(1000, 500), true, false);
+  RandomSource random(5678);
+
+  DamageBroadPhase broadPhase;
+  broadPhase.clear(geometry);
+  for (int i = 0; i < 300; ++i)
+    broadPhase.addTarget(randomRect(random, RectF(950, 0, 1050, 100), 6.0f));
+  broadPhase.build();
+
+  for (int i = 0; i < 500; ++i) {
+    // Occasionally bigger than every target put together.
+    RectF bounds = randomRect(random, RectF(940, -10, 1060, 110), i % 50 == 0 ? 200.0f : 12.0f);
+
+    List<size_t> expected;
+    for (size_t t = 0; t < broadPhase.targetCount(); ++t) {
+      if (geometry.rectIntersectsRect(broadPhase.targetBounds(t), bounds))
+        expected.append(t);
+    }
+
+    List<size_t> found;
+    broadPhase.forEachTarget(bounds, [&](size_t t) { found.append(t); });
+    EXPECT_EQ(found, expected);
+  }
+}
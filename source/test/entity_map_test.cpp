@@ -0,0 +1,189 @@
+#include "StarEntityMap.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  class TestEntity : public Entity {
+  public:
+    TestEntity(Vec2F const& position, RectF const& boundBox)
+      : m_position(position), m_boundBox(boundBox) {}
+
+    EntityType entityType() const override {
+      return EntityType::ItemDrop;
+    }
+
+    Vec2F position() const override {
+      return m_position;
+    }
+
+    RectF metaBoundBox() const override {
+      return m_boundBox;
+    }
+
+    void setPosition(Vec2F const& position) {
+      m_position = position;
+    }
+
+  private:
+    Vec2F m_position;
+    RectF m_boundBox;
+  };
+
+  // Entities here are never handed to a world, init only needs the pointer
+  // to be set.
+  World* const NoWorld = (World*)&NoWorld;
+
+  shared_ptr<TestEntity> addTestEntity(EntityMap& entityMap, RandomSource& random, RectF const& region, float maxSize) {
+    Vec2F position(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+    Vec2F size(random.randf(0.5f, maxSize), random.randf(0.5f, maxSize));
+    auto entity = make_shared<TestEntity>(position, RectF(-size / 2, size / 2));
+    entity->init(NoWorld, entityMap.reserveEntityId(), EntityMode::Master);
+    entityMap.addEntity(entity);
+    return entity;
+  }
+
+  RectF randomRect(RandomSource& random, RectF const& region, float maxSize) {
+    Vec2F min(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+    return RectF::withSize(min, Vec2F(random.randf(0.5f, maxSize), random.randf(0.5f, maxSize)));
+  }
+
+  bool intersectsAny(WorldGeometry const& geometry, EntityPtr const& entity, List<RectF> const& regions) {
+    for (auto const& region : regions) {
+      for (auto const& query : geometry.splitRect(region)) {
+        for (auto const& rect : geometry.splitRect(entity->metaBoundBox(), entity->position())) {
+          if (rect.intersects(query))
+            return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  List<EntityId> bruteForceQuery(EntityMap const& entityMap, WorldGeometry const& geometry, List<RectF> const& regions) {
+    List<EntityId> found;
+    entityMap.forAllEntities([&](EntityPtr const& entity) {
+        if (intersectsAny(geometry, entity, regions))
+          found.append(entity->entityId());
+      });
+    return sorted(found);
+  }
+
+  List<EntityId> mapQuery(EntityMap const& entityMap, List<RectF> const& regions) {
+    List<EntityId> found;
+    entityMap.forEachEntity(regions, [&](EntityPtr const& entity) {
+        found.append(entity->entityId());
+      });
+    return sorted(found);
+  }
+}
+
+TEST(EntityMapTest, MatchesBruteForce) {
+  // Entities and queries straddle the wrap point of a 1000 tile wide world.
+  Vec2U worldSize(1000, 500);
+  WorldGeometry geometry(worldSize, true, false);
+  EntityMap entityMap(worldSize, true, false, 1, 100000);
+  RandomSource random(1234);
+
+  List<shared_ptr<TestEntity>> entities;
+  for (int i = 0; i < 400; ++i)
+    entities.append(addTestEntity(entityMap, random, RectF(950, 0, 1050, 100), 8.0f));
+
+  auto check = [&]() {
+    for (int i = 0; i < 200; ++i) {
+      // Several overlapping regions, like those monitored by a client, and
+      // occasionally one nearly as wide as the whole world.
+      List<RectF> regions;
+      for (int r = 0; r < 3; ++r)
+        regions.append(randomRect(random, RectF(930, -10, 1070, 110), i % 50 == 0 ? 900.0f : 20.0f));
+
+      auto found = mapQuery(entityMap, regions);
+      EXPECT_EQ(found, bruteForceQuery(entityMap, geometry, regions));
+      for (size_t f = 1; f < found.size(); ++f)
+        EXPECT_NE(found[f - 1], found[f]);
+
+      for (auto const& region : regions) {
+        List<EntityId> single;
+        for (auto const& entity : entityMap.entityQuery(region))
+          single.append(entity->entityId());
+        EXPECT_EQ(sorted(single), bruteForceQuery(entityMap, geometry, {region}));
+      }
+    }
+  };
+  check();
+
+  // Moving entities around keeps the sectors up to date.
+  entityMap.updateAllEntities([&](EntityPtr const& entity) {
+      auto testEntity = as<TestEntity>(entity);
+      testEntity->setPosition(geometry.xwrap(testEntity->position() + Vec2F(random.randf(-20, 20), random.randf(-20, 20))));
+    });
+  check();
+
+  // Removed entities are gone, and their slots are reused by new ones.
+  for (size_t i = 0; i < entities.size(); i += 2)
+    EXPECT_EQ(entityMap.removeEntity(entities[i]->entityId()), entities[i]);
+  for (size_t i = 0; i < entities.size(); i += 2)
+    EXPECT_FALSE(entityMap.entity(entities[i]->entityId()));
+  for (int i = 0; i < 100; ++i)
+    addTestEntity(entityMap, random, RectF(950, 0, 1050, 100), 8.0f);
+  EXPECT_EQ(entityMap.size(), 300u);
+  check();
+
+  // Entities added from inside a query are not visited by it, and do not
+  // disturb the entities that are.
+  List<RectF> region = {RectF(940, 0, 1060, 100)};
+  auto expected = mapQuery(entityMap, region);
+  List<EntityId> found;
+  entityMap.forEachEntity(region, [&](EntityPtr const& entity) {
+      found.append(entity->entityId());
+      addTestEntity(entityMap, random, RectF(950, 0, 1050, 100), 8.0f);
+    });
+  EXPECT_EQ(sorted(found), expected);
+  check();
+
+  // Entities removed by the update callback are skipped by the rest of the
+  // update.
+  size_t updated = 0;
+  entityMap.updateAllEntities([&](EntityPtr const& entity) {
+      ++updated;
+      for (auto const& other : entityMap.entityQuery(entity->metaBoundBox().translated(entity->position()))) {
+        if (other != entity)
+          entityMap.removeEntity(other->entityId());
+      }
+    });
+  EXPECT_EQ(updated, entityMap.size());
+  check();
+}
+
+TEST(EntityMapTest, Sleeping) {
+  Vec2U worldSize(1000, 500);
+  EntityMap entityMap(worldSize, true, false, 1, 100000);
+  RandomSource random(4321);
+
+  List<shared_ptr<TestEntity>> entities;
+  for (int i = 0; i < 100; ++i)
+    entities.append(addTestEntity(entityMap, random, RectF(0, 0, 100, 100), 4.0f));
+
+  for (size_t i = 0; i < entities.size(); i += 3)
+    entityMap.setSleeping(entities[i]->entityId(), true);
+  EXPECT_EQ(entityMap.sleepingCount(), 34u);
+  EXPECT_TRUE(entityMap.isSleeping(entities[0]->entityId()));
+  EXPECT_FALSE(entityMap.isSleeping(entities[1]->entityId()));
+
+  // Sleeping entities are not updated, but are still found.
+  HashSet<EntityId> updated;
+  entityMap.updateAllEntities([&](EntityPtr const& entity) { updated.add(entity->entityId()); });
+  EXPECT_EQ(updated.size(), 66u);
+  for (size_t i = 0; i < entities.size(); ++i)
+    EXPECT_EQ(updated.contains(entities[i]->entityId()), i % 3 != 0);
+  EXPECT_EQ(entityMap.entityQuery(RectF(-10, -10, 110, 110)).size(), 100u);
+
+  // Woken and removed entities no longer count as sleeping.
+  entityMap.setSleeping(entities[0]->entityId(), false);
+  entityMap.removeEntity(entities[3]->entityId());
+  EXPECT_EQ(entityMap.sleepingCount(), 32u);
+  auto replacement = addTestEntity(entityMap, random, RectF(0, 0, 100, 100), 4.0f);
+  EXPECT_FALSE(entityMap.isSleeping(replacement->entityId()));
+}
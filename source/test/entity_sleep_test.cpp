@@ -0,0 +1,213 @@
+#include "StarFile.hpp"
+#include "StarRoot.hpp"
+#include "StarWorldServer.hpp"
+#include "StarWorldTemplate.hpp"
+#include "StarWorldParameters.hpp"
+#include "StarObject.hpp"
+#include "StarObjectDatabase.hpp"
+#include "StarLiquidsDatabase.hpp"
+#include "StarEntityFactory.hpp"
+#include "StarPlayer.hpp"
+#include "StarPlayerFactory.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // An object that sleeps for as long as it is told to, and counts how often
+  // the world updates it and asks for its net state.  It never breaks, so
+  // tile changes under it only ever wake it.
+  class SleepyObject : public Object {
+  public:
+    SleepyObject(ObjectConfigConstPtr config)
+      : Object(config), sleep(highest<float>()), updates(0), netStateWrites(0) {}
+
+    pair<ByteArray, uint64_t> writeNetState(uint64_t fromVersion, NetCompatibilityRules rules) override {
+      ++netStateWrites;
+      return Object::writeNetState(fromVersion, rules);
+    }
+
+    void update(float dt, uint64_t currentStep) override {
+      ++updates;
+      Object::update(dt, currentStep);
+    }
+
+    bool checkBroken() override {
+      return false;
+    }
+
+    Maybe<float> sleepTime() const override {
+      return sleep;
+    }
+
+    Maybe<float> sleep;
+    unsigned updates;
+    unsigned netStateWrites;
+  };
+
+  ConnectionId const ClientId = 1;
+
+  // A small generated planet, watched around its player start by a client
+  // without a player, with a SleepyObject standing on the ground there.
+  struct SleepWorld {
+    SleepWorld() {
+      auto worldTemplate = make_shared<WorldTemplate>(generateTerrestrialWorldParameters("garden", "small", 1234), SkyParameters(), 1234);
+      world = make_shared<WorldServer>(worldTemplate, File::ephemeralFile());
+
+      Vec2F start;
+      world->addClient(ClientId, SpawnTarget(), false);
+      for (auto const& packet : world->getOutgoingPackets(ClientId)) {
+        if (auto worldStart = as<WorldStartPacket>(packet))
+          start = worldStart->playerStart;
+      }
+
+      clientState.setWindow(RectI::withCenter(Vec2I::floor(start), Vec2I(200, 100)));
+      world->handleIncomingPackets(ClientId, {make_shared<WorldStartAcknowledgePacket>(), make_shared<WorldClientStateUpdatePacket>(clientState.writeDelta())});
+
+      object = placeObject(Vec2I::floor(start));
+    }
+
+    // Any object without scripts will do, placed wherever it fits on solid
+    // ground near the start.
+    shared_ptr<SleepyObject> placeObject(Vec2I const& near) {
+      auto objectDatabase = Root::singleton().objectDatabase();
+      for (auto const& name : sorted(objectDatabase->allObjects())) {
+        auto config = objectDatabase->getConfig(name);
+        if (config->type != "object" || !config->scripts.empty())
+          continue;
+        for (int y = -10; y <= 10; ++y) {
+          for (int x = -20; x <= 20; ++x) {
+            Vec2I position = near + Vec2I(x, y);
+            if (world->material(position - Vec2I(0, 1), TileLayer::Foreground) == EmptyMaterialId)
+              continue;
+            if (objectDatabase->canPlaceObject(world.get(), position, name)) {
+              auto object = make_shared<SleepyObject>(config);
+              object->setTilePosition(position);
+              object->setDirection(Direction::Right);
+              world->addEntity(object);
+              return object;
+            }
+          }
+        }
+      }
+      return {};
+    }
+
+    // Gives the client a player standing at the given position, sent the way
+    // a WorldClient sends its main player.
+    void addPlayer(Vec2F const& position) {
+      auto& root = Root::singleton();
+      auto player = root.playerFactory()->create();
+      player->finalizeCreation();
+      player->moveTo(position);
+
+      EntityId playerId = connectionEntitySpace(ClientId).first;
+      auto firstNetState = player->writeNetState();
+      clientState.setPlayer(playerId);
+      world->handleIncomingPackets(ClientId, {
+          make_shared<EntityCreatePacket>(EntityType::Player, root.entityFactory()->netStoreEntity(player), std::move(firstNetState.first), playerId),
+          make_shared<WorldClientStateUpdatePacket>(clientState.writeDelta())
+        });
+    }
+
+    void update(unsigned ticks) {
+      for (unsigned i = 0; i < ticks; ++i) {
+        world->update(ServerGlobalTimestep * GlobalTimescale);
+        world->getOutgoingPackets(ClientId);
+      }
+    }
+
+    // Steps the world until the object goes a second without being updated.
+    bool sleep() {
+      for (unsigned i = 0; i < 20; ++i) {
+        unsigned updates = object->updates;
+        update(60);
+        if (object->updates == updates)
+          return true;
+      }
+      return false;
+    }
+
+    // Steps the world and returns how many times the object was updated.
+    unsigned updatesOver(unsigned ticks) {
+      unsigned updates = object->updates;
+      update(ticks);
+      return object->updates - updates;
+    }
+
+    WorldServerPtr world;
+    WorldClientState clientState;
+    shared_ptr<SleepyObject> object;
+  };
+}
+
+TEST(EntitySleepTest, WakesOnTimer) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+  ASSERT_TRUE(sleepWorld.sleep());
+  EXPECT_GT(sleepWorld.world->sleepingEntityCount(), 0u);
+
+  // Woken by its timer every half second, and straight back to sleep.
+  sleepWorld.object->sleep = 0.5f;
+  sleepWorld.world->wakeEntity(sleepWorld.object->entityId());
+  unsigned updates = sleepWorld.updatesOver(120);
+  EXPECT_GE(updates, 3u);
+  EXPECT_LE(updates, 5u);
+}
+
+TEST(EntitySleepTest, WakesNearPlayers) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+  ASSERT_TRUE(sleepWorld.sleep());
+
+  // Kept awake for as long as a player is close by.
+  sleepWorld.addPlayer(sleepWorld.object->position() + Vec2F(10, 0));
+  EXPECT_EQ(sleepWorld.updatesOver(60), 60u);
+}
+
+TEST(EntitySleepTest, WakesOnTileChanges) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+  ASSERT_TRUE(sleepWorld.sleep());
+
+  sleepWorld.world->destroyBlock(TileLayer::Foreground, sleepWorld.object->tilePosition() - Vec2I(0, 1), false, false);
+  EXPECT_GE(sleepWorld.updatesOver(1), 1u);
+}
+
+TEST(EntitySleepTest, WakesOnLiquidChanges) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+  ASSERT_TRUE(sleepWorld.sleep());
+
+  auto water = Root::singleton().liquidsDatabase()->liquidId("water");
+  sleepWorld.world->setLiquid(sleepWorld.object->tilePosition(), water, 1.0f, 1.0f);
+  EXPECT_GE(sleepWorld.updatesOver(1), 1u);
+}
+
+TEST(EntitySleepTest, WakesOnMessages) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+  ASSERT_TRUE(sleepWorld.sleep());
+
+  sleepWorld.world->sendEntityMessage(sleepWorld.object->entityId(), "ping");
+  EXPECT_GE(sleepWorld.updatesOver(1), 1u);
+}
+
+TEST(EntitySleepTest, SkipsNetState) {
+  SleepWorld sleepWorld;
+  ASSERT_TRUE((bool)sleepWorld.object);
+
+  // While awake, the client watching it is sent its net state as usual.
+  sleepWorld.object->sleep = {};
+  unsigned writes = sleepWorld.object->netStateWrites;
+  sleepWorld.update(60);
+  EXPECT_GT(sleepWorld.object->netStateWrites, writes);
+
+  // Once asleep and the client has its last state, it is not asked again.
+  sleepWorld.object->sleep = highest<float>();
+  ASSERT_TRUE(sleepWorld.sleep());
+  writes = sleepWorld.object->netStateWrites;
+  sleepWorld.update(60);
+  EXPECT_EQ(sleepWorld.object->netStateWrites, writes);
+}
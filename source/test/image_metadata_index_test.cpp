@@ -0,0 +1,100 @@
+#include "StarImageMetadataIndex.hpp"
+#include "StarMemoryAssetSource.hpp"
+#include "StarImage.hpp"
+#include "StarBuffer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  ByteArray pngData(Image const& image) {
+    auto buffer = make_shared<Buffer>();
+    image.writePng(buffer);
+    return buffer->takeData();
+  }
+}
+
+TEST(ImageMetadataIndexTest, RoundTrip) {
+  // Opaque pixels in a block that starts at (3, 2), and a single one in the
+  // top right corner.
+  Image sprite(16, 12, PixelFormat::RGBA32);
+  sprite.fill(Vec4B(0, 0, 0, 0));
+  for (unsigned x = 3; x < 7; ++x) {
+    for (unsigned y = 2; y < 5; ++y)
+      sprite.set(x, y, Vec4B(255, 0, 0, 255));
+  }
+  sprite.set(15, 11, Vec4B(0, 0, 255, 1));
+
+  Image empty(5, 7, PixelFormat::RGBA32);
+  empty.fill(Vec4B(0, 0, 0, 0));
+
+  auto source = make_shared<MemoryAssetSource>("test");
+  source->set("/sprite.png", pngData(sprite));
+  source->set("/empty.png", pngData(empty));
+  source->set("/notanimage.png", ByteArray("not a png", 9));
+  source->set("/sprite.frames", ByteArray("{}", 2));
+  source->set(ImageMetadataIndex::IndexPath, ImageMetadataIndex::build(*source));
+
+  ImageMetadataIndex index(source);
+  EXPECT_EQ(index.size(), 2u);
+  EXPECT_FALSE(index.entry("/notanimage.png"));
+  EXPECT_FALSE(index.entry("/sprite.frames"));
+
+  auto spriteEntry = index.entry("/sprite.png");
+  ASSERT_TRUE(spriteEntry);
+  EXPECT_EQ(spriteEntry->size, Vec2U(16, 12));
+  EXPECT_EQ(spriteEntry->nonEmptyRegion, RectU(3, 2, 16, 12));
+  // Paths are case insensitive, like asset paths.
+  EXPECT_EQ(index.entry("/Sprite.PNG"), spriteEntry);
+
+  auto emptyEntry = index.entry("/empty.png");
+  ASSERT_TRUE(emptyEntry);
+  EXPECT_EQ(emptyEntry->size, Vec2U(5, 7));
+  EXPECT_TRUE(emptyEntry->nonEmptyRegion.isNull());
+
+  // Masks read back in any order match the images they were built from.
+  for (int i = 0; i < 2; ++i) {
+    auto emptyMask = index.alphaMask(*emptyEntry);
+    auto spriteMask = index.alphaMask(*spriteEntry);
+    ASSERT_EQ(spriteMask.size, sprite.size());
+    for (unsigned y = 0; y < sprite.height(); ++y) {
+      for (unsigned x = 0; x < sprite.width(); ++x)
+        EXPECT_EQ(spriteMask.get(x, y), sprite.get(x, y)[3] > 0) << x << ", " << y;
+    }
+    ASSERT_EQ(emptyMask.size, empty.size());
+    for (unsigned y = 0; y < empty.height(); ++y) {
+      for (unsigned x = 0; x < empty.width(); ++x)
+        EXPECT_FALSE(emptyMask.get(x, y));
+    }
+  }
+}
+
+TEST(ImageMetadataIndexTest, FrameMask) {
+  Image sprite(8, 6, PixelFormat::RGBA32);
+  sprite.fill(Vec4B(0, 0, 0, 0));
+  // Bottom left pixel of the top left 4x3 frame, in image coordinates.
+  sprite.set(0, 3, Vec4B(255, 255, 255, 255));
+  // Top right pixel of the bottom right 4x3 frame.
+  sprite.set(7, 2, Vec4B(255, 255, 255, 255));
+  auto mask = ImageMetadataIndex::alphaMask(sprite);
+
+  // Frame rects are top down, so the top left frame starts at y 0.
+  auto topLeft = ImageMetadataIndex::frameAlphaMask(mask, RectU(0, 0, 4, 3));
+  ASSERT_TRUE(topLeft);
+  EXPECT_EQ(topLeft->size, Vec2U(4, 3));
+  for (unsigned y = 0; y < 3; ++y) {
+    for (unsigned x = 0; x < 4; ++x)
+      EXPECT_EQ(topLeft->get(x, y), x == 0 && y == 0) << x << ", " << y;
+  }
+
+  auto bottomRight = ImageMetadataIndex::frameAlphaMask(mask, RectU(4, 3, 8, 6));
+  ASSERT_TRUE(bottomRight);
+  for (unsigned y = 0; y < 3; ++y) {
+    for (unsigned x = 0; x < 4; ++x)
+      EXPECT_EQ(bottomRight->get(x, y), x == 3 && y == 2) << x << ", " << y;
+  }
+
+  EXPECT_FALSE(ImageMetadataIndex::frameAlphaMask(mask, RectU(4, 3, 9, 6)));
+  EXPECT_FALSE(ImageMetadataIndex::frameAlphaMask(mask, RectU(0, 0, 4, 7)));
+}
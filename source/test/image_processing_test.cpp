@@ -0,0 +1,60 @@
+#include "StarImageProcessing.hpp"
+#include "StarImage.hpp"
+#include "StarStringView.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+// A small palette sprite with large transparent areas, roughly like a
+// humanoid body frame sheet.
+static Image makeSpriteSheet(unsigned width, unsigned height) {
+  List<Vec4B> palette = {
+    {0, 0, 0, 0}, {0xff, 0xe2, 0xc5, 0xff}, {0xff, 0xc1, 0x81, 0xff}, {0xd3, 0x9c, 0x6c, 0xff},
+    {0xc7, 0x81, 0x5b, 0xff}, {0x73, 0x53, 0x35, 0xff}, {0x40, 0x20, 0x10, 0x80}, {0x20, 0x20, 0x20, 0xff}
+  };
+
+  RandomSource random(1234);
+  Image image(width, height, PixelFormat::RGBA32);
+  image.forEachPixel([&](unsigned x, unsigned y, Vec4B& pixel) {
+    if ((x / 8 + y / 8) % 3 == 0)
+      pixel = palette[0];
+    else
+      pixel = palette[random.randu32() % palette.size()];
+  });
+  return image;
+}
+
+static String const HumanoidDirectives =
+  "?replace;ffe2c5=f7d4b3;ffc181=d9a47a;d39c6c=b57d55;c7815b=9c5e3c"
+  "?replace;735335=5e3a21;402010=301808"
+  "?hueshift=-12?saturation=15?brightness=-8"
+  "?fade=ff0000=0.15?multiply=ffeeddff";
+
+TEST(ImageProcessingTest, FusedMatchesSequential) {
+  Image source = makeSpriteSheet(64, 48);
+
+  for (auto const& directives : {HumanoidDirectives, String("?scanlines=000000=0.5=ffffff=0.2?hueshift=30"), String("?setcolor=ff00ff?replace;ff00ff=00ff00"),
+           String("?hueshift=40?border=1;ff0000;00ff00?brightness=20"), String("?flipx?saturation=-50?scalenearest=2")}) {
+    auto operations = parseImageOperations(directives);
+
+    Image sequential = source;
+    for (auto const& operation : operations)
+      processImageOperation(operation, sequential);
+
+    Image fused = processImageOperations(operations, source);
+    EXPECT_EQ(fused.size(), sequential.size());
+    EXPECT_TRUE(memcmp(fused.data(), sequential.data(), fused.width() * fused.height() * 4) == 0) << directives;
+  }
+
+  Image replaced = processImageOperations(parseImageOperations("?replace;ffe2c5=010203"), source);
+  for (unsigned y = 0; y < source.height(); ++y) {
+    for (unsigned x = 0; x < source.width(); ++x) {
+      if (source.get(x, y) == Vec4B(0xff, 0xe2, 0xc5, 0xff))
+        EXPECT_EQ(replaced.get(x, y), Vec4B(1, 2, 3, 0xff));
+      else
+        EXPECT_EQ(replaced.get(x, y), source.get(x, y));
+    }
+  }
+}
@@ -2,6 +2,9 @@
 #include "StarFile.hpp"
 #include "StarJsonPatch.hpp"
 #include "StarJsonPath.hpp"
+#include "StarJsonInterner.hpp"
+#include "StarJsonBuilder.hpp"
+#include "StarThread.hpp"
 
 #include "gtest/gtest.h"
 
@@ -645,6 +648,23 @@ TEST(JsonTest, PatchingEscaping) {
   jsonPatch(base1, test1.toArray());
 }
 
+TEST(JsonTest, PatchingCompiled) {
+  JsonPatching::CompiledOperation add(Json::parse(R"JSON({"op" : "add", "path" : "/list/-", "value" : 3})JSON"));
+  JsonPatching::CompiledOperation test(Json::parse(R"JSON({"op" : "test", "path" : "/list/0", "value" : 1})JSON"));
+
+  // Compiled operations can be reused across documents
+  Json base1 = Json::parse(R"JSON({"list" : [1, 2]})JSON");
+  Json base2 = Json::parse(R"JSON({"list" : []})JSON");
+  EXPECT_EQ(add.apply(base1), Json::parse(R"JSON({"list" : [1, 2, 3]})JSON"));
+  EXPECT_EQ(add.apply(add.apply(base2)), Json::parse(R"JSON({"list" : [3, 3]})JSON"));
+  EXPECT_EQ(test.apply(base1), base1);
+  EXPECT_THROW(test.apply(base2), JsonPatchTestFail);
+
+  EXPECT_THROW(JsonPatching::CompiledOperation(Json::parse(R"JSON({"op" : "frobnicate", "path" : "/"})JSON")), JsonPatchException);
+  EXPECT_THROW(JsonPatching::CompiledOperation(Json::parse(R"JSON({"op" : "add", "path" : "/foo"})JSON")), JsonPatchException);
+  EXPECT_THROW(JsonPatching::CompiledOperation(Json::parse(R"JSON({"op" : "move", "path" : "/foo"})JSON")), JsonPatchException);
+}
+
 TEST(JsonTest, MergeQuery) {
   Json json1 = Json::parse(R"JSON(
       {
@@ -701,3 +721,138 @@ TEST(JsonTest, MergeQuery) {
   testIdentical("fiz");
   testIdentical("nothing");
 }
+
+TEST(JsonTest, Interning) {
+  JsonInterner interner;
+
+  Json json1 = Json::parseJson(R"JSON(
+      {
+        "image" : "/items/generic/crafting/copperbar.png",
+        "damage" : { "power" : 5, "type" : "physical" },
+        "list" : [1, 2, 3],
+        "floats" : [1.0, 2.0, 3.0]
+      }
+    )JSON");
+  Json json2 = Json::parseJson(R"JSON(
+      {
+        "icon" : "/items/generic/crafting/copperbar.png",
+        "damage" : { "type" : "physical", "power" : 5 },
+        "list" : [1, 2, 3],
+        "floats" : [1, 2, 3]
+      }
+    )JSON");
+
+  Json interned1 = interner.intern(json1);
+  Json interned2 = interner.intern(json2);
+
+  // Interning never changes the value
+  EXPECT_EQ(interned1, json1);
+  EXPECT_EQ(interned2, json2);
+  EXPECT_EQ(interned1.get("list").type(), Json::Type::Array);
+  EXPECT_EQ(interned2.get("floats").get(0).type(), Json::Type::Int);
+
+  // Identical values share storage, even if objects were built in a
+  // different order.
+  EXPECT_EQ(interned1.get("image").stringPtr(), interned2.get("icon").stringPtr());
+  EXPECT_EQ(interned1.get("damage").objectPtr(), interned2.get("damage").objectPtr());
+  EXPECT_EQ(interned1.get("list").arrayPtr(), interned2.get("list").arrayPtr());
+
+  // Ints and floats are never merged
+  EXPECT_NE(interned1.get("floats").arrayPtr(), interned2.get("floats").arrayPtr());
+
+  // The top level value is not shared with the interner
+  EXPECT_TRUE(interned1.unique());
+  EXPECT_TRUE(interner.intern(Json()).isNull());
+
+  // Interned storage is held until it is unused and cleaned up
+  size_t interned = interner.size();
+  EXPECT_EQ(interner.cleanup(), 0u);
+  interned1 = {};
+  EXPECT_EQ(interner.cleanup(), 1u);
+  EXPECT_EQ(interner.size(), interned - 1);
+  // Interned strings may still be shared with the original values
+  interned2 = {};
+  json1 = {};
+  json2 = {};
+  interner.cleanup();
+  EXPECT_EQ(interner.size(), 0u);
+
+  // Nor are zeros of different sign
+  Json zeros = interner.intern(JsonArray{JsonArray{0.0}, JsonArray{-0.0}});
+  EXPECT_NE(zeros.get(0).arrayPtr(), zeros.get(1).arrayPtr());
+  EXPECT_TRUE(std::signbit(zeros.get(1).get(0).toDouble()));
+}
+
+TEST(JsonTest, InterningThreads) {
+  JsonInterner interner;
+
+  List<Json> documents;
+  for (int i = 0; i < 8; ++i) {
+    JsonArray items;
+    for (int j = 0; j < 200; ++j)
+      items.append(JsonObject{{"name", strf("item{}", j)}, {"tags", JsonArray{"shared", strf("tag{}", j % 10)}}});
+    documents.append(JsonObject{{"items", items}});
+  }
+
+  List<Json> interned(documents.size());
+  List<ThreadFunction<void>> threads;
+  for (size_t i = 0; i < documents.size(); ++i)
+    threads.append(Thread::invoke("JsonTest::intern", [&, i]() { interned[i] = interner.intern(documents[i]); }));
+  for (auto& thread : threads)
+    thread.finish();
+
+  // Identical values interned on different threads share storage.
+  for (size_t i = 0; i < interned.size(); ++i) {
+    EXPECT_EQ(interned[i], documents[i]);
+    EXPECT_EQ(interned[i].get("items").arrayPtr(), interned[0].get("items").arrayPtr());
+  }
+  auto items = interned[0].get("items");
+  EXPECT_EQ(items.get(3).get("tags").get(0).stringPtr(), items.get(7).get("tags").get(0).stringPtr());
+  EXPECT_EQ(items.get(3).get("tags").arrayPtr(), items.get(13).get("tags").arrayPtr());
+}
+
+TEST(JsonTest, BufferParser) {
+  auto parseBoth = [](String const& json, JsonParseType type) -> pair<String, String> {
+    pair<String, String> errors;
+    try {
+      inputUtf32Json<String::const_iterator>(json.begin(), json.end(), type);
+    } catch (JsonParsingException const& e) {
+      errors.first = e.what();
+    }
+    try {
+      inputUtf8JsonBuffer(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), type);
+    } catch (JsonParsingException const& e) {
+      errors.second = e.what();
+    }
+    return errors;
+  };
+
+  // Both parsers must agree on what is an error, and where it is
+  for (String const& json : {"{\"a\" : 1,\n  \"b\" : [1, 2 3]}", "{\"日本語\" : tru }", "[1, 2] 3", "{\"a\" : 1, \"a\" : 2}",
+           "[\"unterminated", "[1 /* comment", "[-]", "  /x", "\t[\"\\q\"]", "[1e5, 0.5, -0, 9223372036854775807]"}) {
+    auto errors = parseBoth(json, JsonParseType::Top);
+    EXPECT_EQ(errors.first, errors.second);
+  }
+
+  String json = R"JSON(
+    // comment
+    { "string" : "plain text that is long enough to need more than one block",
+      "escaped" : "tab\there \"quoted\" \u00e9 \ud83d\ude00 \/",
+      "unicode" : "日本語 and then some more ascii after the multi byte run",
+      "numbers" : [0, -1, 1.5, -2.5e-3, 1E10, 123456789012],
+      /* block comment */
+      "words" : [true, false, null],
+      "nested" : {"a" : {"b" : [[], {}]}}
+    }
+  )JSON";
+  Json generic = inputUtf32Json<String::const_iterator>(json.begin(), json.end(), JsonParseType::Top);
+  Json buffer = inputUtf8JsonBuffer(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), JsonParseType::Top);
+  EXPECT_EQ(generic, buffer);
+  EXPECT_EQ(buffer.getString("unicode"), "日本語 and then some more ascii after the multi byte run");
+  EXPECT_EQ(buffer.getString("escaped"), "tab\there \"quoted\" é 😀 /");
+  EXPECT_EQ(buffer.get("numbers").get(5).type(), Json::Type::Int);
+  EXPECT_EQ(generic.printJson(), buffer.printJson());
+
+  std::string invalidUtf8 = "[\"\xc3\x28\"]";
+  EXPECT_THROW(inputUtf8Json(invalidUtf8.data(), invalidUtf8.data() + invalidUtf8.size(), JsonParseType::Top), UnicodeException);
+}
@@ -730,6 +730,55 @@ TEST(LuaTest, Limits) {
   EXPECT_EQ(context.eval<int>("1 + 1"), 2);
 }
 
+TEST(LuaTest, BudgetedThreads) {
+  auto luaEngine = LuaEngine::create();
+  luaEngine->setInstructionLimit(50000);
+  luaEngine->setInstructionMeasureInterval(100);
+  auto context = luaEngine->createContext();
+  context.load(R"SCRIPT(
+      function count(n)
+        local sum = 0
+        for i = 1, n do
+          sum = sum + i
+        end
+        return sum
+      end
+
+      function callback()
+        return nested(2000)
+      end
+    )SCRIPT");
+  context.set("nested", context.createFunction([&context](int n) { return context.invokePath<int>("count", n); }));
+
+  // A budget of zero behaves like a normal resume
+  LuaThread thread = luaEngine->createThread();
+  thread.pushFunction(context.get<LuaFunction>("count"));
+  EXPECT_EQ(thread.resumeBudgeted<int>(0, 100), 5050);
+  EXPECT_EQ(thread.status(), LuaThread::Status::Dead);
+
+  // Work that would exceed the instruction limit completes across several
+  // forced yields instead.
+  thread.pushFunction(context.get<LuaFunction>("count"));
+  unsigned slices = 1;
+  auto result = thread.resumeBudgeted<double>(10000, 100000);
+  while (thread.status() == LuaThread::Status::Active) {
+    EXPECT_FALSE(result);
+    result = thread.resumeBudgeted<double>(10000);
+    ++slices;
+  }
+  EXPECT_EQ(result, 5000050000.0);
+  EXPECT_GT(slices, 1u);
+
+  // Threads cannot yield across the C++ callback boundary, so callbacks into
+  // lua finish within a single resume.
+  thread.pushFunction(context.get<LuaFunction>("callback"));
+  EXPECT_EQ(thread.resumeBudgeted<int>(100), 2001000);
+  EXPECT_EQ(thread.status(), LuaThread::Status::Dead);
+
+  // Normal calls are unaffected once the budgeted resume has finished.
+  EXPECT_EQ(context.invokePath<int>("count", 100), 5050);
+}
+
 TEST(LuaTest, Errors) {
   auto luaEngine = LuaEngine::create();
   auto context = luaEngine->createContext();
@@ -0,0 +1,83 @@
+#include "StarMemoryTracker.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static MemoryTracker::TagStats memoryTagStats(String const& name) {
+  for (auto const& stats : MemoryTracker::stats()) {
+    if (stats.name == name)
+      return stats;
+  }
+  return {name, 0, 0, 0, 0};
+}
+
+TEST(MemoryTrackerTest, Tags) {
+  auto tag = MemoryTracker::tag("MemoryTrackerTest");
+  EXPECT_EQ(MemoryTracker::tag("MemoryTrackerTest"), tag);
+
+  if (!MemoryTracker::enabled()) {
+    EXPECT_EQ(tag, MemoryTracker::Untagged);
+    MemoryTagScope scope(tag);
+    EXPECT_EQ(MemoryTracker::currentTag(), MemoryTracker::Untagged);
+    EXPECT_TRUE(MemoryTracker::stats().empty());
+    return;
+  }
+
+  EXPECT_NE(tag, MemoryTracker::Untagged);
+  void* tagged;
+  void* untagged;
+  {
+    MemoryTagScope scope(tag);
+    EXPECT_EQ(MemoryTracker::currentTag(), tag);
+    tagged = Star::malloc(1000);
+    {
+      MemoryTagScope innerScope(MemoryTracker::Untagged);
+      untagged = Star::malloc(500);
+    }
+    EXPECT_EQ(MemoryTracker::currentTag(), tag);
+  }
+  EXPECT_EQ(MemoryTracker::currentTag(), MemoryTracker::Untagged);
+
+  auto stats = memoryTagStats("MemoryTrackerTest");
+  EXPECT_EQ(stats.liveBytes, 1000);
+  EXPECT_EQ(stats.liveAllocations, 1);
+  EXPECT_EQ(stats.allocations, 1u);
+
+  // Reallocating charges the new size to the current tag.
+  {
+    MemoryTagScope scope(tag);
+    tagged = Star::realloc(tagged, 3000);
+  }
+  stats = memoryTagStats("MemoryTrackerTest");
+  EXPECT_EQ(stats.liveBytes, 3000);
+  EXPECT_EQ(stats.liveAllocations, 1);
+  EXPECT_EQ(stats.allocations, 2u);
+  EXPECT_EQ(stats.allocatedBytes, 4000u);
+
+  // Memory freed by another thread is credited back to the tag it was
+  // allocated under, and survives that thread exiting.
+  Thread::invoke("MemoryTrackerTest::free", [tagged]() { Star::free(tagged, 3000); }).finish();
+  stats = memoryTagStats("MemoryTrackerTest");
+  EXPECT_EQ(stats.liveBytes, 0);
+  EXPECT_EQ(stats.liveAllocations, 0);
+  EXPECT_EQ(stats.allocations, 2u);
+
+  Star::free(untagged);
+}
+
+TEST(MemoryTrackerTest, SubTags) {
+  auto parent = MemoryTracker::tag("MemoryTrackerTest parent");
+  auto subTag = MemoryTracker::subTag(parent, "lua");
+  EXPECT_EQ(MemoryTracker::subTag(parent, "lua"), subTag);
+  EXPECT_EQ(MemoryTracker::subTag(MemoryTracker::Untagged, "MemoryTrackerTest"), MemoryTracker::tag("MemoryTrackerTest"));
+
+  if (!MemoryTracker::enabled()) {
+    EXPECT_EQ(subTag, MemoryTracker::Untagged);
+    return;
+  }
+
+  EXPECT_NE(subTag, parent);
+  EXPECT_EQ(MemoryTracker::tag("MemoryTrackerTest parent/lua"), subTag);
+}
@@ -0,0 +1,60 @@
+#include "StarMixer.hpp"
+#include "StarBuffer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A stereo 16 bit PCM wav of a square wave, built in memory.
+  Audio makeSquareWave(unsigned sampleRate, size_t frames, int16_t amplitude) {
+    auto writeLE = [](ByteArray& bytes, uint32_t value, size_t size) {
+      for (size_t i = 0; i < size; ++i)
+        bytes.appendByte((char)((value >> (i * 8)) & 0xff));
+    };
+
+    ByteArray wav;
+    wav.append("RIFF", 4);
+    writeLE(wav, 36 + frames * 4, 4);
+    wav.append("WAVEfmt ", 8);
+    writeLE(wav, 16, 4);
+    writeLE(wav, 1, 2);
+    writeLE(wav, 2, 2);
+    writeLE(wav, sampleRate, 4);
+    writeLE(wav, sampleRate * 4, 4);
+    writeLE(wav, 4, 2);
+    writeLE(wav, 16, 2);
+    wav.append("data", 4);
+    writeLE(wav, frames * 4, 4);
+    for (size_t f = 0; f < frames; ++f) {
+      int16_t sample = (f / 50) % 2 ? amplitude : -amplitude;
+      writeLE(wav, (uint16_t)sample, 2);
+      writeLE(wav, (uint16_t)sample, 2);
+    }
+
+    return Audio(make_shared<Buffer>(std::move(wav)));
+  }
+}
+
+TEST(MixerTest, MixesVoices) {
+  Mixer mixer(44100, 2);
+  auto audio = makeSquareWave(44100, 44100, 1000);
+
+  for (int i = 0; i < 4; ++i)
+    mixer.play(make_shared<AudioInstance>(audio));
+  mixer.update(0.0f);
+
+  List<int16_t> buffer(512 * 2);
+  mixer.read(buffer.ptr(), 512);
+  // Four voices of an identical square wave at full volume sum exactly.
+  EXPECT_EQ(buffer[0], -4000);
+  EXPECT_EQ(buffer[1], -4000);
+  EXPECT_EQ(buffer[100], 4000);
+
+  // The sum saturates instead of wrapping.
+  auto loud = makeSquareWave(44100, 44100, 20000);
+  for (int i = 0; i < 4; ++i)
+    mixer.play(make_shared<AudioInstance>(loud));
+  mixer.read(buffer.ptr(), 512);
+  EXPECT_EQ(buffer[0], -32767);
+}
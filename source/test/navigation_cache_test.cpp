@@ -0,0 +1,116 @@
+#include "StarFile.hpp"
+#include "StarPlatformerAStar.hpp"
+#include "StarWorldServer.hpp"
+#include "StarWorldTemplate.hpp"
+#include "StarWorldParameters.hpp"
+#include "StarBiome.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A small generated planet and a search across the ground near its player
+  // start, which is generated along with the world.
+  struct NavigationWorld {
+    NavigationWorld() {
+      auto worldTemplate = make_shared<WorldTemplate>(generateTerrestrialWorldParameters("garden", "small", 1234), SkyParameters(), 1234);
+      world = make_shared<WorldServer>(worldTemplate, File::ephemeralFile());
+
+      world->addClient(1, SpawnTarget(), false);
+      for (auto const& packet : world->getOutgoingPackets(1)) {
+        if (auto worldStart = as<WorldStartPacket>(packet))
+          start = worldStart->playerStart;
+      }
+      world->removeClient(1);
+    }
+
+    PlatformerAStar::PathFinder pathFinder() const {
+      return PlatformerAStar::PathFinder(world.get(), start, start + Vec2F(12, 0), ActorMovementParameters::sensibleDefaults());
+    }
+
+    // Runs a search to completion, so that it is shared through the cache.
+    bool search() const {
+      auto finder = pathFinder();
+      return *finder.explore();
+    }
+
+    WorldServerPtr world;
+    Vec2F start;
+  };
+}
+
+TEST(NavigationCacheTest, SharesResults) {
+  NavigationWorld navigation;
+  auto cache = navigation.world->navigationCache();
+  ASSERT_TRUE((bool)cache);
+
+  auto first = navigation.pathFinder();
+  auto found = first.explore();
+  ASSERT_TRUE(found.isValid());
+  EXPECT_EQ(cache->resultCount(), 1u);
+  EXPECT_GT(cache->expansionCount(), 0u);
+
+  // An identical search finds the finished one without exploring a node, and
+  // both hand out the same path.
+  auto second = navigation.pathFinder();
+  EXPECT_EQ(second.explore(0), found);
+  EXPECT_EQ(&second.result(), &first.result());
+  EXPECT_EQ(cache->resultCount(), 1u);
+
+  // A search with other limits has to explore for itself.
+  PlatformerAStar::Parameters parameters;
+  parameters.maxDistance = 30.0f;
+  PlatformerAStar::PathFinder limited(navigation.world.get(), navigation.start, navigation.start + Vec2F(12, 0), ActorMovementParameters::sensibleDefaults(), parameters);
+  EXPECT_FALSE(limited.explore(0).isValid());
+  EXPECT_TRUE(limited.explore().isValid());
+  EXPECT_EQ(cache->resultCount(), 2u);
+}
+
+TEST(NavigationCacheTest, InvalidatedByCollision) {
+  NavigationWorld navigation;
+  auto cache = navigation.world->navigationCache();
+  navigation.search();
+  ASSERT_EQ(cache->resultCount(), 1u);
+
+  // Breaking the block under the start dirties collision where the search
+  // began.
+  navigation.world->destroyBlock(TileLayer::Foreground, Vec2I::floor(navigation.start) - Vec2I(0, 1), false, false);
+  EXPECT_EQ(cache->resultCount(), 0u);
+
+  auto finder = navigation.pathFinder();
+  EXPECT_FALSE(finder.explore(0).isValid());
+}
+
+TEST(NavigationCacheTest, InvalidatedByTerraform) {
+  NavigationWorld navigation;
+  auto cache = navigation.world->navigationCache();
+  navigation.search();
+  ASSERT_EQ(cache->resultCount(), 1u);
+
+  // Adding a biome region flags the sectors under it for terraforming, which
+  // rewrites their tiles when they are next generated.
+  Vec2I position = Vec2I::floor(navigation.start);
+  auto worldTemplate = navigation.world->worldTemplate();
+  String biomeName = worldTemplate->environmentBiome(position[0], position[1])->baseName;
+  navigation.world->addBiomeRegion(position, biomeName, "largeClumps", 200);
+  navigation.world->generateRegion(RectI::withCenter(position, Vec2I(128, 128)));
+  EXPECT_EQ(cache->resultCount(), 0u);
+
+  auto finder = navigation.pathFinder();
+  EXPECT_FALSE(finder.explore(0).isValid());
+}
+
+TEST(NavigationCacheTest, InvalidatedByUnload) {
+  NavigationWorld navigation;
+  auto cache = navigation.world->navigationCache();
+  navigation.search();
+  ASSERT_EQ(cache->resultCount(), 1u);
+  ASSERT_GT(cache->expansionCount(), 0u);
+
+  // Shutting down the world unloads every sector, which must not leave
+  // anything behind for a world that loads them again.
+  navigation.world.reset();
+  EXPECT_EQ(cache->resultCount(), 0u);
+  EXPECT_EQ(cache->expansionCount(), 0u);
+}
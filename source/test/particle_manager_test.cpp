@@ -0,0 +1,99 @@
+#include "StarParticleManager.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A fully loaded, empty world with a solid floor along its bottom row and
+  // a pool of liquid in its left half.
+  ClientTileSectorArrayPtr makeTileArray(Vec2U const& size) {
+    auto tileArray = make_shared<ClientTileSectorArray>(size, true, false);
+    for (auto const& sector : tileArray->validSectorsFor(RectI(0, 0, size[0], size[1])))
+      tileArray->loadSector(sector, make_unique<ClientTileSectorArray::Array>());
+
+    for (int x = 0; x < (int)size[0]; ++x) {
+      for (int y = 0; y < (int)size[1]; ++y) {
+        auto tile = tileArray->modifyTile({x, y});
+        tile->collision = y == 0 ? CollisionKind::Block : CollisionKind::None;
+        if (y > 0 && y < 8 && x < (int)size[0] / 2)
+          tile->liquid = LiquidLevel(1, 1.0f);
+      }
+    }
+    return tileArray;
+  }
+
+  Particle makeParticle(Vec2F const& position, Vec2F const& velocity) {
+    Particle particle;
+    particle.type = Particle::Type::Ember;
+    particle.position = position;
+    particle.velocity = velocity;
+    particle.finalVelocity = velocity;
+    particle.timeToLive = 10.0f;
+    return particle;
+  }
+}
+
+TEST(ParticleManagerTest, Update) {
+  Vec2U worldSize(256, 256);
+  ParticleManager particleManager(WorldGeometry(worldSize, true, false), makeTileArray(worldSize));
+  RectF cullRegion(0, 0, 256, 256);
+
+  // Falls onto the floor, collides and then finishes its destruction.
+  particleManager.add(makeParticle({200.5f, 2.5f}, {0, -20}));
+  // Falls into the liquid and is destroyed immediately.
+  auto liquidParticle = makeParticle({10.5f, 10.5f}, {0, -40});
+  particleManager.add(liquidParticle);
+  // Outside the cull region and dropped.
+  particleManager.add(makeParticle({200.5f, 200.5f}, {}));
+  // Keeps flying and leaves a trail behind.
+  auto trailParticle = makeParticle({150.5f, 50.5f}, {1, 0});
+  trailParticle.trail = true;
+  particleManager.add(trailParticle);
+
+  particleManager.update(0.1f, RectF(0, 0, 256, 100), 0.0f);
+  ASSERT_EQ(particleManager.count(), 3u);
+  auto const& particles = particleManager.particles();
+  EXPECT_EQ(particles[0].velocity, Vec2F());
+  EXPECT_LE(particles[0].timeToLive, 0.0f);
+  EXPECT_TRUE(particles[1].trail);
+  EXPECT_FALSE(particles[2].trail);
+  EXPECT_EQ(particles[2].position, particles[1].position);
+
+  // Enough particles to be split into several batches agree with the same
+  // particles updated one at a time.
+  RandomSource random(4321);
+  List<Particle> many;
+  for (size_t i = 0; i < ParticleManager::UpdateBatchSize * 5 + 17; ++i)
+    many.append(makeParticle({random.randf(0, 256), random.randf(0, 256)}, {random.randf(-10, 10), random.randf(-10, 10)}));
+
+  auto tileArray = makeTileArray(worldSize);
+  ParticleManager batched(WorldGeometry(worldSize, true, false), tileArray);
+  batched.addParticles(many);
+  for (int step = 0; step < 20; ++step)
+    batched.update(0.05f, cullRegion, 1.0f);
+
+  ParticleManager single(WorldGeometry(worldSize, true, false), tileArray);
+  single.addParticles(many);
+  for (int step = 0; step < 20; ++step) {
+    // Updating in slices no larger than a batch never leaves the calling
+    // thread.
+    List<Particle> next;
+    auto current = single.particles();
+    for (size_t i = 0; i < current.size(); i += ParticleManager::UpdateBatchSize) {
+      ParticleManager slice(WorldGeometry(worldSize, true, false), tileArray);
+      slice.addParticles(current.slice(i, i + ParticleManager::UpdateBatchSize));
+      slice.update(0.05f, cullRegion, 1.0f);
+      next.appendAll(slice.particles());
+    }
+    single.clear();
+    single.addParticles(std::move(next));
+  }
+
+  ASSERT_EQ(batched.count(), single.count());
+  for (size_t i = 0; i < batched.count(); ++i) {
+    EXPECT_EQ(batched.particles()[i].position, single.particles()[i].position);
+    EXPECT_EQ(batched.particles()[i].timeToLive, single.particles()[i].timeToLive);
+  }
+}
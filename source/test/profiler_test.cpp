@@ -0,0 +1,95 @@
+#include "StarProfiler.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(ProfilerTest, Disabled) {
+  Profiler::reset();
+  Profiler::setEnabled(false);
+  {
+    ProfileScope scope("disabled");
+    scope.next("disabledNext");
+  }
+  EXPECT_TRUE(Profiler::stats("ProfilerTest").empty());
+  EXPECT_TRUE(Profiler::stats().filtered([](Profiler::PhaseStats const& s) { return s.phase.beginsWith("disabled"); }).empty());
+}
+
+TEST(ProfilerTest, PhasesAndGroups) {
+  Profiler::reset();
+  Profiler::setEnabled(true);
+
+  auto tick = [](String const& group, int ticks) {
+    Profiler::setThreadGroup(group);
+    for (int i = 0; i < ticks; ++i) {
+      ProfileScope scope("tick");
+      ProfileScope phase("first");
+      Profiler::record("recorded", Time::monotonicMicroseconds(), i);
+      phase.next("second");
+    }
+  };
+  // Other threads report under their own groups, and their phases are
+  // dropped once they exit.
+  auto other = Thread::invoke("ProfilerTest::other", tick, String("ProfilerTest other"), 10);
+  other.finish();
+  EXPECT_TRUE(Profiler::stats("ProfilerTest other").empty());
+
+  tick("ProfilerTest main", 1000);
+  Profiler::setEnabled(false);
+  auto stats = Profiler::stats("ProfilerTest");
+  auto trace = Profiler::chromeTrace();
+
+  StringMap<Profiler::PhaseStats> byPhase;
+  for (auto const& s : stats) {
+    EXPECT_EQ(s.group, String("ProfilerTest main"));
+    byPhase[s.phase] = s;
+  }
+  EXPECT_EQ(byPhase.keys().sorted(), StringList({"first", "recorded", "second", "tick"}));
+  for (auto const& pair : byPhase)
+    EXPECT_EQ(pair.second.count, 1000u);
+
+  // Durations 0 to 999 recorded exactly, percentiles are within a bucket.
+  auto const& recorded = byPhase.get("recorded");
+  EXPECT_EQ(recorded.total, 999 * 1000 / 2);
+  EXPECT_EQ(recorded.max, 999);
+  EXPECT_GE(recorded.p50, 499);
+  EXPECT_LE(recorded.p50, 499 * 5 / 4);
+  EXPECT_GE(recorded.p99, 989);
+  EXPECT_LE(recorded.p99, 999);
+
+  for (size_t i = 1; i < stats.size(); ++i)
+    EXPECT_GE(stats[i - 1].total, stats[i].total);
+
+  size_t traced = 0;
+  for (auto const& event : trace.get("traceEvents").iterateArray()) {
+    if (event.getString("ph") == "X" && event.getString("cat") == "ProfilerTest main")
+      ++traced;
+  }
+  EXPECT_EQ(traced, 4000u);
+
+  Profiler::reset();
+  EXPECT_TRUE(Profiler::stats("ProfilerTest").empty());
+}
+
+TEST(ProfilerTest, RingBuffer) {
+  Profiler::reset();
+  Profiler::setEnabled(true);
+  Profiler::setThreadGroup("ProfilerTest ring");
+  for (size_t i = 0; i < Profiler::RingSize + 100; ++i)
+    Profiler::record("ring", i, 1);
+  Profiler::setEnabled(false);
+
+  // Only the most recent phases are kept, oldest first, but every phase
+  // counts towards the histogram.
+  List<int64_t> starts;
+  for (auto const& event : Profiler::chromeTrace().get("traceEvents").iterateArray()) {
+    if (event.getString("ph") == "X" && event.getString("cat") == "ProfilerTest ring")
+      starts.append(event.getInt("ts"));
+  }
+  ASSERT_EQ(starts.size(), Profiler::RingSize);
+  EXPECT_EQ(starts.first(), 100);
+  EXPECT_EQ(starts.last(), (int64_t)Profiler::RingSize + 99);
+  EXPECT_EQ(Profiler::stats("ProfilerTest ring").first().count, Profiler::RingSize + 100);
+  Profiler::reset();
+}
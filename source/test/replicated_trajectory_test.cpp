@@ -0,0 +1,106 @@
+#include "StarReplicatedTrajectory.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  float const Gravity = 80.0f;
+  float const Timestep = 1.0f / 60.0f;
+
+  // Stands in for the master's movement controller: gravity, a little air
+  // friction the prediction knows nothing about, and a floor at y = 0 that
+  // it bounces off of.
+  struct Body {
+    // Returns true if it collided with the floor.
+    bool tick(WorldGeometry const& geometry) {
+      position += velocity * Timestep;
+      bool collided = false;
+      if (position[1] < 0.0f) {
+        position[1] = 0.0f;
+        velocity[1] = -velocity[1] * 0.5f;
+        collided = true;
+      }
+      velocity[1] -= Gravity * Timestep;
+      velocity *= 0.998f;
+      position = geometry.limit(position);
+      return collided;
+    }
+
+    Vec2F position;
+    Vec2F velocity;
+  };
+}
+
+TEST(ReplicatedTrajectoryTest, Prediction) {
+  ReplicatedTrajectory trajectory;
+  trajectory.reset(Vec2F(10, 20), Vec2F(30, 0));
+  trajectory.advance(Vec2F(0, -Gravity), Timestep);
+  EXPECT_LT(vmag(trajectory.position() - Vec2F(10.5f, 20.0f)), 0.0001f);
+  EXPECT_LT(vmag(trajectory.velocity() - Vec2F(30.0f, -Gravity * Timestep)), 0.0001f);
+}
+
+TEST(ReplicatedTrajectoryTest, CorrectsDivergence) {
+  WorldGeometry geometry(Vec2U(100, 1000), true, false);
+  Body master{Vec2F(90, 60), Vec2F(25, 30)};
+
+  ReplicatedTrajectory masterTrajectory(0.25f);
+  ReplicatedTrajectory slaveTrajectory(0.25f);
+  masterTrajectory.reset(master.position, master.velocity);
+  slaveTrajectory.reset(master.position, master.velocity);
+
+  unsigned ticks = 240;
+  unsigned corrections = 0;
+  unsigned collisions = 0;
+  float maxError = 0.0f;
+  for (unsigned i = 0; i < ticks; ++i) {
+    bool collided = master.tick(geometry);
+    masterTrajectory.advance(Vec2F(0, -Gravity), Timestep);
+    slaveTrajectory.advance(Vec2F(0, -Gravity), Timestep);
+
+    // Collisions are always sent, anything else once the prediction strays
+    // too far, and the slave takes the master's state as it is.
+    bool corrected = collided;
+    if (collided) {
+      ++collisions;
+      masterTrajectory.reset(master.position, master.velocity);
+    } else {
+      corrected = masterTrajectory.correct(geometry, master.position, master.velocity);
+    }
+    if (corrected) {
+      ++corrections;
+      slaveTrajectory.reset(master.position, master.velocity);
+    }
+
+    // Both ends predict the same path, even across the wrap point, and the
+    // slave never strays further than the tolerance.
+    EXPECT_EQ(slaveTrajectory.position(), masterTrajectory.position());
+    EXPECT_EQ(slaveTrajectory.velocity(), masterTrajectory.velocity());
+    float error = geometry.diff(slaveTrajectory.position(), master.position).magnitude();
+    EXPECT_LE(error, 0.25f);
+    maxError = max(maxError, error);
+  }
+
+  EXPECT_GT(collisions, 0u);
+  EXPECT_GT(corrections, collisions);
+  EXPECT_GT(maxError, 0.0f);
+  EXPECT_LT(corrections, ticks / 4);
+}
+
+TEST(ReplicatedTrajectoryTest, DivergesWithoutCorrections) {
+  WorldGeometry geometry(Vec2U(100, 1000), true, false);
+  Body master{Vec2F(50, 500), Vec2F(20, 0)};
+
+  ReplicatedTrajectory trajectory(0.25f);
+  trajectory.reset(master.position, master.velocity);
+  for (unsigned i = 0; i < 120; ++i) {
+    master.tick(geometry);
+    trajectory.advance(Vec2F(0, -Gravity), Timestep);
+  }
+
+  Vec2F predicted = trajectory.position();
+  EXPECT_GT(geometry.diff(predicted, master.position).magnitude(), 0.25f);
+  EXPECT_TRUE(trajectory.correct(geometry, master.position, master.velocity));
+  EXPECT_EQ(trajectory.position(), master.position);
+  EXPECT_FALSE(trajectory.correct(geometry, master.position, master.velocity));
+}
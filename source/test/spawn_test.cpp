@@ -1,6 +1,8 @@
 #include "StarAssets.hpp"
 #include "StarCelestialDatabase.hpp"
 #include "StarRoot.hpp"
+#include "StarSpawner.hpp"
+#include "StarRandom.hpp"
 
 #include "StarTestUniverse.hpp"
 #include "gtest/gtest.h"
@@ -46,3 +48,265 @@ TEST(SpawnTest, RandomInstanceWorld) {
   EXPECT_EQ(testUniverse.currentPlayerWorld(), instanceWorld);
   validateWorld(testUniverse);
 }
+
+namespace {
+  // A planet surface of rolling hills, with caves carved beneath it, a water
+  // table flooding the lower caves and scattered platforms, for exercising
+  // spawn cell evaluation without a running world.
+  class PlanetSpawnerFacade : public SpawnerFacade {
+  public:
+    struct Tile {
+      CollisionKind collision = CollisionKind::None;
+      bool backgroundEmpty = true;
+      float liquid = 0.0f;
+    };
+
+    PlanetSpawnerFacade(Vec2U const& size, uint64_t seed)
+      : m_geometry(size, true, false), m_tiles(size[0] * size[1]) {
+      RandomSource random(seed);
+      int width = size[0];
+      int height = size[1];
+
+      float phase1 = random.randf() * 2 * Constants::pi;
+      float phase2 = random.randf() * 2 * Constants::pi;
+      List<int> surface;
+      for (int x = 0; x < width; ++x) {
+        surface.append(height / 2 + (int)(30 * sin(x * 0.007f + phase1) + 6 * sin(x * 0.061f + phase2)));
+        for (int y = 0; y < height; ++y) {
+          auto& tile = modifyTile({x, y});
+          tile.collision = y < surface[x] ? CollisionKind::Block : CollisionKind::None;
+          tile.backgroundEmpty = y >= surface[x] + 2;
+        }
+      }
+
+      for (int i = 0; i < 600; ++i) {
+        Vec2I center(random.randInt(width - 1), random.randInt(height / 2 - 20));
+        Vec2I radius(random.randInt(4, 24), random.randInt(2, 8));
+        for (int x = -radius[0]; x <= radius[0]; ++x) {
+          for (int y = -radius[1]; y <= radius[1]; ++y) {
+            if (square(x / (float)radius[0]) + square(y / (float)radius[1]) <= 1.0f)
+              modifyTile(center + Vec2I(x, y)).collision = CollisionKind::None;
+          }
+        }
+      }
+
+      for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height / 2 - 40; ++y) {
+          auto& tile = modifyTile({x, y});
+          if (tile.collision == CollisionKind::None)
+            tile.liquid = 1.0f;
+        }
+      }
+
+      for (int i = 0; i < 400; ++i) {
+        Vec2I start(random.randInt(width - 1), random.randInt(height - 1));
+        for (int x = 0; x < 6; ++x) {
+          auto& tile = modifyTile(start + Vec2I(x, 0));
+          if (tile.collision == CollisionKind::None)
+            tile.collision = CollisionKind::Platform;
+        }
+      }
+    }
+
+    Tile& modifyTile(Vec2I const& position) {
+      Vec2I pos = m_geometry.xwrap(position);
+      pos[1] = clamp<int>(pos[1], 0, m_geometry.height() - 1);
+      return m_tiles[pos[1] * m_geometry.width() + pos[0]];
+    }
+
+    Tile const& tile(Vec2I const& position) const {
+      return const_cast<PlanetSpawnerFacade*>(this)->modifyTile(position);
+    }
+
+    WorldGeometry geometry() const override {
+      return m_geometry;
+    }
+
+    List<RectF> clientWindows() const override {
+      return windows;
+    }
+
+    bool signalRegion(RectF const&) const override {
+      return true;
+    }
+
+    bool isFreeSpace(RectF const&) const override {
+      return true;
+    }
+
+    CollisionKind collision(Vec2I const& position) const override {
+      return tile(position).collision;
+    }
+
+    bool isBackgroundEmpty(Vec2I const& position) const override {
+      return tile(position).backgroundEmpty;
+    }
+
+    LiquidLevel liquidLevel(Vec2I const& position) const override {
+      return LiquidLevel(1, tile(position).liquid);
+    }
+
+    bool spawningProhibited(RectF const&) const override {
+      return true;
+    }
+
+    uint64_t spawnSeed() const override {
+      return 0;
+    }
+
+    SpawnProfile spawnProfile(Vec2F const&) const override {
+      return {};
+    }
+
+    float dayLevel() const override {
+      return 1.0f;
+    }
+
+    float threatLevel() const override {
+      return 1.0f;
+    }
+
+    EntityId spawnEntity(EntityPtr) const override {
+      return NullEntityId;
+    }
+
+    EntityPtr getEntity(EntityId) const override {
+      return {};
+    }
+
+    void despawnEntity(EntityId) override {}
+
+    List<RectF> windows;
+
+  private:
+    WorldGeometry m_geometry;
+    List<Tile> m_tiles;
+  };
+
+  // Classifies a spawn cell by checking every tile and the tiles around it
+  // through the facade one at a time, as the spawner once did.
+  Maybe<SpawnParameters> scanSpawnCell(SpawnerFacade const& facade, Json const& config, Vec2I const& cellIndex) {
+    int cellSize = config.getInt("spawnCellSize");
+    unsigned nearSurfaceDistance = config.getUInt("spawnCellNearSurfaceDistance");
+    unsigned nearCeilingDistance = config.getUInt("spawnCellNearCeilingDistance");
+    float minimumLiquidLevel = config.getFloat("minimumLiquidLevel");
+
+    unsigned emptyCount = 0, nearSurfaceCount = 0, nearCeilingCount = 0, airCount = 0, liquidCount = 0, exposedCount = 0;
+    auto region = RectI::withSize(cellIndex * cellSize, Vec2I::filled(cellSize));
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        if (facade.collision({x, y}) != CollisionKind::None)
+          continue;
+
+        ++emptyCount;
+        if (facade.liquidLevel({x, y}).level > minimumLiquidLevel)
+          ++liquidCount;
+        if (facade.isBackgroundEmpty({x, y}))
+          ++exposedCount;
+
+        bool nearSurface = false;
+        for (unsigned sd = 1; sd <= nearSurfaceDistance && !nearSurface; ++sd) {
+          auto collision = facade.collision({x, y - (int)sd});
+          nearSurface = BlockCollisionSet.contains(collision) || collision == CollisionKind::Platform;
+        }
+        bool nearCeiling = false;
+        for (unsigned cd = 1; cd <= nearCeilingDistance && !nearSurface && !nearCeiling; ++cd)
+          nearCeiling = BlockCollisionSet.contains(facade.collision({x, y + (int)cd}));
+
+        if (nearSurface)
+          ++nearSurfaceCount;
+        else if (nearCeiling)
+          ++nearCeilingCount;
+        else
+          ++airCount;
+      }
+    }
+
+    Set<SpawnParameters::Area> spawnAreas;
+    if (liquidCount > config.getUInt("spawnCellMinimumLiquidTiles"))
+      spawnAreas.add(SpawnParameters::Area::Liquid);
+    if (nearSurfaceCount > config.getUInt("spawnCellMinimumNearSurfaceTiles"))
+      spawnAreas.add(SpawnParameters::Area::Surface);
+    if (nearCeilingCount > config.getUInt("spawnCellMinimumNearCeilingTiles"))
+      spawnAreas.add(SpawnParameters::Area::Ceiling);
+    if (airCount > config.getUInt("spawnCellMinimumAirTiles"))
+      spawnAreas.add(SpawnParameters::Area::Air);
+    if (emptyCount < config.getUInt("spawnCellMinimumEmptyTiles"))
+      spawnAreas.add(SpawnParameters::Area::Solid);
+    if (spawnAreas.empty())
+      return {};
+
+    auto spawnRegion = exposedCount >= config.getUInt("spawnCellMinimumExposedTiles")
+        ? SpawnParameters::Region::Exposed : SpawnParameters::Region::Enclosed;
+    return SpawnParameters(spawnAreas, spawnRegion, SpawnParameters::Time::Day);
+  }
+
+  void expectSameParameters(Maybe<SpawnParameters> const& a, Maybe<SpawnParameters> const& b, Vec2I const& cellIndex) {
+    ASSERT_EQ(a.isValid(), b.isValid()) << strf("cell {}", cellIndex);
+    if (a) {
+      EXPECT_EQ(a->areas, b->areas) << strf("cell {}", cellIndex);
+      EXPECT_EQ(a->region, b->region) << strf("cell {}", cellIndex);
+    }
+  }
+}
+
+TEST(SpawnTest, SpawnCells) {
+  auto config = Root::singleton().assets()->json("/spawning.config");
+  int cellSize = config.getInt("spawnCellSize");
+  auto facade = make_shared<PlanetSpawnerFacade>(Vec2U(cellSize * 40 + cellSize / 2, cellSize * 20), 1234);
+  Spawner spawner;
+  spawner.init(facade);
+
+  // Includes the cell that wraps around the edge of the world.
+  List<Vec2I> cells;
+  for (int x = 0; x <= 40; ++x) {
+    for (int y = 0; y < 20; ++y)
+      cells.append({x, y});
+  }
+  auto cellPosition = [&](Vec2I const& cell) {
+    return Vec2F(cell * cellSize) + Vec2F(0.5f, 0.5f);
+  };
+
+  for (auto const& cell : cells)
+    expectSameParameters(spawner.cellSpawnParameters(cellPosition(cell)), scanSpawnCell(*facade, config, cell), cell);
+
+  // Dig, build and flood, telling the spawner about each tile, and the cached
+  // cells still agree with a fresh scan.
+  RandomSource random(5678);
+  for (int i = 0; i < 5000; ++i) {
+    Vec2I position(random.randInt(facade->geometry().width() - 1), random.randInt(facade->geometry().height() - 1));
+    auto& tile = facade->modifyTile(position);
+    switch (random.randInt(3)) {
+      case 0:
+        tile.collision = tile.collision == CollisionKind::None ? CollisionKind::Block : CollisionKind::None;
+        spawner.tileModified(position);
+        break;
+      case 1:
+        tile.collision = CollisionKind::Platform;
+        spawner.tileModified(position);
+        break;
+      case 2:
+        tile.backgroundEmpty = !tile.backgroundEmpty;
+        spawner.tileModified(position);
+        break;
+      default:
+        tile.liquid = random.randf();
+        spawner.liquidModified(position);
+    }
+  }
+
+  for (auto const& cell : cells)
+    expectSameParameters(spawner.cellSpawnParameters(cellPosition(cell)), scanSpawnCell(*facade, config, cell), cell);
+
+  // Fill a whole block without reporting each tile, as sector generation
+  // does, and dropping the region brings the cells back in line.
+  RectI region = RectI::withSize(Vec2I(cellSize * 10 + 3, cellSize * 4 + 5), Vec2I(cellSize * 3, cellSize * 2));
+  for (int x = region.xMin(); x < region.xMax(); ++x) {
+    for (int y = region.yMin(); y < region.yMax(); ++y)
+      facade->modifyTile({x, y}).collision = CollisionKind::Block;
+  }
+  spawner.regionModified(region);
+
+  for (auto const& cell : cells)
+    expectSameParameters(spawner.cellSpawnParameters(cellPosition(cell)), scanSpawnCell(*facade, config, cell), cell);
+}
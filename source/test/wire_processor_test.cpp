@@ -0,0 +1,224 @@
+#include "StarWireProcessor.hpp"
+#include "StarWireEntity.hpp"
+#include "StarWorldStorage.hpp"
+#include "StarEntityMap.hpp"
+#include "StarFile.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A wire entity with a single input and a single output, which records what
+  // it read from its input the last time it was evaluated.
+  class TestWireEntity : public WireEntity {
+  public:
+    TestWireEntity(Vec2I const& tilePosition)
+      : m_tilePosition(tilePosition), m_output(false), m_input(false), m_evaluations(0) {}
+
+    EntityType entityType() const override {
+      return EntityType::Object;
+    }
+
+    RectF metaBoundBox() const override {
+      return RectF(0, 0, 1, 1);
+    }
+
+    Vec2I tilePosition() const override {
+      return m_tilePosition;
+    }
+
+    void setTilePosition(Vec2I const& tilePosition) override {
+      m_tilePosition = tilePosition;
+    }
+
+    bool checkBroken() override {
+      return false;
+    }
+
+    size_t nodeCount(WireDirection) const override {
+      return 1;
+    }
+
+    Vec2I nodePosition(WireNode) const override {
+      return {};
+    }
+
+    List<WireConnection> connectionsForNode(WireNode wireNode) const override {
+      return wireNode.direction == WireDirection::Input ? m_inputConnections : m_outputConnections;
+    }
+
+    bool nodeState(WireNode wireNode) const override {
+      return wireNode.direction == WireDirection::Output && m_output;
+    }
+
+    void addNodeConnection(WireNode wireNode, WireConnection nodeConnection) override {
+      auto& connections = wireNode.direction == WireDirection::Input ? m_inputConnections : m_outputConnections;
+      connections.append(nodeConnection);
+    }
+
+    void removeNodeConnection(WireNode wireNode, WireConnection nodeConnection) override {
+      auto& connections = wireNode.direction == WireDirection::Input ? m_inputConnections : m_outputConnections;
+      connections.remove(nodeConnection);
+    }
+
+    void evaluate(WireCoordinator* coordinator) override {
+      m_input = false;
+      for (auto const& connection : m_inputConnections)
+        m_input = m_input || coordinator->readInputConnection(connection);
+      ++m_evaluations;
+    }
+
+    void setOutput(bool output) {
+      m_output = output;
+    }
+
+    bool input() const {
+      return m_input;
+    }
+
+    unsigned evaluations() const {
+      return m_evaluations;
+    }
+
+  private:
+    Vec2I m_tilePosition;
+    List<WireConnection> m_inputConnections;
+    List<WireConnection> m_outputConnections;
+    bool m_output;
+    bool m_input;
+    unsigned m_evaluations;
+  };
+
+  // Never generates anything and never stores any entity, the entities here
+  // are only ever added to the entity map directly.
+  struct TestGeneratorFacade : WorldGeneratorFacade {
+    void generateSectorLevel(WorldStorage*, Sector const&, SectorGenerationLevel) override {}
+    void sectorLoadLevelChanged(WorldStorage*, Sector const&, SectorLoadLevel) override {}
+    void terraformSector(WorldStorage*, Sector const&) override {}
+    void initEntity(WorldStorage*, EntityId, EntityPtr const&) override {}
+    void destructEntity(WorldStorage*, EntityPtr const&) override {}
+    bool entityKeepAlive(WorldStorage*, EntityPtr const&) const override {
+      return false;
+    }
+    bool entityPersistent(WorldStorage*, EntityPtr const&) const override {
+      return false;
+    }
+    RpcPromise<Vec2I> enqueuePlacement(List<BiomeItemDistribution>, Maybe<DungeonId>) override {
+      return RpcPromise<Vec2I>::createFailed("no placements");
+    }
+  };
+
+  // Entities here are never handed to a world, init only needs the pointer
+  // to be set.
+  World* const NoWorld = (World*)&NoWorld;
+
+  struct WireWorld {
+    WireWorld() {
+      storage = make_shared<WorldStorage>(Vec2U(256, 256), true, false, File::ephemeralFile(), make_shared<TestGeneratorFacade>());
+      for (auto const& sector : storage->sectorsForRegion(RectI(0, 0, 256, 256)))
+        storage->loadSector(sector);
+      processor = make_shared<WireProcessor>(storage);
+    }
+
+    shared_ptr<TestWireEntity> add(Vec2I const& tilePosition) {
+      auto entity = make_shared<TestWireEntity>(tilePosition);
+      entity->init(NoWorld, storage->entityMap()->reserveEntityId(), EntityMode::Master);
+      storage->entityMap()->addEntity(entity);
+      processor->invalidate();
+      return entity;
+    }
+
+    void remove(shared_ptr<TestWireEntity> const& entity) {
+      storage->entityMap()->removeEntity(entity->entityId());
+      entity->uninit();
+      processor->invalidate();
+    }
+
+    // Wires the output of one entity to the input of another.
+    void connect(shared_ptr<TestWireEntity> const& output, shared_ptr<TestWireEntity> const& input) {
+      output->addNodeConnection({WireDirection::Output, 0}, {input->tilePosition(), 0});
+      input->addNodeConnection({WireDirection::Input, 0}, {output->tilePosition(), 0});
+      processor->invalidate();
+    }
+
+    void disconnect(shared_ptr<TestWireEntity> const& output, shared_ptr<TestWireEntity> const& input) {
+      output->removeNodeConnection({WireDirection::Output, 0}, {input->tilePosition(), 0});
+      input->removeNodeConnection({WireDirection::Input, 0}, {output->tilePosition(), 0});
+      processor->invalidate();
+    }
+
+    // Processes one step and returns the ids of every entity it evaluated.
+    HashSet<EntityId> process() {
+      processor->process();
+      return HashSet<EntityId>::from(processor->pullEvaluatedEntities());
+    }
+
+    WorldStoragePtr storage;
+    WireProcessorPtr processor;
+  };
+}
+
+TEST(WireProcessorTest, ConnectAndDisconnect) {
+  WireWorld world;
+  // The switch and the lamp are in different sectors.
+  auto wireSwitch = world.add(Vec2I(250, 10));
+  auto lamp = world.add(Vec2I(20, 10));
+  world.connect(wireSwitch, lamp);
+
+  // Every network is evaluated once when they are first built.
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId(), lamp->entityId()}));
+  EXPECT_FALSE(lamp->input());
+
+  wireSwitch->setOutput(true);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId(), lamp->entityId()}));
+  EXPECT_TRUE(lamp->input());
+
+  // Nothing changed, so nothing is evaluated.
+  EXPECT_TRUE(world.process().empty());
+  EXPECT_EQ(lamp->evaluations(), 2u);
+
+  // Once disconnected, both are evaluated as their own networks, and the lamp
+  // no longer sees the switch.
+  world.disconnect(wireSwitch, lamp);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId(), lamp->entityId()}));
+  EXPECT_FALSE(lamp->input());
+
+  // Changes to the switch only evaluate its own network now.
+  wireSwitch->setOutput(false);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId()}));
+  wireSwitch->setOutput(true);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId()}));
+  EXPECT_FALSE(lamp->input());
+  EXPECT_EQ(lamp->evaluations(), 3u);
+
+  // Connecting them again joins the networks.
+  world.connect(wireSwitch, lamp);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId(), lamp->entityId()}));
+  EXPECT_TRUE(lamp->input());
+}
+
+TEST(WireProcessorTest, AddAndRemoveEntities) {
+  WireWorld world;
+  auto lamp = world.add(Vec2I(100, 100));
+  EXPECT_EQ(world.process(), HashSet<EntityId>({lamp->entityId()}));
+  EXPECT_TRUE(world.process().empty());
+
+  // A newly added switch joins the lamp's network.
+  auto wireSwitch = world.add(Vec2I(104, 100));
+  wireSwitch->setOutput(true);
+  world.connect(wireSwitch, lamp);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({wireSwitch->entityId(), lamp->entityId()}));
+  EXPECT_TRUE(lamp->input());
+
+  // Once the switch is removed its network is dropped, and the lamp loses the
+  // connection to it.
+  world.remove(wireSwitch);
+  EXPECT_EQ(world.process(), HashSet<EntityId>({lamp->entityId()}));
+  EXPECT_FALSE(lamp->input());
+  EXPECT_TRUE(lamp->connectionsForNode({WireDirection::Input, 0}).empty());
+
+  wireSwitch->setOutput(false);
+  EXPECT_TRUE(world.process().empty());
+  EXPECT_EQ(wireSwitch->evaluations(), 1u);
+}
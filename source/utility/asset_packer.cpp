@@ -1,4 +1,5 @@
 #include "StarPackedAssetSource.hpp"
+#include "StarImageMetadataIndex.hpp"
 #include "StarTime.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarFile.hpp"
@@ -15,6 +16,7 @@ int main(int argc, char** argv) {
     optParse.addParameter("c", "configFile", OptionParser::Optional, "JSON file with ignore lists and ordering info");
     optParse.addSwitch("s", "Enable server mode");
     optParse.addSwitch("v", "Verbose, list each file added");
+    optParse.addSwitch("n", "Do not precompute the image metadata index");
     optParse.addArgument("assets folder path", OptionParser::Required, "Path to the assets to be packed");
     optParse.addArgument("output filename", OptionParser::Required, "Output pak file");
 
@@ -67,7 +69,19 @@ int main(int argc, char** argv) {
 
     outputFilename = File::relativeTo(File::fullPath(File::dirName(outputFilename)), File::baseName(outputFilename));
     DirectoryAssetSource directorySource(assetsFolderPath, ignoreFiles);
-    PackedAssetSource::build(directorySource, outputFilename, extensionOrdering, progressCallback);
+
+    List<pair<String, ByteArray>> generatedAssets;
+    if (!opts.switches.contains("n")) {
+      double indexStartTime = Time::monotonicTime();
+      auto imageCallback = [verbose](String const& assetPath) {
+        if (verbose)
+          coutf("Indexing image metadata for '{}'\n", assetPath);
+      };
+      generatedAssets.append({ImageMetadataIndex::IndexPath, ImageMetadataIndex::build(directorySource, imageCallback)});
+      coutf("Built image metadata index in {}s\n", Time::monotonicTime() - indexStartTime);
+    }
+
+    PackedAssetSource::build(directorySource, outputFilename, extensionOrdering, progressCallback, generatedAssets);
 
     coutf("Output packed assets to {} in {}s\n", outputFilename, Time::monotonicTime() - startTime);
     return 0;
@@ -0,0 +1,94 @@
+#include "StarRootLoader.hpp"
+#include "StarCelestialDatabase.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Replays bursts of clients arriving in the same neighbourhood of a fresh
+// universe, and reports how long each burst takes to be answered.
+
+// Every chunk in a small block of the universe and every system in it, the
+// way a handful of clients opening their navigation screens on the same
+// neighbourhood would ask for them.
+static List<CelestialRequest> neighbourhoodRequests(CelestialMasterDatabase& database) {
+  int chunkSize = database.baseInformation().chunkSize;
+  List<CelestialRequest> requests;
+  for (int x = 0; x < 3; ++x) {
+    for (int y = 0; y < 3; ++y)
+      requests.append(makeLeft(Vec2I(x, y)));
+  }
+  for (auto const& system : database.scanSystems(RectI(0, 0, chunkSize * 3, chunkSize * 3)))
+    requests.append(makeRight(system.location()));
+  return requests;
+}
+
+// Sends the requests from 'clients' simultaneous clients, each in its own
+// order, through a pool of threads like the universe server does, and waits
+// for every response.
+static void requestBurst(CelestialMasterDatabase& database, WorkerPool& workerPool,
+    List<CelestialRequest> const& requests, size_t clients, uint64_t seed) {
+  RandomSource random(seed);
+  List<WorkerPoolPromise<CelestialResponse>> promises;
+  for (size_t c = 0; c < clients; ++c) {
+    List<size_t> order;
+    for (size_t i = 0; i < requests.size(); ++i)
+      order.append(i);
+    random.shuffle(order);
+
+    for (size_t i : order) {
+      promises.append(workerPool.addProducer<CelestialResponse>([&database, request = requests[i]]() {
+          return database.respondToRequest(request);
+        }));
+    }
+  }
+
+  for (auto& promise : promises)
+    promise.get();
+}
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addParameter("threads", "threads", OptionParser::Optional, "number of worker threads answering requests, default 4");
+    rootLoader.addParameter("clients", "clients", OptionParser::Optional, "number of clients in each burst, default 16");
+    rootLoader.addParameter("bursts", "bursts", OptionParser::Optional, "number of bursts, each against a fresh universe, default 5");
+
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    unsigned threads = 4;
+    if (auto threadsOption = options.parameters.maybe("threads"))
+      threads = lexicalCast<unsigned>(threadsOption->first());
+
+    size_t clients = 16;
+    if (auto clientsOption = options.parameters.maybe("clients"))
+      clients = lexicalCast<size_t>(clientsOption->first());
+
+    int bursts = 5;
+    if (auto burstsOption = options.parameters.maybe("bursts"))
+      bursts = lexicalCast<int>(burstsOption->first());
+
+    CelestialMasterDatabase reference;
+    auto requests = neighbourhoodRequests(reference);
+
+    WorkerPool workerPool("CelestialBenchmark", threads);
+    int64_t elapsed = 0;
+    for (int i = 0; i < bursts; ++i) {
+      CelestialMasterDatabase database;
+      int64_t start = Time::monotonicMicroseconds();
+      requestBurst(database, workerPool, requests, clients, i);
+      elapsed += Time::monotonicMicroseconds() - start;
+    }
+
+    coutf("{} bursts of {} clients making {} requests each on {} threads: {:.2f}ms per burst\n",
+        bursts, clients, requests.size(), threads, elapsed / 1000.0 / bursts);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
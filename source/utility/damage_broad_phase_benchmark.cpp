@@ -0,0 +1,77 @@
+#include "StarDamageBroadPhase.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// A large fight: NPCs, monsters and turrets spread over a battlefield, with
+// projectiles and melee swings as damage sources around them.  Reports the
+// cost of finding the candidate pairs per tick against checking every source
+// against every target.
+
+static RectF randomRect(RandomSource& random, RectF const& region, float maxSize) {
+  Vec2F min(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+  return RectF::withSize(min, Vec2F(random.randf(0.5f, maxSize), random.randf(0.5f, maxSize)));
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 4) {
+      cerrf("Usage: {} [targets] [sources] [iterations]\n", argv[0]);
+      return 1;
+    }
+
+    int targetCount = argc > 1 ? lexicalCast<int>(argv[1]) : 600;
+    int sourceCount = argc > 2 ? lexicalCast<int>(argv[2]) : 3000;
+    int iterations = argc > 3 ? lexicalCast<int>(argv[3]) : 10;
+
+    WorldGeometry geometry(Vec2U(3000, 1000), true, false);
+    RectF battlefield(1000, 400, 1400, 500);
+    RandomSource random(1234);
+
+    List<RectF> targets;
+    for (int i = 0; i < targetCount; ++i)
+      targets.append(randomRect(random, battlefield, 5.0f));
+    List<RectF> sources;
+    for (int i = 0; i < sourceCount; ++i)
+      sources.append(randomRect(random, battlefield, 3.0f));
+
+    DamageBroadPhase broadPhase;
+    size_t gridPairs = 0;
+    int64_t start = Time::monotonicMicroseconds();
+    for (int i = 0; i < iterations; ++i) {
+      broadPhase.clear(geometry);
+      for (auto const& target : targets)
+        broadPhase.addTarget(target);
+      broadPhase.build();
+      for (auto const& source : sources)
+        broadPhase.forEachTarget(source, [&](size_t) { ++gridPairs; });
+    }
+    int64_t gridTime = Time::monotonicMicroseconds() - start;
+
+    size_t brutePairs = 0;
+    start = Time::monotonicMicroseconds();
+    for (int i = 0; i < iterations; ++i) {
+      for (auto const& source : sources) {
+        for (auto const& target : targets) {
+          if (geometry.rectIntersectsRect(target, source))
+            ++brutePairs;
+        }
+      }
+    }
+    int64_t bruteTime = Time::monotonicMicroseconds() - start;
+
+    if (gridPairs != brutePairs) {
+      cerrf("Broad phase found {} pairs, checking every pair found {}\n", gridPairs, brutePairs);
+      return 1;
+    }
+
+    coutf("{} sources against {} targets: {:.3f}ms per tick with the broad phase, {:.3f}ms checking every pair\n",
+        sources.size(), targets.size(), gridTime / 1000.0 / iterations, bruteTime / 1000.0 / iterations);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,140 @@
+#include "StarEntityMap.hpp"
+#include "StarSpatialHash2D.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Monsters, NPCs, items and projectiles moving about a world and being queried
+// for, the way a busy server does every tick.  Reports the cost against the
+// spatial hash the entity map used to be built on.
+
+class BenchmarkEntity : public Entity {
+public:
+  BenchmarkEntity(Vec2F const& position, RectF const& boundBox)
+    : m_position(position), m_boundBox(boundBox) {}
+
+  EntityType entityType() const override {
+    return EntityType::ItemDrop;
+  }
+
+  Vec2F position() const override {
+    return m_position;
+  }
+
+  RectF metaBoundBox() const override {
+    return m_boundBox;
+  }
+
+  void setPosition(Vec2F const& position) {
+    m_position = position;
+  }
+
+private:
+  Vec2F m_position;
+  RectF m_boundBox;
+};
+
+// Entities here are never handed to a world, init only needs the pointer to
+// be set.
+static World* const NoWorld = (World*)&NoWorld;
+
+static RectF randomRect(RandomSource& random, RectF const& region, float maxSize) {
+  Vec2F min(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+  return RectF::withSize(min, Vec2F(random.randf(0.5f, maxSize), random.randf(0.5f, maxSize)));
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 4) {
+      cerrf("Usage: {} [entities] [queries per tick] [ticks]\n", argv[0]);
+      return 1;
+    }
+
+    size_t entityCount = argc > 1 ? lexicalCast<size_t>(argv[1]) : 10000;
+    int queriesPerTick = argc > 2 ? lexicalCast<int>(argv[2]) : 2000;
+    int ticks = argc > 3 ? lexicalCast<int>(argv[3]) : 20;
+
+    Vec2U worldSize(3000, 1000);
+    WorldGeometry geometry(worldSize, true, false);
+    RectF populated(0, 300, 3000, 700);
+
+    RandomSource random(5678);
+    List<pair<Vec2F, RectF>> entityBounds;
+    for (size_t i = 0; i < entityCount; ++i) {
+      Vec2F size(random.randf(0.5f, 6.0f), random.randf(0.5f, 6.0f));
+      entityBounds.append({Vec2F(random.randf(populated.xMin(), populated.xMax()), random.randf(populated.yMin(), populated.yMax())), RectF(-size / 2, size / 2)});
+    }
+    List<Vec2F> movement;
+    for (size_t i = 0; i < entityCount * ticks; ++i)
+      movement.append(Vec2F(random.randf(-0.5f, 0.5f), random.randf(-0.5f, 0.5f)));
+    List<RectF> queries;
+    for (int i = 0; i < queriesPerTick; ++i)
+      queries.append(randomRect(random, populated, i % 100 == 0 ? 200.0f : 10.0f));
+
+    // Both sides get their own copy of the same entities, each moved by its
+    // entity id.
+    auto makeEntities = [&]() {
+      List<shared_ptr<BenchmarkEntity>> entities;
+      for (size_t i = 0; i < entityCount; ++i) {
+        entities.append(make_shared<BenchmarkEntity>(entityBounds[i].first, entityBounds[i].second));
+        entities.last()->init(NoWorld, i + 1, EntityMode::Master);
+      }
+      return entities;
+    };
+    auto move = [&](int tick, EntityPtr const& entity) {
+      auto benchmarkEntity = as<BenchmarkEntity>(entity);
+      benchmarkEntity->setPosition(geometry.xwrap(benchmarkEntity->position() + movement[tick * entityCount + entity->entityId() - 1]));
+    };
+
+    EntityMap entityMap(worldSize, true, false, 1, entityCount + 1);
+    for (auto const& entity : makeEntities())
+      entityMap.addEntity(entity);
+
+    size_t mapFound = 0;
+    int64_t start = Time::monotonicMicroseconds();
+    for (int t = 0; t < ticks; ++t) {
+      entityMap.updateAllEntities([&](EntityPtr const& entity) { move(t, entity); });
+      for (auto const& query : queries)
+        entityMap.forEachEntity(query, [&](EntityPtr const&) { ++mapFound; });
+    }
+    int64_t mapTime = Time::monotonicMicroseconds() - start;
+
+    // Updated and queried the way the entity map used to do it.
+    typedef SpatialHash2D<EntityId, float, EntityPtr> SpatialMap;
+    SpatialMap spatialMap(EntityMap::SectorSize);
+    for (auto const& entity : makeEntities())
+      spatialMap.set(entity->entityId(), geometry.splitRect(entity->metaBoundBox(), entity->position()), entity);
+
+    size_t hashFound = 0;
+    List<SpatialMap::Entry const*> entries;
+    start = Time::monotonicMicroseconds();
+    for (int t = 0; t < ticks; ++t) {
+      entries.clear();
+      for (auto const& entry : spatialMap.entries())
+        entries.append(&entry.second);
+      for (auto entry : entries) {
+        move(t, entry->value);
+        auto rects = geometry.splitRect(entry->value->metaBoundBox(), entry->value->position());
+        if (!containersEqual(rects, entry->rects))
+          spatialMap.set(entry->value->entityId(), rects);
+      }
+      for (auto const& query : queries)
+        spatialMap.forEach(geometry.splitRect(query), EntityCallback([&](EntityPtr const&) { ++hashFound; }));
+    }
+    int64_t hashTime = Time::monotonicMicroseconds() - start;
+
+    if (mapFound != hashFound) {
+      cerrf("Entity map found {} entities, spatial hash found {}\n", mapFound, hashFound);
+      return 1;
+    }
+
+    coutf("{} entities, {} queries per tick: {:.3f}ms per tick with the entity map, {:.3f}ms with a spatial hash\n",
+        entityCount, queriesPerTick, mapTime / 1000.0 / ticks, hashTime / 1000.0 / ticks);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
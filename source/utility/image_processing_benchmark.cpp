@@ -0,0 +1,72 @@
+#include "StarImageProcessing.hpp"
+#include "StarImage.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Measures applying a chain of image directives to a humanoid sized sprite
+// sheet one operation at a time, against the fused single pass that Assets
+// uses.
+
+static String const HumanoidDirectives =
+  "?replace;ffe2c5=f7d4b3;ffc181=d9a47a;d39c6c=b57d55;c7815b=9c5e3c"
+  "?replace;735335=5e3a21;402010=301808"
+  "?hueshift=-12?saturation=15?brightness=-8"
+  "?fade=ff0000=0.15?multiply=ffeeddff";
+
+// A small palette sprite with large transparent areas, roughly like a
+// humanoid body frame sheet.
+static Image makeSpriteSheet(unsigned width, unsigned height) {
+  List<Vec4B> palette = {
+    {0, 0, 0, 0}, {0xff, 0xe2, 0xc5, 0xff}, {0xff, 0xc1, 0x81, 0xff}, {0xd3, 0x9c, 0x6c, 0xff},
+    {0xc7, 0x81, 0x5b, 0xff}, {0x73, 0x53, 0x35, 0xff}, {0x40, 0x20, 0x10, 0x80}, {0x20, 0x20, 0x20, 0xff}
+  };
+
+  RandomSource random(1234);
+  Image image(width, height, PixelFormat::RGBA32);
+  image.forEachPixel([&](unsigned x, unsigned y, Vec4B& pixel) {
+    if ((x / 8 + y / 8) % 3 == 0)
+      pixel = palette[0];
+    else
+      pixel = palette[random.randu32() % palette.size()];
+  });
+  return image;
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 3) {
+      cerrf("Usage: {} [iterations] [directives]\n", argv[0]);
+      return 1;
+    }
+
+    int iterations = argc > 1 ? lexicalCast<int>(argv[1]) : 20;
+    String directives = argc > 2 ? String(argv[2]) : HumanoidDirectives;
+
+    Image source = makeSpriteSheet(387, 344);
+    auto operations = parseImageOperations(directives);
+
+    int64_t start = Time::monotonicMicroseconds();
+    for (int i = 0; i < iterations; ++i) {
+      Image image = source;
+      for (auto const& operation : operations)
+        processImageOperation(operation, image);
+    }
+    int64_t sequentialTime = Time::monotonicMicroseconds() - start;
+
+    start = Time::monotonicMicroseconds();
+    for (int i = 0; i < iterations; ++i)
+      processImageOperations(operations, source);
+    int64_t fusedTime = Time::monotonicMicroseconds() - start;
+
+    coutf("{} operations on a {}x{} image\n", operations.size(), source.width(), source.height());
+    coutf("sequential: {:.2f} ms per image\n", sequentialTime / 1000.0 / iterations);
+    coutf("fused: {:.2f} ms per image\n", fusedTime / 1000.0 / iterations);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
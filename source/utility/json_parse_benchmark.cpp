@@ -0,0 +1,110 @@
+#include "StarFile.hpp"
+#include "StarJsonBuilder.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Measures json parsing throughput over every json asset in an unpacked
+// assets directory, comparing the generic iterator parser against the UTF-8
+// buffer parser that Assets uses.
+
+static StringSet const NonJsonExtensions = {
+  "png", "ogg", "wav", "lua", "ttf", "otf", "woff2", "vert", "frag", "txt", "abc", "pak"
+};
+
+static void findFiles(String const& directory, StringList& files) {
+  for (auto const& entry : File::dirList(directory)) {
+    String path = File::relativeTo(directory, entry.first);
+    if (entry.second)
+      findFiles(path, files);
+    else if (!NonJsonExtensions.contains(entry.first.rsplit('.', 1).last().toLower()))
+      files.append(path);
+  }
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc < 2 || argc > 3) {
+      cerrf("Usage: {} <assets directory> [iterations]\n", argv[0]);
+      return 1;
+    }
+
+    String directory = argv[1];
+    int iterations = argc > 2 ? lexicalCast<int>(argv[2]) : 5;
+
+    StringList paths;
+    findFiles(directory, paths);
+
+    // Only files that the generic parser accepts count towards the benchmark,
+    // the buffer parser must then accept all of them.
+    StringList filePaths;
+    List<ByteArray> files;
+    List<String> strings;
+    size_t totalBytes = 0;
+    for (auto const& path : paths) {
+      ByteArray bytes = File::readFile(path);
+      String string(bytes.ptr(), bytes.size());
+      try {
+        inputUtf32Json<String::const_iterator>(string.begin(), string.end(), JsonParseType::Top);
+      } catch (std::exception const&) {
+        continue;
+      }
+      totalBytes += bytes.size();
+      filePaths.append(path);
+      files.append(std::move(bytes));
+      strings.append(std::move(string));
+    }
+    coutf("Parsing {} json files, {} bytes, {} times\n", files.size(), totalBytes, iterations);
+
+    StringList failures;
+    for (size_t f = 0; f < files.size(); ++f) {
+      try {
+        inputUtf8Json(files[f].ptr(), files[f].ptr() + files[f].size(), JsonParseType::Top);
+      } catch (std::exception const& e) {
+        failures.append(strf("'{}' is rejected by the buffer parser: {}", filePaths[f], e.what()));
+      }
+    }
+    if (!failures.empty()) {
+      for (auto const& failure : failures)
+        cerrf("{}\n", failure);
+      return 1;
+    }
+
+    int64_t start = Time::monotonicMicroseconds();
+    List<Json> generic(files.size());
+    for (int i = 0; i < iterations; ++i) {
+      for (size_t f = 0; f < strings.size(); ++f)
+        generic[f] = inputUtf32Json<String::const_iterator>(strings[f].begin(), strings[f].end(), JsonParseType::Top);
+    }
+    int64_t genericTime = Time::monotonicMicroseconds() - start;
+
+    start = Time::monotonicMicroseconds();
+    List<Json> buffer(files.size());
+    for (int i = 0; i < iterations; ++i) {
+      for (size_t f = 0; f < files.size(); ++f)
+        buffer[f] = inputUtf8Json(files[f].ptr(), files[f].ptr() + files[f].size(), JsonParseType::Top);
+    }
+    int64_t bufferTime = Time::monotonicMicroseconds() - start;
+
+    for (size_t f = 0; f < files.size(); ++f) {
+      if (generic[f] != buffer[f])
+        failures.append(strf("Parsers disagree on the contents of '{}'", filePaths[f]));
+    }
+    if (!failures.empty()) {
+      for (auto const& failure : failures)
+        cerrf("{}\n", failure);
+      return 1;
+    }
+
+    auto throughput = [&](int64_t micros) {
+      return (double)totalBytes * iterations / max<int64_t>(micros, 1);
+    };
+    coutf("generic: {:.1f} MB/s\n", throughput(genericTime));
+    coutf("buffer: {:.1f} MB/s\n", throughput(bufferTime));
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,79 @@
+#include "StarMixer.hpp"
+#include "StarBuffer.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Renders a busy scene of looping positional voices and reports the cost of
+// mixing relative to real time.
+
+// A stereo 16 bit PCM wav of a square wave, built in memory.
+static Audio makeSquareWave(unsigned sampleRate, size_t frames, int16_t amplitude) {
+  auto writeLE = [](ByteArray& bytes, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+      bytes.appendByte((char)((value >> (i * 8)) & 0xff));
+  };
+
+  ByteArray wav;
+  wav.append("RIFF", 4);
+  writeLE(wav, 36 + frames * 4, 4);
+  wav.append("WAVEfmt ", 8);
+  writeLE(wav, 16, 4);
+  writeLE(wav, 1, 2);
+  writeLE(wav, 2, 2);
+  writeLE(wav, sampleRate, 4);
+  writeLE(wav, sampleRate * 4, 4);
+  writeLE(wav, 4, 2);
+  writeLE(wav, 16, 2);
+  wav.append("data", 4);
+  writeLE(wav, frames * 4, 4);
+  for (size_t f = 0; f < frames; ++f) {
+    int16_t sample = (f / 50) % 2 ? amplitude : -amplitude;
+    writeLE(wav, (uint16_t)sample, 2);
+    writeLE(wav, (uint16_t)sample, 2);
+  }
+
+  return Audio(make_shared<Buffer>(std::move(wav)));
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 3) {
+      cerrf("Usage: {} [voices] [iterations]\n", argv[0]);
+      return 1;
+    }
+
+    int voices = argc > 1 ? lexicalCast<int>(argv[1]) : 128;
+    int iterations = argc > 2 ? lexicalCast<int>(argv[2]) : 200;
+    unsigned const sampleRate = 44100;
+    size_t const frames = 1024;
+
+    Mixer mixer(sampleRate, 2);
+    auto audio = makeSquareWave(sampleRate, sampleRate, 200);
+    for (int i = 0; i < voices; ++i) {
+      auto instance = make_shared<AudioInstance>(audio);
+      instance->setLoops(-1);
+      instance->setPosition(Vec2F(i * 4.0f, 0.0f));
+      instance->setPitchMultiplier(0.75f + (i % 8) * 0.0625f);
+      mixer.play(instance);
+    }
+    mixer.update(0.0f, [](unsigned channel, Vec2F position, float) {
+        return clamp(position[0] / 1024.0f + channel * 0.1f, 0.0f, 1.0f);
+      });
+
+    List<int16_t> buffer(frames * 2);
+    int64_t start = Time::monotonicMicroseconds();
+    for (int i = 0; i < iterations; ++i)
+      mixer.read(buffer.ptr(), frames);
+    int64_t elapsed = Time::monotonicMicroseconds() - start;
+
+    double audioSeconds = (double)frames * iterations / sampleRate;
+    coutf("Mixed {} voices, {:.2f}s of audio in {:.2f}ms ({:.1f}x real time)\n",
+        voices, audioSeconds, elapsed / 1000.0, audioSeconds * 1000000.0 / max<int64_t>(elapsed, 1));
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,75 @@
+#include "StarParticleManager.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+
+using namespace Star;
+
+// Updates a weather sized cloud of particles falling through a world with a
+// floor and a pool of liquid, and reports the cost per update.
+
+// A fully loaded, empty world with a solid floor along its bottom row and a
+// pool of liquid in its left half.
+static ClientTileSectorArrayPtr makeTileArray(Vec2U const& size) {
+  auto tileArray = make_shared<ClientTileSectorArray>(size, true, false);
+  for (auto const& sector : tileArray->validSectorsFor(RectI(0, 0, size[0], size[1])))
+    tileArray->loadSector(sector, make_unique<ClientTileSectorArray::Array>());
+
+  for (int x = 0; x < (int)size[0]; ++x) {
+    for (int y = 0; y < (int)size[1]; ++y) {
+      auto tile = tileArray->modifyTile({x, y});
+      tile->collision = y == 0 ? CollisionKind::Block : CollisionKind::None;
+      if (y > 0 && y < 8 && x < (int)size[0] / 2)
+        tile->liquid = LiquidLevel(1, 1.0f);
+    }
+  }
+  return tileArray;
+}
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 3) {
+      cerrf("Usage: {} [particles] [iterations]\n", argv[0]);
+      return 1;
+    }
+
+    size_t particleCount = argc > 1 ? lexicalCast<size_t>(argv[1]) : 50000;
+    int iterations = argc > 2 ? lexicalCast<int>(argv[2]) : 100;
+
+    Vec2U worldSize(1024, 256);
+    ParticleManager particleManager(WorldGeometry(worldSize, true, false), makeTileArray(worldSize));
+    RectF cullRegion(0, 0, 1024, 256);
+
+    RandomSource random(1234);
+    auto refill = [&]() {
+      List<Particle> particles;
+      while (particleManager.count() + particles.size() < particleCount) {
+        Particle particle;
+        particle.type = Particle::Type::Ember;
+        particle.position = Vec2F(random.randf(0, 1024), random.randf(8, 256));
+        particle.velocity = Vec2F(random.randf(-2, 2), -random.randf(5, 30));
+        particle.finalVelocity = particle.velocity;
+        particle.timeToLive = 10.0f;
+        particle.ignoreWind = false;
+        particle.trail = random.randf() < 0.05f;
+        particles.append(std::move(particle));
+      }
+      particleManager.addParticles(std::move(particles));
+    };
+
+    int64_t elapsed = 0;
+    for (int i = 0; i < iterations; ++i) {
+      refill();
+      int64_t start = Time::monotonicMicroseconds();
+      particleManager.update(1.0f / 60.0f, cullRegion, 3.0f);
+      elapsed += Time::monotonicMicroseconds() - start;
+    }
+
+    coutf("Updated {} particles {} times in {:.2f}ms ({:.3f}ms per update)\n",
+        particleCount, iterations, elapsed / 1000.0, elapsed / 1000.0 / iterations);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,354 @@
+#include "StarBuffer.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarFile.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarLogging.hpp"
+#include "StarMemoryTracker.hpp"
+#include "StarRandom.hpp"
+#include "StarRootLoader.hpp"
+#include "StarWorldServer.hpp"
+#include "StarWorldTemplate.hpp"
+#include "StarWorldParameters.hpp"
+#include "StarItemDrop.hpp"
+#include "StarMonster.hpp"
+#include "StarMonsterDatabase.hpp"
+#include "StarObject.hpp"
+#include "StarObjectDatabase.hpp"
+#include "StarLiquidsDatabase.hpp"
+
+using namespace Star;
+
+// Steps a WorldServer headlessly through a set of fixed scenarios, watched by
+// a number of simulated clients, and writes the results as JSON so that runs
+// before and after a change can be compared.  Scenarios are seeded, so every
+// run places the same things in the same places.
+
+struct BenchmarkSettings {
+  Maybe<String> worldFile;
+  String dungeon;
+  uint64_t seed;
+  WorldServerFidelity fidelity;
+  unsigned warmupTicks;
+  unsigned ticks;
+  unsigned repetitions;
+  unsigned clients;
+  unsigned scale;
+  String monsterType;
+  String itemName;
+  String liquidName;
+  String wireObject;
+};
+
+// What a scenario populates the world through.  The region is the area every
+// client is watching, centered on the player start.  Each populate function
+// adds the number of things it means to place to 'requested'.
+struct ScenarioContext {
+  WorldServer& world;
+  RandomSource& random;
+  RectI region;
+  ConnectionId client;
+  BenchmarkSettings const& settings;
+  size_t requested;
+};
+
+struct Scenario {
+  String name;
+  // Returns the number of things placed in the world.
+  function<size_t(ScenarioContext&)> populate;
+};
+
+static Vec2F randomPosition(RandomSource& random, RectI const& region) {
+  return Vec2F(random.randf(region.xMin(), region.xMax()), random.randf(region.yMin(), region.yMax()));
+}
+
+static size_t populateEntities(ScenarioContext& context) {
+  auto monsterDatabase = Root::singleton().monsterDatabase();
+  size_t count = 250 * context.settings.scale;
+  context.requested += count * 2;
+  for (size_t i = 0; i < count; ++i) {
+    auto monster = monsterDatabase->createMonster(monsterDatabase->monsterVariant(context.settings.monsterType, context.random.randu64()));
+    monster->setPosition(randomPosition(context.random, context.region));
+    context.world.addEntity(monster);
+
+    auto itemDrop = ItemDrop::createRandomizedDrop(ItemDescriptor(context.settings.itemName, 1), randomPosition(context.random, context.region));
+    context.world.addEntity(itemDrop);
+  }
+  return count * 2;
+}
+
+static size_t populateLiquids(ScenarioContext& context) {
+  LiquidId liquid = Root::singleton().liquidsDatabase()->liquidId(context.settings.liquidName);
+  size_t count = 2000 * context.settings.scale;
+  context.requested += count;
+  size_t placed = 0;
+  for (size_t attempt = 0; attempt < count * 20 && placed < count; ++attempt) {
+    Vec2I position = Vec2I::floor(randomPosition(context.random, context.region));
+    if (context.world.material(position, TileLayer::Foreground) == EmptyMaterialId) {
+      context.world.setLiquid(position, liquid, 1.0f, 1.0f);
+      ++placed;
+    }
+  }
+  return placed;
+}
+
+static size_t populateWiring(ScenarioContext& context) {
+  // A ring of wired objects, each output connected to the next input, so
+  // that with logic gates the signal keeps travelling around it.
+  auto objectDatabase = Root::singleton().objectDatabase();
+  size_t count = 50 * context.settings.scale;
+  context.requested += count;
+  List<ObjectPtr> objects;
+  for (size_t attempt = 0; attempt < count * 20 && objects.size() < count; ++attempt) {
+    Vec2I position = Vec2I::floor(randomPosition(context.random, context.region));
+    if (auto object = objectDatabase->createForPlacement(&context.world, context.settings.wireObject, position, Direction::Right)) {
+      if (object->nodeCount(WireDirection::Input) == 0 || object->nodeCount(WireDirection::Output) == 0)
+        throw StarException::format("Object '{}' does not have both wire inputs and outputs", context.settings.wireObject);
+      context.world.addEntity(object);
+      objects.append(object);
+    }
+  }
+
+  List<PacketPtr> packets;
+  for (size_t i = 0; i < objects.size(); ++i) {
+    auto const& next = objects[(i + 1) % objects.size()];
+    packets.append(make_shared<ConnectWirePacket>(WireConnection{objects[i]->tilePosition(), 0}, WireConnection{next->tilePosition(), 0}));
+  }
+  context.world.handleIncomingPackets(context.client, packets);
+  return objects.size();
+}
+
+static List<Scenario> const Scenarios = {
+  {"idle", [](ScenarioContext&) { return size_t(0); }},
+  {"entities", populateEntities},
+  {"liquids", populateLiquids},
+  {"wiring", populateWiring},
+  {"combined", [](ScenarioContext& context) {
+      return populateEntities(context) + populateLiquids(context) + populateWiring(context);
+    }}
+};
+
+static WorldServerPtr makeWorld(BenchmarkSettings const& settings) {
+  // Fixture worlds are copied into memory, so that every run starts from the
+  // same state and the file is never written to.
+  if (settings.worldFile)
+    return make_shared<WorldServer>(make_shared<Buffer>(File::readFile(*settings.worldFile)));
+
+  auto worldParameters = generateFloatingDungeonWorldParameters(settings.dungeon);
+  auto worldTemplate = make_shared<WorldTemplate>(worldParameters, SkyParameters(), settings.seed);
+  return make_shared<WorldServer>(worldTemplate, File::ephemeralFile());
+}
+
+// Allocations charged to the benchmark memory tag and its sub-tags, such as
+// the Lua heap of scripts run during a tick.  Only counted when memory
+// tracking is compiled in.
+static uint64_t benchmarkAllocations() {
+  uint64_t allocations = 0;
+  for (auto const& stats : MemoryTracker::stats()) {
+    if (stats.name == "benchmark" || stats.name.beginsWith("benchmark/"))
+      allocations += stats.allocations;
+  }
+  return allocations;
+}
+
+static JsonObject runScenario(Scenario const& scenario, BenchmarkSettings const& settings) {
+  Random::init(settings.seed);
+  RandomSource random(settings.seed);
+  auto world = makeWorld(settings);
+  world->setFidelity(settings.fidelity);
+
+  // Every client watches the same region around the player start.
+  List<ConnectionId> clients;
+  Maybe<Vec2F> playerStart;
+  for (unsigned i = 0; i < settings.clients; ++i) {
+    ConnectionId clientId = i + 1;
+    world->addClient(clientId, SpawnTarget(), false);
+    for (auto const& packet : world->getOutgoingPackets(clientId)) {
+      if (auto worldStart = as<WorldStartPacket>(packet))
+        playerStart = worldStart->playerStart;
+    }
+    clients.append(clientId);
+  }
+  RectI region = RectI::withCenter(Vec2I::floor(playerStart.value()), Vec2I(200, 100));
+
+  WorldClientState clientState;
+  clientState.setWindow(region);
+  ByteArray clientStateDelta = clientState.writeDelta();
+  for (auto clientId : clients)
+    world->handleIncomingPackets(clientId, {make_shared<WorldStartAcknowledgePacket>(), make_shared<WorldClientStateUpdatePacket>(clientStateDelta)});
+
+  // The region is generated and the world settled before anything is placed,
+  // so that placement sees the same tiles every run.
+  world->generateRegion(region);
+
+  float dt = ServerGlobalTimestep * GlobalTimescale;
+  DataStreamBuffer packetBuffer;
+  auto measurePackets = [&]() {
+    size_t bytes = 0;
+    for (auto clientId : clients) {
+      for (auto const& packet : world->getOutgoingPackets(clientId)) {
+        packetBuffer.clear();
+        packet->write(packetBuffer, NetCompatibilityRules());
+        bytes += packetBuffer.size();
+      }
+    }
+    return bytes;
+  };
+
+  for (unsigned i = 0; i < settings.warmupTicks; ++i) {
+    world->update(dt);
+    measurePackets();
+  }
+
+  ScenarioContext context{*world, random, region, clients.first(), settings, 0};
+  size_t populated = scenario.populate(context);
+  if (populated < context.requested)
+    throw StarException::format("Scenario '{}' only placed {} of {} things", scenario.name, populated, context.requested);
+
+  List<int64_t> tickTimes;
+  size_t packetBytes = 0;
+  auto benchmarkTag = MemoryTracker::tag("benchmark");
+  uint64_t allocationsBefore = benchmarkAllocations();
+  for (unsigned i = 0; i < settings.ticks; ++i) {
+    int64_t start = Time::monotonicMicroseconds();
+    {
+      MemoryTagScope tagScope(benchmarkTag);
+      world->update(dt);
+    }
+    tickTimes.append(Time::monotonicMicroseconds() - start);
+    packetBytes += measurePackets();
+  }
+  uint64_t allocations = benchmarkAllocations() - allocationsBefore;
+
+  size_t entities = 0;
+  world->forEachEntity(RectF(Vec2F(), Vec2F(world->geometry().size())), [&](EntityPtr const&) { ++entities; });
+
+  int64_t totalTime = 0;
+  for (auto time : tickTimes)
+    totalTime += time;
+  sort(tickTimes);
+  auto percentile = [&](double fraction) {
+    return tickTimes[min<size_t>(tickTimes.size() * fraction, tickTimes.size() - 1)] / 1000.0;
+  };
+
+  return JsonObject{
+    {"name", scenario.name},
+    {"populated", populated},
+    {"entities", entities},
+    {"ticks", settings.ticks},
+    {"ticks_per_second", settings.ticks / (totalTime / 1000000.0)},
+    {"mean_tick_ms", totalTime / 1000.0 / settings.ticks},
+    {"p50_tick_ms", percentile(0.5)},
+    {"p99_tick_ms", percentile(0.99)},
+    {"max_tick_ms", tickTimes.last() / 1000.0},
+    {"allocations_per_tick", MemoryTracker::enabled() ? Json((double)allocations / settings.ticks) : Json()},
+    {"packet_bytes_per_client_tick", (double)packetBytes / clients.size() / settings.ticks}
+  };
+}
+
+// The median of every measurement over the repetitions of a scenario.
+static JsonObject medianResult(List<JsonObject> const& repetitions) {
+  JsonObject median = repetitions.first();
+  median["name"] = strf("{}_median", repetitions.first().get("name").toString());
+  median["aggregate"] = "median";
+  for (auto& pair : median) {
+    if (pair.second.type() != Json::Type::Float)
+      continue;
+    List<double> values;
+    for (auto const& repetition : repetitions)
+      values.append(repetition.get(pair.first).toDouble());
+    sort(values);
+    pair.second = values[values.size() / 2];
+  }
+  return median;
+}
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addParameter("world", "world file", OptionParser::Optional, "fixture world file to run the scenarios in, instead of a dungeon world");
+    rootLoader.addParameter("dungeon", "dungeon", OptionParser::Optional, "dungeon world to run the scenarios in, defaults to testarena");
+    rootLoader.addParameter("seed", "seed", OptionParser::Optional, "seed for the world and the scenarios, defaults to 1234");
+    rootLoader.addParameter("fidelity", "server fidelity", OptionParser::Optional, "fidelity to run the server with, defaults to high");
+    rootLoader.addParameter("filter", "filter", OptionParser::Optional, "only run scenarios whose name contains this");
+    rootLoader.addParameter("warmup", "ticks", OptionParser::Optional, "ticks to run before populating and measuring, defaults to 120");
+    rootLoader.addParameter("ticks", "ticks", OptionParser::Optional, "ticks to measure, defaults to 1800");
+    rootLoader.addParameter("repetitions", "repetitions", OptionParser::Optional, "times to run each scenario, defaults to 1");
+    rootLoader.addParameter("clients", "clients", OptionParser::Optional, "simulated clients watching the scenario, defaults to 2");
+    rootLoader.addParameter("scale", "scale", OptionParser::Optional, "multiplier for the number of things each scenario places, defaults to 1");
+    rootLoader.addParameter("monster", "monster type", OptionParser::Optional, "monster type spawned by the entity scenarios, defaults to poptop");
+    rootLoader.addParameter("item", "item name", OptionParser::Optional, "item dropped by the entity scenarios, defaults to dirtmaterial");
+    rootLoader.addParameter("liquid", "liquid name", OptionParser::Optional, "liquid placed by the liquid scenarios, defaults to water");
+    rootLoader.addParameter("wireobject", "object name", OptionParser::Optional, "wired object placed by the wiring scenarios, defaults to notgate");
+    rootLoader.addParameter("output", "output file", OptionParser::Optional, "file to write the JSON results to, defaults to stdout");
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    auto parameter = [&](String const& name, String const& def) -> String {
+      if (auto values = options.parameters.ptr(name))
+        return values->first();
+      return def;
+    };
+
+    BenchmarkSettings settings;
+    if (options.parameters.contains("world"))
+      settings.worldFile = parameter("world", "");
+    settings.dungeon = parameter("dungeon", "testarena");
+    settings.seed = lexicalCast<uint64_t>(parameter("seed", "1234"));
+    settings.fidelity = WorldServerFidelityNames.getLeft(parameter("fidelity", "high"));
+    settings.warmupTicks = lexicalCast<unsigned>(parameter("warmup", "120"));
+    settings.ticks = max(lexicalCast<unsigned>(parameter("ticks", "1800")), 1u);
+    settings.repetitions = max(lexicalCast<unsigned>(parameter("repetitions", "1")), 1u);
+    settings.clients = max(lexicalCast<unsigned>(parameter("clients", "2")), 1u);
+    settings.scale = lexicalCast<unsigned>(parameter("scale", "1"));
+    settings.monsterType = parameter("monster", "poptop");
+    settings.itemName = parameter("item", "dirtmaterial");
+    settings.liquidName = parameter("liquid", "water");
+    settings.wireObject = parameter("wireobject", "notgate");
+    String filter = parameter("filter", "");
+
+    cerrf("Fully loading root...");
+    root->fullyLoad();
+    cerrf(" done\n");
+
+    JsonArray results;
+    for (auto const& scenario : Scenarios) {
+      if (!scenario.name.contains(filter))
+        continue;
+
+      List<JsonObject> repetitions;
+      for (unsigned i = 0; i < settings.repetitions; ++i) {
+        cerrf("Running scenario '{}' ({}/{})\n", scenario.name, i + 1, settings.repetitions);
+        repetitions.append(runScenario(scenario, settings));
+        repetitions.last()["repetition"] = i;
+        results.append(repetitions.last());
+      }
+      if (repetitions.size() > 1)
+        results.append(medianResult(repetitions));
+    }
+
+    Json report = JsonObject{
+      {"context", JsonObject{
+        {"date", Time::printCurrentDateAndTime()},
+        {"world", settings.worldFile ? *settings.worldFile : strf("dungeon:{}", settings.dungeon)},
+        {"seed", settings.seed},
+        {"fidelity", WorldServerFidelityNames.getRight(settings.fidelity)},
+        {"warmup_ticks", settings.warmupTicks},
+        {"ticks", settings.ticks},
+        {"clients", settings.clients},
+        {"scale", settings.scale}
+      }},
+      {"benchmarks", std::move(results)}
+    };
+
+    if (auto output = options.parameters.ptr("output"))
+      File::writeFile(report.repr(2), output->first());
+    else
+      coutf("{}\n", report.repr(2));
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}